@@ -1,9 +1,66 @@
 #include "core/AlarmConfig.h"
-#include "hal/WifiModule.h"
+#include <core/Log.h>
 #include <ArduinoJson.h>
+#include "core/Events.h"
 
 extern WifiModule wifi;
 
+namespace {
+
+// ArduinoJson reader that stops after `limit` bytes, so an oversized body
+// fails the parse instead of being read to the end.
+class BoundedReader {
+  public:
+    BoundedReader(Stream& stream, size_t limit) : _stream(stream), _remaining(limit), _exhausted(false) {}
+
+    int read() {
+      if (_remaining == 0) {
+        _exhausted = true;
+        return -1;
+      }
+      // readBytes() waits up to the stream timeout; read() would give up on a slow socket
+      char c;
+      if (_stream.readBytes(&c, 1) != 1) return -1;
+      _remaining--;
+      return (uint8_t)c;
+    }
+
+    size_t readBytes(char* buffer, size_t length) {
+      if (length > _remaining) {
+        length = _remaining;
+        if (length == 0) {
+          _exhausted = true;
+          return 0;
+        }
+      }
+      size_t n = _stream.readBytes(buffer, length);
+      _remaining -= n;
+      return n;
+    }
+
+    bool exhausted() const { return _exhausted; }
+
+  private:
+    Stream& _stream;
+    size_t  _remaining;
+    bool    _exhausted;
+};
+
+// Extract one alarm entry; hour and minute are required, days defaults to every day.
+bool parseEntry(JsonObjectConst alarm, uint8_t& hour, uint8_t& minute, uint8_t& days) {
+  if (!alarm["hour"].is<int>() || !alarm["minute"].is<int>()) return false;
+  int h = alarm["hour"];
+  int m = alarm["minute"];
+  int d = alarm["days"] | (int)AlarmScheduler::EVERY_DAY;
+  if (h < 0 || h > 23 || m < 0 || m > 59 || d <= 0 || d > AlarmScheduler::EVERY_DAY) return false;
+  hour = h;
+  minute = m;
+  days = d;
+  return true;
+}
+
+}  // namespace
+
 AlarmConfig::AlarmConfig(AlarmScheduler& scheduler,
                          const char* serverHost,
                          uint16_t serverPort,
@@ -14,52 +71,165 @@ AlarmConfig::AlarmConfig(AlarmScheduler& scheduler,
   , _port(serverPort)
   , _path(endpointPath)
   , _period(refreshPeriod)
-  , _lastFetch(0)
-{}
+  , _pending(WifiModule::INVALID_HANDLE)
+  , _fetches(0)
+  , _refresh(*this)
+{
+  _applied.count = 0;
+}
 
 void AlarmConfig::begin() {
   if (fetchAlarm()) {
-    Serial.println("Initial alarm fetched.");
+    LOG_INFO("Initial alarm fetched.");
   } else {
-    Serial.println("Initial alarm fetch failed.");
+    LOG_WARN("Initial alarm fetch failed.");
   }
 }
 
-void AlarmConfig::update() {
-  unsigned long now = millis();
-  if (now - _lastFetch >= _period) {
-    _lastFetch = now;
-    if (fetchAlarm()) {
-      Serial.println("Alarm re-fetched successfully.");
-    } else {
-      Serial.println("Alarm re-fetch failed.");
-    }
+void AlarmConfig::refresh() {
+  if (wifi.state(_pending) != WifiModule::Unknown) return;  // the last one is still running
+
+  // The body is parsed as it arrives; only the schedule comes back to loop()
+  HttpRequest request = HttpRequest::get(_host, _port, _path);
+  request.handler = &_refresh;
+  _pending = wifi.submit(request, _onFetched, this);
+  if (_pending == WifiModule::INVALID_HANDLE) {
+    LOG_WARN("Alarm re-fetch not queued.");
   }
 }
+
+void AlarmConfig::_onFetched(void* self, const HttpResponse& response) {
+  AlarmConfig* config = static_cast<AlarmConfig*>(self);
+  config->_pending = WifiModule::INVALID_HANDLE;
+
+  if (response.status == 200) {
+    config->_fetches++;
+    config->_apply(config->_refresh.schedule);
+    LOG_INFO("Alarm re-fetched successfully.");
+  } else {
+    LOG_WARN("Alarm re-fetch failed: HTTP %d", response.status);
+  }
+}
+
+bool AlarmConfig::Refresh::onResponse(int status, Stream& body, int contentLength) {
+  return _config._parse(status, body, contentLength, schedule);
+}
+
 bool AlarmConfig::fetchAlarm() {
-  Serial.println("Fetching remote alarm…");
+  LOG_DEBUG("Fetching remote alarm…");
+
+  // Body is parsed and applied inside onResponse() while it is being received
+  int status = wifi.httpGetStream(_host, _port, _path, *this);
+  if (status != 200) {
+    LOG_WARN("Failed to fetch alarm: HTTP %d", status);
+    return false;
+  }
+  return true;
+}
+
+bool AlarmConfig::onResponse(int status, Stream& body, int contentLength) {
+  Schedule schedule;
+  if (!_parse(status, body, contentLength, schedule)) return false;
+  _fetches++;
+  _apply(schedule);
+  return true;
+}
 
-  // 1) Perform HTTP GET via WifiModule
-  String body;
-  int status = wifi.httpGet(_host, _port, _path, body);
+bool AlarmConfig::_parse(int status, Stream& body, int contentLength, Schedule& schedule) const {
+  // 1) Reject anything that is not a reasonably sized success before reading it
   if (status != 200) {
-    Serial.printf("Failed to fetch alarm: HTTP %d\n", status);
+    return false;
+  }
+  if (contentLength > (int)MAX_BODY_BYTES) {
+    LOG_WARN("Alarm config too large: %d bytes", contentLength);
+    return false;
+  }
+
+  // 2) Parse JSON from the socket, keeping only the fields we use
+  // Sized by shape, not bytes: slots are twice as large in the 64-bit host builds
+  StaticJsonDocument<JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(3)> filter;
+  filter["hour"] = true;
+  filter["minute"] = true;
+  filter["alarms"][0]["hour"] = true;
+  filter["alarms"][0]["minute"] = true;
+  filter["alarms"][0]["days"] = true;
+  if (filter.overflowed()) {
+    LOG_ERROR("Alarm config filter does not fit");
     return false;
   }
 
-  // 2) Parse JSON response
-  StaticJsonDocument<128> doc;
-  auto err = deserializeJson(doc, body);
+  StaticJsonDocument<JSON_ARRAY_SIZE(AlarmScheduler::MAX_ALARMS) +
+                     AlarmScheduler::MAX_ALARMS * JSON_OBJECT_SIZE(3) +
+                     JSON_OBJECT_SIZE(3) + 64> doc;
+  BoundedReader reader(body, MAX_BODY_BYTES);
+  auto err = deserializeJson(doc, reader,
+                             DeserializationOption::Filter(filter),
+                             DeserializationOption::NestingLimit(MAX_NESTING));
+  if (reader.exhausted()) {
+    LOG_WARN("Alarm config too large: body limit reached");
+    return false;
+  }
   if (err) {
-    Serial.print("JSON parse failed: ");
-    Serial.println(err.c_str());
+    LOG_WARN("JSON parse failed: %s", err.c_str());
     return false;
   }
+  if (doc.overflowed()) {
+    LOG_WARN("Alarm config too large: too many alarms");
+    return false;
+  }
+
+  // 3) Validate every entry before touching the schedule
+  Schedule::Entry* entries = schedule.entries;
+  uint8_t count = 0;
+
+  JsonArrayConst alarms = doc["alarms"];
+  if (!alarms.isNull()) {
+    if (alarms.size() > AlarmScheduler::MAX_ALARMS) {
+      LOG_WARN("Alarm config has %u alarms, max %u",
+               (unsigned)alarms.size(), AlarmScheduler::MAX_ALARMS);
+      return false;
+    }
+    for (JsonObjectConst alarm : alarms) {
+      if (!parseEntry(alarm, entries[count].hour, entries[count].minute, entries[count].days)) {
+        LOG_WARN("Alarm config has an invalid entry");
+        return false;
+      }
+      count++;
+    }
+  } else {
+    if (!parseEntry(doc.as<JsonObjectConst>(), entries[0].hour, entries[0].minute, entries[0].days)) {
+      LOG_WARN("Alarm config missing hour/minute");
+      return false;
+    }
+    count = 1;
+  }
+  schedule.count = count;
+  return true;
+}
+
+void AlarmConfig::_apply(const Schedule& schedule) {
+  if (_unchanged(schedule)) return;
+
+  const Schedule::Entry* entries = schedule.entries;
+  _scheduler.clearAlarms();
+  for (uint8_t i = 0; i < schedule.count; i++) {
+    LOG_INFO("Received alarm %02u:%02u (days 0x%02x)",
+             entries[i].hour, entries[i].minute, entries[i].days);
+    _scheduler.addAlarm(entries[i].hour, entries[i].minute, entries[i].days);
+  }
+  _applied = schedule;
+  // An emptied schedule is a change too; its first alarm reads 00:00
+  AppBus::post(ConfigUpdate{schedule.count,
+                            schedule.count ? entries[0].hour : (uint8_t)0,
+                            schedule.count ? entries[0].minute : (uint8_t)0});
+}
 
-  // 3) Extract hour & minute and apply
-  uint8_t h = doc["hour"];
-  uint8_t m = doc["minute"];
-  Serial.printf("Received alarm %02u:%02u\n", h, m);
-  _scheduler.setAlarm(h, m);
+bool AlarmConfig::_unchanged(const Schedule& schedule) const {
+  if (schedule.count != _applied.count) return false;
+  for (uint8_t i = 0; i < schedule.count; i++) {
+    const Schedule::Entry& a = schedule.entries[i];
+    const Schedule::Entry& b = _applied.entries[i];
+    if (a.hour != b.hour || a.minute != b.minute || a.days != b.days) return false;
+  }
   return true;
-}
\ No newline at end of file
+}
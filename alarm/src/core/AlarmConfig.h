@@ -6,13 +6,30 @@
 #include <HttpClient.h>
 #include <ArduinoJson.h>
 #include <core/AlarmScheduler.h>
+#include <hal/WifiModule.h>
 
 /**
- * AlarmConfig periodically fetches an alarm time (hour & minute) from
- * a REST endpoint and reprograms an AlarmScheduler.
+ * AlarmConfig periodically fetches the alarm schedule from a REST endpoint
+ * and reprograms an AlarmScheduler.
+ *
+ * The response is parsed straight from the socket with an ArduinoJson filter,
+ * so only the fields below are kept and no String copy of the body is made:
+ *   {"alarms":[{"hour":7,"minute":30,"days":62}, ...]}   (days: optional weekday mask)
+ *   {"hour":7,"minute":30}                               (legacy single alarm)
+ * Bodies larger than MAX_BODY_BYTES, nested deeper than MAX_NESTING, with more
+ * than AlarmScheduler::MAX_ALARMS entries or with invalid times are rejected
+ * and leave the current schedule untouched.
+ *
+ * begin() fetches synchronously, so setup() starts with a schedule.
+ * refresh() only queues the request on WifiModule. Its response is parsed
+ * on the request task, and the schedule applied from WifiModule::dispatch(),
+ * so loop() keeps running meanwhile.
  */
-class AlarmConfig {
+class AlarmConfig : public ResponseHandler {
   public:
+    static const size_t  MAX_BODY_BYTES = 2048;
+    static const uint8_t MAX_NESTING    = 4;
+
     /**
      * @param scheduler      Reference to AlarmScheduler instance.
      * @param serverHost     The host (IP or domain) of alarm‐config API.
@@ -29,17 +46,57 @@ class AlarmConfig {
     /** Call once in setup() after Wi-Fi is up and time is synced. */
     void begin();
 
-    /** Call from loop() to do periodic fetch + re-set. */
-    void update();
+    /** Queue a fetch of the schedule; run it every period() from a timer job. */
+    void refresh();
+
+    /** Configured refresh period in ms. */
+    unsigned long period() const { return _period; }
+
+    /** True while a refresh() is queued or running; cleared when its completion is dispatched. */
+    bool refreshing() const { return _pending != WifiModule::INVALID_HANDLE; }
+
+    /** Fetches answered with a valid schedule since boot, empty or unchanged ones included. */
+    uint32_t fetches() const { return _fetches; }
 
   private:
+    // A parsed and validated schedule
+    struct Schedule {
+      struct Entry { uint8_t hour, minute, days; };
+      Entry   entries[AlarmScheduler::MAX_ALARMS];
+      uint8_t count;
+    };
+
+    // The handler of refresh()'s request: parses on the request task, leaves applying to _onFetched()
+    class Refresh : public ResponseHandler {
+      public:
+        explicit Refresh(AlarmConfig& config) : _config(config) {}
+        bool onResponse(int status, Stream& body, int contentLength) override;
+        Schedule schedule;
+
+      private:
+        AlarmConfig& _config;
+    };
+
     AlarmScheduler& _scheduler;
     const char*     _host;
     uint16_t        _port;
     const char*     _path;
     unsigned long   _period;
-    unsigned long   _lastFetch;
+    WifiModule::Handle _pending;   // refresh() in flight
+    uint32_t        _fetches;
+    Refresh         _refresh;
+    Schedule        _applied;      // what the scheduler was last programmed with
     bool            fetchAlarm();  // returns true if successfully fetched+set
+
+    static void _onFetched(void* self, const HttpResponse& response);
+
+    bool _parse(int status, Stream& body, int contentLength, Schedule& schedule) const;
+    void _apply(const Schedule& schedule);   // reprograms the scheduler and posts ConfigUpdate on a change only
+    bool _unchanged(const Schedule& schedule) const;
+
+    // ResponseHandler: parse the schedule as it streams in, then apply it.
+    // Reachable through a ResponseHandler& so host tools can feed it bodies they received themselves.
+    bool onResponse(int status, Stream& body, int contentLength) override;
 };
 
 #endif
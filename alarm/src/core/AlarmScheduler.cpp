@@ -1,48 +1,82 @@
 #include "AlarmScheduler.h"
+#include <core/Log.h>
 
-AlarmScheduler::AlarmScheduler() : _alarmSet(false), _alarmTriggered(false), _callback(nullptr) {
+AlarmScheduler::AlarmScheduler() : _count(0) {
 }
 
 void AlarmScheduler::setAlarm(uint8_t hour, uint8_t minute) {
-  _alarmHour = hour;
-  _alarmMinute = minute;
-  _alarmSet = true;
-  _alarmTriggered = false;
-  Serial.print("Alarm set for ");
-  Serial.print(hour);
-  Serial.print(":");
-  Serial.println(minute);
+  clearAlarms();
+  addAlarm(hour, minute);
 }
 
-void AlarmScheduler::setCallback(AlarmCallback callback) {
-  _callback = callback;
+void AlarmScheduler::clearAlarms() {
+  _count = 0;
+}
+
+bool AlarmScheduler::addAlarm(uint8_t hour, uint8_t minute, uint8_t days) {
+  if (hour > 23 || minute > 59 || _count >= MAX_ALARMS)
+    return false;
+
+  _alarms[_count] = { hour, minute, (uint8_t)(days & EVERY_DAY), false };
+  _count++;
+  LOG_INFO("Alarm set for %u:%u", hour, minute);
+  return true;
+}
+
+bool AlarmScheduler::nextAlarm(const struct tm& now, uint8_t& hour, uint8_t& minute, uint8_t& daysAhead,
+                               bool includeNow) const {
+  const uint16_t minutesPerDay = 24 * 60;
+  uint16_t nowMinute = now.tm_hour * 60 + now.tm_min;
+  uint16_t best = 0xFFFF;  // minutes from now
+
+  for (uint8_t i = 0; i < _count; i++) {
+    const Alarm& alarm = _alarms[i];
+    uint16_t at = alarm.hour * 60 + alarm.minute;
+    // Today only counts if the alarm is still ahead; a full week later covers "same time next week"
+    for (uint8_t d = 0; d <= 7; d++) {
+      if (!(alarm.days & (1 << ((now.tm_wday + d) % 7)))) continue;
+      if (d == 0 && at < nowMinute) continue;
+      if (d == 0 && at == nowMinute && (!includeNow || alarm.triggered)) continue;
+      uint16_t delta = d * minutesPerDay + at - nowMinute;
+      if (delta < best) {
+        best = delta;
+        hour = alarm.hour;
+        minute = alarm.minute;
+        daysAhead = (nowMinute + delta) / minutesPerDay;
+      }
+      break;
+    }
+  }
+  return best != 0xFFFF;
 }
 
 void AlarmScheduler::checkAlarm() {
-  if (!_alarmSet)
+  if (_count == 0)
     return; // No alarm has been set.
 
   struct tm timeinfo;
   if (!getLocalTime(&timeinfo)) {
-    Serial.println("Failed to obtain time");
+    LOG_WARN("Failed to obtain time");
     return;
   }
 
   uint8_t currentHour = timeinfo.tm_hour;
   uint8_t currentMinute = timeinfo.tm_min;
+  uint8_t today = 1 << timeinfo.tm_wday;
 
-  // If the current time equals the alarm time
-  if ((currentHour == _alarmHour) && (currentMinute == _alarmMinute)) {
-    // and haven’t yet triggered an alarm during the current minute
-    if (!_alarmTriggered) {
-      Serial.println("Alarm triggered!");
-      _alarmTriggered = true;
-      if (_callback) {
-        _callback();
+  for (uint8_t i = 0; i < _count; i++) {
+    Alarm& alarm = _alarms[i];
+    // If the current time equals the alarm time on one of its days
+    if ((alarm.days & today) && currentHour == alarm.hour && currentMinute == alarm.minute) {
+      // and haven’t yet triggered this alarm during the current minute
+      if (!alarm.triggered) {
+        LOG_INFO("Alarm triggered!");
+        alarm.triggered = true;
+        AppBus::post(AlarmEvent{alarm.hour, alarm.minute});
       }
+    } else {
+      // Reset trigger flag when the alarm minute has passed.
+      alarm.triggered = false;
     }
-  } else {
-    // Reset trigger flag when the alarm minute has passed.
-    _alarmTriggered = false;
   }
 }
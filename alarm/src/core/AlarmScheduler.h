@@ -3,39 +3,65 @@
 
 #include <Arduino.h>
 #include <time.h>
-
-// Define the type for the alarm callback function.
-typedef void (*AlarmCallback)();
+#include <core/Events.h>
 
 class AlarmScheduler {
   public:
+    /** Maximum number of alarms in a schedule. */
+    static const uint8_t MAX_ALARMS = 8;
+
+    /** Weekday mask covering every day (bit 0 = Sunday ... bit 6 = Saturday). */
+    static const uint8_t EVERY_DAY = 0x7F;
+
     AlarmScheduler();
 
     /**
-     * Sets the alarm time in 24-hour format.
+     * Replaces the schedule with a single daily alarm in 24-hour format.
      * @param hour   Hour (0-23).
      * @param minute Minute (0-59).
      */
     void setAlarm(uint8_t hour, uint8_t minute);
 
+    /** Removes all alarms. */
+    void clearAlarms();
+
     /**
-     * Sets the callback function that will be called when the alarm is triggered.
-     * @param callback The function to call on alarm trigger.
+     * Adds an alarm to the schedule.
+     * @param hour   Hour (0-23).
+     * @param minute Minute (0-59).
+     * @param days   Weekday mask (bit 0 = Sunday); defaults to every day.
+     * @return false if the time is invalid or the schedule is full.
      */
-    void setCallback(AlarmCallback callback);
+    bool addAlarm(uint8_t hour, uint8_t minute, uint8_t days = EVERY_DAY);
+
+    /** Number of alarms currently scheduled. */
+    uint8_t alarmCount() const { return _count; }
 
     /**
-     * Checks the current time; if it matches the alarm time and hasn’t been triggered 
-     * this minute, the callback is called.
+     * Finds the next alarm strictly after `now` within the coming week.
+     * @param daysAhead  Set to 0 for today, 1 for tomorrow, ...
+     * @param includeNow Also count an alarm in now's minute that hasn't triggered yet.
+     * @return false if no alarm is scheduled.
+     */
+    bool nextAlarm(const struct tm& now, uint8_t& hour, uint8_t& minute, uint8_t& daysAhead,
+                   bool includeNow = false) const;
+
+    /**
+     * Checks the current time; if it matches an alarm time and that alarm hasn’t been
+     * triggered this minute, an AlarmEvent is posted to AppBus.
      */
     void checkAlarm();
 
   private:
-    uint8_t _alarmHour;
-    uint8_t _alarmMinute;
-    bool _alarmSet;
-    bool _alarmTriggered;  // Ensure we trigger only once per alarm minute.
-    AlarmCallback _callback;
+    struct Alarm {
+      uint8_t hour;
+      uint8_t minute;
+      uint8_t days;
+      bool    triggered;  // Ensure we trigger only once per alarm minute.
+    };
+
+    Alarm   _alarms[MAX_ALARMS];
+    uint8_t _count;
 };
 
 #endif
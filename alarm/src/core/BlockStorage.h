@@ -0,0 +1,30 @@
+#ifndef BLOCKSTORAGE_H
+#define BLOCKSTORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * BlockStorage persists fixed-size blocks in a few independent areas,
+ * e.g. one file per area. Blocks are rewritten in place, and a block that
+ * was never written reads as zeros. Implementations return false on I/O
+ * errors.
+ */
+class BlockStorage {
+  public:
+    virtual ~BlockStorage() {}
+
+    /**
+     * Make `area` hold `blocks` blocks of `blockSize` bytes. An area whose
+     * size differs (a different layout) is wiped.
+     */
+    virtual bool open(uint8_t area, uint16_t blocks, uint16_t blockSize) = 0;
+
+    /** Read len bytes from the start of a block (e.g. only its header). */
+    virtual bool read(uint8_t area, uint16_t block, uint8_t* buf, uint16_t len) = 0;
+
+    /** Write a whole block. */
+    virtual bool write(uint8_t area, uint16_t block, const uint8_t* buf) = 0;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef BYTESINK_H
+#define BYTESINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * ByteSink receives a byte stream piece by piece (a socket, a compressor,
+ * a buffer). Implementations return false once they can no longer accept
+ * data; callers should stop producing at that point.
+ */
+class ByteSink {
+  public:
+    virtual ~ByteSink() {}
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+};
+
+/**
+ * BodySource generates a request body on demand by writing it into a sink,
+ * so the full body never has to exist in RAM at once.
+ */
+class BodySource {
+  public:
+    virtual ~BodySource() {}
+    /** Write the whole body to sink; return false if the sink failed. */
+    virtual bool writeTo(ByteSink& sink) = 0;
+};
+
+#endif
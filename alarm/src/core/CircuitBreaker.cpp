@@ -0,0 +1,82 @@
+#include "core/CircuitBreaker.h"
+#include <string.h>
+
+CircuitBreaker::CircuitBreaker(uint32_t seed)
+  : _state(Closed)
+  , _failures(0)
+  , _backoffs(0)
+  , _probing(false)
+  , _retryAt(0)
+  , _rng(seed ? seed : 1)
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool CircuitBreaker::allow(uint32_t nowMs) {
+  if (_state == Open && (int32_t)(nowMs - _retryAt) >= 0) {
+    _state = HalfOpen;
+    _probing = false;
+  }
+  if (_state == Open || (_state == HalfOpen && _probing)) {
+    _stats.rejected++;
+    return false;
+  }
+  if (_state == HalfOpen) _probing = true;
+  _stats.requests++;
+  return true;
+}
+
+void CircuitBreaker::record(bool success, uint32_t nowMs, uint32_t latencyMs) {
+  _stats.lastLatencyMs = latencyMs;
+  if (latencyMs > _stats.maxLatencyMs) _stats.maxLatencyMs = latencyMs;
+  _probing = false;
+
+  if (success) {
+    _state = Closed;
+    _failures = 0;
+    _backoffs = 0;
+    return;
+  }
+
+  _stats.failures++;
+  if (_failures < 0xFF) _failures++;
+  if (_state == HalfOpen || (_state == Closed && _failures >= FAILURE_THRESHOLD)) {
+    if (_state == Closed) _stats.trips++;
+    _open(nowMs);
+  }
+}
+
+void CircuitBreaker::abandon() {
+  _probing = false;
+  if (_stats.requests) _stats.requests--;
+}
+
+void CircuitBreaker::_open(uint32_t nowMs) {
+  uint32_t backoff = BASE_BACKOFF_MS;
+  for (uint8_t i = 0; i < _backoffs && backoff < MAX_BACKOFF_MS; ++i) backoff *= 2;
+  if (backoff > MAX_BACKOFF_MS) backoff = MAX_BACKOFF_MS;
+  if (_backoffs < 0xFF) _backoffs++;
+
+  // xorshift32; only needs to decorrelate devices
+  _rng ^= _rng << 13;
+  _rng ^= _rng >> 17;
+  _rng ^= _rng << 5;
+  uint32_t half = backoff / 2;
+  _retryAt = nowMs + half + _rng % (half + 1);
+  _state = Open;
+}
+
+uint32_t CircuitBreaker::retryInMs(uint32_t nowMs) const {
+  if (_state != Open) return 0;
+  int32_t left = (int32_t)(_retryAt - nowMs);
+  return left > 0 ? (uint32_t)left : 0;
+}
+
+const char* CircuitBreaker::stateName(State state) {
+  switch (state) {
+    case Closed:   return "closed";
+    case Open:     return "open";
+    case HalfOpen: return "half-open";
+  }
+  return "?";
+}
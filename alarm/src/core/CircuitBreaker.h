@@ -0,0 +1,72 @@
+#ifndef CIRCUITBREAKER_H
+#define CIRCUITBREAKER_H
+
+#include <stdint.h>
+
+/** Counters of one CircuitBreaker, for the logs. */
+struct BreakerStats {
+  uint32_t requests;       // let through
+  uint32_t failures;
+  uint32_t rejected;       // failed fast while open
+  uint32_t trips;          // closed -> open transitions
+  uint32_t lastLatencyMs;  // of the last request let through
+  uint32_t maxLatencyMs;
+};
+
+/**
+ * Circuit breaker with exponential backoff for one backend.
+ *
+ *   Closed    requests go out. FAILURE_THRESHOLD failures in a row open it.
+ *   Open      requests fail fast until the backoff has passed, then one
+ *             request is let through as a probe (HalfOpen).
+ *   HalfOpen  the probe decides: success closes the breaker, failure opens
+ *             it again with twice the backoff, up to MAX_BACKOFF_MS.
+ *
+ * Backoffs use "equal jitter" (half fixed, half random), so clocks that
+ * lost the same server do not all probe it at the same moment.
+ *
+ * Callers report every request that allow() let through via record().
+ * No Arduino dependencies, so it also builds on the host.
+ */
+class CircuitBreaker {
+  public:
+    enum State : uint8_t { Closed, Open, HalfOpen };
+
+    static const uint8_t  FAILURE_THRESHOLD = 3;
+    static const uint32_t BASE_BACKOFF_MS = 5000;
+    static const uint32_t MAX_BACKOFF_MS = 10UL * 60UL * 1000UL;
+
+    explicit CircuitBreaker(uint32_t seed = 1);
+
+    /** May a request go out now? Open -> HalfOpen once the backoff has passed. */
+    bool allow(uint32_t nowMs);
+
+    /** Report the outcome of a request that allow() let through. */
+    void record(bool success, uint32_t nowMs, uint32_t latencyMs);
+
+    /** Forget a request allow() let through that never reached the server. */
+    void abandon();
+
+    State state() const { return _state; }
+    uint8_t consecutiveFailures() const { return _failures; }
+
+    /** Milliseconds until the next probe while open, else 0. */
+    uint32_t retryInMs(uint32_t nowMs) const;
+
+    const BreakerStats& stats() const { return _stats; }
+
+    static const char* stateName(State state);
+
+  private:
+    State        _state;
+    uint8_t      _failures;   // in a row
+    uint8_t      _backoffs;   // consecutive opens, for the exponent
+    bool         _probing;    // HalfOpen request in flight
+    uint32_t     _retryAt;    // ms, while open
+    uint32_t     _rng;
+    BreakerStats _stats;
+
+    void _open(uint32_t nowMs);
+};
+
+#endif
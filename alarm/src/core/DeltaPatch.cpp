@@ -0,0 +1,233 @@
+#include "core/DeltaPatch.h"
+#include <string.h>
+
+static uint32_t readLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool hashImage(FirmwareImage& image, uint32_t size, uint8_t digest[Sha256::DIGEST_SIZE]) {
+  Sha256 hash;
+  uint8_t chunk[256];
+  for (uint32_t offset = 0; offset < size; offset += sizeof(chunk)) {
+    size_t n = size - offset < sizeof(chunk) ? size - offset : sizeof(chunk);
+    if (!image.read(offset, chunk, n)) return false;
+    hash.update(chunk, n);
+  }
+  hash.finish(digest);
+  return true;
+}
+
+DeltaPatcher::DeltaPatcher(FirmwareImage& base, uint32_t baseSize, const uint8_t baseHash[Sha256::DIGEST_SIZE],
+                           ByteSink& out)
+  : _base(base)
+  , _baseSize(baseSize)
+  , _out(out)
+  , _status(Running)
+  , _header()
+  , _patchBytes(0)
+  , _produced(0)
+  , _bits(0)
+  , _bitCount(0)
+  , _windowPos(0)
+  , _step(AddLength)
+  , _varint(0)
+  , _varintShift(0)
+  , _addLeft(0)
+  , _copyLeft(0)
+  , _seek(0)
+  , _basePos(0)
+  , _cacheStart(-1)
+  , _outLen(0)
+{
+  memcpy(_baseHash, baseHash, sizeof(_baseHash));
+  memset(_window, 0, sizeof(_window));
+}
+
+bool DeltaPatcher::write(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    // The last token ends in the last byte; whatever comes after it is not part of the patch
+    if (_status != Running) {
+      if (_status == Done) _fail(Corrupt);
+      return false;
+    }
+
+    if (_patchBytes < DELTA_HEADER_SIZE) {
+      _headerBytes[_patchBytes++] = data[i];
+      if (_patchBytes == DELTA_HEADER_SIZE) _parseHeader();
+      continue;
+    }
+    _patchBytes++;
+
+    // At most 19 bits are left over from the last byte, so 27 fit
+    _bits = _bits << 8 | data[i];
+    _bitCount += 8;
+    while (_status == Running && _bitCount > 0) {
+      if (_bits >> (_bitCount - 1) & 1) {
+        if (_bitCount < 9) break;
+        _bitCount -= 9;
+        _unpacked((uint8_t)(_bits >> _bitCount));
+      } else {
+        if (_bitCount < 20) break;
+        _bitCount -= 20;
+        uint32_t token = _bits >> _bitCount & 0x7FFFF;
+        uint16_t distance = (token >> 8) + 1;
+        uint16_t length = (token & 0xFF) + MIN_MATCH;
+        while (length-- > 0 && _status == Running) {
+          _unpacked(_window[(uint16_t)(_windowPos - distance) & (WINDOW - 1)]);
+        }
+      }
+    }
+  }
+  return _status == Running || _status == Done;
+}
+
+DeltaPatcher::Status DeltaPatcher::finish() {
+  if (_status == Running) _fail(_patchBytes < DELTA_HEADER_SIZE ? BadHeader : Corrupt);
+  return _status;
+}
+
+const char* DeltaPatcher::statusName(Status status) {
+  switch (status) {
+    case Running:      return "running";
+    case Done:         return "done";
+    case BadHeader:    return "bad header";
+    case WrongBase:    return "wrong base";
+    case Corrupt:      return "corrupt";
+    case ReadFailed:   return "read failed";
+    case WriteFailed:  return "write failed";
+    case HashMismatch: return "hash mismatch";
+  }
+  return "?";
+}
+
+void DeltaPatcher::_parseHeader() {
+  const uint8_t* h = _headerBytes;
+  _header.baseSize = readLe32(h + 4);
+  _header.imageSize = readLe32(h + 8);
+  memcpy(_header.baseHash, h + 12, Sha256::DIGEST_SIZE);
+  memcpy(_header.imageHash, h + 44, Sha256::DIGEST_SIZE);
+
+  if (memcmp(h, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0 || _header.imageSize == 0) {
+    _fail(BadHeader);
+    return;
+  }
+  if (_header.baseSize != 0 &&
+      (_header.baseSize != _baseSize || memcmp(_header.baseHash, _baseHash, Sha256::DIGEST_SIZE) != 0)) {
+    _fail(WrongBase);
+  }
+}
+
+// One byte of the unpacked stream: into the history, and on to the instructions
+void DeltaPatcher::_unpacked(uint8_t value) {
+  _window[_windowPos++ & (WINDOW - 1)] = value;
+  _windowPos &= WINDOW - 1;
+  _instruction(value);
+}
+
+void DeltaPatcher::_instruction(uint8_t value) {
+  uint8_t base;
+  switch (_step) {
+    case AddLength:
+    case CopyLength:
+    case Seek: {
+      if (_varintShift > 35) {
+        _fail(Corrupt);
+        return;
+      }
+      _varint |= (uint64_t)(value & 0x7F) << _varintShift;
+      if (value & 0x80) {
+        _varintShift += 7;
+        return;
+      }
+      uint64_t v = _varint;
+      _varint = 0;
+      _varintShift = 0;
+      uint32_t left = _header.imageSize - _produced;
+      if (_step == AddLength) {
+        if (v > left) {
+          _fail(Corrupt);
+          return;
+        }
+        _addLeft = (uint32_t)v;
+        _step = CopyLength;
+      } else if (_step == CopyLength) {
+        if (v > left - _addLeft) {
+          _fail(Corrupt);
+          return;
+        }
+        _copyLeft = (uint32_t)v;
+        _step = Seek;
+      } else {
+        _seek = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+        if (_addLeft) _step = Add;
+        else if (_copyLeft) _step = Copy;
+        else _endInstruction();
+      }
+      return;
+    }
+    case Add:
+      if (!_baseByte(base)) return;
+      _basePos++;
+      _emit((uint8_t)(base + value));
+      if (--_addLeft == 0) {
+        if (_copyLeft) _step = Copy;
+        else _endInstruction();
+      }
+      return;
+    case Copy:
+      _emit(value);
+      if (--_copyLeft == 0) _endInstruction();
+      return;
+  }
+}
+
+// The image is complete at the end of the instruction that produced its last byte
+void DeltaPatcher::_endInstruction() {
+  _basePos += _seek;
+  _step = AddLength;
+  if (_status != Running || _produced < _header.imageSize) return;
+
+  if (!_flushOut()) return;
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  _hash.finish(digest);
+  _status = memcmp(digest, _header.imageHash, sizeof(digest)) == 0 ? Done : HashMismatch;
+}
+
+// Read through an aligned cache: add runs walk the base forward
+bool DeltaPatcher::_baseByte(uint8_t& value) {
+  if (_basePos < 0 || _basePos >= (int64_t)_baseSize) {
+    _fail(Corrupt);
+    return false;
+  }
+  if (_cacheStart < 0 || _basePos < _cacheStart || _basePos >= _cacheStart + BASE_CACHE) {
+    uint32_t start = (uint32_t)_basePos & ~(uint32_t)(BASE_CACHE - 1);
+    size_t n = _baseSize - start < BASE_CACHE ? _baseSize - start : BASE_CACHE;
+    if (!_base.read(start, _cache, n)) {
+      _cacheStart = -1;
+      _fail(ReadFailed);
+      return false;
+    }
+    _cacheStart = start;
+  }
+  value = _cache[_basePos - _cacheStart];
+  return true;
+}
+
+void DeltaPatcher::_emit(uint8_t value) {
+  _outBuf[_outLen++] = value;
+  _produced++;
+  if (_outLen == OUT_SIZE) _flushOut();
+}
+
+bool DeltaPatcher::_flushOut() {
+  if (_outLen == 0) return true;
+  _hash.update(_outBuf, _outLen);
+  bool ok = _out.write(_outBuf, _outLen);
+  _outLen = 0;
+  if (!ok) _fail(WriteFailed);
+  return ok;
+}
+
+void DeltaPatcher::_fail(Status status) {
+  if (_status == Running || _status == Done) _status = status;
+}
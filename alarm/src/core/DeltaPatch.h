@@ -0,0 +1,152 @@
+#ifndef DELTAPATCH_H
+#define DELTAPATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <core/ByteSink.h>
+#include <core/Sha256.h>
+
+/**
+ * Firmware delta patches: applied as they stream in, with bounded RAM.
+ *
+ * A patch turns one exact firmware image (the base, named by its SHA-256)
+ * into a new one. tools/ota/ota_diff builds them; the format is
+ *
+ *   header, 76 B, little endian:
+ *     "OTD1"  u32 baseSize  u32 imageSize  baseHash[32]  imageHash[32]
+ *   body: an LZSS stream (below) that unpacks to bsdiff instructions, each
+ *     varint addLength  varint copyLength  zigzag varint seek
+ *     addLength bytes   added to the base bytes at the base position
+ *     copyLength bytes  taken as they are
+ *   after which the base position moves by addLength + seek.
+ *
+ * A patch with baseSize 0 carries a full image in one copy and applies to
+ * any base. Two firmware builds differ in small scattered ways (shifted
+ * addresses, changed constants), so most add bytes are zero and the LZSS
+ * stage squeezes them out: a typical patch is a few percent of the image.
+ *
+ * LZSS, bits MSB first, over a WINDOW-byte history of the unpacked stream:
+ *   1 + 8 bits        a literal byte
+ *   0 + 11 + 8 bits   a match: distance - 1, length - MIN_MATCH
+ *
+ * RAM: the window, a BASE_CACHE-byte cache of the base image, an output
+ * buffer and the running hash, about 3 KB; images of any size apply.
+ */
+
+static const uint8_t  DELTA_MAGIC[4] = { 'O', 'T', 'D', '1' };
+static const uint8_t  DELTA_HEADER_SIZE = 76;
+
+/** Patch header, decoded. */
+struct DeltaHeader {
+  uint32_t baseSize;   // 0 = full image
+  uint32_t imageSize;
+  uint8_t  baseHash[Sha256::DIGEST_SIZE];
+  uint8_t  imageHash[Sha256::DIGEST_SIZE];
+};
+
+/** Random access to a firmware image: the running partition, or a file on the host. */
+class FirmwareImage {
+  public:
+    virtual ~FirmwareImage() {}
+    virtual bool read(uint32_t offset, uint8_t* data, size_t len) = 0;
+};
+
+/** SHA-256 of the first `size` bytes of an image; false if a read failed. */
+bool hashImage(FirmwareImage& image, uint32_t size, uint8_t digest[Sha256::DIGEST_SIZE]);
+
+/**
+ * DeltaPatcher: write() the patch as it arrives, and the new image comes
+ * out of `out` in order. The base is only read, so it may be the image
+ * that is running. The new image's hash is checked once its last byte is
+ * out; status() is Done only if it matched.
+ */
+class DeltaPatcher : public ByteSink {
+  public:
+    static const uint16_t WINDOW = 2048;
+    static const uint16_t BASE_CACHE = 256;
+    static const uint16_t OUT_SIZE = 256;
+    static const uint8_t  MIN_MATCH = 3;
+    static const uint16_t MAX_MATCH = 258;
+
+    enum Status : uint8_t {
+      Running,
+      Done,
+      BadHeader,     // not a patch, or a version this code does not know
+      WrongBase,     // made for another base image
+      Corrupt,       // the body does not decode to a valid image
+      ReadFailed,    // the base could not be read
+      WriteFailed,   // `out` refused data
+      HashMismatch   // decoded fine, but not to the image in the header
+    };
+
+    /**
+     * @param base      the image the device runs
+     * @param baseSize  its length
+     * @param baseHash  its SHA-256, which the patch must have been made against
+     * @param out       receives the new image
+     */
+    DeltaPatcher(FirmwareImage& base, uint32_t baseSize, const uint8_t baseHash[Sha256::DIGEST_SIZE],
+                 ByteSink& out);
+
+    /** Apply the next piece of the patch; false once it failed or anything follows its end. */
+    bool write(const uint8_t* data, size_t len) override;
+
+    /** Call once the patch has ended; a patch that stopped short is Corrupt. */
+    Status finish();
+
+    Status status() const { return _status; }
+
+    /** Valid once the header is in (imageSize 0 before). */
+    const DeltaHeader& header() const { return _header; }
+
+    uint32_t patchBytes() const { return _patchBytes; }
+    uint32_t imageBytes() const { return _produced; }
+
+    static const char* statusName(Status status);
+
+  private:
+    enum Step : uint8_t { AddLength, CopyLength, Seek, Add, Copy };
+
+    FirmwareImage& _base;
+    uint32_t       _baseSize;
+    uint8_t        _baseHash[Sha256::DIGEST_SIZE];
+    ByteSink&      _out;
+    Status         _status;
+    DeltaHeader    _header;
+    uint8_t        _headerBytes[DELTA_HEADER_SIZE];
+    uint32_t       _patchBytes;
+    uint32_t       _produced;
+
+    // LZSS
+    uint32_t _bits;
+    uint8_t  _bitCount;
+    uint8_t  _window[WINDOW];
+    uint16_t _windowPos;
+
+    // bsdiff instructions
+    Step     _step;
+    uint64_t _varint;
+    uint8_t  _varintShift;
+    uint32_t _addLeft;
+    uint32_t _copyLeft;
+    int64_t  _seek;
+    int64_t  _basePos;
+
+    uint8_t  _cache[BASE_CACHE];
+    int64_t  _cacheStart;  // -1 = empty
+
+    uint8_t  _outBuf[OUT_SIZE];
+    uint16_t _outLen;
+    Sha256   _hash;
+
+    void _parseHeader();
+    void _unpacked(uint8_t value);
+    void _instruction(uint8_t value);
+    void _endInstruction();
+    bool _baseByte(uint8_t& value);
+    void _emit(uint8_t value);
+    bool _flushOut();
+    void _fail(Status status);
+};
+
+#endif
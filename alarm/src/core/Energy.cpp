@@ -0,0 +1,114 @@
+#include "core/Energy.h"
+#include <Arduino.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+static portMUX_TYPE energyMux = portMUX_INITIALIZER_UNLOCKED;
+#define ENERGY_LOCK()   portENTER_CRITICAL(&energyMux)
+#define ENERGY_UNLOCK() portEXIT_CRITICAL(&energyMux)
+#else
+#include <mutex>
+static std::mutex energyMutex;
+#define ENERGY_LOCK()   energyMutex.lock()
+#define ENERGY_UNLOCK() energyMutex.unlock()
+#endif
+
+// ESP32 datasheet (modem-sleep, 240 MHz dual core), DHT20 datasheet, and
+// the usual figures for a 5 mm LED on 3.3 V through 220 Ω and a small
+// magnetic buzzer behind a transistor
+const EnergyProfile DEFAULT_ENERGY_PROFILE = { {
+  { 30000 },                               // board: LDO, CP2104, ST7789 backlight
+  { 30000, 50000 },                        // CPU idle, busy
+  { 0, 20000, 100000 },                    // radio off, associated, on the air
+  { 0, 25000 },                            // buzzer
+  { 0, 7000, 14000, 21000, 28000 },        // 0-4 LEDs lit
+  { 0, 980 },                              // DHT20 converting
+} };
+
+static const char* const RAIL_NAMES[ENERGY_RAILS] = { "board", "cpu", "radio", "buzzer", "leds", "sensor" };
+
+static const EnergyProfile* currents = &DEFAULT_ENERGY_PROFILE;
+static bool         started = false;
+static uint32_t     lastMicros = 0;
+static uint64_t     clockUs = 0;  // micros() widened to 64 bits; set() runs often enough to see each wrap
+static uint8_t      current[ENERGY_RAILS];
+static uint64_t     since[ENERGY_RAILS];
+static EnergyTotals booked;
+
+// Caller holds the lock
+static uint64_t nowUs() {
+  uint32_t m = micros();
+  clockUs += (uint32_t)(m - lastMicros);
+  lastMicros = m;
+  return clockUs;
+}
+
+static void book(uint8_t rail, uint64_t now) {
+  booked.us[rail][current[rail]] += now - since[rail];
+  since[rail] = now;
+}
+
+void Energy::begin(const EnergyProfile& profile) {
+  ENERGY_LOCK();
+  currents = &profile;
+  memset(&booked, 0, sizeof(booked));
+  lastMicros = micros();
+  clockUs = 0;
+  for (uint8_t i = 0; i < ENERGY_RAILS; ++i) since[i] = 0;
+  current[RailCpu] = CpuBusy;
+  started = true;
+  ENERGY_UNLOCK();
+}
+
+void Energy::set(EnergyRail rail, uint8_t state) {
+  if (state >= ENERGY_STATES) state = ENERGY_STATES - 1;
+  ENERGY_LOCK();
+  if (state != current[rail]) {
+    if (started) book(rail, nowUs());
+    current[rail] = state;
+  }
+  ENERGY_UNLOCK();
+}
+
+uint8_t Energy::state(EnergyRail rail) {
+  return current[rail];
+}
+
+void Energy::totals(EnergyTotals& out) {
+  ENERGY_LOCK();
+  if (started) {
+    uint64_t now = nowUs();
+    for (uint8_t i = 0; i < ENERGY_RAILS; ++i) book(i, now);
+  }
+  out = booked;
+  ENERGY_UNLOCK();
+}
+
+const EnergyProfile& Energy::profile() {
+  return *currents;
+}
+
+void Energy::setProfile(const EnergyProfile& profile) {
+  currents = &profile;
+}
+
+const char* Energy::railName(EnergyRail rail) {
+  return rail < ENERGY_RAILS ? RAIL_NAMES[rail] : "?";
+}
+
+void energyCharge(const EnergyProfile& profile, const EnergyTotals& from, const EnergyTotals& to,
+                  uint32_t microampHours[ENERGY_RAILS]) {
+  for (uint8_t rail = 0; rail < ENERGY_RAILS; ++rail) {
+    uint64_t microampMicros = 0;
+    for (uint8_t state = 0; state < ENERGY_STATES; ++state) {
+      microampMicros += (uint64_t)profile.microamps[rail][state] * (to.us[rail][state] - from.us[rail][state]);
+    }
+    microampHours[rail] = (uint32_t)((microampMicros + 1800000000ULL) / 3600000000ULL);
+  }
+}
+
+uint32_t energyTimeMs(const EnergyTotals& from, const EnergyTotals& to, EnergyRail rail, uint8_t state) {
+  return (uint32_t)((to.us[rail][state] - from.us[rail][state]) / 1000);
+}
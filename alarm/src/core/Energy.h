@@ -0,0 +1,90 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+
+/**
+ * Energy accounting: how long each subsystem spends in each power state,
+ * and the charge that adds up to with a table of currents.
+ *
+ *   Energy::set(RailRadio, RadioActive);   // from the driver that switches it
+ *   ...
+ *   EnergyTotals now;
+ *   Energy::totals(now);
+ *   energyCharge(Energy::profile(), before, now, uAh);
+ *
+ * Drivers report state changes, nothing is sampled. A rail stays in its
+ * state until the next set(), and its time is attributed when that comes
+ * (or when totals() is read). The result is an estimate: the currents are
+ * typical figures, not measured, but they rank the subsystems by their
+ * share of the battery, which is what optimizations need.
+ *
+ * set() may be called from any task (the radio's from WifiModule's request
+ * task), not from ISRs. No Arduino types, so TelemetryEncoder can use the
+ * rail count and the header builds on the host.
+ */
+
+/** Subsystems with their own current draw. */
+enum EnergyRail : uint8_t {
+  RailBoard,   // always on: regulator, USB bridge, display backlight
+  RailCpu,     // the loop task: busy, or waiting in delay()
+  RailRadio,   // Wi-Fi
+  RailBuzzer,
+  RailLeds,    // state = number of LEDs lit
+  RailSensor   // DHT20
+};
+
+static const uint8_t ENERGY_RAILS = 6;
+static const uint8_t ENERGY_STATES = 5;  // per rail; state 0 is the rail's lowest
+
+enum CpuState : uint8_t { CpuIdle, CpuBusy };
+enum RadioState : uint8_t {
+  RadioOff,
+  RadioIdle,    // associated; the modem sleeps between beacons
+  RadioActive   // connecting, or a request on the air
+};
+enum SwitchState : uint8_t { SwitchOff, SwitchOn };  // buzzer, sensor conversion
+
+/** Average current of each rail in each state, in µA. */
+struct EnergyProfile {
+  uint32_t microamps[ENERGY_RAILS][ENERGY_STATES];
+};
+
+/** Typical figures for the TTGO board at 240 MHz with the clock's peripherals. */
+extern const EnergyProfile DEFAULT_ENERGY_PROFILE;
+
+/** Time spent in each state since Energy::begin(). */
+struct EnergyTotals {
+  uint64_t us[ENERGY_RAILS][ENERGY_STATES];
+
+  /** Time covered, i.e. the board rail's (it never leaves state 0). */
+  uint64_t elapsedUs() const { return us[RailBoard][0]; }
+};
+
+class Energy {
+  public:
+    /** Start accounting: the CPU busy, everything else in state 0. */
+    static void begin(const EnergyProfile& profile = DEFAULT_ENERGY_PROFILE);
+
+    /** Switch a rail to `state`; the time in its previous state is booked. */
+    static void set(EnergyRail rail, uint8_t state);
+
+    static uint8_t state(EnergyRail rail);
+
+    /** Time in every state up to now, the current states included. */
+    static void totals(EnergyTotals& out);
+
+    static const EnergyProfile& profile();
+    static void setProfile(const EnergyProfile& profile);
+
+    static const char* railName(EnergyRail rail);
+};
+
+/** Charge drawn per rail between two totals, in µAh. */
+void energyCharge(const EnergyProfile& profile, const EnergyTotals& from, const EnergyTotals& to,
+                  uint32_t microampHours[ENERGY_RAILS]);
+
+/** Time a rail spent in `state` between two totals, in ms. */
+uint32_t energyTimeMs(const EnergyTotals& from, const EnergyTotals& to, EnergyRail rail, uint8_t state);
+
+#endif
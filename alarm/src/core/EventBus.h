@@ -0,0 +1,177 @@
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * EventBus: a typed publish/subscribe bus resolved entirely at compile time.
+ *
+ * - Each event type E gets its own bounded lock-free queue (EventChannel<E>).
+ *   post() may be called from any task or ISR; it never blocks or allocates.
+ * - Subscribers are declared by specializing Subscribers<E> with a
+ *   HandlerList of plain functions. Dispatch is a chain of direct calls,
+ *   no virtual functions or function-pointer tables at runtime.
+ * - dispatch() drains every channel of the bus and must be called from a
+ *   single consumer context (the Arduino loop).
+ *
+ * Only the translation unit that calls dispatch()/publish() needs to see
+ * the Subscribers<> specializations; producers only touch the queues.
+ */
+
+#ifndef EVENTBUS_QUEUE_DEPTH
+#define EVENTBUS_QUEUE_DEPTH 16
+#endif
+
+/**
+ * Bounded multi-producer/single-consumer queue (Vyukov style).
+ * Every slot carries a sequence number, so producers never wait on each
+ * other: an ISR that interrupts a half-finished push simply claims the
+ * next slot, and the consumer picks up both once they are committed.
+ */
+template <typename T, uint16_t N>
+class EventQueue {
+  static_assert((N & (N - 1)) == 0, "EventQueue depth must be a power of two");
+
+public:
+  EventQueue() : _head(0), _tail(0) {
+    for (uint16_t i = 0; i < N; ++i) {
+      _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /** Enqueue a copy of item; returns false if the queue is full. ISR-safe. */
+  bool push(const T& item) {
+    uint32_t pos = _tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = _slots[pos & (N - 1)];
+      uint32_t seq = slot.seq.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)seq - (int32_t)pos;
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.item = item;
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** Dequeue into item; returns false if nothing committed is pending. */
+  bool pop(T& item) {
+    uint32_t pos = _head.load(std::memory_order_relaxed);
+    Slot& slot = _slots[pos & (N - 1)];
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if ((int32_t)seq - (int32_t)(pos + 1) < 0) {
+      return false;  // empty, or the next producer has not committed yet
+    }
+    item = slot.item;
+    _head.store(pos + 1, std::memory_order_relaxed);
+    slot.seq.store(pos + N, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    T item;
+  };
+  Slot _slots[N];
+  std::atomic<uint32_t> _head;
+  std::atomic<uint32_t> _tail;
+};
+
+/** Per-event-type storage shared by all producers and the consumer. */
+template <typename E>
+struct EventChannel {
+  static EventQueue<E, EVENTBUS_QUEUE_DEPTH> queue;
+  static std::atomic<uint32_t> dropped;  // posts rejected because the queue was full
+};
+
+template <typename E>
+EventQueue<E, EVENTBUS_QUEUE_DEPTH> EventChannel<E>::queue;
+
+template <typename E>
+std::atomic<uint32_t> EventChannel<E>::dropped(0);
+
+/** Compile-time list of handler functions for event type E. */
+template <typename E, void (*... Handlers)(const E&)>
+struct HandlerList;
+
+template <typename E>
+struct HandlerList<E> {
+  static inline void call(const E&) {}
+};
+
+template <typename E, void (*First)(const E&), void (*... Rest)(const E&)>
+struct HandlerList<E, First, Rest...> {
+  static inline void call(const E& event) {
+    First(event);
+    HandlerList<E, Rest...>::call(event);
+  }
+};
+
+/**
+ * Subscribers<E>::type names the HandlerList for E. The default has no
+ * handlers; the application specializes it for the events it consumes.
+ */
+template <typename E>
+struct Subscribers {
+  typedef HandlerList<E> type;
+};
+
+template <typename... Events>
+struct EventBus;
+
+template <>
+struct EventBus<> {
+  static inline uint16_t dispatch() { return 0; }
+};
+
+template <typename First, typename... Rest>
+struct EventBus<First, Rest...> {
+  /** Queue an event for the next dispatch(); safe from ISRs and other tasks. */
+  template <typename E>
+  static inline bool post(const E& event) {
+    if (EventChannel<E>::queue.push(event)) {
+      return true;
+    }
+    EventChannel<E>::dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  /** Deliver an event to its subscribers immediately, in the caller's context. */
+  template <typename E>
+  static inline void publish(const E& event) {
+    Subscribers<E>::type::call(event);
+  }
+
+  /** Number of events of type E dropped due to a full queue. */
+  template <typename E>
+  static inline uint32_t dropped() {
+    return EventChannel<E>::dropped.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Drain all pending events and deliver them to their subscribers.
+   * Handlers may post new events or call dispatch() again (re-entrantly);
+   * each event is removed from its queue before its handlers run.
+   * @return number of events delivered.
+   */
+  static uint16_t dispatch() {
+    uint16_t delivered = 0;
+    First event;
+    while (EventChannel<First>::queue.pop(event)) {
+      Subscribers<First>::type::call(event);
+      delivered++;
+    }
+    return delivered + EventBus<Rest...>::dispatch();
+  }
+};
+
+#endif
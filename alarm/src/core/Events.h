@@ -0,0 +1,68 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <core/EventBus.h>
+
+/**
+ * Application events exchanged over AppBus.
+ * Keep these small and trivially copyable: they are copied into the
+ * per-type queues by value.
+ */
+
+/** Button edge reported by ButtonDriver (pressed = LOW, released = HIGH). */
+struct ButtonEvent {
+  enum Edge : uint8_t { Pressed, Released };
+  uint8_t       pin;
+  Edge          edge;
+  unsigned long timestampMs;
+};
+
+/** Raised by AlarmScheduler when the configured alarm minute is reached. */
+struct AlarmEvent {
+  uint8_t hour;
+  uint8_t minute;
+};
+
+/** One DHT20 reading. */
+struct SensorSample {
+  float  temperature;  // °C
+  float  humidity;     // %
+  time_t timestamp;    // epoch seconds
+};
+
+/** Raised by AlarmConfig when a fetched alarm schedule differs from the applied one, emptied ones included. */
+struct ConfigUpdate {
+  uint8_t count;   // alarms in the schedule
+  uint8_t hour;    // first alarm, 00:00 when count is 0
+  uint8_t minute;
+};
+
+/** Gesture recognized by ImuDriver from the accelerometer FIFO. */
+struct MotionEvent {
+  enum Kind : uint8_t { PickedUp, Shake };
+  Kind          kind;
+  uint16_t      magnitudeMg;  // peak dynamic acceleration leading up to it
+  unsigned long timestampMs;
+};
+
+/** Outcome of a firmware update check by OtaUpdater. */
+struct OtaEvent {
+  enum Result : uint8_t {
+    UpToDate,   // the server has nothing newer
+    Installed,  // the new image is in the other slot and boots next
+    Skipped,    // the server offers the image that was rolled back
+    Failed
+  };
+  Result   result;
+  uint8_t  patch;       // DeltaPatcher::Status
+  int16_t  status;      // HTTP status, negative on transport error
+  uint32_t patchBytes;  // downloaded
+  uint32_t imageBytes;  // of the new image, i.e. what a full download would have been
+  uint32_t ms;          // check to outcome
+};
+
+typedef EventBus<ButtonEvent, AlarmEvent, SensorSample, ConfigUpdate, MotionEvent, OtaEvent> AppBus;
+
+#endif
@@ -0,0 +1,209 @@
+#include "core/GzipWriter.h"
+#include <string.h>
+
+static const uint16_t MIN_MATCH = 3;
+static const uint16_t MAX_MATCH = 258;
+static const uint16_t END_OF_BLOCK = 256;
+
+static const uint16_t LENGTH_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// CRC-32 (IEEE), nibble-table variant to keep flash/RAM use tiny.
+static const uint32_t CRC_NIBBLE[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+// Huffman codes are defined MSB-first but deflate packs bits LSB-first.
+static uint16_t reverseBits(uint16_t code, uint8_t len) {
+  uint16_t out = 0;
+  for (uint8_t i = 0; i < len; ++i) {
+    out = (out << 1) | (code & 1);
+    code >>= 1;
+  }
+  return out;
+}
+
+GzipWriter::GzipWriter(ByteSink& out)
+  : _out(out)
+  , _ok(true)
+  , _crc(0)
+  , _bytesIn(0)
+  , _bytesOut(0)
+  , _len(0)
+  , _pos(0)
+  , _bits(0)
+  , _bitCount(0)
+  , _outLen(0)
+{
+  for (uint16_t i = 0; i < HASH_SIZE; ++i) _head[i] = -1;
+
+  // gzip member header: magic, CM=deflate, no flags, no mtime, XFL=0, OS=unknown
+  static const uint8_t header[10] = { 0x1F, 0x8B, 0x08, 0, 0, 0, 0, 0, 0, 0xFF };
+  for (uint8_t i = 0; i < sizeof(header); ++i) _putByte(header[i]);
+
+  // A single fixed-Huffman block carries the whole stream (BFINAL=0, BTYPE=01)
+  _putBits(0x2, 3);
+}
+
+bool GzipWriter::write(const uint8_t* data, size_t len) {
+  if (!_ok) return false;
+  _crc = crc32Update(_crc, data, len);
+  _bytesIn += len;
+
+  while (len > 0) {
+    size_t room = sizeof(_buf) - _len;
+    size_t n = len < room ? len : room;
+    memcpy(_buf + _len, data, n);
+    _len += n;
+    data += n;
+    len -= n;
+
+    if (_len == sizeof(_buf)) {
+      _compress(false);
+      _slide();
+    }
+  }
+  return _ok;
+}
+
+bool GzipWriter::finish() {
+  _compress(true);
+  _emitFixedCode(END_OF_BLOCK);
+
+  // Empty final block terminates the deflate stream
+  _putBits(0x3, 3);
+  _emitFixedCode(END_OF_BLOCK);
+  if (_bitCount > 0) _putBits(0, 8 - _bitCount);
+
+  for (uint8_t i = 0; i < 4; ++i) _putByte(_crc >> (8 * i));
+  for (uint8_t i = 0; i < 4; ++i) _putByte(_bytesIn >> (8 * i));
+  _flushOut();
+  return _ok;
+}
+
+uint16_t GzipWriter::_hash(uint16_t pos) const {
+  uint32_t v = ((uint32_t)_buf[pos] << 16) | ((uint32_t)_buf[pos + 1] << 8) | _buf[pos + 2];
+  return (uint16_t)((v * 2654435761u) >> 23) & (HASH_SIZE - 1);
+}
+
+void GzipWriter::_compress(bool flush) {
+  // Without flush, keep MAX_MATCH bytes of lookahead so matches are never cut short
+  uint16_t limit = flush ? _len : (_len > MAX_MATCH ? _len - MAX_MATCH : 0);
+
+  while (_pos < limit && _ok) {
+    uint16_t bestLen = 0;
+    uint16_t bestDist = 0;
+
+    if (_pos + MIN_MATCH <= _len) {
+      uint16_t h = _hash(_pos);
+      int16_t candidate = _head[h];
+      _head[h] = _pos;
+
+      if (candidate >= 0) {
+        uint16_t maxLen = _len - _pos;
+        if (maxLen > MAX_MATCH) maxLen = MAX_MATCH;
+        uint16_t n = 0;
+        while (n < maxLen && _buf[candidate + n] == _buf[_pos + n]) n++;
+        if (n >= MIN_MATCH) {
+          bestLen = n;
+          bestDist = _pos - candidate;
+        }
+      }
+    }
+
+    if (bestLen) {
+      _emitMatch(bestLen, bestDist);
+      // Index the positions covered by the match so later data can refer to them
+      for (uint16_t i = 1; i < bestLen; ++i) {
+        uint16_t p = _pos + i;
+        if (p + MIN_MATCH <= _len) _head[_hash(p)] = p;
+      }
+      _pos += bestLen;
+    } else {
+      _emitLiteral(_buf[_pos]);
+      _pos++;
+    }
+  }
+}
+
+void GzipWriter::_slide() {
+  // Drop the oldest WINDOW bytes; everything after stays addressable as history
+  uint16_t shift = _pos < WINDOW ? _pos : WINDOW;
+  memmove(_buf, _buf + shift, _len - shift);
+  _len -= shift;
+  _pos -= shift;
+  for (uint16_t i = 0; i < HASH_SIZE; ++i) {
+    _head[i] = _head[i] >= (int16_t)shift ? _head[i] - shift : -1;
+  }
+}
+
+void GzipWriter::_emitLiteral(uint8_t value) {
+  _emitFixedCode(value);
+}
+
+void GzipWriter::_emitMatch(uint16_t length, uint16_t distance) {
+  uint8_t li = 28;
+  while (LENGTH_BASE[li] > length) li--;
+  _emitFixedCode(257 + li);
+  if (LENGTH_EXTRA[li]) _putBits(length - LENGTH_BASE[li], LENGTH_EXTRA[li]);
+
+  uint8_t di = 29;
+  while (DIST_BASE[di] > distance) di--;
+  _putBits(reverseBits(di, 5), 5);
+  if (DIST_EXTRA[di]) _putBits(distance - DIST_BASE[di], DIST_EXTRA[di]);
+}
+
+void GzipWriter::_emitFixedCode(uint16_t symbol) {
+  // Fixed literal/length code from RFC 1951, section 3.2.6
+  if (symbol < 144)      _putBits(reverseBits(0x30 + symbol, 8), 8);
+  else if (symbol < 256) _putBits(reverseBits(0x190 + (symbol - 144), 9), 9);
+  else if (symbol < 280) _putBits(reverseBits(symbol - 256, 7), 7);
+  else                   _putBits(reverseBits(0xC0 + (symbol - 280), 8), 8);
+}
+
+void GzipWriter::_putBits(uint32_t value, uint8_t count) {
+  _bits |= value << _bitCount;
+  _bitCount += count;
+  while (_bitCount >= 8) {
+    _putByte(_bits & 0xFF);
+    _bits >>= 8;
+    _bitCount -= 8;
+  }
+}
+
+void GzipWriter::_putByte(uint8_t value) {
+  _outBuf[_outLen++] = value;
+  if (_outLen == OUT_SIZE) _flushOut();
+}
+
+void GzipWriter::_flushOut() {
+  if (_outLen == 0) return;
+  if (_ok && !_out.write(_outBuf, _outLen)) _ok = false;
+  _bytesOut += _outLen;
+  _outLen = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef GZIPWRITER_H
+#define GZIPWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <core/ByteSink.h>
+
+/**
+ * GzipWriter: streaming gzip (RFC 1952) compressor with bounded memory.
+ *
+ * Input written to it is deflated with a small LZ77 window and the fixed
+ * Huffman code, and the compressed bytes are forwarded to a downstream
+ * ByteSink as they are produced. Nothing but the window (2 x WINDOW bytes),
+ * the hash heads and a small output buffer is kept in RAM, so bodies of any
+ * size can be compressed on the fly.
+ *
+ * This trades some ratio against zlib for a ~4 KB footprint; on repetitive
+ * telemetry text it still removes most of the redundancy.
+ */
+class GzipWriter : public ByteSink {
+  public:
+    static const uint16_t WINDOW   = 1024;  // LZ77 history, bytes
+    static const uint16_t HASH_SIZE = 512;  // hash heads (power of two)
+    static const uint16_t OUT_SIZE = 256;   // output staging buffer
+
+    explicit GzipWriter(ByteSink& out);
+
+    /** Compress and forward data; returns false if the downstream sink failed. */
+    bool write(const uint8_t* data, size_t len) override;
+
+    /** Flush remaining input and write the gzip trailer. Call exactly once. */
+    bool finish();
+
+    /** Uncompressed bytes accepted so far. */
+    uint32_t bytesIn() const { return _bytesIn; }
+
+    /** Compressed bytes (including header/trailer) forwarded so far. */
+    uint32_t bytesOut() const { return _bytesOut; }
+
+  private:
+    ByteSink& _out;
+    bool      _ok;
+    uint32_t  _crc;
+    uint32_t  _bytesIn;
+    uint32_t  _bytesOut;
+
+    // LZ77 state: _buf holds [history | lookahead]; _pos is the next byte to encode.
+    uint8_t   _buf[2 * WINDOW];
+    uint16_t  _len;
+    uint16_t  _pos;
+    int16_t   _head[HASH_SIZE];  // last position per 3-byte hash, -1 if none
+
+    // Bit and byte output
+    uint32_t  _bits;
+    uint8_t   _bitCount;
+    uint8_t   _outBuf[OUT_SIZE];
+    uint16_t  _outLen;
+
+    void _compress(bool flush);
+    void _slide();
+    uint16_t _hash(uint16_t pos) const;
+    void _emitLiteral(uint8_t value);
+    void _emitMatch(uint16_t length, uint16_t distance);
+    void _emitFixedCode(uint16_t symbol);
+    void _putBits(uint32_t value, uint8_t count);
+    void _putByte(uint8_t value);
+    void _flushOut();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "core/Log.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+#define LOG_LOCK()   portENTER_CRITICAL(&logMux)
+#define LOG_UNLOCK() portEXIT_CRITICAL(&logMux)
+#else
+#include <mutex>
+static std::mutex logMutex;
+#define LOG_LOCK()   logMutex.lock()
+#define LOG_UNLOCK() logMutex.unlock()
+#endif
+
+// In RAM a record keeps the site pointer instead of the ID, so the task can format it
+struct RamHeader {
+  uint8_t        length;
+  uint8_t        level;
+  const LogSite* site;
+  uint32_t       time;
+};
+
+static const LogSite DROPPED_SITE = { LOG_ID_DROPPED, LOG_DROPPED_FORMAT };
+
+static uint8_t  ring[LOG_BUFFER_SIZE];
+static uint16_t head = 0;  // next byte written
+static uint16_t used = 0;
+static uint32_t pendingDrops = 0;
+static LogStats counters = { 0, 0, 0 };
+static Print*   output = &Serial;
+static bool     binaryOutput = LOG_BINARY;
+static bool     deferred = false;
+
+static void ringPut(const void* data, uint16_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (uint16_t i = 0; i < len; ++i) {
+    ring[head] = p[i];
+    head = (head + 1) % LOG_BUFFER_SIZE;
+  }
+  used += len;
+}
+
+static void ringGet(uint16_t tail, void* data, uint16_t len) {
+  uint8_t* p = static_cast<uint8_t*>(data);
+  for (uint16_t i = 0; i < len; ++i) p[i] = ring[(tail + i) % LOG_BUFFER_SIZE];
+}
+
+// Caller holds the lock
+static bool enqueue(uint8_t level, const LogSite* site, uint32_t time, const uint8_t* args, size_t len) {
+  RamHeader h = { (uint8_t)(sizeof(RamHeader) + len), level, site, time };
+  if (used + h.length > LOG_BUFFER_SIZE) return false;
+  ringPut(&h, sizeof(h));
+  ringPut(args, (uint16_t)len);
+  if (used > counters.highWater) counters.highWater = used;
+  return true;
+}
+
+void Log::write(uint8_t level, const LogSite& site, const uint8_t* args, size_t len) {
+  uint32_t now = millis();
+  LOG_LOCK();
+  bool ok = true;
+  if (pendingDrops) {
+    uint8_t marker[5];
+    size_t n = logPut(marker, sizeof(marker), pendingDrops);
+    // The marker only goes in together with the record that follows it
+    ok = used + 2 * sizeof(RamHeader) + n + len <= LOG_BUFFER_SIZE;
+    if (ok) {
+      enqueue(LOG_LEVEL_WARN, &DROPPED_SITE, now, marker, n);
+      pendingDrops = 0;
+    }
+  }
+  if (ok) ok = enqueue(level, &site, now, args, len);
+  if (ok) {
+    counters.written++;
+  } else {
+    counters.dropped++;
+    pendingDrops++;
+  }
+  LOG_UNLOCK();
+
+  if (!deferred) drain();
+}
+
+size_t Log::drain(size_t maxRecords) {
+  size_t count = 0;
+  uint8_t record[sizeof(RamHeader) + LOG_MAX_ARGS];
+  while (count < maxRecords) {
+    LOG_LOCK();
+    if (used == 0) {
+      LOG_UNLOCK();
+      break;
+    }
+    uint16_t tail = (head + LOG_BUFFER_SIZE - used) % LOG_BUFFER_SIZE;
+    RamHeader h;
+    ringGet(tail, &h, sizeof(h));
+    ringGet(tail, record, h.length);
+    used -= h.length;
+    LOG_UNLOCK();
+
+    const uint8_t* args = record + sizeof(RamHeader);
+    size_t argLen = h.length - sizeof(RamHeader);
+    if (binaryOutput) {
+      uint8_t frame[2 + LOG_HEADER];
+      frame[0] = LOG_SYNC0;
+      frame[1] = LOG_SYNC1;
+      frame[2] = (uint8_t)(LOG_HEADER + argLen);
+      frame[3] = h.level;
+      for (uint8_t i = 0; i < 4; ++i) frame[4 + i] = (uint8_t)(h.site->id >> (8 * i));
+      for (uint8_t i = 0; i < 4; ++i) frame[8 + i] = (uint8_t)(h.time >> (8 * i));
+      output->write(frame, sizeof(frame));
+      output->write(args, argLen);
+    } else {
+      char line[200];
+      int n = snprintf(line, sizeof(line), "[%8lu] %c ", (unsigned long)h.time, logLevelTag(h.level));
+      n += logFormat(line + n, sizeof(line) - n - 1, h.site->format, args, argLen);
+      line[n++] = '\n';
+      output->write((const uint8_t*)line, n);
+    }
+    count++;
+  }
+  return count;
+}
+
+LogStats Log::stats() {
+  LOG_LOCK();
+  LogStats s = counters;
+  LOG_UNLOCK();
+  return s;
+}
+
+#ifdef ESP_PLATFORM
+static void logTask(void*) {
+  for (;;) {
+    if (Log::drain(8) == 0) vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+#endif
+
+void Log::begin(Print& out, bool binary) {
+  LOG_LOCK();
+  output = &out;
+  binaryOutput = binary;
+  LOG_UNLOCK();
+#ifdef ESP_PLATFORM
+  if (!deferred) {
+    // Idle priority: records only reach Serial when nothing else wants the CPU
+    xTaskCreatePinnedToCore(logTask, "log", 3072, nullptr, tskIDLE_PRIORITY, nullptr, ARDUINO_RUNNING_CORE);
+    deferred = true;
+  }
+#endif
+}
@@ -0,0 +1,106 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <core/LogFormat.h>
+
+/**
+ * Deferred logging.
+ *
+ *   LOG_WARN("POST %s failed, code=%d", path, status);
+ *
+ * - Levels above LOG_LEVEL compile to nothing. Their arguments are not
+ *   even evaluated.
+ * - An enabled call copies the format ID and the raw arguments into a RAM
+ *   ring (see core/LogFormat.h). That costs a few hundred cycles and does
+ *   no formatting and no Serial I/O.
+ * - A low-priority task drains the ring to Serial, as text or as binary
+ *   frames (LOG_BINARY=1) for tools/log/log_decode.
+ * - If the ring is full, the record is dropped and counted, and the next
+ *   record that fits is preceded by a "dropped" marker. A call never
+ *   blocks.
+ *
+ * Until Log::begin() starts the task, and in host builds, each call
+ * drains synchronously, so early boot messages are not lost. Not for use
+ * in ISRs.
+ */
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_BINARY
+#define LOG_BINARY 0
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 2048
+#endif
+
+/** A call site: format ID and the format itself, for on-device text output. */
+struct LogSite {
+  uint32_t    id;
+  const char* format;
+};
+
+/** Never called; lets the compiler check formats against arguments. */
+inline void logCheckFormat(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void logCheckFormat(const char*, ...) {}
+
+#define LOG_AT(level, fmt, ...) do { \
+    static constexpr LogSite _logSite = { logHash(fmt), fmt }; \
+    if (0) logCheckFormat(fmt, ##__VA_ARGS__); \
+    uint8_t _logArgs[LOG_MAX_ARGS]; \
+    size_t _logLen = logEncode(_logArgs, sizeof(_logArgs), ##__VA_ARGS__); \
+    Log::write(level, _logSite, _logLen ? _logArgs : nullptr, _logLen); \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do {} while (0)
+#endif
+
+/** Ring buffer counters. */
+struct LogStats {
+  uint32_t written;
+  uint32_t dropped;
+  uint16_t highWater;  // most bytes ever queued
+};
+
+class Log {
+  public:
+    /**
+     * Send records to out from now on, from a low-priority task.
+     * @param binary  Frames for tools/log/log_decode instead of text.
+     */
+    static void begin(Print& out, bool binary = LOG_BINARY);
+
+    /** Queue one record; used by the LOG_* macros. */
+    static void write(uint8_t level, const LogSite& site, const uint8_t* args, size_t len);
+
+    /** Output up to maxRecords queued records in the caller's context; returns how many. */
+    static size_t drain(size_t maxRecords = 0xFFFF);
+
+    static LogStats stats();
+};
+
+#endif
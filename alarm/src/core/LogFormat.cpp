@@ -0,0 +1,148 @@
+#include "core/LogFormat.h"
+#include <stdio.h>
+
+namespace {
+
+struct Arg {
+  uint8_t     type;
+  uint64_t    bits;
+  const char* str;
+  uint8_t     strLen;
+};
+
+bool nextArg(const uint8_t*& p, const uint8_t* end, Arg& arg) {
+  if (p >= end) return false;
+  arg.type = *p++;
+  size_t n = 0;
+  switch (arg.type) {
+    case LOG_ARG_I32:
+    case LOG_ARG_U32:
+    case LOG_ARG_F32: n = 4; break;
+    case LOG_ARG_I64:
+    case LOG_ARG_U64: n = 8; break;
+    case LOG_ARG_STR:
+      if (p >= end) return false;
+      arg.strLen = *p++;
+      if ((size_t)(end - p) < arg.strLen) return false;
+      arg.str = (const char*)p;
+      p += arg.strLen;
+      return true;
+    default: return false;
+  }
+  if ((size_t)(end - p) < n) return false;
+  arg.bits = 0;
+  for (size_t i = 0; i < n; ++i) arg.bits |= (uint64_t)p[i] << (8 * i);
+  p += n;
+  // Sign-extend 32-bit signed values so they can be printed through long long
+  if (arg.type == LOG_ARG_I32) arg.bits = (uint64_t)(int64_t)(int32_t)(uint32_t)arg.bits;
+  return true;
+}
+
+int64_t asSigned(const Arg& a) { return (int64_t)a.bits; }
+
+double asDouble(const Arg& a) {
+  if (a.type != LOG_ARG_F32) return (double)asSigned(a);
+  uint32_t bits = (uint32_t)a.bits;
+  float f;
+  memcpy(&f, &bits, 4);
+  return f;
+}
+
+}  // namespace
+
+char logLevelTag(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_ERROR: return 'E';
+    case LOG_LEVEL_WARN:  return 'W';
+    case LOG_LEVEL_INFO:  return 'I';
+    case LOG_LEVEL_DEBUG: return 'D';
+    default:              return '?';
+  }
+}
+
+size_t logFormat(char* out, size_t capacity, const char* format, const uint8_t* args, size_t len) {
+  if (capacity == 0) return 0;
+  const uint8_t* p = args;
+  const uint8_t* end = args + len;
+  size_t o = 0;
+
+  // Appends snprintf output, clamped to what is left
+  #define EMIT(...) do { \
+      int n_ = snprintf(out + o, capacity - o, __VA_ARGS__); \
+      if (n_ > 0) o += (size_t)n_ < capacity - o ? (size_t)n_ : capacity - o - 1; \
+    } while (0)
+
+  for (const char* f = format; *f && o + 1 < capacity; ++f) {
+    if (*f != '%') {
+      out[o++] = *f;
+      continue;
+    }
+    if (f[1] == '%') {
+      out[o++] = '%';
+      ++f;
+      continue;
+    }
+
+    // Rebuild the spec without length modifiers: flags, width, precision
+    char spec[24];
+    size_t s = 0;
+    spec[s++] = '%';
+    ++f;
+    while (*f && strchr("-+ #0", *f) && s < 8) spec[s++] = *f++;
+    while (*f && ((*f >= '0' && *f <= '9') || *f == '.') && s < 20) spec[s++] = *f++;
+    while (*f && strchr("hlLqjzt", *f)) ++f;
+    char conv = *f;
+    if (!conv) break;
+
+    Arg a = {};
+    if (!nextArg(p, end, a)) {
+      EMIT("<?>");
+      continue;
+    }
+    if (conv == 's') {
+      if (a.type != LOG_ARG_STR) { EMIT("<?>"); continue; }
+      // The encoded string is not NUL-terminated; width and precision from the format still apply
+      char tmp[LOG_MAX_STRING + 1];
+      memcpy(tmp, a.str, a.strLen);
+      tmp[a.strLen] = 0;
+      spec[s++] = 's';
+      spec[s] = 0;
+      EMIT(spec, tmp);
+      continue;
+    }
+    if (a.type == LOG_ARG_STR) {
+      EMIT("<?>");
+      continue;
+    }
+    switch (conv) {
+      case 'd': case 'i':
+        spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = 'd'; spec[s] = 0;
+        EMIT(spec, (long long)asSigned(a));
+        break;
+      case 'u': case 'x': case 'X': case 'o': {
+        // Unsigned conversions of 32-bit values keep 32-bit width (e.g. %x of -1)
+        unsigned long long v = a.type == LOG_ARG_I32 ? (uint32_t)a.bits : a.bits;
+        spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+        EMIT(spec, v);
+        break;
+      }
+      case 'c':
+        spec[s++] = 'c'; spec[s] = 0;
+        EMIT(spec, (int)asSigned(a));
+        break;
+      case 'p':
+        EMIT("0x%llx", (unsigned long long)a.bits);
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec[s++] = conv; spec[s] = 0;
+        EMIT(spec, asDouble(a));
+        break;
+      default:
+        EMIT("<?>");
+        break;
+    }
+  }
+  #undef EMIT
+  out[o] = 0;
+  return o;
+}
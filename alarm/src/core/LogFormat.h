@@ -0,0 +1,133 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * Binary log records, shared by the firmware (core/Log.h) and the host
+ * decoder (tools/log).
+ *
+ * A record carries a format ID and the raw arguments. The text is only
+ * produced when the record is formatted: by the device's log task, or on
+ * the host. The ID is a 32-bit FNV-1a hash of the format string, computed
+ * at compile time. The decoder rebuilds the same table by scanning the
+ * sources.
+ *
+ * Record (little-endian):
+ *   u8 length   whole record, this byte included
+ *   u8 level    LOG_LEVEL_*
+ *   u32 id      format hash (LOG_ID_DROPPED: one U32 argument, the count)
+ *   u32 time    millis()
+ *   arguments   u8 type tag + payload: I32/U32/F32 4 bytes, I64/U64 8 bytes,
+ *               STR u8 length + bytes (truncated to LOG_MAX_STRING)
+ * On the wire every record is preceded by LOG_SYNC0 LOG_SYNC1.
+ *
+ * No Arduino dependencies, so it also builds on the host.
+ */
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+enum LogArgType : uint8_t {
+  LOG_ARG_I32 = 1,
+  LOG_ARG_U32,
+  LOG_ARG_I64,
+  LOG_ARG_U64,
+  LOG_ARG_F32,
+  LOG_ARG_STR
+};
+
+static const uint8_t  LOG_SYNC0 = 0xA5;
+static const uint8_t  LOG_SYNC1 = 0x5A;
+static const uint8_t  LOG_HEADER = 10;
+static const uint8_t  LOG_MAX_RECORD = 128;
+static const uint8_t  LOG_MAX_ARGS = LOG_MAX_RECORD - LOG_HEADER;
+static const uint8_t  LOG_MAX_STRING = 48;
+static const uint32_t LOG_ID_DROPPED = 0;
+#define LOG_DROPPED_FORMAT "log: %u records dropped"
+
+/** FNV-1a over a NUL-terminated string, usable in constant expressions. ID 0 is reserved. */
+constexpr uint32_t logHash(const char* s, uint32_t h = 2166136261u) {
+  return *s ? logHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : (h ? h : 1);
+}
+
+// --- Argument encoding -------------------------------------------------------
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, size_t>::type
+logPut(uint8_t* p, size_t room, T value) {
+  bool wide = sizeof(T) > 4;
+  size_t n = wide ? 9 : 5;
+  if (room < n) return 0;
+  p[0] = std::is_signed<T>::value ? (wide ? LOG_ARG_I64 : LOG_ARG_I32) : (wide ? LOG_ARG_U64 : LOG_ARG_U32);
+  uint64_t v = std::is_signed<T>::value ? (uint64_t)(int64_t)value : (uint64_t)value;
+  for (size_t i = 1; i < n; ++i, v >>= 8) p[i] = (uint8_t)v;
+  return n;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+logPut(uint8_t* p, size_t room, T value) {
+  if (room < 5) return 0;
+  float f = (float)value;
+  uint32_t bits;
+  memcpy(&bits, &f, 4);
+  p[0] = LOG_ARG_F32;
+  for (size_t i = 1; i < 5; ++i, bits >>= 8) p[i] = (uint8_t)bits;
+  return 5;
+}
+
+inline size_t logPut(uint8_t* p, size_t room, const char* s) {
+  if (room < 2) return 0;
+  // Stops at the terminator: strnlen() may read up to its bound, past a short literal
+  size_t max = room - 2 < LOG_MAX_STRING ? room - 2 : LOG_MAX_STRING;
+  size_t len = 0;
+  while (s && len < max && s[len]) len++;
+  p[0] = LOG_ARG_STR;
+  p[1] = (uint8_t)len;
+  if (len) memcpy(p + 2, s, len);
+  return 2 + len;
+}
+
+inline size_t logPut(uint8_t* p, size_t room, char* s) {
+  return logPut(p, room, (const char*)s);
+}
+
+/** Other pointers are logged by address (%p). */
+inline size_t logPut(uint8_t* p, size_t room, const void* ptr) {
+  return logPut(p, room, (uintptr_t)ptr);
+}
+
+inline size_t logEncode(uint8_t*, size_t) {
+  return 0;
+}
+
+/** Encode the arguments into p; arguments that do not fit are left out. */
+template <typename T, typename... Rest>
+inline size_t logEncode(uint8_t* p, size_t room, T first, Rest... rest) {
+  size_t n = logPut(p, room, first);
+  return n + logEncode(p + n, room - n, rest...);
+}
+
+// --- Formatting ---------------------------------------------------------------
+
+/**
+ * printf-style formatting of encoded arguments into out (always
+ * NUL-terminated). Each conversion takes the next argument. Its length
+ * modifier comes from the argument's type, not from the format, so a
+ * mismatched %ld cannot misread memory. Missing or unsuitable arguments
+ * print as "<?>".
+ * @return characters written, excluding the terminator.
+ */
+size_t logFormat(char* out, size_t capacity, const char* format, const uint8_t* args, size_t len);
+
+/** One-letter level tag: E, W, I, D. */
+char logLevelTag(uint8_t level);
+
+#endif
@@ -0,0 +1,119 @@
+#include "core/MotionDetector.h"
+
+static const uint8_t  GRAVITY_SHIFT = 3;                         // low-pass alpha = 1/8
+static const uint8_t  Q = 4;                                     // fractional bits of _g
+static const uint8_t  SETTLE_SAMPLES = 8;                        // before decisions are made
+static const uint16_t QUIET_SAMPLES = 2 * MotionDetector::SAMPLE_HZ;
+static const int32_t  QUIET_MG = 60;
+static const uint8_t  TILT_SAMPLES = MotionDetector::SAMPLE_HZ / 4;
+static const uint8_t  SHAKE_WINDOW = MotionDetector::SAMPLE_HZ;  // one second
+
+// ±4 g full scale: 0.122 mg/LSB, and 125/1024 = 0.12207
+static inline int32_t toMg(int16_t raw) {
+  return ((int32_t)raw * 125) >> 10;
+}
+
+MotionDetector::MotionDetector() {
+  reset();
+}
+
+void MotionDetector::reset() {
+  for (uint8_t i = 0; i < 3; ++i) {
+    _g[i] = 0;
+    _rest[i] = 0;
+  }
+  _hasRest = false;
+  _samples = 0;
+  _quiet = 0;
+  _tilted = 0;
+  _pickedUp = false;
+  _above = false;
+  _peakCount = 0;
+  _refractory = 0;
+  _peakMg = 0;
+  _eventMg = 0;
+}
+
+uint8_t MotionDetector::feed(int16_t x, int16_t y, int16_t z) {
+  int32_t a[3] = { toMg(x), toMg(y), toMg(z) };
+  uint8_t result = None;
+
+  // Seed gravity with the first sample so the filter does not ramp up from zero
+  if (_samples == 0) {
+    for (uint8_t i = 0; i < 3; ++i) _g[i] = a[i] << Q;
+  }
+  int32_t dyn[3];
+  for (uint8_t i = 0; i < 3; ++i) {
+    _g[i] += ((a[i] << Q) - _g[i]) >> GRAVITY_SHIFT;
+    dyn[i] = a[i] - (_g[i] >> Q);
+  }
+  if (_samples < 0xFFFF) _samples++;
+  if (_samples < SETTLE_SAMPLES) return None;
+
+  int32_t dyn2 = dyn[0] * dyn[0] + dyn[1] * dyn[1] + dyn[2] * dyn[2];
+  // Integer square root is only needed for the reported peak, and only when it grows
+  if (dyn2 > (int32_t)_peakMg * _peakMg) {
+    uint32_t rem = (uint32_t)dyn2, root = 0;
+    for (uint32_t bit = 1u << 30; bit; bit >>= 2) {
+      if (rem >= root + bit) {
+        rem -= root + bit;
+        root = (root >> 1) + bit;
+      } else {
+        root >>= 1;
+      }
+    }
+    _peakMg = (uint16_t)(root > 0xFFFF ? 0xFFFF : root);
+  }
+
+  // --- Shake: count rising crossings of SHAKE_MG inside a one-second window ---
+  for (uint8_t i = 0; i < _peakCount; ++i) {
+    if (_peakAge[i] < 0xFF) _peakAge[i]++;
+  }
+  while (_peakCount > 0 && _peakAge[0] > SHAKE_WINDOW) {
+    for (uint8_t i = 1; i < _peakCount; ++i) _peakAge[i - 1] = _peakAge[i];
+    _peakCount--;
+  }
+  bool above = dyn2 > SHAKE_MG * SHAKE_MG;
+  if (above && !_above) {
+    if (_peakCount == SHAKE_PEAKS) {
+      for (uint8_t i = 1; i < _peakCount; ++i) _peakAge[i - 1] = _peakAge[i];
+      _peakCount--;
+    }
+    _peakAge[_peakCount++] = 0;
+  }
+  _above = above;
+  if (_refractory) {
+    _refractory--;
+  } else if (_peakCount >= SHAKE_PEAKS) {
+    result |= Shake;
+    _peakCount = 0;
+    _refractory = SAMPLE_HZ;
+  }
+
+  // --- Rest orientation: learned after a quiet stretch ---
+  _quiet = dyn2 < QUIET_MG * QUIET_MG ? (_quiet < 0xFFFF ? _quiet + 1 : _quiet) : 0;
+  if (_quiet >= QUIET_SAMPLES || !_hasRest) {
+    for (uint8_t i = 0; i < 3; ++i) _rest[i] = _g[i] >> Q;
+    _hasRest = true;
+    if (_quiet >= QUIET_SAMPLES) _pickedUp = false;
+  }
+
+  // --- Picked up: angle(g, rest) > 30°  <=>  dot < cos30 * |g||rest|  <=>  4 dot² < 3 |g|²|rest|² (dot > 0) ---
+  int64_t g0 = _g[0] >> Q, g1 = _g[1] >> Q, g2 = _g[2] >> Q;
+  int64_t dot = g0 * _rest[0] + g1 * _rest[1] + g2 * _rest[2];
+  int64_t gg = g0 * g0 + g1 * g1 + g2 * g2;
+  int64_t rr = (int64_t)_rest[0] * _rest[0] + (int64_t)_rest[1] * _rest[1] + (int64_t)_rest[2] * _rest[2];
+  // Scale to mg/16 so the products stay within 64 bits
+  bool tilted = dot <= 0 || 4 * (dot >> 4) * (dot >> 4) < 3 * (gg >> 4) * (rr >> 4);
+  _tilted = tilted ? (_tilted < 0xFF ? _tilted + 1 : _tilted) : 0;
+  if (_tilted >= TILT_SAMPLES && !_pickedUp) {
+    _pickedUp = true;
+    result |= PickedUp;
+  }
+
+  if (result) {
+    _eventMg = _peakMg;
+    _peakMg = 0;
+  }
+  return result;
+}
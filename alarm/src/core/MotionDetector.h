@@ -0,0 +1,61 @@
+#ifndef MOTIONDETECTOR_H
+#define MOTIONDETECTOR_H
+
+#include <stdint.h>
+
+/**
+ * MotionDetector turns raw accelerometer samples (±4 g range, 52 Hz) into
+ * "shake" and "picked up" decisions using integer arithmetic only.
+ *
+ * - Gravity is tracked per axis with a first-order low-pass (alpha 1/8).
+ *   The dynamic part is the sample minus gravity (a high-pass).
+ * - Shake: at least SHAKE_PEAKS separate excursions of the dynamic
+ *   acceleration above SHAKE_MG within one second.
+ * - Picked up: gravity tilts more than ~30° away from the resting
+ *   orientation and stays there for a quarter second. The resting
+ *   orientation is re-learned after two seconds without motion.
+ *
+ * No Arduino dependencies, so it also builds on the host.
+ */
+class MotionDetector {
+  public:
+    enum Result : uint8_t { None = 0, Shake = 1, PickedUp = 2 };
+
+    static const uint16_t SAMPLE_HZ   = 52;
+    static const int32_t  SHAKE_MG    = 700;
+    static const uint8_t  SHAKE_PEAKS = 4;
+
+    MotionDetector();
+
+    /** Forget all state, including the resting orientation. */
+    void reset();
+
+    /** Feed one sample in raw counts; returns a Result bit set. */
+    uint8_t feed(int16_t x, int16_t y, int16_t z);
+
+    /** Largest dynamic acceleration leading up to the last detection, in mg. */
+    uint16_t eventMg() const { return _eventMg; }
+
+    /** True if the last sample carried more than gravity (above the rest noise floor). */
+    bool moving() const { return _quiet == 0; }
+
+    /** True once a resting orientation has been learned. */
+    bool hasRest() const { return _hasRest; }
+
+  private:
+    int32_t  _g[3];          // gravity estimate, mg in Q4
+    int32_t  _rest[3];       // resting gravity, mg
+    bool     _hasRest;
+    uint16_t _samples;       // since reset, saturating
+    uint16_t _quiet;         // consecutive samples without motion
+    uint8_t  _tilted;        // consecutive samples tilted away from rest
+    bool     _pickedUp;      // latched until the device rests again
+    bool     _above;         // dynamic acceleration currently above SHAKE_MG
+    uint8_t  _peakAge[SHAKE_PEAKS];  // samples since each of the last peaks
+    uint8_t  _peakCount;
+    uint16_t _refractory;    // samples left before another Shake may fire
+    uint16_t _peakMg;        // since the last detection
+    uint16_t _eventMg;
+};
+
+#endif
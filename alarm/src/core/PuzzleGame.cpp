@@ -1,4 +1,6 @@
 #include "core/PuzzleGame.h"
+#include <core/Log.h>
+#include <core/Trace.h>
 
 // Constructor: allocate history buffer and sequence buffer
 PuzzleGame::PuzzleGame(uint8_t numLEDs,
@@ -33,6 +35,7 @@ const uint8_t* PuzzleGame::generateSequence() {
   }
   for (uint8_t i = 0; i < _currentSteps; ++i) {
     sequence[i] = random(0, _numLEDs);
+    TRACE_RANDOM(sequence[i]);
   }
   return sequence;
 }
@@ -69,9 +72,8 @@ void PuzzleGame::_adaptDifficulty() {
   float avgA = _avgAttempts();
   float avgR = _avgReactionTime() / 1000.0f; // convert ms→s
 
-  Serial.print(avgA);
-  Serial.print(avgR);
-  
+  LOG_DEBUG("Puzzle averages: %.2f attempts, %.2fs", avgA, avgR);
+
   bool adapted = false;
 
   // if struggling: shorten & slow down
@@ -87,8 +89,6 @@ void PuzzleGame::_adaptDifficulty() {
     adapted = true;
   }
 
-  Serial.printf(
-    "Adapted → steps: %u, blink: %ums (avgA=%.2f, avgR=%.2fs)\n",
-    _currentSteps, _blinkInterval, avgA, avgR
-  );
+  LOG_INFO("Adapted → steps: %u, blink: %ums (avgA=%.2f, avgR=%.2fs)",
+           _currentSteps, _blinkInterval, avgA, avgR);
 }
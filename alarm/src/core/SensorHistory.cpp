@@ -0,0 +1,266 @@
+#include "core/SensorHistory.h"
+#include <string.h>
+
+// Block counts cover the retention at the worst-case compression measured by
+// tools/history (noisy signal, one sample a minute) with about 30% headroom.
+// 284 blocks of 512 B: 142 KB of flash.
+const SensorHistory::TierSpec SensorHistory::TIERS[TIER_COUNT] = {
+  //  bucket  retention             blocks  channels
+  {      0,   24UL * 3600,              20,  2 },
+  {    300,   7UL * 24 * 3600,          64,  6 },
+  {   3600,   365UL * 24 * 3600,       200,  6 },
+};
+
+static uint32_t bucketStart(uint32_t timestamp, uint32_t size) {
+  return timestamp - timestamp % size;
+}
+
+static int16_t mean(int32_t sum, uint32_t count) {
+  int32_t n = (int32_t)count;
+  return (int16_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+}
+
+SensorHistory::SensorHistory(BlockStorage& storage)
+  : _storage(storage)
+  , _ready(false)
+  , _writers{ SeriesBlockWriter(_blocks[Raw]), SeriesBlockWriter(_blocks[FiveMinute]),
+              SeriesBlockWriter(_blocks[Hourly]) }
+{
+  memset(_dirty, 0, sizeof(_dirty));
+  memset(_lastTs, 0, sizeof(_lastTs));
+  memset(&_fiveMinute, 0, sizeof(_fiveMinute));
+  memset(&_hour, 0, sizeof(_hour));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool SensorHistory::begin() {
+  _ready = true;
+  for (uint8_t t = 0; t < TIER_COUNT; ++t) {
+    if (!_storage.open(t, TIERS[t].blocks, SERIES_BLOCK_SIZE)) _ready = false;
+  }
+  if (!_ready) return false;
+
+  for (uint8_t t = 0; t < TIER_COUNT; ++t) _open((Tier)t);
+
+  // Rebuild the rollups of the current hour from the raw samples
+  if (_lastTs[Raw]) {
+    query(Raw, bucketStart(_lastTs[Raw], TIERS[Hourly].bucketSec), _lastTs[Raw], _restore, this);
+  }
+  return true;
+}
+
+void SensorHistory::_open(Tier tier) {
+  const TierSpec& spec = TIERS[tier];
+  SeriesBlockWriter& writer = _writers[tier];
+
+  // The newest block is the one with the highest sequence number
+  uint32_t head = 0;
+  uint16_t headSlot = 0;
+  SeriesHeader header;
+  for (uint16_t slot = 0; slot < spec.blocks; ++slot) {
+    if (!_storage.read(tier, slot, _scratch, SERIES_HEADER)) continue;
+    if (!header.parse(_scratch) || header.channels != spec.channels) continue;
+    if ((header.seq - 1) % spec.blocks != slot || header.seq <= head) continue;
+    head = header.seq;
+    headSlot = slot;
+  }
+
+  if (head && _storage.read(tier, headSlot, _blocks[tier], SERIES_BLOCK_SIZE) && writer.resume()) {
+    _lastTs[tier] = writer.lastTs();
+  } else {
+    writer.reset(head + 1, spec.channels);
+    _lastTs[tier] = 0;
+  }
+  _dirty[tier] = false;
+}
+
+bool SensorHistory::append(const SensorRecord& record) {
+  if (!_ready) return false;
+  uint32_t ts = record.timestamp;
+  if (ts < MIN_TIMESTAMP || ts <= _lastTs[Raw]) {
+    _stats.rejected++;
+    return false;
+  }
+
+  int16_t values[2] = { record.temperatureCenti, (int16_t)record.humidityCenti };
+  if (!_append(Raw, ts, values)) return false;
+  _stats.appended++;
+  _rollup(ts, record.temperatureCenti, record.humidityCenti);
+  return true;
+}
+
+bool SensorHistory::flush() {
+  bool ok = true;
+  for (uint8_t t = 0; t < TIER_COUNT; ++t) {
+    if (_dirty[t] && !_writeBlock((Tier)t)) ok = false;
+  }
+  return ok;
+}
+
+bool SensorHistory::_append(Tier tier, uint32_t timestamp, const int16_t* values) {
+  SeriesBlockWriter& writer = _writers[tier];
+  if (!writer.append(timestamp, values)) {
+    // Full: write it out and continue in the next (oldest) slot of the ring
+    _writeBlock(tier);
+    writer.reset(writer.seq() + 1, TIERS[tier].channels);
+    if (!writer.append(timestamp, values)) return false;
+  }
+  _dirty[tier] = true;
+  _lastTs[tier] = timestamp;
+  return true;
+}
+
+bool SensorHistory::_writeBlock(Tier tier) {
+  const SeriesBlockWriter& writer = _writers[tier];
+  if (writer.count() == 0) return true;
+
+  _stats.blockWrites++;
+  uint16_t slot = (writer.seq() - 1) % TIERS[tier].blocks;
+  if (!_storage.write(tier, slot, _blocks[tier])) {
+    _stats.writeErrors++;
+    return false;
+  }
+  _dirty[tier] = false;
+  return true;
+}
+
+void SensorHistory::_rollup(uint32_t timestamp, int16_t temperature, uint16_t humidity) {
+  uint32_t bucket = bucketStart(timestamp, TIERS[FiveMinute].bucketSec);
+
+  // A sample from a later bucket closes the current one, which also feeds its hour
+  if (_fiveMinute.count && _fiveMinute.bucket != bucket) {
+    _emit(FiveMinute, _fiveMinute);
+    uint32_t hour = bucketStart(_fiveMinute.bucket, TIERS[Hourly].bucketSec);
+    if (_hour.count && _hour.bucket != hour) {
+      _emit(Hourly, _hour);
+      _hour.count = 0;
+    }
+    _merge(_hour, hour, _fiveMinute);
+    _fiveMinute.count = 0;
+  }
+
+  Rollup sample = { bucket, 1, temperature, humidity, temperature, temperature, humidity, humidity };
+  _merge(_fiveMinute, bucket, sample);
+}
+
+void SensorHistory::_emit(Tier tier, const Rollup& rollup) {
+  // Rollups rebuilt by begin() may repeat buckets that were already stored
+  if (rollup.bucket <= _lastTs[tier]) return;
+
+  int16_t values[6] = {
+    mean(rollup.temperatureSum, rollup.count), rollup.temperatureMin, rollup.temperatureMax,
+    mean((int32_t)rollup.humiditySum, rollup.count),
+    (int16_t)rollup.humidityMin, (int16_t)rollup.humidityMax
+  };
+  _append(tier, rollup.bucket, values);
+}
+
+void SensorHistory::_merge(Rollup& into, uint32_t bucket, const Rollup& from) {
+  if (into.count == 0) {
+    into = from;
+    into.bucket = bucket;
+    return;
+  }
+  into.count += from.count;
+  into.temperatureSum += from.temperatureSum;
+  into.humiditySum += from.humiditySum;
+  if (from.temperatureMin < into.temperatureMin) into.temperatureMin = from.temperatureMin;
+  if (from.temperatureMax > into.temperatureMax) into.temperatureMax = from.temperatureMax;
+  if (from.humidityMin < into.humidityMin) into.humidityMin = from.humidityMin;
+  if (from.humidityMax > into.humidityMax) into.humidityMax = from.humidityMax;
+}
+
+bool SensorHistory::_restore(void* self, const HistoryPoint& point) {
+  static_cast<SensorHistory*>(self)->_rollup(point.timestamp, point.temperatureCenti,
+                                             point.humidityCenti);
+  return true;
+}
+
+uint32_t SensorHistory::_firstSeq(Tier tier) const {
+  // The head block reuses the slot of the block `blocks` before it
+  uint32_t head = _writers[tier].seq();
+  return head > TIERS[tier].blocks ? head - TIERS[tier].blocks + 1 : 1;
+}
+
+bool SensorHistory::_readHeader(Tier tier, uint32_t seq, SeriesHeader& header) {
+  if (seq == _writers[tier].seq()) return header.parse(_blocks[tier]);
+  uint16_t slot = (seq - 1) % TIERS[tier].blocks;
+  return _storage.read(tier, slot, _scratch, SERIES_HEADER) &&
+         header.parse(_scratch) && header.seq == seq;
+}
+
+uint32_t SensorHistory::oldest(Tier tier) {
+  if (!_ready) return 0;
+  SeriesHeader header;
+  for (uint32_t seq = _firstSeq(tier); seq <= _writers[tier].seq(); ++seq) {
+    if (_readHeader(tier, seq, header) && header.count > 0) return header.firstTs;
+  }
+  return 0;
+}
+
+SensorHistory::Tier SensorHistory::tierFor(uint32_t from) {
+  Tier best = Raw;
+  uint32_t bestOldest = 0;
+  for (uint8_t t = 0; t < TIER_COUNT; ++t) {
+    uint32_t first = oldest((Tier)t);
+    if (first == 0) continue;
+    if (first <= from) return (Tier)t;
+    if (bestOldest == 0 || first < bestOldest) {
+      best = (Tier)t;
+      bestOldest = first;
+    }
+  }
+  return best;
+}
+
+uint32_t SensorHistory::query(Tier tier, uint32_t from, uint32_t to,
+                              HistoryVisitor visitor, void* context) {
+  if (!_ready || from > to) return 0;
+  uint32_t head = _writers[tier].seq();
+  SeriesHeader header;
+
+  // Blocks are in time order: binary search for the first one ending at or after `from`
+  uint32_t lo = _firstSeq(tier);
+  uint32_t hi = head;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (_readHeader(tier, mid, header) && header.lastTs >= from) hi = mid;
+    else lo = mid + 1;
+  }
+
+  uint32_t visited = 0;
+  for (uint32_t seq = lo; seq <= head; ++seq) {
+    const uint8_t* block = _blocks[tier];
+    if (seq != head) {
+      uint16_t slot = (seq - 1) % TIERS[tier].blocks;
+      if (!_storage.read(tier, slot, _scratch, SERIES_BLOCK_SIZE)) continue;
+      block = _scratch;
+    }
+    if (!header.parse(block) || header.seq != seq || header.lastTs < from) continue;
+    if (header.firstTs > to) break;
+
+    SeriesBlockReader reader(block);
+    uint32_t ts;
+    int16_t v[SERIES_MAX_CHANNELS];
+    while (reader.next(ts, v)) {
+      if (ts < from) continue;
+      if (ts > to) return visited;
+      HistoryPoint point;
+      point.timestamp = ts;
+      if (reader.header().channels == 2) {
+        point.temperatureCenti = point.temperatureMin = point.temperatureMax = v[0];
+        point.humidityCenti = point.humidityMin = point.humidityMax = (uint16_t)v[1];
+      } else {
+        point.temperatureCenti = v[0];
+        point.temperatureMin = v[1];
+        point.temperatureMax = v[2];
+        point.humidityCenti = (uint16_t)v[3];
+        point.humidityMin = (uint16_t)v[4];
+        point.humidityMax = (uint16_t)v[5];
+      }
+      visited++;
+      if (!visitor(context, point)) return visited;
+    }
+  }
+  return visited;
+}
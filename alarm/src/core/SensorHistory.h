@@ -0,0 +1,128 @@
+#ifndef SENSORHISTORY_H
+#define SENSORHISTORY_H
+
+#include <stdint.h>
+#include <core/BlockStorage.h>
+#include <core/SeriesBlock.h>
+#include <core/TelemetryEncoder.h>
+
+/** One point returned by SensorHistory::query(). */
+struct HistoryPoint {
+  uint32_t timestamp;         // epoch seconds; start of the bucket for rollups
+  int16_t  temperatureCenti;  // °C x 100, mean over the bucket
+  int16_t  temperatureMin;
+  int16_t  temperatureMax;
+  uint16_t humidityCenti;     // % x 100, mean over the bucket
+  uint16_t humidityMin;
+  uint16_t humidityMax;
+};
+
+/** Receives query results in time order; return false to stop early. */
+typedef bool (*HistoryVisitor)(void* context, const HistoryPoint& point);
+
+struct HistoryStats {
+  uint32_t appended;     // raw samples stored
+  uint32_t rejected;     // clock not set yet, or not newer than the last sample
+  uint32_t blockWrites;
+  uint32_t writeErrors;
+};
+
+/**
+ * SensorHistory keeps the DHT20 readings on flash in three tiers:
+ *
+ *   Raw         every sample (2 channels)              about a day
+ *   FiveMinute  mean/min/max per 5-minute bucket (6)    about a week
+ *   Hourly      mean/min/max per hour (6)               about a year
+ *
+ * Each tier is a ring of compressed SeriesBlocks in one BlockStorage
+ * area; when it is full, the oldest block is overwritten. Block counts
+ * are sized from the compression measured by tools/history, with
+ * headroom. Rollups are built as samples arrive: a bucket is written when
+ * the first sample of a later bucket shows up.
+ *
+ * The newest block of each tier is kept in RAM and reaches flash when it
+ * fills up or on flush(). After a reboot, begin() re-opens those blocks
+ * and rebuilds the rollups of the current hour from the raw tier.
+ *
+ * No Arduino dependencies, so it also builds on the host (see tools/history).
+ */
+class SensorHistory {
+  public:
+    enum Tier : uint8_t { Raw, FiveMinute, Hourly, TIER_COUNT };
+
+    struct TierSpec {
+      uint32_t bucketSec;     // 0 = raw samples
+      uint32_t retentionSec;  // what the block count is sized for
+      uint16_t blocks;
+      uint8_t  channels;
+    };
+    static const TierSpec TIERS[TIER_COUNT];
+
+    /** Samples before this (2020-01-01) mean the clock is not set yet. */
+    static const uint32_t MIN_TIMESTAMP = 1577836800UL;
+
+    explicit SensorHistory(BlockStorage& storage);
+
+    /** Open the storage areas and pick up where the last run stopped. */
+    bool begin();
+
+    /** Store one sample; false if it was rejected or history is unavailable. */
+    bool append(const SensorRecord& record);
+
+    /** Write the partially filled newest blocks to storage. */
+    bool flush();
+
+    /**
+     * Visit the points of one tier with from <= timestamp <= to, oldest
+     * first. The newest, unflushed points are included; rollup buckets
+     * still being filled are not. Returns the number of points visited.
+     * Not reentrant: the visitor must not call back into SensorHistory.
+     */
+    uint32_t query(Tier tier, uint32_t from, uint32_t to, HistoryVisitor visitor, void* context);
+
+    /** The finest tier that still reaches back to `from`, else the one reaching back furthest. */
+    Tier tierFor(uint32_t from);
+
+    /** Timestamp of the oldest point in a tier, or 0 if it is empty. */
+    uint32_t oldest(Tier tier);
+
+    /** Timestamp of the newest point in a tier, or 0 if it is empty. */
+    uint32_t newest(Tier tier) const { return _lastTs[tier]; }
+
+    const HistoryStats& stats() const { return _stats; }
+
+  private:
+    // Running mean/min/max of one bucket
+    struct Rollup {
+      uint32_t bucket;  // start, epoch seconds
+      uint32_t count;
+      int32_t  temperatureSum;
+      uint32_t humiditySum;
+      int16_t  temperatureMin, temperatureMax;
+      uint16_t humidityMin, humidityMax;
+    };
+
+    BlockStorage&     _storage;
+    bool              _ready;
+    uint8_t           _blocks[TIER_COUNT][SERIES_BLOCK_SIZE];
+    uint8_t           _scratch[SERIES_BLOCK_SIZE];  // flash blocks being queried
+    SeriesBlockWriter _writers[TIER_COUNT];
+    bool              _dirty[TIER_COUNT];
+    uint32_t          _lastTs[TIER_COUNT];
+    Rollup            _fiveMinute;
+    Rollup            _hour;
+    HistoryStats      _stats;
+
+    void _open(Tier tier);
+    bool _append(Tier tier, uint32_t timestamp, const int16_t* values);
+    bool _writeBlock(Tier tier);
+    void _rollup(uint32_t timestamp, int16_t temperature, uint16_t humidity);
+    void _emit(Tier tier, const Rollup& rollup);
+    uint32_t _firstSeq(Tier tier) const;
+    bool _readHeader(Tier tier, uint32_t seq, SeriesHeader& header);
+
+    static void _merge(Rollup& into, uint32_t bucket, const Rollup& from);
+    static bool _restore(void* self, const HistoryPoint& point);
+};
+
+#endif
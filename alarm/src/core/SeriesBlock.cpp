@@ -0,0 +1,245 @@
+#include "core/SeriesBlock.h"
+#include <string.h>
+
+static const uint16_t PAYLOAD_BITS = (SERIES_BLOCK_SIZE - SERIES_HEADER) * 8;
+
+// Variable-length codes after the 1-bit '0' for zero: prefix, prefix bits, value bits
+struct Bucket {
+  uint8_t prefix;
+  uint8_t prefixBits;
+  uint8_t valueBits;
+};
+
+static const Bucket TS_BUCKETS[4] = {
+  { 0x2, 2, 7 }, { 0x6, 3, 9 }, { 0xE, 4, 12 }, { 0xF, 4, 32 }
+};
+// The last value bucket carries the value itself rather than the delta
+static const Bucket VALUE_BUCKETS[4] = {
+  { 0x2, 2, 4 }, { 0x6, 3, 7 }, { 0xE, 4, 10 }, { 0xF, 4, 16 }
+};
+
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Bucket index for a zigzagged value, or -1 for the 1-bit zero code
+static int8_t bucketFor(uint32_t zz, const Bucket* buckets) {
+  if (zz == 0) return -1;
+  for (int8_t i = 0; i < 3; ++i) {
+    if (zz < (1u << buckets[i].valueBits)) return i;
+  }
+  return 3;
+}
+
+static uint8_t codeBits(uint32_t zz, const Bucket* buckets) {
+  int8_t b = bucketFor(zz, buckets);
+  return b < 0 ? 1 : buckets[b].prefixBits + buckets[b].valueBits;
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool SeriesHeader::parse(const uint8_t* block) {
+  seq      = getU32(block);
+  firstTs  = getU32(block + 4);
+  lastTs   = getU32(block + 8);
+  count    = block[12] | (block[13] << 8);
+  channels = block[14];
+  return seq != 0 && block[15] == SERIES_MAGIC &&
+         channels > 0 && channels <= SERIES_MAX_CHANNELS && lastTs >= firstTs;
+}
+
+SeriesBlockWriter::SeriesBlockWriter(uint8_t* block)
+  : _block(block)
+  , _seq(0)
+  , _firstTs(0)
+  , _lastTs(0)
+  , _lastDelta(0)
+  , _count(0)
+  , _bits(0)
+  , _channels(1)
+{
+  memset(_last, 0, sizeof(_last));
+}
+
+void SeriesBlockWriter::reset(uint32_t seq, uint8_t channels) {
+  memset(_block, 0, SERIES_BLOCK_SIZE);
+  _seq = seq;
+  _channels = channels > SERIES_MAX_CHANNELS ? SERIES_MAX_CHANNELS : channels;
+  _firstTs = _lastTs = 0;
+  _lastDelta = 0;
+  _count = 0;
+  _bits = 0;
+  _writeHeader();
+}
+
+bool SeriesBlockWriter::resume() {
+  SeriesHeader header;
+  if (!header.parse(_block)) return false;
+  SeriesBlockReader reader(_block);
+
+  // Replay the points to recover the encoder state; the bits stay as they are
+  _seq = header.seq;
+  _channels = header.channels;
+  _count = 0;
+  uint32_t ts;
+  uint32_t previous = 0;
+  while (reader.next(ts, _last)) {
+    _lastDelta = _count > 0 ? (int32_t)(ts - previous) : 0;
+    previous = ts;
+    _count++;
+  }
+  if (_count != header.count) return false;
+  _firstTs = header.firstTs;
+  _lastTs = previous;
+  _bits = reader.bitsRead();
+  // Clear anything past the last point so new bits can be OR-ed in
+  uint16_t used = (_bits + 7) / 8;
+  if (_bits & 7) _block[SERIES_HEADER + used - 1] &= 0xFF << (8 - (_bits & 7));
+  memset(_block + SERIES_HEADER + used, 0, SERIES_BLOCK_SIZE - SERIES_HEADER - used);
+  return true;
+}
+
+bool SeriesBlockWriter::append(uint32_t timestamp, const int16_t* values) {
+  if (_count == 0) {
+    if (_bits + 16u * _channels > PAYLOAD_BITS) return false;
+    for (uint8_t c = 0; c < _channels; ++c) {
+      _putBits((uint16_t)values[c], 16);
+      _last[c] = values[c];
+    }
+    _firstTs = _lastTs = timestamp;
+    _lastDelta = 0;
+    _count = 1;
+    _writeHeader();
+    return true;
+  }
+
+  // Size the point first, so a full block is left untouched
+  int32_t delta = (int32_t)(timestamp - _lastTs);
+  uint32_t dod = zigzag(delta - _lastDelta);
+  uint32_t deltas[SERIES_MAX_CHANNELS];
+  uint16_t bits = codeBits(dod, TS_BUCKETS);
+  for (uint8_t c = 0; c < _channels; ++c) {
+    deltas[c] = zigzag((int32_t)values[c] - _last[c]);
+    bits += codeBits(deltas[c], VALUE_BUCKETS);
+  }
+  if (_bits + bits > PAYLOAD_BITS || _count == 0xFFFF) return false;
+
+  int8_t b = bucketFor(dod, TS_BUCKETS);
+  if (b < 0) {
+    _putBits(0, 1);
+  } else {
+    _putBits(TS_BUCKETS[b].prefix, TS_BUCKETS[b].prefixBits);
+    _putBits(dod, TS_BUCKETS[b].valueBits);
+  }
+  for (uint8_t c = 0; c < _channels; ++c) {
+    b = bucketFor(deltas[c], VALUE_BUCKETS);
+    if (b < 0) {
+      _putBits(0, 1);
+    } else {
+      _putBits(VALUE_BUCKETS[b].prefix, VALUE_BUCKETS[b].prefixBits);
+      _putBits(b == 3 ? (uint16_t)values[c] : deltas[c], VALUE_BUCKETS[b].valueBits);
+    }
+    _last[c] = values[c];
+  }
+
+  _lastDelta = delta;
+  _lastTs = timestamp;
+  _count++;
+  _writeHeader();
+  return true;
+}
+
+void SeriesBlockWriter::_putBits(uint32_t value, uint8_t count) {
+  uint8_t* payload = _block + SERIES_HEADER;
+  while (count > 0) {
+    uint8_t room = 8 - (_bits & 7);
+    uint8_t n = count < room ? count : room;
+    uint8_t chunk = (value >> (count - n)) & ((1u << n) - 1);
+    payload[_bits >> 3] |= chunk << (room - n);
+    _bits += n;
+    count -= n;
+  }
+}
+
+void SeriesBlockWriter::_writeHeader() {
+  putU32(_block, _seq);
+  putU32(_block + 4, _firstTs);
+  putU32(_block + 8, _lastTs);
+  _block[12] = _count;
+  _block[13] = _count >> 8;
+  _block[14] = _channels;
+  _block[15] = SERIES_MAGIC;
+}
+
+SeriesBlockReader::SeriesBlockReader(const uint8_t* block)
+  : _block(block)
+  , _index(0)
+  , _bits(0)
+  , _lastTs(0)
+  , _lastDelta(0)
+  , _overrun(false)
+{
+  if (!_header.parse(block)) _header.count = 0;
+  memset(_last, 0, sizeof(_last));
+}
+
+bool SeriesBlockReader::next(uint32_t& timestamp, int16_t* values) {
+  if (_index >= _header.count || _overrun) return false;
+
+  if (_index == 0) {
+    for (uint8_t c = 0; c < _header.channels; ++c) _last[c] = (int16_t)_getBits(16);
+    _lastTs = _header.firstTs;
+    _lastDelta = 0;
+  } else {
+    int32_t dod = 0;
+    if (_getBits(1)) {
+      uint8_t b = 0;
+      while (b < 3 && _getBits(1)) b++;
+      dod = unzigzag(_getBits(TS_BUCKETS[b].valueBits));
+    }
+    _lastDelta += dod;
+    _lastTs += _lastDelta;
+
+    for (uint8_t c = 0; c < _header.channels; ++c) {
+      if (!_getBits(1)) continue;
+      uint8_t b = 0;
+      while (b < 3 && _getBits(1)) b++;
+      uint32_t v = _getBits(VALUE_BUCKETS[b].valueBits);
+      _last[c] = b == 3 ? (int16_t)v : (int16_t)(_last[c] + unzigzag(v));
+    }
+  }
+  if (_overrun) return false;
+
+  timestamp = _lastTs;
+  memcpy(values, _last, _header.channels * sizeof(int16_t));
+  _index++;
+  return true;
+}
+
+uint32_t SeriesBlockReader::_getBits(uint8_t count) {
+  if (_bits + count > PAYLOAD_BITS) {
+    _overrun = true;
+    return 0;
+  }
+  const uint8_t* payload = _block + SERIES_HEADER;
+  uint32_t value = 0;
+  while (count > 0) {
+    uint8_t room = 8 - (_bits & 7);
+    uint8_t n = count < room ? count : room;
+    uint8_t chunk = (payload[_bits >> 3] >> (room - n)) & ((1u << n) - 1);
+    value = (value << n) | chunk;
+    _bits += n;
+    count -= n;
+  }
+  return value;
+}
@@ -0,0 +1,119 @@
+#ifndef SERIESBLOCK_H
+#define SERIESBLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Compressed block of time-series points (timestamp + up to
+ * SERIES_MAX_CHANNELS fixed-point values), after Facebook's Gorilla.
+ *
+ * Layout (little endian):
+ *   0  u32 seq       position in the tier's ring, 0 = never written
+ *   4  u32 firstTs   epoch seconds of the first point
+ *   8  u32 lastTs    and of the last one
+ *  12  u16 count
+ *  14  u8  channels
+ *  15  u8  magic     SERIES_MAGIC
+ *  16  bit stream, MSB first:
+ *        first point: each value as 16 raw bits
+ *        then per point: timestamp delta-of-delta, then each value as a
+ *        delta from the previous value of the same channel
+ *
+ * Timestamp delta-of-delta (zigzag):  0 -> '0'
+ *   '10' + 7 bits | '110' + 9 bits | '1110' + 12 bits | '1111' + 32 bits
+ * Value delta (zigzag):  0 -> '0'
+ *   '10' + 4 bits | '110' + 7 bits | '1110' + 10 bits | '1111' + the value
+ *
+ * A steady sample rate costs 1 bit per timestamp, and an unchanged
+ * reading 1 bit per channel. Values are integers (centi-units, see
+ * TelemetryEncoder.h), so deltas are used rather than Gorilla's float XOR.
+ *
+ * No Arduino dependencies, so it also builds on the host (see tools/history).
+ */
+
+static const uint16_t SERIES_BLOCK_SIZE   = 512;
+static const uint8_t  SERIES_HEADER       = 16;
+static const uint8_t  SERIES_MAX_CHANNELS = 6;
+static const uint8_t  SERIES_MAGIC        = 0x53;
+
+/** Fields of a block header. */
+struct SeriesHeader {
+  uint32_t seq;
+  uint32_t firstTs;
+  uint32_t lastTs;
+  uint16_t count;
+  uint8_t  channels;
+
+  /** Parse the first SERIES_HEADER bytes of a block; false if it holds no valid block. */
+  bool parse(const uint8_t* block);
+};
+
+/** Appends points to a block in caller-provided memory. */
+class SeriesBlockWriter {
+  public:
+    explicit SeriesBlockWriter(uint8_t* block);
+
+    /** Start an empty block. */
+    void reset(uint32_t seq, uint8_t channels);
+
+    /**
+     * Re-open a block that was written out earlier (e.g. after a reboot), so
+     * appending continues where it stopped. Returns false if it is not valid.
+     */
+    bool resume();
+
+    /** Append a point; false (and nothing written) if the block is full. */
+    bool append(uint32_t timestamp, const int16_t* values);
+
+    uint32_t seq() const { return _seq; }
+    uint16_t count() const { return _count; }
+    uint32_t firstTs() const { return _firstTs; }
+    uint32_t lastTs() const { return _lastTs; }
+    uint8_t  channels() const { return _channels; }
+    /** Bytes used so far, header included. */
+    uint16_t bytesUsed() const { return SERIES_HEADER + (_bits + 7) / 8; }
+
+  private:
+    uint8_t* _block;
+    uint32_t _seq;
+    uint32_t _firstTs;
+    uint32_t _lastTs;
+    int32_t  _lastDelta;
+    uint16_t _count;
+    uint16_t _bits;      // used in the bit stream
+    uint8_t  _channels;
+    int16_t  _last[SERIES_MAX_CHANNELS];
+
+    void _putBits(uint32_t value, uint8_t count);
+    void _writeHeader();
+};
+
+/** Iterates over the points of a block. */
+class SeriesBlockReader {
+  public:
+    /** The block must stay valid while reading. An invalid block reads as empty. */
+    explicit SeriesBlockReader(const uint8_t* block);
+
+    const SeriesHeader& header() const { return _header; }
+
+    /** Decode the next point; false once all points were read. */
+    bool next(uint32_t& timestamp, int16_t* values);
+
+    /** Position in the bit stream, i.e. bits taken by the points read so far. */
+    uint16_t bitsRead() const { return _bits; }
+
+  private:
+    const uint8_t* _block;
+    SeriesHeader   _header;
+    uint16_t       _index;
+    uint16_t       _bits;
+    uint32_t       _lastTs;
+    int32_t        _lastDelta;
+    int16_t        _last[SERIES_MAX_CHANNELS];
+    bool           _overrun;  // the header claims more points than the stream holds
+
+    uint32_t _getBits(uint8_t count);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Sha256: incremental SHA-256 (FIPS 180-4) in portable C++.
+ *
+ * Used to identify firmware images and to verify what an update wrote, on
+ * the device and in the host tools alike, so both sides hash exactly the
+ * same way. 112 bytes of state; no heap.
+ */
+class Sha256 {
+  public:
+    static const uint8_t DIGEST_SIZE = 32;
+
+    Sha256() { reset(); }
+
+    void reset();
+    void update(const uint8_t* data, size_t len);
+
+    /** Write the digest and reset for the next message. */
+    void finish(uint8_t digest[DIGEST_SIZE]);
+
+  private:
+    uint32_t _state[8];
+    uint64_t _length;    // message bytes so far
+    uint8_t  _block[64];
+    uint8_t  _used;      // bytes in _block
+
+    void _compress(const uint8_t* block);
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "StatusScreen.h"
+
+// Clock, next alarm, environment, puzzle (see the layout in StatusScreen.h)
+const StatusScreen::Area StatusScreen::AREAS[StatusScreen::WIDGET_COUNT] = {
+  {   0, 54 },
+  {  54, 27 },
+  {  81, 27 },
+  { 108, 27 },
+};
+
+// Widgets in redraw order: input feedback first, slow-changing lines last
+static const uint8_t DRAW_ORDER[] = { 3, 0, 1, 2 };
+
+static const uint16_t COLOR_TEXT   = TFT_WHITE;
+static const uint16_t COLOR_DIM    = TFT_DARKGREY;
+static const uint16_t COLOR_ACCENT = TFT_ORANGE;
+static const char* const WEEKDAYS[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+StatusScreen::StatusScreen(DisplayDriver& display, const AlarmScheduler& scheduler)
+  : _display(display)
+  , _scheduler(scheduler)
+  , _dirty(0)
+  , _painting(CLOCK)
+  , _now()
+  , _timeValid(false)
+  , _hasEnvironment(false)
+  , _temperatureDeci(0)
+  , _humidityPercent(0)
+  , _puzzle{PuzzleView::Idle, 0, 0, 0}
+{}
+
+void StatusScreen::begin() {
+  _dirty = (1 << WIDGET_COUNT) - 1;
+}
+
+void StatusScreen::setEnvironment(float temperature, float humidity) {
+  int16_t t = (int16_t)lroundf(temperature * 10);
+  int16_t h = (int16_t)lroundf(humidity);
+  if (_hasEnvironment && t == _temperatureDeci && h == _humidityPercent) return;
+  _hasEnvironment = true;
+  _temperatureDeci = t;
+  _humidityPercent = h;
+  _dirty |= bit(ENVIRONMENT);
+}
+
+void StatusScreen::setPuzzle(const PuzzleView& view) {
+  if (view.phase == _puzzle.phase && view.attempt == _puzzle.attempt &&
+      view.entered == _puzzle.entered && view.steps == _puzzle.steps) return;
+  _puzzle = view;
+  _dirty |= bit(PUZZLE);
+}
+
+void StatusScreen::_refreshClock() {
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+  bool valid = local.tm_year >= (2020 - 1900);  // before NTP sync the clock starts at 1970
+
+  if (valid != _timeValid || local.tm_sec != _now.tm_sec || local.tm_min != _now.tm_min) {
+    _dirty |= bit(CLOCK);
+  }
+  // "Today"/"tomorrow" and passed alarms change with the minute
+  if (valid != _timeValid || local.tm_min != _now.tm_min) {
+    _dirty |= bit(NEXT_ALARM);
+  }
+  _now = local;
+  _timeValid = valid;
+}
+
+bool StatusScreen::update(uint32_t budgetUs) {
+  _refreshClock();
+  if (!_dirty) return true;
+
+  uint32_t start = micros();
+  uint8_t deferred = 0;
+  bool drawn = false;
+  _display.beginFrame();
+
+  for (uint8_t i = 0; i < sizeof(DRAW_ORDER); ++i) {
+    Widget w = (Widget)DRAW_ORDER[i];
+    if (!(_dirty & bit(w))) continue;
+
+    // Skip what would not fit, but always make progress with at least one widget
+    uint8_t bands = (AREAS[w].rows + DisplayDriver::STRIP_ROWS - 1) / DisplayDriver::STRIP_ROWS;
+    uint32_t estimate = bands * _display.bandCostUs();
+    if (drawn && micros() - start + estimate > budgetUs) {
+      deferred++;
+      continue;
+    }
+
+    _painting = w;
+    _display.renderRows(AREAS[w].top, AREAS[w].rows, *this);
+    _dirty &= ~bit(w);
+    drawn = true;
+  }
+
+  _display.endFrame(budgetUs, deferred);
+  return _dirty == 0;
+}
+
+void StatusScreen::paint(TFT_eSprite& strip, int16_t top) {
+  int16_t y = AREAS[_painting].top - top;  // widget origin in strip coordinates
+  switch (_painting) {
+    case CLOCK:       _paintClock(strip, y); break;
+    case NEXT_ALARM:  _paintNextAlarm(strip, y); break;
+    case ENVIRONMENT: _paintEnvironment(strip, y); break;
+    case PUZZLE:      _paintPuzzle(strip, y); break;
+    default: break;
+  }
+}
+
+void StatusScreen::_paintClock(TFT_eSprite& s, int16_t y) {
+  char hm[6];
+  char sec[3];
+  if (_timeValid) {
+    snprintf(hm, sizeof(hm), "%02d:%02d", _now.tm_hour, _now.tm_min);
+    snprintf(sec, sizeof(sec), "%02d", _now.tm_sec);
+  } else {
+    strcpy(hm, "--:--");
+    strcpy(sec, "--");
+  }
+  s.setTextColor(COLOR_TEXT);
+  s.setTextDatum(TL_DATUM);
+  s.drawString(hm, 8, y + 3, 7);
+  s.setTextColor(COLOR_DIM);
+  s.setTextDatum(BR_DATUM);
+  s.drawString(sec, DisplayDriver::WIDTH - 8, y + 51, 4);
+}
+
+void StatusScreen::_paintNextAlarm(TFT_eSprite& s, int16_t y) {
+  char line[32];
+  uint8_t hour, minute, days;
+  if (_timeValid && _scheduler.nextAlarm(_now, hour, minute, days)) {
+    const char* when = days == 0 ? "today" : days == 1 ? "tomorrow" : WEEKDAYS[(_now.tm_wday + days) % 7];
+    snprintf(line, sizeof(line), "Alarm %02u:%02u %s", hour, minute, when);
+    s.setTextColor(COLOR_ACCENT);
+  } else {
+    snprintf(line, sizeof(line), _scheduler.alarmCount() ? "Alarm --:--" : "No alarm");
+    s.setTextColor(COLOR_DIM);
+  }
+  s.setTextDatum(ML_DATUM);
+  s.drawString(line, 8, y + 13, 4);
+}
+
+void StatusScreen::_paintEnvironment(TFT_eSprite& s, int16_t y) {
+  char line[32];
+  if (_hasEnvironment) {
+    snprintf(line, sizeof(line), "%d.%d C   %d %%",
+             _temperatureDeci / 10, abs(_temperatureDeci % 10), _humidityPercent);
+  } else {
+    strcpy(line, "--.- C   -- %");
+  }
+  s.setTextColor(COLOR_TEXT);
+  s.setTextDatum(ML_DATUM);
+  s.drawString(line, 8, y + 13, 4);
+}
+
+void StatusScreen::_paintPuzzle(TFT_eSprite& s, int16_t y) {
+  char line[32];
+  uint16_t color = COLOR_TEXT;
+  switch (_puzzle.phase) {
+    case PuzzleView::Ringing: strcpy(line, "WAKE UP! Press a button"); color = TFT_RED; break;
+    case PuzzleView::Showing: snprintf(line, sizeof(line), "Watch #%u", _puzzle.attempt); color = COLOR_ACCENT; break;
+    case PuzzleView::Input:   snprintf(line, sizeof(line), "Repeat #%u", _puzzle.attempt); color = COLOR_ACCENT; break;
+    case PuzzleView::Solved:  snprintf(line, sizeof(line), "Solved in %u", _puzzle.attempt); color = TFT_GREEN; break;
+    default:                  strcpy(line, "Ready"); color = COLOR_DIM; break;
+  }
+  s.setTextColor(color);
+  s.setTextDatum(ML_DATUM);
+  s.drawString(line, 8, y + 13, 2);
+
+  // One dot per step, filled as the sequence is entered
+  if (_puzzle.phase == PuzzleView::Input || _puzzle.phase == PuzzleView::Showing) {
+    for (uint8_t i = 0; i < _puzzle.steps && i < 10; ++i) {
+      int16_t cx = DisplayDriver::WIDTH - 12 - (_puzzle.steps - 1 - i) * 12;
+      if (_puzzle.phase == PuzzleView::Input && i < _puzzle.entered) s.fillCircle(cx, y + 13, 4, color);
+      else s.drawCircle(cx, y + 13, 4, color);
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef STATUSSCREEN_H
+#define STATUSSCREEN_H
+
+#include <Arduino.h>
+#include <time.h>
+#include <hal/DisplayDriver.h>
+#include <core/AlarmScheduler.h>
+
+/** What the alarm flow is doing, as shown on the puzzle line. */
+struct PuzzleView {
+  enum Phase : uint8_t { Idle, Ringing, Showing, Input, Solved };
+  Phase   phase;
+  uint8_t attempt;   // 1-based
+  uint8_t entered;   // inputs so far (Input phase)
+  uint8_t steps;     // sequence length
+};
+
+/**
+ * StatusScreen lays out the clock UI on a DisplayDriver:
+ *
+ *   rows   0-53   HH:MM (7-segment font) and seconds
+ *   rows  54-80   next alarm
+ *   rows  81-107  temperature / humidity
+ *   rows 108-134  puzzle state
+ *
+ * Setters only record state and mark a widget dirty when what it shows
+ * changes. update() redraws dirty widgets within a time budget, puzzle
+ * feedback first; whatever does not fit is drawn on a later call, so the
+ * UI never holds up alarm or input handling for longer than the budget
+ * (plus at most one widget when the first one alone exceeds it).
+ */
+class StatusScreen : private DisplayPainter {
+  public:
+    StatusScreen(DisplayDriver& display, const AlarmScheduler& scheduler);
+
+    /** Mark everything dirty; call once after DisplayDriver::begin(). */
+    void begin();
+
+    void setEnvironment(float temperature, float humidity);
+    void setPuzzle(const PuzzleView& view);
+
+    /** The alarm schedule changed; recompute the next-alarm line. */
+    void alarmsChanged() { _dirty |= bit(NEXT_ALARM); }
+
+    /**
+     * Redraw dirty widgets, spending about `budgetUs` at most.
+     * Cheap when nothing changed. Returns true when nothing is left dirty.
+     */
+    bool update(uint32_t budgetUs);
+
+  private:
+    enum Widget : uint8_t { CLOCK, NEXT_ALARM, ENVIRONMENT, PUZZLE, WIDGET_COUNT };
+
+    struct Area { int16_t top, rows; };
+    static const Area AREAS[WIDGET_COUNT];
+
+    DisplayDriver&        _display;
+    const AlarmScheduler& _scheduler;
+    uint8_t               _dirty;     // bit per Widget
+    Widget                _painting;  // widget being rendered by paint()
+
+    // Shown state
+    struct tm  _now;
+    bool       _timeValid;
+    bool       _hasEnvironment;
+    int16_t    _temperatureDeci;  // 0.1 °C
+    int16_t    _humidityPercent;
+    PuzzleView _puzzle;
+
+    static uint8_t bit(Widget w) { return 1 << w; }
+
+    void _refreshClock();
+    void paint(TFT_eSprite& strip, int16_t top) override;
+    void _paintClock(TFT_eSprite& s, int16_t y);
+    void _paintNextAlarm(TFT_eSprite& s, int16_t y);
+    void _paintEnvironment(TFT_eSprite& s, int16_t y);
+    void _paintPuzzle(TFT_eSprite& s, int16_t y);
+};
+
+#endif
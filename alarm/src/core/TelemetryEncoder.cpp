@@ -0,0 +1,223 @@
+#include "core/TelemetryEncoder.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+int16_t toCenti(float value) {
+  float scaled = value * 100.0f;
+  return (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+uint16_t toCentiUnsigned(float value) {
+  if (value <= 0) return 0;
+  return (uint16_t)(value * 100.0f + 0.5f);
+}
+
+// ---------------------------------------------------------------------------
+// JSON
+// ---------------------------------------------------------------------------
+
+// Render epoch seconds the same way TimeSync::getFormattedTime() does.
+static void formatTimestamp(uint32_t epoch, char* out, size_t len) {
+  time_t t = (time_t)epoch;
+  struct tm timeinfo;
+  localtime_r(&t, &timeinfo);
+  strftime(out, len, "%Y-%m-%d %H:%M:%S", &timeinfo);
+}
+
+// Print a centi-unit value as "<int>.<2 digits>" without touching floats.
+static int formatCenti(char* out, size_t len, int32_t centi) {
+  const char* sign = centi < 0 ? "-" : "";
+  uint32_t magnitude = centi < 0 ? (uint32_t)(-centi) : (uint32_t)centi;
+  return snprintf(out, len, "%s%lu.%02lu", sign,
+                  (unsigned long)(magnitude / 100), (unsigned long)(magnitude % 100));
+}
+
+static size_t finish(int written, size_t capacity) {
+  // snprintf reports the untruncated length; treat truncation as failure.
+  return (written < 0 || (size_t)written >= capacity) ? 0 : (size_t)written;
+}
+
+size_t JsonEncoder::encode(const SensorRecord& record, uint8_t* buf, size_t capacity) const {
+  char ts[24];
+  char temperature[12];
+  char humidity[12];
+  formatTimestamp(record.timestamp, ts, sizeof(ts));
+  formatCenti(temperature, sizeof(temperature), record.temperatureCenti);
+  formatCenti(humidity, sizeof(humidity), record.humidityCenti);
+  int n = snprintf((char*)buf, capacity,
+                   "{\"timestamp\":\"%s\",\"temperature\":%s,\"humidity\":%s}",
+                   ts, temperature, humidity);
+  return finish(n, capacity);
+}
+
+size_t JsonEncoder::encode(const MetricsRecord& record, uint8_t* buf, size_t capacity) const {
+  char ts[24];
+  formatTimestamp(record.timestamp, ts, sizeof(ts));
+  int n = snprintf((char*)buf, capacity,
+                   "{\"timestamp\":\"%s\",\"attempts\":%u,\"reaction_time\":%lu}",
+                   ts, record.attempts, (unsigned long)record.reactionTime);
+  return finish(n, capacity);
+}
+
+size_t JsonEncoder::encode(const EnergyRecord& record, uint8_t* buf, size_t capacity) const {
+  char ts[24];
+  formatTimestamp(record.timestamp, ts, sizeof(ts));
+  int n = snprintf((char*)buf, capacity, "{\"timestamp\":\"%s\",\"window\":\"%s\",\"seconds\":%lu,\"uah\":[",
+                   ts, record.window == EnergyRecord::Alarm ? "alarm" : "hour", (unsigned long)record.seconds);
+  for (uint8_t i = 0; i < ENERGY_RAILS && n >= 0 && (size_t)n < capacity; ++i) {
+    n += snprintf((char*)buf + n, capacity - n, "%s%lu", i ? "," : "", (unsigned long)record.microampHours[i]);
+  }
+  if (n >= 0 && (size_t)n < capacity) n += snprintf((char*)buf + n, capacity - n, "]}");
+  return finish(n, capacity);
+}
+
+size_t JsonEncoder::encode(const BackendRecord& record, uint8_t* buf, size_t capacity) const {
+  static const char* const STATES[] = { "closed", "open", "half-open" };
+  char ts[24];
+  formatTimestamp(record.timestamp, ts, sizeof(ts));
+  int n = snprintf((char*)buf, capacity,
+                   "{\"timestamp\":\"%s\",\"backend\":\"%.*s\",\"state\":\"%s\",\"requests\":%lu,"
+                   "\"failures\":%lu,\"rejected\":%lu,\"trips\":%lu}",
+                   ts, (int)sizeof(record.host), record.host, record.state < 3 ? STATES[record.state] : "?",
+                   (unsigned long)record.requests, (unsigned long)record.failures,
+                   (unsigned long)record.rejected, (unsigned long)record.trips);
+  return finish(n, capacity);
+}
+
+static size_t putChar(char c, uint8_t* buf, size_t capacity) {
+  if (capacity < 1) return 0;
+  buf[0] = c;
+  return 1;
+}
+
+size_t JsonEncoder::beginBatch(uint16_t, uint8_t* buf, size_t capacity) const {
+  return putChar('[', buf, capacity);
+}
+
+size_t JsonEncoder::batchSeparator(uint8_t* buf, size_t capacity) const {
+  return putChar(',', buf, capacity);
+}
+
+size_t JsonEncoder::endBatch(uint8_t* buf, size_t capacity) const {
+  return putChar(']', buf, capacity);
+}
+
+// ---------------------------------------------------------------------------
+// CBOR
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Minimal bounds-checked CBOR writer: just the major types we emit.
+class CborWriter {
+  public:
+    CborWriter(uint8_t* buf, size_t capacity)
+      : _buf(buf), _cap(capacity), _len(0), _ok(true) {}
+
+    void map(uint8_t entries)   { head(5, entries); }
+    void array(uint16_t items)  { head(4, items); }
+    void u32(uint32_t value)    { head(0, value); }
+    void i32(int32_t value) {
+      if (value < 0) head(1, (uint32_t)(-1 - value));
+      else           head(0, (uint32_t)value);
+    }
+    void text(const char* s) {
+      size_t n = strlen(s);
+      head(3, (uint32_t)n);
+      put((const uint8_t*)s, n);
+    }
+
+    size_t length() const { return _ok ? _len : 0; }
+
+  private:
+    uint8_t* _buf;
+    size_t   _cap;
+    size_t   _len;
+    bool     _ok;
+
+    void head(uint8_t major, uint32_t value) {
+      uint8_t tmp[5];
+      size_t n;
+      major <<= 5;
+      if (value < 24) {
+        tmp[0] = major | value; n = 1;
+      } else if (value <= 0xFF) {
+        tmp[0] = major | 24; tmp[1] = value; n = 2;
+      } else if (value <= 0xFFFF) {
+        tmp[0] = major | 25; tmp[1] = value >> 8; tmp[2] = value; n = 3;
+      } else {
+        tmp[0] = major | 26;
+        tmp[1] = value >> 24; tmp[2] = value >> 16; tmp[3] = value >> 8; tmp[4] = value;
+        n = 5;
+      }
+      put(tmp, n);
+    }
+
+    void put(const uint8_t* data, size_t n) {
+      if (!_ok || _len + n > _cap) { _ok = false; return; }
+      memcpy(_buf + _len, data, n);
+      _len += n;
+    }
+};
+
+}  // namespace
+
+size_t CborEncoder::encode(const SensorRecord& record, uint8_t* buf, size_t capacity) const {
+  CborWriter w(buf, capacity);
+  w.map(3);
+  w.text("ts"); w.u32(record.timestamp);
+  w.text("t");  w.i32(record.temperatureCenti);
+  w.text("h");  w.u32(record.humidityCenti);
+  return w.length();
+}
+
+size_t CborEncoder::encode(const MetricsRecord& record, uint8_t* buf, size_t capacity) const {
+  CborWriter w(buf, capacity);
+  w.map(3);
+  w.text("ts"); w.u32(record.timestamp);
+  w.text("a");  w.u32(record.attempts);
+  w.text("rt"); w.u32(record.reactionTime);
+  return w.length();
+}
+
+size_t CborEncoder::encode(const EnergyRecord& record, uint8_t* buf, size_t capacity) const {
+  CborWriter w(buf, capacity);
+  w.map(4);
+  w.text("ts"); w.u32(record.timestamp);
+  w.text("w");  w.u32(record.window);
+  w.text("s");  w.u32(record.seconds);
+  w.text("q");  w.array(ENERGY_RAILS);
+  for (uint8_t i = 0; i < ENERGY_RAILS; ++i) w.u32(record.microampHours[i]);
+  return w.length();
+}
+
+size_t CborEncoder::encode(const BackendRecord& record, uint8_t* buf, size_t capacity) const {
+  char host[sizeof(record.host) + 1];
+  memcpy(host, record.host, sizeof(record.host));
+  host[sizeof(record.host)] = '\0';
+  CborWriter w(buf, capacity);
+  w.map(7);
+  w.text("ts"); w.u32(record.timestamp);
+  w.text("b");  w.text(host);
+  w.text("st"); w.u32(record.state);
+  w.text("n");  w.u32(record.requests);
+  w.text("f");  w.u32(record.failures);
+  w.text("r");  w.u32(record.rejected);
+  w.text("tr"); w.u32(record.trips);
+  return w.length();
+}
+
+size_t CborEncoder::beginBatch(uint16_t count, uint8_t* buf, size_t capacity) const {
+  CborWriter w(buf, capacity);
+  w.array(count);
+  return w.length();
+}
+
+size_t CborEncoder::batchSeparator(uint8_t*, size_t) const {
+  return 0;  // array items are self-delimiting
+}
+
+size_t CborEncoder::endBatch(uint8_t*, size_t) const {
+  return 0;  // definite-length array needs no terminator
+}
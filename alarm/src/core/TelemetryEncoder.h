@@ -0,0 +1,128 @@
+#ifndef TELEMETRYENCODER_H
+#define TELEMETRYENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <core/Energy.h>
+
+/**
+ * Telemetry records and their wire encodings.
+ *
+ * Records use integer epoch timestamps and fixed-point readings so they can
+ * be built without floats or String concatenation. An encoder serializes a
+ * record into a caller-provided buffer; it never allocates.
+ *
+ * This file has no Arduino dependencies so it also builds on the host
+ * (see tools/telemetry).
+ */
+
+/** One DHT20 sample. */
+struct SensorRecord {
+  uint32_t timestamp;         // epoch seconds
+  int16_t  temperatureCenti;  // °C x 100
+  uint16_t humidityCenti;     // % x 100
+};
+
+/** Result of one alarm puzzle. */
+struct MetricsRecord {
+  uint32_t timestamp;     // epoch seconds
+  uint8_t  attempts;
+  uint32_t reactionTime;  // ms
+};
+
+/** Estimated charge drawn over an hour, or over one alarm, per rail (core/Energy.h). */
+struct EnergyRecord {
+  enum Window : uint8_t { Hour, Alarm };
+  uint32_t timestamp;                    // epoch seconds at the end of the window
+  Window   window;
+  uint32_t seconds;                      // length of the window
+  uint32_t microampHours[ENERGY_RAILS];  // in EnergyRail order
+};
+
+/** Requests to one backend host and the state of its circuit breaker (core/CircuitBreaker.h), since boot. */
+struct BackendRecord {
+  uint32_t timestamp;  // epoch seconds
+  char     host[24];   // "host:port", truncated to fit
+  uint8_t  state;      // CircuitBreaker::State: 0 closed, 1 open, 2 half-open
+  uint32_t requests;   // let through
+  uint32_t failures;
+  uint32_t rejected;   // failed fast while open
+  uint32_t trips;
+};
+
+/** Convert a float reading to the fixed-point representation (rounded). */
+int16_t  toCenti(float value);
+uint16_t toCentiUnsigned(float value);
+
+class TelemetryEncoder {
+  public:
+    virtual ~TelemetryEncoder() {}
+
+    /** MIME type sent as Content-Type for this encoding. */
+    virtual const char* contentType() const = 0;
+
+    /**
+     * Encode a record into buf.
+     * @return number of bytes written, or 0 if capacity was too small.
+     */
+    virtual size_t encode(const SensorRecord& record, uint8_t* buf, size_t capacity) const = 0;
+    virtual size_t encode(const MetricsRecord& record, uint8_t* buf, size_t capacity) const = 0;
+    virtual size_t encode(const EnergyRecord& record, uint8_t* buf, size_t capacity) const = 0;
+    virtual size_t encode(const BackendRecord& record, uint8_t* buf, size_t capacity) const = 0;
+
+    /**
+     * Framing for a batch of records: written before the first record,
+     * between records, and after the last one. Same return convention,
+     * except that separator and terminator may legitimately be empty.
+     */
+    virtual size_t beginBatch(uint16_t count, uint8_t* buf, size_t capacity) const = 0;
+    virtual size_t batchSeparator(uint8_t* buf, size_t capacity) const = 0;
+    virtual size_t endBatch(uint8_t* buf, size_t capacity) const = 0;
+};
+
+/**
+ * Legacy JSON format understood by every backend version:
+ * {"timestamp":"YYYY-MM-DD HH:MM:SS","temperature":21.50,"humidity":40.25}
+ * Energy records, which are newer, follow the same style:
+ * {"timestamp":"...","window":"hour","seconds":3600,"uah":[30000,31245,20410,0,0,4]}
+ * and backend records:
+ * {"timestamp":"...","backend":"host:5000","state":"closed","requests":96,"failures":2,"rejected":0,"trips":0}
+ * Batches are a JSON array of those objects.
+ * The timestamp is rendered in local time, as TimeSync::getFormattedTime() did.
+ */
+class JsonEncoder : public TelemetryEncoder {
+  public:
+    const char* contentType() const override { return "application/json"; }
+    size_t encode(const SensorRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t encode(const MetricsRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t encode(const EnergyRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t encode(const BackendRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t beginBatch(uint16_t count, uint8_t* buf, size_t capacity) const override;
+    size_t batchSeparator(uint8_t* buf, size_t capacity) const override;
+    size_t endBatch(uint8_t* buf, size_t capacity) const override;
+};
+
+/**
+ * Compact CBOR (RFC 8949) map with short keys:
+ *   sensor:  {"ts": uint, "t": int (centi-°C), "h": uint (centi-%)}
+ *   metrics: {"ts": uint, "a": uint, "rt": uint (ms)}
+ *   energy:  {"ts": uint, "w": uint (0 hour, 1 alarm), "s": uint, "q": [uint (µAh), ...]}
+ *   backend: {"ts": uint, "b": text, "st": uint, "n": uint, "f": uint, "r": uint, "tr": uint}
+ * Batches are a definite-length CBOR array of those maps.
+ */
+class CborEncoder : public TelemetryEncoder {
+  public:
+    const char* contentType() const override { return "application/cbor"; }
+    size_t encode(const SensorRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t encode(const MetricsRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t encode(const EnergyRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t encode(const BackendRecord& record, uint8_t* buf, size_t capacity) const override;
+    size_t beginBatch(uint16_t count, uint8_t* buf, size_t capacity) const override;
+    size_t batchSeparator(uint8_t* buf, size_t capacity) const override;
+    size_t endBatch(uint8_t* buf, size_t capacity) const override;
+};
+
+/** Largest encoding of any record in either format, for stack buffers. */
+static const size_t TELEMETRY_MAX_RECORD = 192;
+
+#endif
@@ -0,0 +1,274 @@
+#include "core/TelemetryEndpoint.h"
+#include <core/Log.h>
+#include "hal/WifiModule.h"
+
+extern WifiModule wifi;
+
+static const int HTTP_UNSUPPORTED_MEDIA_TYPE = 415;
+
+static const JsonEncoder jsonEncoder;
+static const CborEncoder cborEncoder;
+
+static_assert(TELEMETRY_MAX_RECORD <= WifiModule::MAX_INLINE_BODY,
+              "an encoded record must fit a queued request body");
+
+namespace {
+
+// Encodes a record array into the request body as it is being sent.
+template <typename Record>
+class BatchSource : public BodySource {
+  public:
+    BatchSource(const TelemetryEncoder& encoder, const Record* records, uint16_t count)
+      : _encoder(encoder), _records(records), _count(count) {}
+
+    bool writeTo(ByteSink& sink) override {
+      uint8_t buf[TELEMETRY_MAX_RECORD];
+      size_t n = _encoder.beginBatch(_count, buf, sizeof(buf));
+      if (!sink.write(buf, n)) return false;
+      for (uint16_t i = 0; i < _count; ++i) {
+        if (i > 0) {
+          n = _encoder.batchSeparator(buf, sizeof(buf));
+          if (n && !sink.write(buf, n)) return false;
+        }
+        n = _encoder.encode(_records[i], buf, sizeof(buf));
+        if (n == 0 || !sink.write(buf, n)) return false;
+      }
+      n = _encoder.endBatch(buf, sizeof(buf));
+      return n == 0 || sink.write(buf, n);
+    }
+
+  private:
+    const TelemetryEncoder& _encoder;
+    const Record*           _records;
+    uint16_t                _count;
+};
+
+}  // namespace
+
+// An asynchronous upload. It owns a copy of its records, so it can be encoded
+// again after a 415 and the caller's buffer may change meanwhile. A batch is
+// its own request body, generated on the request task.
+class TelemetryUpload : public BodySource {
+  public:
+    TelemetryUpload(bool batch, uint16_t count, UploadCallback callback, void* context)
+      : batch(batch), count(count), callback(callback), context(context) {}
+    virtual ~TelemetryUpload() {}
+
+    /** Encode the single record into buf; returns its length, 0 on failure. */
+    virtual size_t encode(uint8_t* buf, size_t len) = 0;
+
+    const bool           batch;
+    const uint16_t       count;
+    const UploadCallback callback;
+    void* const          context;
+};
+
+namespace {
+
+template <typename Record>
+class RecordUpload : public TelemetryUpload {
+  public:
+    RecordUpload(const TelemetryEndpoint& endpoint, const Record* records, uint16_t count, bool batch,
+                 UploadCallback callback, void* context)
+      : TelemetryUpload(batch, count, callback, context), _endpoint(endpoint), _records(new Record[count]) {
+      memcpy(_records, records, count * sizeof(Record));
+    }
+    ~RecordUpload() { delete[] _records; }
+
+    size_t encode(uint8_t* buf, size_t len) override {
+      return _endpoint.encoder().encode(_records[0], buf, len);
+    }
+
+    bool writeTo(ByteSink& sink) override {
+      BatchSource<Record> source(_endpoint.encoder(), _records, count);
+      return source.writeTo(sink);
+    }
+
+  private:
+    const TelemetryEndpoint& _endpoint;
+    Record*                  _records;
+};
+
+}  // namespace
+
+TelemetryEndpoint::TelemetryEndpoint(const char* serverHost, uint16_t serverPort, const char* path)
+  : _host(serverHost)
+  , _port(serverPort)
+  , _path(path)
+  , _binary(true)
+  , _gzip(true)
+  , _upload(nullptr)
+{}
+
+const TelemetryEncoder& TelemetryEndpoint::encoder() const {
+  if (_binary) return cborEncoder;
+  return jsonEncoder;
+}
+
+int TelemetryEndpoint::post(const SensorRecord& record, String& responseBody) {
+  return _post(record, responseBody);
+}
+
+int TelemetryEndpoint::post(const MetricsRecord& record, String& responseBody) {
+  return _post(record, responseBody);
+}
+
+int TelemetryEndpoint::post(const EnergyRecord& record, String& responseBody) {
+  return _post(record, responseBody);
+}
+
+int TelemetryEndpoint::post(const BackendRecord& record, String& responseBody) {
+  return _post(record, responseBody);
+}
+
+int TelemetryEndpoint::postBatch(const SensorRecord* records, uint16_t count, String& responseBody) {
+  return _postBatch(records, count, responseBody);
+}
+
+int TelemetryEndpoint::postBatch(const MetricsRecord* records, uint16_t count, String& responseBody) {
+  return _postBatch(records, count, responseBody);
+}
+
+int TelemetryEndpoint::postBatch(const EnergyRecord* records, uint16_t count, String& responseBody) {
+  return _postBatch(records, count, responseBody);
+}
+
+int TelemetryEndpoint::postBatch(const BackendRecord* records, uint16_t count, String& responseBody) {
+  return _postBatch(records, count, responseBody);
+}
+
+template <typename Record>
+int TelemetryEndpoint::_post(const Record& record, String& responseBody) {
+  uint8_t buf[TELEMETRY_MAX_RECORD];
+
+  size_t len = encoder().encode(record, buf, sizeof(buf));
+  if (len == 0) {
+    LOG_WARN("Telemetry encode failed for %s", _path);
+    return -1;
+  }
+  int status = wifi.httpPost(_host, _port, _path, buf, len,
+                             encoder().contentType(), responseBody);
+
+  // Server does not understand the binary format: fall back to JSON and retry once
+  if (status == HTTP_UNSUPPORTED_MEDIA_TYPE && _stepDown(false)) {
+    len = encoder().encode(record, buf, sizeof(buf));
+    if (len == 0) return -1;
+    status = wifi.httpPost(_host, _port, _path, buf, len,
+                           encoder().contentType(), responseBody);
+  }
+  return status;
+}
+
+template <typename Record>
+int TelemetryEndpoint::_postBatch(const Record* records, uint16_t count, String& responseBody) {
+  for (;;) {
+    BatchSource<Record> source(encoder(), records, count);
+    int status = wifi.httpPostStream(_host, _port, _path, encoder().contentType(),
+                                     source, _gzip, responseBody);
+    if (status > 0) {
+      LOG_INFO("Batch %s: %u records, %lu -> %lu bytes", _path, count,
+               (unsigned long)wifi.lastStreamBytesIn(),
+               (unsigned long)wifi.lastStreamBytesOut());
+    }
+    if (status != HTTP_UNSUPPORTED_MEDIA_TYPE || !_stepDown(true)) return status;
+  }
+}
+
+bool TelemetryEndpoint::_stepDown(bool batch) {
+  // One capability at a time: compression first, then the binary format
+  if (batch && _gzip) {
+    LOG_WARN("%s rejected gzip, sending uncompressed", _path);
+    _gzip = false;
+    return true;
+  }
+  if (_binary) {
+    LOG_WARN("%s rejected %s, falling back to JSON", _path, encoder().contentType());
+    _binary = false;
+    return true;
+  }
+  return false;
+}
+
+bool TelemetryEndpoint::postAsync(const SensorRecord& record, UploadCallback callback, void* context) {
+  return _postAsync(&record, 1, false, callback, context);
+}
+
+bool TelemetryEndpoint::postAsync(const MetricsRecord& record, UploadCallback callback, void* context) {
+  return _postAsync(&record, 1, false, callback, context);
+}
+
+bool TelemetryEndpoint::postAsync(const EnergyRecord& record, UploadCallback callback, void* context) {
+  return _postAsync(&record, 1, false, callback, context);
+}
+
+bool TelemetryEndpoint::postAsync(const BackendRecord& record, UploadCallback callback, void* context) {
+  return _postAsync(&record, 1, false, callback, context);
+}
+
+bool TelemetryEndpoint::postBatchAsync(const SensorRecord* records, uint16_t count,
+                                       UploadCallback callback, void* context) {
+  return _postAsync(records, count, true, callback, context);
+}
+
+bool TelemetryEndpoint::postBatchAsync(const MetricsRecord* records, uint16_t count,
+                                       UploadCallback callback, void* context) {
+  return _postAsync(records, count, true, callback, context);
+}
+
+bool TelemetryEndpoint::postBatchAsync(const EnergyRecord* records, uint16_t count,
+                                       UploadCallback callback, void* context) {
+  return _postAsync(records, count, true, callback, context);
+}
+
+bool TelemetryEndpoint::postBatchAsync(const BackendRecord* records, uint16_t count,
+                                       UploadCallback callback, void* context) {
+  return _postAsync(records, count, true, callback, context);
+}
+
+template <typename Record>
+bool TelemetryEndpoint::_postAsync(const Record* records, uint16_t count, bool batch,
+                                   UploadCallback callback, void* context) {
+  if (_upload || count == 0) return false;
+  _upload = new RecordUpload<Record>(*this, records, count, batch, callback, context);
+  if (_submit()) return true;
+  delete _upload;
+  _upload = nullptr;
+  return false;
+}
+
+bool TelemetryEndpoint::_submit() {
+  if (_upload->batch) {
+    HttpRequest request = HttpRequest::postStream(_host, _port, _path, encoder().contentType(),
+                                                  *_upload, _gzip);
+    return wifi.submit(request, _onUploaded, this) != WifiModule::INVALID_HANDLE;
+  }
+  // submit() copies the body
+  uint8_t buf[TELEMETRY_MAX_RECORD];
+  size_t len = _upload->encode(buf, sizeof(buf));
+  if (len == 0) {
+    LOG_WARN("Telemetry encode failed for %s", _path);
+    return false;
+  }
+  HttpRequest request = HttpRequest::post(_host, _port, _path, encoder().contentType(), buf, len);
+  return wifi.submit(request, _onUploaded, this) != WifiModule::INVALID_HANDLE;
+}
+
+void TelemetryEndpoint::_onUploaded(void* self, const HttpResponse& response) {
+  TelemetryEndpoint* endpoint = static_cast<TelemetryEndpoint*>(self);
+  TelemetryUpload* upload = endpoint->_upload;
+  int status = response.status;
+  if (upload->batch && status > 0) {
+    LOG_INFO("Batch %s: %u records, %lu -> %lu bytes", endpoint->_path, upload->count,
+             (unsigned long)response.bytesIn, (unsigned long)response.bytesOut);
+  }
+  if (status == HTTP_UNSUPPORTED_MEDIA_TYPE && endpoint->_stepDown(upload->batch) && endpoint->_submit()) {
+    return;
+  }
+
+  // Free the endpoint first, so the callback can start the next upload
+  endpoint->_upload = nullptr;
+  UploadCallback callback = upload->callback;
+  void* context = upload->context;
+  delete upload;
+  callback(context, status);
+}
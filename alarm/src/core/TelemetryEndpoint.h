@@ -0,0 +1,179 @@
+#ifndef TELEMETRYENDPOINT_H
+#define TELEMETRYENDPOINT_H
+
+#include <Arduino.h>
+#include <core/TelemetryEncoder.h>
+
+struct HttpResponse;
+class TelemetryUpload;  // an upload in flight, see TelemetryEndpoint.cpp
+
+/** Final status of an asynchronous upload; runs from WifiModule::dispatch(). */
+typedef void (*UploadCallback)(void* context, int status);
+
+/**
+ * TelemetryEndpoint posts telemetry records to one backend path and
+ * negotiates the encoding per endpoint.
+ *
+ * It starts out sending compact CBOR. If the server answers
+ * 415 Unsupported Media Type, the endpoint falls back to the legacy JSON
+ * format and remembers that choice until reset().
+ *
+ * Batches are streamed gzip-compressed (Content-Encoding: gzip). A 415 on
+ * a compressed batch first disables compression, then the binary format.
+ *
+ * The *Async variants queue the upload on WifiModule and return at once.
+ * They copy the records, and resubmit after a 415 like the blocking ones.
+ * An endpoint runs one asynchronous upload at a time.
+ */
+class TelemetryEndpoint {
+  public:
+    /**
+     * @param serverHost  The host (IP or domain) of the telemetry API.
+     * @param serverPort  Port to connect to.
+     * @param path        Full path (e.g. "/api/sensor").
+     */
+    TelemetryEndpoint(const char* serverHost, uint16_t serverPort, const char* path);
+
+    /** Encode and POST a record; returns HTTP status or negative on error. */
+    int post(const SensorRecord& record, String& responseBody);
+    int post(const MetricsRecord& record, String& responseBody);
+    int post(const EnergyRecord& record, String& responseBody);
+    int post(const BackendRecord& record, String& responseBody);
+
+    /**
+     * Stream `count` records as one batch (array) body; returns HTTP status or
+     * negative on error. Records are encoded one at a time while sending.
+     */
+    int postBatch(const SensorRecord* records, uint16_t count, String& responseBody);
+    int postBatch(const MetricsRecord* records, uint16_t count, String& responseBody);
+    int postBatch(const EnergyRecord* records, uint16_t count, String& responseBody);
+    int postBatch(const BackendRecord* records, uint16_t count, String& responseBody);
+
+    /**
+     * Queue a post of one record or a batch; `callback` gets the final status.
+     * Returns false, and never calls back, if busy() or WifiModule's queue is full.
+     */
+    bool postAsync(const SensorRecord& record, UploadCallback callback, void* context);
+    bool postAsync(const MetricsRecord& record, UploadCallback callback, void* context);
+    bool postAsync(const EnergyRecord& record, UploadCallback callback, void* context);
+    bool postAsync(const BackendRecord& record, UploadCallback callback, void* context);
+    bool postBatchAsync(const SensorRecord* records, uint16_t count, UploadCallback callback, void* context);
+    bool postBatchAsync(const MetricsRecord* records, uint16_t count, UploadCallback callback, void* context);
+    bool postBatchAsync(const EnergyRecord* records, uint16_t count, UploadCallback callback, void* context);
+    bool postBatchAsync(const BackendRecord* records, uint16_t count, UploadCallback callback, void* context);
+
+    /** An asynchronous upload is in flight. */
+    bool busy() const { return _upload != nullptr; }
+
+    /** The encoder currently negotiated for this endpoint. */
+    const TelemetryEncoder& encoder() const;
+
+    /** Forget a previous fallback and try the binary format again. */
+    void reset() { _binary = true; _gzip = true; }
+
+    const char* path() const { return _path; }
+
+  private:
+    const char* _host;
+    uint16_t    _port;
+    const char* _path;
+    bool        _binary;
+    bool        _gzip;
+    TelemetryUpload* _upload;
+
+    template <typename Record>
+    int _post(const Record& record, String& responseBody);
+    template <typename Record>
+    int _postBatch(const Record* records, uint16_t count, String& responseBody);
+    template <typename Record>
+    bool _postAsync(const Record* records, uint16_t count, bool batch,
+                    UploadCallback callback, void* context);
+
+    // After a 415: drop compression (batches only), then the binary format
+    bool _stepDown(bool batch);
+    bool _submit();
+    static void _onUploaded(void* self, const HttpResponse& response);
+};
+
+/**
+ * Fixed-size backlog of records that could not be uploaded yet.
+ * When full, the oldest record is dropped. Records stay contiguous so the
+ * backlog can be handed to TelemetryEndpoint::postBatch() directly.
+ *
+ * For an asynchronous upload, beginUpload() marks the records it covers.
+ * Records pushed while it runs stay in the backlog after uploaded().
+ * uploadFinished() settles it by status: only a 2xx or a client error a
+ * retry cannot fix drops the records, and a 413 halves the batch.
+ */
+template <typename Record, uint8_t N>
+class TelemetryBacklog {
+  public:
+    TelemetryBacklog() : _count(0), _uploading(0), _batchLimit(N), _dropped(0), _rejected(0) {}
+
+    void push(const Record& record) {
+      if (_count == N) {
+        memmove(_records, _records + 1, (N - 1) * sizeof(Record));
+        _count--;
+        _dropped++;
+        if (_uploading) _uploading--;
+      }
+      _records[_count++] = record;
+    }
+
+    void clear() { _count = 0; }
+
+    /** Mark the oldest records, at most batchLimit(), as being uploaded; returns how many. */
+    uint8_t beginUpload() { return _uploading = _count < _batchLimit ? _count : _batchLimit; }
+    /** The upload went through (or was refused for good): drop its records. */
+    void uploaded() {
+      memmove(_records, _records + _uploading, (_count - _uploading) * sizeof(Record));
+      _count -= _uploading;
+      _uploading = 0;
+    }
+    void uploadFailed() { _uploading = 0; }
+    bool uploading() const { return _uploading > 0; }
+
+    /**
+     * Settle the upload by its final status:
+     *   2xx            delivered, drop its records
+     *   400, 415, 422  the server will never take them: drop them too
+     *   413            too large: halve the batch (a single record is dropped)
+     *   anything else  408, 429, 5xx, transport errors: keep them for later
+     * @return true if the rest should be sent right away (after 2xx or 413).
+     */
+    bool uploadFinished(int status) {
+      if (status >= 200 && status < 300) {
+        uploaded();
+        return _count > 0;
+      }
+      if (status == 413 && _uploading > 1) {
+        _batchLimit = _uploading / 2;
+        _uploading = 0;
+        return true;
+      }
+      if (status == 400 || status == 413 || status == 415 || status == 422) {
+        _rejected += _uploading;
+        uploaded();
+        return false;
+      }
+      uploadFailed();
+      return false;
+    }
+
+    const Record* data() const { return _records; }
+    uint8_t  count()   const { return _count; }
+    uint32_t dropped() const { return _dropped; }
+    /** Records the server refused for good. */
+    uint32_t rejected() const { return _rejected; }
+    uint8_t  batchLimit() const { return _batchLimit; }
+
+  private:
+    Record   _records[N];
+    uint8_t  _count;
+    uint8_t  _uploading;
+    uint8_t  _batchLimit;  // records per batch; shrinks on 413
+    uint32_t _dropped;
+    uint32_t _rejected;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "TimeSync.h"
+#include <core/Log.h>
+#include <core/Trace.h>
 
 TimeSync::TimeSync(const char* ntpServer1, const char* ntpServer2, long gmtOffsetSec, int daylightOffsetSec, int maxRetries)
   : _ntpServer1(ntpServer1), _ntpServer2(ntpServer2),
@@ -16,18 +18,21 @@ bool TimeSync::sync() {
   int retry = 0;
   // Wait until getLocalTime() returns true or we hit the maximum retry count.
   while (!getLocalTime(&timeinfo) && (retry < _maxRetries)) {
-    Serial.println("Waiting for time synchronization...");
+    LOG_INFO("Waiting for time synchronization...");
     delay(2000);
     retry++;
   }
 
   if (retry >= _maxRetries) {
-    Serial.println("Failed to obtain time");
+    LOG_WARN("Failed to obtain time");
     return false;
   }
 
   // Print the synchronized time.
-  Serial.println(&timeinfo, "Time synchronized: %A, %B %d %Y %H:%M:%S");
+  char text[48];
+  strftime(text, sizeof(text), "%A, %B %d %Y %H:%M:%S", &timeinfo);
+  LOG_INFO("Time synchronized: %s", text);
+  TRACE_CLOCK();
   return true;
 }
 
@@ -0,0 +1,180 @@
+#include "core/TimerWheel.h"
+
+TimerWheel::TimerWheel(Job* pool, uint16_t capacity, uint16_t tickMs, uint32_t nowMs)
+  : _pool(pool)
+  , _capacity(capacity < NIL ? capacity : NIL - 1)
+  , _tickMs(tickMs ? tickMs : 1)
+  , _active(0)
+  , _free(NIL)
+  , _tick(0)
+  , _tickStartMs(nowMs)
+  , _next(0)
+  , _nextDirty(false)
+  , _rng(nowMs | 1)
+{
+  for (uint16_t i = 0; i <= SLOTS; ++i) _heads[i] = NIL;
+  for (uint16_t i = _capacity; i-- > 0;) {
+    _pool[i].list = FREE;
+    _pool[i].generation = 1;
+    _pool[i].next = _free;
+    _free = i;
+  }
+}
+
+uint32_t TimerWheel::_roundDeadline(uint32_t earliest, uint16_t slack) const {
+  if (slack == 0) return earliest;
+  uint32_t latest = earliest + slack;
+  // The tick in [earliest, latest] with the most trailing zero bits
+  for (uint8_t bit = 31; bit > 0; --bit) {
+    uint32_t mask = (1u << bit) - 1;
+    uint32_t candidate = (earliest + mask) & ~mask;
+    if (candidate >= earliest && candidate <= latest) return candidate;
+  }
+  return earliest;
+}
+
+uint32_t TimerWheel::_random(uint16_t bound) {
+  if (bound == 0) return 0;
+  // xorshift32; only needs to decorrelate devices, not be unpredictable
+  _rng ^= _rng << 13;
+  _rng ^= _rng >> 17;
+  _rng ^= _rng << 5;
+  return _rng % ((uint32_t)bound + 1);
+}
+
+void TimerWheel::_link(uint16_t index, uint16_t list) {
+  Job& job = _pool[index];
+  job.list = list;
+  job.prev = NIL;
+  job.next = _heads[list];
+  if (job.next != NIL) _pool[job.next].prev = index;
+  _heads[list] = index;
+}
+
+void TimerWheel::_unlink(uint16_t index) {
+  Job& job = _pool[index];
+  if (job.prev != NIL) _pool[job.prev].next = job.next;
+  else _heads[job.list] = job.next;
+  if (job.next != NIL) _pool[job.next].prev = job.prev;
+}
+
+void TimerWheel::_arm(uint16_t index, uint32_t expiry) {
+  // Everything up to _tick has been expired already
+  if ((int32_t)(expiry - _tick) <= 0) expiry = _tick + 1;
+  _pool[index].expiry = expiry;
+  _link(index, expiry % SLOTS);
+  if (!_nextDirty && (_active == 1 || (int32_t)(expiry - _next) < 0)) _next = expiry;
+}
+
+void TimerWheel::_release(uint16_t index) {
+  Job& job = _pool[index];
+  job.list = FREE;
+  job.generation = job.generation == 0xFFFF ? 1 : job.generation + 1;
+  job.next = _free;
+  _free = index;
+  _active--;
+  if (_active == 0) _nextDirty = false;
+}
+
+TimerWheel::Handle TimerWheel::schedule(uint32_t delayMs, TimerCallback callback, void* context,
+                                        uint32_t periodMs, uint16_t jitterMs, uint16_t slackMs) {
+  if (_free == NIL || !callback) return INVALID;
+  uint16_t index = _free;
+  Job& job = _pool[index];
+  _free = job.next;
+  _active++;
+
+  job.callback = callback;
+  job.context = context;
+  job.period = periodMs ? (periodMs + _tickMs - 1) / _tickMs : 0;
+  job.jitter = jitterMs / _tickMs;
+  job.slack = slackMs / _tickMs;
+  uint32_t earliest = _tick + (delayMs + _tickMs - 1) / _tickMs + _random(job.jitter);
+  _arm(index, _roundDeadline(earliest, job.slack));
+  return ((Handle)job.generation << 16) | index;
+}
+
+bool TimerWheel::cancel(Handle handle) {
+  if (!pending(handle)) return false;
+  uint16_t index = handle & 0xFFFF;
+  if (_pool[index].expiry == _next) _nextDirty = true;
+  _unlink(index);
+  _release(index);
+  return true;
+}
+
+bool TimerWheel::pending(Handle handle) const {
+  uint16_t index = handle & 0xFFFF;
+  if (handle == INVALID || index >= _capacity) return false;
+  const Job& job = _pool[index];
+  return job.list != FREE && job.generation == (handle >> 16);
+}
+
+uint16_t TimerWheel::advance(uint32_t nowMs) {
+  // Relative to the last tick, so millis() wrapping around is harmless
+  uint32_t elapsed = (nowMs - _tickStartMs) / _tickMs;
+  if (elapsed == 0) return 0;
+  uint32_t target = _tick + elapsed;
+  _tickStartMs += elapsed * _tickMs;
+  uint16_t ran = 0;
+
+  // After a long gap one revolution visits every slot; beyond that there is nothing new to see
+  uint32_t steps = target - _tick;
+  if (steps > SLOTS) steps = SLOTS;
+  uint32_t first = target - steps + 1;
+  for (uint32_t t = first; t - first < steps; ++t) {
+    uint16_t i = _heads[t % SLOTS];
+    while (i != NIL) {
+      uint16_t next = _pool[i].next;
+      if ((int32_t)(_pool[i].expiry - target) <= 0) {
+        _unlink(i);
+        _link(i, EXPIRED);
+      }
+      i = next;
+    }
+  }
+  _tick = target;
+  _nextDirty = true;
+
+  // Callbacks may schedule or cancel anything, including jobs still waiting on this list
+  while (_heads[EXPIRED] != NIL) {
+    uint16_t i = _heads[EXPIRED];
+    Job& job = _pool[i];
+    _unlink(i);
+    TimerCallback callback = job.callback;
+    void* context = job.context;
+    if (job.period) {
+      uint32_t expiry = job.expiry + job.period;
+      if ((int32_t)(expiry - _tick) <= 0) expiry = _tick + job.period;
+      _arm(i, _roundDeadline(expiry + _random(job.jitter), job.slack));
+    } else {
+      _release(i);
+    }
+    callback(context);
+    ran++;
+  }
+  return ran;
+}
+
+uint32_t TimerWheel::msUntilNext(uint32_t nowMs) {
+  if (_active == 0) return NO_DEADLINE;
+  if (_nextDirty) {
+    // The slot at distance d only holds deadlines >= _tick + d, so stop once d passes the best one seen
+    uint32_t best = 0;
+    bool found = false;
+    for (uint32_t d = 1; !found || (int32_t)(_tick + d - best) <= 0; ++d) {
+      for (uint16_t i = _heads[(_tick + d) % SLOTS]; i != NIL; i = _pool[i].next) {
+        if (!found || (int32_t)(_pool[i].expiry - best) < 0) {
+          best = _pool[i].expiry;
+          found = true;
+        }
+      }
+      if (d >= SLOTS && found) break;
+    }
+    _next = best;
+    _nextDirty = false;
+  }
+  uint32_t dueMs = _tickStartMs + (_next - _tick) * _tickMs;
+  int32_t remaining = (int32_t)(dueMs - nowMs);
+  return remaining > 0 ? (uint32_t)remaining : 0;
+}
@@ -0,0 +1,125 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+
+/** Job callback; runs inside TimerWheel::advance(). */
+typedef void (*TimerCallback)(void* context);
+
+/**
+ * Hashed timer wheel for one-shot and periodic jobs.
+ *
+ * Time is kept in ticks of tickMs milliseconds. A job due at tick T is
+ * stored in slot T % SLOTS, in an intrusive doubly linked list. Insert
+ * and cancel are O(1). Expiring one tick visits one slot, and only the
+ * jobs hashed to it. Jobs more than one revolution away stay in their
+ * slot until their round comes up.
+ *
+ * Per job:
+ * - period: 0 for one-shot. Periodic jobs are re-armed from their
+ *   previous deadline, so they don't drift. Runs missed while advance()
+ *   was not called are skipped, not replayed.
+ * - jitter: a random 0..jitter ms added to each deadline, so a fleet of
+ *   devices doesn't poll a backend in lockstep.
+ * - slack: the job may run up to slack ms late. The deadline is moved to
+ *   the "roundest" tick inside that window, so jobs with overlapping
+ *   windows expire on the same tick and share one wake-up.
+ *
+ * msUntilNext() tells the caller how long it may sleep. Jobs live in a
+ * caller-provided pool (see StaticTimerWheel), and nothing is allocated.
+ * No Arduino dependencies, so it also builds on the host (see tools/timers).
+ */
+class TimerWheel {
+  public:
+    /** Opaque job handle; generation-checked, so stale handles are harmless. */
+    typedef uint32_t Handle;
+    static const Handle INVALID = 0;
+    static const uint32_t NO_DEADLINE = 0xFFFFFFFF;
+    // Prime, so deadlines rounded to power-of-two ticks by slack still spread over every slot
+    static const uint16_t SLOTS = 251;
+
+    struct Job {
+      uint32_t      expiry;    // tick
+      uint32_t      period;    // ticks, 0 = one-shot
+      uint16_t      jitter;    // ticks
+      uint16_t      slack;     // ticks
+      TimerCallback callback;
+      void*         context;
+      uint16_t      next;
+      uint16_t      prev;
+      uint16_t      list;      // slot index, EXPIRED, or FREE
+      uint16_t      generation;
+    };
+
+    /**
+     * @param pool      Storage for `capacity` jobs.
+     * @param tickMs    Resolution; deadlines are rounded up to whole ticks.
+     * @param nowMs     Current time, e.g. millis().
+     */
+    TimerWheel(Job* pool, uint16_t capacity, uint16_t tickMs, uint32_t nowMs);
+
+    /**
+     * Schedule a job to run delayMs from the wheel's current time, i.e.
+     * the last advance(). Call advance() first after a long pause.
+     * @return a handle, or INVALID if the pool is exhausted.
+     */
+    Handle schedule(uint32_t delayMs, TimerCallback callback, void* context,
+                    uint32_t periodMs = 0, uint16_t jitterMs = 0, uint16_t slackMs = 0);
+
+    /** Convenience for a periodic job whose first run is one period away. */
+    Handle every(uint32_t periodMs, TimerCallback callback, void* context,
+                 uint16_t jitterMs = 0, uint16_t slackMs = 0) {
+      return schedule(periodMs, callback, context, periodMs, jitterMs, slackMs);
+    }
+
+    /** Cancel a job; safe on expired, cancelled or INVALID handles. Returns true if it was pending. */
+    bool cancel(Handle handle);
+
+    /** True while the job is scheduled (including periodic jobs between runs). */
+    bool pending(Handle handle) const;
+
+    /** Run every job that is due at nowMs; returns the number of callbacks run. */
+    uint16_t advance(uint32_t nowMs);
+
+    /** Milliseconds from nowMs until the earliest deadline (0 if overdue), or NO_DEADLINE. */
+    uint32_t msUntilNext(uint32_t nowMs);
+
+    uint16_t active() const { return _active; }
+    uint16_t capacity() const { return _capacity; }
+
+  private:
+    static const uint16_t NIL = 0xFFFF;
+    static const uint16_t EXPIRED = SLOTS;
+    static const uint16_t FREE = SLOTS + 1;
+
+    Job*     _pool;
+    uint16_t _capacity;
+    uint16_t _tickMs;
+    uint16_t _active;
+    uint16_t _free;
+    uint16_t _heads[SLOTS + 1];  // slots, then the list of jobs being expired
+    uint32_t _tick;              // last tick fully expired
+    uint32_t _tickStartMs;       // wall time at which _tick began
+    uint32_t _next;              // cached earliest expiry, valid unless _nextDirty
+    bool     _nextDirty;
+    uint32_t _rng;
+
+    uint32_t _roundDeadline(uint32_t earliest, uint16_t slack) const;
+    uint32_t _random(uint16_t bound);
+    void _link(uint16_t index, uint16_t list);
+    void _unlink(uint16_t index);
+    void _arm(uint16_t index, uint32_t expiry);
+    void _release(uint16_t index);
+};
+
+/** TimerWheel with its job pool inline. */
+template <uint16_t N>
+class StaticTimerWheel : public TimerWheel {
+  public:
+    StaticTimerWheel(uint16_t tickMs, uint32_t nowMs) : TimerWheel(_jobs, N, tickMs, nowMs) {}
+
+  private:
+    Job _jobs[N];
+};
+
+#endif
@@ -0,0 +1,365 @@
+#include "core/Trace.h"
+#include <core/Log.h>
+#include <string.h>
+#include <sys/time.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+static const uint8_t TRACE_MAGIC[4] = { 'T', 'R', 'C', '1' };
+static const uint32_t CLOCK_STEP_MS = 1000;  // departures from millis() smaller than this are jitter
+static const uint8_t BODY_KEYS = 8;
+
+namespace {
+
+#ifdef ESP_PLATFORM
+typedef TaskHandle_t TaskId;
+TaskId currentTask() { return xTaskGetCurrentTaskHandle(); }
+#else
+typedef std::thread::id TaskId;
+TaskId currentTask() { return std::this_thread::get_id(); }
+#endif
+
+struct BodySeen {
+  uint32_t key;
+  uint32_t hash;
+  size_t   length;
+};
+
+struct Recorder {
+  Print*     out;
+  TaskId     task;  // that called begin()
+  uint32_t   maxBytes;
+  uint32_t   lastMs;
+  uint64_t   lastWallMs;  // wall clock at lastMs, as last recorded or extrapolated
+  bool       full;
+  TraceStats stats;
+  BodySeen   bodies[BODY_KEYS];
+  uint8_t    bodyCount;
+  uint8_t    bodyNext;  // replaced next once all are in use
+};
+
+Recorder rec = {};
+
+// The recorder has no lock: hooks called from another task than the one
+// recording (loop()) are ignored, not even counted as dropped
+bool otherTask() {
+  return rec.out && currentTask() != rec.task;
+}
+
+// Encoders for one record, built in a small buffer before it goes out
+struct Record {
+  uint8_t buf[32];
+  uint8_t len;
+
+  void u8(uint8_t v) { buf[len++] = v; }
+  void varint(uint32_t v) {
+    while (v >= 0x80) {
+      buf[len++] = (uint8_t)(v | 0x80);
+      v >>= 7;
+    }
+    buf[len++] = (uint8_t)v;
+  }
+  void zigzag(long v) { varint(((uint32_t)v << 1) ^ (uint32_t)(v >> 31)); }
+  void u32(uint32_t v) {
+    for (uint8_t i = 0; i < 4; ++i) buf[len++] = (uint8_t)(v >> (8 * i));
+  }
+  void f32(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    u32(bits);
+  }
+};
+
+uint32_t fnv1a(const uint8_t* data, size_t length, uint32_t h = 2166136261u) {
+  for (size_t i = 0; i < length; ++i) h = (h ^ data[i]) * 16777619u;
+  return h;
+}
+
+uint64_t wallMs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Starts a record: its type and the time since the previous one
+Record open(TraceType type, uint32_t now) {
+  Record r;
+  r.len = 0;
+  r.u8(type);
+  r.varint(now - rec.lastMs);
+  return r;
+}
+
+// Writes a record and the bytes that follow it, or drops it if the trace is full
+bool commit(const Record& r, uint32_t now, const uint8_t* tail = nullptr, size_t tailLength = 0) {
+  if (!rec.out || rec.full) {
+    rec.stats.dropped++;
+    return false;
+  }
+  if (rec.stats.bytes + r.len + tailLength > rec.maxBytes) {
+    rec.full = true;
+    rec.stats.dropped++;
+    LOG_WARN("Trace full at %lu B, recording stopped", (unsigned long)rec.stats.bytes);
+    return false;
+  }
+  rec.out->write(r.buf, r.len);
+  if (tailLength) rec.out->write(tail, tailLength);
+  rec.lastWallMs += now - rec.lastMs;
+  rec.lastMs = now;
+  rec.stats.bytes += r.len + tailLength;
+  rec.stats.records++;
+  return true;
+}
+
+void writeClock(uint32_t now, uint64_t wall) {
+  Record r = open(TraceClock, now);
+  r.varint((uint32_t)(wall / 1000));
+  r.varint((uint32_t)(wall % 1000));
+  if (commit(r, now)) rec.lastWallMs = wall;
+}
+
+}  // namespace
+
+void Trace::begin(Print& out, uint32_t maxBytes) {
+  rec = Recorder();
+  rec.out = &out;
+  rec.task = currentTask();
+  rec.maxBytes = maxBytes;
+  out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  rec.stats.bytes = sizeof(TRACE_MAGIC);
+  writeClock(millis(), wallMs());
+}
+
+void Trace::end() {
+  flush();
+  rec.out = nullptr;
+}
+
+void Trace::flush() {
+  if (rec.out) rec.out->flush();
+}
+
+bool Trace::recording() {
+  return rec.out && !rec.full;
+}
+
+bool Trace::recordingHere() {
+  return recording() && !otherTask();
+}
+
+TraceStats Trace::stats() {
+  return rec.stats;
+}
+
+void Trace::clock() {
+  if (!rec.out || otherTask()) return;
+  uint32_t now = millis();
+  uint64_t wall = wallMs();
+  uint64_t expected = rec.lastWallMs + (now - rec.lastMs);
+  uint64_t step = wall > expected ? wall - expected : expected - wall;
+  if (step >= CLOCK_STEP_MS) writeClock(now, wall);
+}
+
+void Trace::button(uint8_t pin, int level) {
+  if (otherTask()) return;
+  uint32_t now = millis();
+  Record r = open(TraceButton, now);
+  r.u8((uint8_t)(pin << 1 | (level ? 1 : 0)));
+  commit(r, now);
+}
+
+void Trace::sensor(float temperature, float humidity) {
+  if (otherTask()) return;
+  uint32_t now = millis();
+  Record r = open(TraceSensor, now);
+  r.f32(temperature);
+  r.f32(humidity);
+  commit(r, now);
+}
+
+void Trace::response(const char* method, const char* path, int status, uint32_t latencyMs,
+                     long contentLength, const uint8_t* body, size_t length, bool truncated) {
+  if (otherTask()) return;
+  uint32_t now = millis();
+  uint32_t key = requestKey(method, path);
+  if (length > TRACE_MAX_BODY) {
+    length = TRACE_MAX_BODY;
+    truncated = true;
+  }
+  uint32_t hash = fnv1a(body, length);
+
+  // The reader keeps the same table, replacing entries in the same order
+  BodySeen* seen = nullptr;
+  for (uint8_t i = 0; i < rec.bodyCount && !seen; ++i) {
+    if (rec.bodies[i].key == key) seen = &rec.bodies[i];
+  }
+  bool repeated = seen && seen->hash == hash && seen->length == length;
+
+  Record r = open(TraceResponse, now);
+  r.u32(key);
+  r.zigzag(status);
+  r.varint(latencyMs);
+  r.zigzag(contentLength);
+  r.u8((truncated ? TRACE_BODY_TRUNCATED : 0) | (repeated ? TRACE_BODY_REPEATED : 0));
+  if (!repeated) r.varint((uint32_t)length);
+  if (!commit(r, now, repeated ? nullptr : body, repeated ? 0 : length) || repeated) return;
+
+  if (!seen) {
+    seen = &rec.bodies[rec.bodyNext++ % BODY_KEYS];
+    if (rec.bodyCount < BODY_KEYS) rec.bodyCount++;
+  }
+  *seen = BodySeen{ key, hash, length };
+}
+
+void Trace::random(long value) {
+  if (otherTask()) return;
+  uint32_t now = millis();
+  Record r = open(TraceRandom, now);
+  r.zigzag(value);
+  commit(r, now);
+}
+
+uint32_t Trace::requestKey(const char* method, const char* path) {
+  uint32_t h = fnv1a((const uint8_t*)method, strlen(method));
+  h = fnv1a((const uint8_t*)" ", 1, h);
+  return fnv1a((const uint8_t*)path, strcspn(path, "?"), h);
+}
+
+// ---- Reader ----
+
+TraceReader::TraceReader(const uint8_t* data, size_t length)
+  : _data(data)
+  , _length(length)
+  , _pos(sizeof(TRACE_MAGIC))
+  , _ms(0)
+  , _valid(length >= sizeof(TRACE_MAGIC) && memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0)
+  , _truncated(false)
+  , _bodyCount(0)
+  , _bodyNext(0)
+{
+}
+
+const TraceReader::Body* TraceReader::_find(uint32_t key) const {
+  for (uint8_t i = 0; i < _bodyCount; ++i) {
+    if (_bodies[i].key == key) return &_bodies[i];
+  }
+  return nullptr;
+}
+
+void TraceReader::_remember(uint32_t key, const uint8_t* data, size_t length) {
+  Body* seen = const_cast<Body*>(_find(key));
+  if (!seen) {
+    seen = &_bodies[_bodyNext++ % BODY_KEYS];
+    if (_bodyCount < BODY_KEYS) _bodyCount++;
+  }
+  *seen = Body{ key, data, length };
+}
+
+bool TraceReader::_varint(uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (_pos >= _length) return false;
+    uint8_t b = _data[_pos++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+bool TraceReader::_zigzag(long& value) {
+  uint32_t v;
+  if (!_varint(v)) return false;
+  value = (long)(int32_t)((v >> 1) ^ (0u - (v & 1)));
+  return true;
+}
+
+bool TraceReader::_bytes(const uint8_t*& data, size_t length) {
+  if (_length - _pos < length) return false;
+  data = _data + _pos;
+  _pos += length;
+  return true;
+}
+
+static uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static float readF32(const uint8_t* p) {
+  uint32_t bits = readU32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+bool TraceReader::next(TraceEvent& event) {
+  if (!_valid || _truncated || _pos >= _length) return false;
+  size_t start = _pos;
+  memset(&event, 0, sizeof(event));
+
+  uint32_t dt, v = 0;
+  long z;
+  const uint8_t* p;
+  bool ok = _bytes(p, 1) && _varint(dt);
+  event.type = ok ? (TraceType)p[0] : TraceClock;
+  if (ok) {
+    switch (event.type) {
+      case TraceClock:
+        ok = _varint(event.epoch) && _varint(v);
+        event.epochMs = (uint16_t)v;
+        break;
+      case TraceButton:
+        ok = _bytes(p, 1);
+        if (ok) {
+          event.pin = p[0] >> 1;
+          event.level = p[0] & 1;
+        }
+        break;
+      case TraceSensor:
+        ok = _bytes(p, 8);
+        if (ok) {
+          event.temperature = readF32(p);
+          event.humidity = readF32(p + 4);
+        }
+        break;
+      case TraceResponse: {
+        const uint8_t* flags;
+        ok = _bytes(p, 4) && _zigzag(z) && _varint(event.latencyMs) && _zigzag(event.contentLength) &&
+             _bytes(flags, 1);
+        if (!ok) break;
+        event.key = readU32(p);
+        event.status = (int)z;
+        event.flags = flags[0];
+        if (event.flags & TRACE_BODY_REPEATED) {
+          const Body* seen = _find(event.key);
+          if (seen) {
+            event.body = seen->data;
+            event.bodyLength = seen->length;
+          }
+        } else {
+          ok = _varint(v) && _bytes(event.body, v);
+          event.bodyLength = v;
+          if (ok) _remember(event.key, event.body, v);
+        }
+        break;
+      }
+      case TraceRandom:
+        ok = _zigzag(event.value);
+        break;
+      default:
+        ok = false;  // a newer format; nothing after it can be trusted
+        break;
+    }
+  }
+  if (!ok) {
+    _pos = start;
+    _truncated = true;
+    return false;
+  }
+  _ms += dt;
+  event.ms = _ms;
+  return true;
+}
@@ -0,0 +1,170 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+/**
+ * Input trace: what the firmware's logic was fed, with timestamps, for
+ * replaying a device's day through the same main.cpp on the host
+ * (tools/replay).
+ *
+ *   TRACE_BUTTON(pin, level);   raw pin changes, before debouncing
+ *   TRACE_SENSOR(t, h);         DHT20 samples as posted
+ *   TRACE_RESPONSE(...);        HTTP outcomes as handed to their caller
+ *   TRACE_RANDOM(value);        draws that shape the logic (puzzle sequences)
+ *   TRACE_CLOCK();              wall clock, recorded only when it steps
+ *
+ * - Without TRACE_RECORD=1 the macros compile to nothing, like disabled
+ *   LOG_* levels, and their arguments are not evaluated.
+ * - With it, each call appends a few bytes to the Print given to
+ *   Trace::begin() (a LittleFS file on the device). Recording stops once
+ *   `maxBytes` are written; later calls only count as dropped.
+ * - Hooks run in loop() context (drivers' update()/dispatch() callbacks)
+ *   and are not for ISRs. Calls from other tasks are ignored; such a task
+ *   hands its outcome to loop() to be recorded there, as OtaUpdater does
+ *   with its OtaEvent.
+ *
+ * Format: "TRC1", then records of
+ *   [type:u8][ms since the previous record, since boot for the first:varint][payload]
+ *   Clock     epoch seconds:varint, milliseconds:varint
+ *   Button    pin << 1 | level:u8
+ *   Sensor    temperature:f32, humidity:f32 (little-endian)
+ *   Response  key:u32, status:zigzag, latency ms:varint, content length:zigzag,
+ *             flags:u8, then body length:varint and body unless TRACE_BODY_REPEATED
+ *   Random    value:zigzag
+ * A response body equal to the last one for the same request is stored as
+ * TRACE_BODY_REPEATED, so polling an unchanged resource costs a few bytes.
+ */
+
+#ifndef TRACE_RECORD
+#define TRACE_RECORD 0
+#endif
+
+#ifndef TRACE_MAX_BODY
+#define TRACE_MAX_BODY 2048
+#endif
+
+#if TRACE_RECORD
+#define TRACE_CLOCK() Trace::clock()
+#define TRACE_BUTTON(pin, level) Trace::button(pin, level)
+#define TRACE_SENSOR(temperature, humidity) Trace::sensor(temperature, humidity)
+#define TRACE_RESPONSE(method, path, status, latencyMs, contentLength, body, length, truncated) \
+  Trace::response(method, path, status, latencyMs, contentLength, body, length, truncated)
+#define TRACE_RANDOM(value) Trace::random(value)
+#else
+#define TRACE_CLOCK() do {} while (0)
+#define TRACE_BUTTON(pin, level) do {} while (0)
+#define TRACE_SENSOR(temperature, humidity) do {} while (0)
+#define TRACE_RESPONSE(method, path, status, latencyMs, contentLength, body, length, truncated) \
+  do {} while (0)
+#define TRACE_RANDOM(value) do {} while (0)
+#endif
+
+enum TraceType : uint8_t { TraceClock = 1, TraceButton, TraceSensor, TraceResponse, TraceRandom };
+
+static const uint8_t TRACE_BODY_TRUNCATED = 0x01;  // longer than TRACE_MAX_BODY or the caller's limit
+static const uint8_t TRACE_BODY_REPEATED  = 0x02;  // same as the previous body for this key
+
+/** One decoded record; only the fields of its type are set. */
+struct TraceEvent {
+  TraceType      type;
+  uint32_t       ms;             // millis() when it was recorded
+  uint32_t       epoch;          // Clock
+  uint16_t       epochMs;
+  uint8_t        pin;            // Button
+  uint8_t        level;
+  float          temperature;    // Sensor
+  float          humidity;
+  uint32_t       key;            // Response: Trace::requestKey()
+  int            status;
+  uint32_t       latencyMs;      // from the request being made to its outcome
+  long           contentLength;
+  uint8_t        flags;
+  const uint8_t* body;           // points into the trace
+  size_t         bodyLength;
+  long           value;          // Random
+};
+
+/** Recorder counters. */
+struct TraceStats {
+  uint32_t records;
+  uint32_t bytes;
+  uint32_t dropped;  // past maxBytes, or while not recording
+};
+
+class Trace {
+  public:
+    /** Start a trace on `out`: the header and a clock record. */
+    static void begin(Print& out, uint32_t maxBytes);
+
+    /** Stop recording; `out` is no longer used. */
+    static void end();
+
+    /** Push what `out` buffers to storage, e.g. LittleFS's cache. */
+    static void flush();
+
+    static bool recording();
+
+    /** Recording, and called from the task that records, so hooks would be kept. */
+    static bool recordingHere();
+    static TraceStats stats();
+
+    // Hooks behind the TRACE_* macros
+    static void clock();
+    static void button(uint8_t pin, int level);
+    static void sensor(float temperature, float humidity);
+    static void response(const char* method, const char* path, int status, uint32_t latencyMs,
+                         long contentLength, const uint8_t* body, size_t length, bool truncated);
+    static void random(long value);
+
+    /**
+     * Identifies a request across firmware versions: FNV-1a of "METHOD path".
+     * The query string is left out; it carries per-image state (OtaUpdater's base hash).
+     */
+    static uint32_t requestKey(const char* method, const char* path);
+};
+
+/**
+ * Decodes a trace held in memory. Records come out in order; a response's
+ * repeated body points at the earlier copy.
+ */
+class TraceReader {
+  public:
+    TraceReader(const uint8_t* data, size_t length);
+
+    /** The data starts with the trace header. */
+    bool valid() const { return _valid; }
+
+    /** Decode the next record; false at the end of the trace. */
+    bool next(TraceEvent& event);
+
+    /** The trace ends in a partial record, e.g. cut off by a reset. */
+    bool truncated() const { return _truncated; }
+
+  private:
+    static const uint8_t BODY_KEYS = 8;
+
+    struct Body {
+      uint32_t       key;
+      const uint8_t* data;
+      size_t         length;
+    };
+
+    const uint8_t* _data;
+    size_t         _length;
+    size_t         _pos;
+    uint32_t       _ms;
+    bool           _valid;
+    bool           _truncated;
+    Body           _bodies[BODY_KEYS];
+    uint8_t        _bodyCount;
+    uint8_t        _bodyNext;
+
+    bool _varint(uint32_t& value);
+    bool _zigzag(long& value);
+    bool _bytes(const uint8_t*& data, size_t length);
+    const Body* _find(uint32_t key) const;
+    void _remember(uint32_t key, const uint8_t* data, size_t length);
+};
+
+#endif
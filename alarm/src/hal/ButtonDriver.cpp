@@ -1,7 +1,8 @@
 #include "ButtonDriver.h"
+#include <core/Trace.h>
 
-ButtonDriver::ButtonDriver(std::initializer_list<uint8_t> pins, ButtonCallback callback, unsigned long debounce_ms)
-  : _numPins(pins.size()), _callback(callback), _debounce(debounce_ms)
+ButtonDriver::ButtonDriver(std::initializer_list<uint8_t> pins, unsigned long debounce_ms)
+  : _numPins(pins.size()), _debounce(debounce_ms)
 {
   // Allocate memory for pins, last-pressed times, and previous state.
   _pins = new uint8_t[_numPins];
@@ -29,13 +30,18 @@ void ButtonDriver::update() {
   // Poll each button pin.
   for (uint8_t i = 0; i < _numPins; i++) {
     int currentState = digitalRead(_pins[i]);
-    // Detect a rising edge: the button was previously LOW (pressed) and now is HIGH (released).
-    if (_prevState[i] == LOW && currentState == HIGH) {
+    if (currentState != _prevState[i]) {
+      TRACE_BUTTON(_pins[i], currentState);
       unsigned long currentMillis = millis();
-      // Only trigger if the debounce interval has elapsed.
+      // Only report edges once the debounce interval since the last release has elapsed.
       if (currentMillis - _lastPressed[i] > _debounce) {
-        _lastPressed[i] = currentMillis;
-        _callback(_pins[i]);
+        if (currentState == HIGH) {
+          // Rising edge: the button was LOW (pressed) and is now HIGH (released).
+          _lastPressed[i] = currentMillis;
+          AppBus::post(ButtonEvent{_pins[i], ButtonEvent::Released, currentMillis});
+        } else {
+          AppBus::post(ButtonEvent{_pins[i], ButtonEvent::Pressed, currentMillis});
+        }
       }
     }
     // Update the previous state for this pin.
@@ -44,8 +50,8 @@ void ButtonDriver::update() {
 }
 
 void ButtonDriver::simulateButtonPress(uint8_t buttonPin) {
-  // Directly call the callback for simulation.
-  _callback(buttonPin);
+  // Post a release edge as if the button had been pressed and let go.
+  AppBus::post(ButtonEvent{buttonPin, ButtonEvent::Released, millis()});
 }
 
 bool ButtonDriver::isAnyButtonPressed() {
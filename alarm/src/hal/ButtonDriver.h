@@ -3,19 +3,18 @@
 
 #include <Arduino.h>
 #include <initializer_list>
-
-// Define the type for the button press callback function.
-typedef void (*ButtonCallback)(uint8_t buttonPin);
+#include <core/Events.h>
 
 class ButtonDriver {
   public:
     /**
      * Constructor that accepts an initializer list for button pins.
+     * Edges are posted to AppBus as ButtonEvent (Pressed on HIGH->LOW,
+     * Released on LOW->HIGH).
      * @param pins An initializer list of button pin numbers.
-     * @param callback Function to be called when a button release (HIGH after LOW) is detected.
      * @param debounce_ms Debounce time in milliseconds (default is 200).
      */
-    ButtonDriver(std::initializer_list<uint8_t> pins, ButtonCallback callback, unsigned long debounce_ms = 200);
+    ButtonDriver(std::initializer_list<uint8_t> pins, unsigned long debounce_ms = 200);
 
     /**
      * Initializes the buttons.
@@ -23,13 +22,12 @@ class ButtonDriver {
     void begin();
 
     /**
-     * Polls each button pin. If a button's state goes from LOW to HIGH and passes debouncing,
-     * calls the callback function.
+     * Polls each button pin and posts a ButtonEvent for every debounced edge.
      */
     void update();
 
     /**
-     * Simulates a button press (for testing) by immediately calling the callback.
+     * Simulates a button press (for testing) by posting a Released event.
      * @param buttonPin The pin number to simulate the press for.
      */
     void simulateButtonPress(uint8_t buttonPin);
@@ -45,7 +43,6 @@ class ButtonDriver {
     uint8_t* _pins;
     unsigned long* _lastPressed;  // for debouncing
     int* _prevState;              // store previous state for edge detection
-    ButtonCallback _callback;
     unsigned long _debounce;  // Debounce time in milliseconds
 };
 
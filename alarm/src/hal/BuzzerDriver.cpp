@@ -1,4 +1,5 @@
 #include "BuzzerDriver.h"
+#include <core/Energy.h>
 
 BuzzerDriver::BuzzerDriver(uint8_t pin, uint8_t channel)
   : _pin(pin), _channel(channel) {
@@ -19,8 +20,12 @@ void BuzzerDriver::notify(uint32_t frequency, uint8_t volume, unsigned long dura
   ledcWriteTone(_channel, frequency);
   // Set the volume (duty cycle).
   ledcWrite(_channel, volume);
-  // Keep the tone on for the given duration (blocking delay).
+  Energy::set(RailBuzzer, SwitchOn);
+  // Keep the tone on for the given duration (blocking delay, the CPU idles).
+  Energy::set(RailCpu, CpuIdle);
   delay(duration);
+  Energy::set(RailCpu, CpuBusy);
   // Turn off the tone.
   ledcWriteTone(_channel, 0);
+  Energy::set(RailBuzzer, SwitchOff);
 }
@@ -1,35 +1,135 @@
 #include "DHTDriver.h"
+#include <core/Energy.h>
+#include <core/Log.h>
+#include <core/Trace.h>
+
+static const uint8_t CMD_STATUS  = 0x71;
+static const uint8_t STATUS_BUSY = 0x80;
+static const uint8_t STATUS_CAL  = 0x18;
+
+// CRC-8, polynomial 0x31, initial value 0xFF (DHT20 datasheet)
+static uint8_t crc8(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0xFF;
+  for (uint8_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (uint8_t b = 0; b < 8; ++b) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+DHTDriver::DHTDriver(I2cBus& bus)
+  : _bus(bus)
+  , _device(0)
+  , _state(Idle)
+  , _triggeredAt(0)
+  , _triggerFailed(false)
+  , _temperature(NAN)
+  , _humidity(NAN)
+{
+}
 
 void DHTDriver::begin() {
-  // Initialize default pins
-  Wire.begin();
-  // Initialize the DHT20
-  if (!_sensor.begin()) {
-    Serial.println("DHT20 init failed!");
+  _device = _bus.addDevice("DHT20", ADDRESS);
+  uint8_t status = 0;
+  if (_device == I2cBus::INVALID_DEVICE || !_bus.readRegister(_device, CMD_STATUS, status)) {
+    LOG_ERROR("DHT20 init failed!");
     while (1) delay(1000);
   }
-  Serial.println("DHT20 initialized.");
+  // An uncalibrated sensor needs its three calibration registers re-initialized
+  if ((status & STATUS_CAL) != STATUS_CAL) {
+    _resetRegister(0x1B);
+    _resetRegister(0x1C);
+    _resetRegister(0x1E);
+  }
+  LOG_INFO("DHT20 initialized.");
 }
 
-bool DHTDriver::read() {
-  uint8_t status = _sensor.read();
-  if (status != 0) {
-    Serial.printf("DHT20 read failed: %u\n", status);
-    return false;
-  }
-  float t = _sensor.getTemperature();
-  float h = _sensor.getHumidity();
-  if (isnan(t) || isnan(h)) {
-    Serial.println("DHT20 returned NaN.");
+bool DHTDriver::_resetRegister(uint8_t reg) {
+  uint8_t cmd[3] = { reg, 0x00, 0x00 };
+  if (!_bus.transfer(_device, cmd, 3)) return false;
+  delay(5);
+  uint8_t value[3];
+  if (!_bus.transfer(_device, nullptr, 0, value, 3)) return false;
+  delay(10);
+  cmd[0] = 0xB0 | reg;
+  cmd[1] = value[1];
+  cmd[2] = value[2];
+  return _bus.transfer(_device, cmd, 3);
+}
+
+bool DHTDriver::requestRead() {
+  if (_state != Idle) return false;
+  static const uint8_t trigger[3] = { 0xAC, 0x33, 0x00 };
+  if (!_bus.submit(I2cBus::Background, _device, trigger, sizeof(trigger), nullptr, 0, _onTriggered, this)) {
     return false;
   }
+  _state = Converting;
+  _triggerFailed = false;
+  _triggeredAt = millis();
+  Energy::set(RailSensor, SwitchOn);
   return true;
 }
 
+void DHTDriver::update() {
+  if (_state != Converting || millis() - _triggeredAt < CONVERSION_MS) return;
+  if (_bus.submit(I2cBus::Background, _device, nullptr, 0, _data, sizeof(_data), _onData, this)) {
+    _state = Reading;
+  }
+}
+
+// A NACKed trigger leaves the previous measurement in the sensor: do not read it as new
+void DHTDriver::_onTriggered(void* self, const I2cResult& result) {
+  if (result.ok) return;
+  DHTDriver* dht = static_cast<DHTDriver*>(self);
+  LOG_WARN("DHT20 trigger failed: bus error");
+  if (dht->_state == Converting) {
+    dht->_state = Idle;
+    Energy::set(RailSensor, SwitchOff);
+  } else {
+    dht->_triggerFailed = true;  // the read is queued already; _onData() drops it
+  }
+}
+
+void DHTDriver::_onData(void* self, const I2cResult& result) {
+  DHTDriver* dht = static_cast<DHTDriver*>(self);
+  const uint8_t* d = dht->_data;
+  if (dht->_triggerFailed) {
+    dht->_triggerFailed = false;
+    dht->_state = Idle;
+    Energy::set(RailSensor, SwitchOff);
+    return;
+  }
+  if (result.ok && (d[0] & STATUS_BUSY)) {
+    // Conversion not finished yet; poll again shortly
+    dht->_state = Converting;
+    dht->_triggeredAt = millis() - CONVERSION_MS + 10;
+    return;
+  }
+  dht->_state = Idle;
+  Energy::set(RailSensor, SwitchOff);
+  if (!result.ok) {
+    LOG_WARN("DHT20 read failed: bus error");
+    return;
+  }
+  if (crc8(d, 6) != d[6]) {
+    LOG_WARN("DHT20 read failed: CRC mismatch");
+    return;
+  }
+
+  uint32_t rawHumidity = ((uint32_t)d[1] << 12) | ((uint32_t)d[2] << 4) | (d[3] >> 4);
+  uint32_t rawTemperature = ((uint32_t)(d[3] & 0x0F) << 16) | ((uint32_t)d[4] << 8) | d[5];
+  dht->_humidity = rawHumidity * (100.0f / 1048576.0f);
+  dht->_temperature = rawTemperature * (200.0f / 1048576.0f) - 50.0f;
+  TRACE_SENSOR(dht->_temperature, dht->_humidity);
+  AppBus::post(SensorSample{dht->_temperature, dht->_humidity, time(nullptr)});
+}
+
 float DHTDriver::getTemperature() {
-  return _sensor.getTemperature();
+  return _temperature;
 }
 
 float DHTDriver::getHumidity() {
-  return _sensor.getHumidity();
+  return _humidity;
 }
@@ -2,19 +2,31 @@
 #define DHTDRIVER_H
 
 #include <Arduino.h>
-#include <Wire.h>
-#include <DHT20.h>
+#include <hal/I2cBus.h>
+#include <core/Events.h>
 
 /**
  * DHTDriver wraps the DHT20 temperature/humidity sensor.
+ *
+ * A reading is two Background-priority bus transactions: a measurement
+ * trigger, and a 7-byte read once the 80 ms conversion is over. Nothing
+ * blocks in between. The result is posted as a SensorSample.
  */
 class DHTDriver {
 public:
-  /** Initialize pins and the sensor. */
+  static const uint8_t ADDRESS = 0x38;
+  static const unsigned long CONVERSION_MS = 80;
+
+  explicit DHTDriver(I2cBus& bus);
+
+  /** Check the sensor's calibration state and register it on the bus. */
   void begin();
 
-  /** Trigger a read; returns false on error. */
-  bool read();
+  /** Start a measurement; returns false if one is already running. */
+  bool requestRead();
+
+  /** Fetches the measurement once it is due. */
+  void update();
 
   /** Last read temperature in °C. */
   float getTemperature();
@@ -23,7 +35,20 @@ public:
   float getHumidity();
 
 private:
-  DHT20 _sensor;
+  enum State : uint8_t { Idle, Converting, Reading };
+
+  I2cBus&  _bus;
+  uint8_t  _device;
+  State    _state;
+  unsigned long _triggeredAt;
+  bool     _triggerFailed;  // reported after the read was queued
+  uint8_t  _data[7];
+  float    _temperature;
+  float    _humidity;
+
+  bool _resetRegister(uint8_t reg);
+  static void _onTriggered(void* self, const I2cResult& result);
+  static void _onData(void* self, const I2cResult& result);
 };
 
 #endif
@@ -0,0 +1,147 @@
+#include "DisplayDriver.h"
+#include <core/Log.h>
+
+DisplayDriver::DisplayDriver()
+  : _stripA(&_tft)
+  , _stripB(&_tft)
+  , _strips{&_stripA, &_stripB}
+  , _inFlight{false, false}
+  , _back(0)
+  , _ready(false)
+  , _dma(false)
+  , _background(TFT_BLACK)
+  , _frameStart(0)
+  , _frameBytes(0)
+  , _bandCostUs(3000)
+  , _stats()
+{}
+
+bool DisplayDriver::begin(uint16_t background) {
+  _background = background;
+  _tft.init();
+  _tft.setRotation(1);  // landscape, 240x135
+  _tft.fillScreen(background);
+#ifdef TFT_BL
+  pinMode(TFT_BL, OUTPUT);
+  digitalWrite(TFT_BL, TFT_BACKLIGHT_ON);
+#endif
+
+  for (uint8_t i = 0; i < 2; ++i) {
+    _strips[i]->setColorDepth(16);
+    if (!_strips[i]->createSprite(WIDTH, STRIP_ROWS)) {
+      LOG_WARN("Display: strip allocation failed");
+      return false;
+    }
+  }
+
+  // 16-bit sprites already hold pixels in panel byte order, so push them as is
+  _tft.setSwapBytes(false);
+  _dma = _tft.initDMA();
+  if (!_dma) LOG_WARN("Display: DMA unavailable, using blocking SPI");
+
+  // The panel starts out cleared: seed the row hashes with an empty row
+  _strips[0]->fillSprite(background);
+  uint32_t blank = _hashRow((const uint16_t*)_strips[0]->getPointer());
+  for (int16_t y = 0; y < HEIGHT; ++y) _rowHash[y] = blank;
+
+  _ready = true;
+  return true;
+}
+
+void DisplayDriver::beginFrame() {
+  _frameStart = micros();
+  _frameBytes = 0;
+  if (_ready) _tft.startWrite();
+}
+
+void DisplayDriver::renderRows(int16_t top, int16_t rows, DisplayPainter& painter) {
+  if (!_ready) return;
+  if (top < 0) {
+    rows += top;
+    top = 0;
+  }
+  if (top + rows > HEIGHT) rows = HEIGHT - top;
+
+  while (rows > 0) {
+    uint32_t bandStart = micros();
+    int16_t band = rows < STRIP_ROWS ? rows : STRIP_ROWS;
+
+    // Draw into the back strip while the other one may still be on its way to the panel
+    uint8_t index = _back;
+    _back ^= 1;
+    if (_inFlight[index]) {
+      _tft.dmaWait();
+      _inFlight[0] = _inFlight[1] = false;
+    }
+    TFT_eSprite& strip = *_strips[index];
+    strip.fillSprite(_background);
+    painter.paint(strip, top);
+    _push(index, top, band);
+
+    // Exponential average (1/8) of the band cost
+    uint32_t cost = micros() - bandStart;
+    _bandCostUs = _bandCostUs - (_bandCostUs >> 3) + (cost >> 3);
+    _stats.bandsRendered++;
+
+    top += band;
+    rows -= band;
+  }
+}
+
+void DisplayDriver::_push(uint8_t index, int16_t top, int16_t rows) {
+  const uint16_t* pixels = (const uint16_t*)_strips[index]->getPointer();
+  int16_t runStart = -1;
+  bool changed = false;
+
+  // Push each run of consecutive changed rows as one rectangle
+  for (int16_t r = 0; r <= rows; ++r) {
+    bool dirty = false;
+    if (r < rows) {
+      uint32_t h = _hashRow(pixels + r * WIDTH);
+      dirty = h != _rowHash[top + r];
+      _rowHash[top + r] = h;
+    }
+    if (dirty && runStart < 0) runStart = r;
+    if (!dirty && runStart >= 0) {
+      int16_t runRows = r - runStart;
+      uint16_t* data = (uint16_t*)(pixels + runStart * WIDTH);
+      if (_dma) {
+        // pushImageDMA() first waits for the previous transfer, so the other strip is free afterwards
+        _tft.pushImageDMA(0, top + runStart, WIDTH, runRows, data);
+        _inFlight[index ^ 1] = false;
+        _inFlight[index] = true;
+      } else {
+        _tft.pushImage(0, top + runStart, WIDTH, runRows, data);
+      }
+      _frameBytes += (uint32_t)runRows * WIDTH * 2;
+      runStart = -1;
+      changed = true;
+    }
+  }
+  if (!changed) _stats.bandsUnchanged++;
+}
+
+void DisplayDriver::endFrame(uint32_t budgetUs, uint8_t deferred) {
+  if (_ready) {
+    if (_dma) _tft.dmaWait();
+    _inFlight[0] = _inFlight[1] = false;
+    _tft.endWrite();
+  }
+  uint32_t elapsed = micros() - _frameStart;
+  _stats.frames++;
+  _stats.lastFrameUs = elapsed;
+  if (elapsed > _stats.maxFrameUs) _stats.maxFrameUs = elapsed;
+  if (elapsed > budgetUs) _stats.overBudget++;
+  _stats.lastSpiBytes = _frameBytes;
+  _stats.totalSpiBytes += _frameBytes;
+  _stats.deferred += deferred;
+}
+
+uint32_t DisplayDriver::_hashRow(const uint16_t* row) {
+  // FNV-1a over the row's 16-bit pixels
+  uint32_t h = 2166136261u;
+  for (int16_t x = 0; x < WIDTH; ++x) {
+    h = (h ^ row[x]) * 16777619u;
+  }
+  return h;
+}
@@ -0,0 +1,86 @@
+#ifndef DISPLAYDRIVER_H
+#define DISPLAYDRIVER_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+/**
+ * Draws one horizontal band of the screen into an off-screen strip.
+ * Content for screen row y goes to strip row (y - top); the strip clips.
+ */
+class DisplayPainter {
+public:
+  virtual ~DisplayPainter() {}
+  virtual void paint(TFT_eSprite& strip, int16_t top) = 0;
+};
+
+/** Per-frame and running display measurements. */
+struct DisplayStats {
+  uint32_t frames;
+  uint32_t lastFrameUs;     // render + SPI, including the final DMA wait
+  uint32_t maxFrameUs;
+  uint32_t lastSpiBytes;    // pixel bytes pushed in the last frame
+  uint32_t totalSpiBytes;
+  uint32_t bandsRendered;
+  uint32_t bandsUnchanged;  // rendered, but identical to what is on the panel
+  uint32_t overBudget;      // frames that took longer than their budget
+  uint32_t deferred;        // dirty regions postponed to a later frame
+};
+
+/**
+ * DisplayDriver owns the ST7789 (TFT_eSPI, landscape 240x135) and renders
+ * through two 240xSTRIP_ROWS 16-bit TFT_eSprite strips (~25 KB in total)
+ * instead of a full-screen sprite (~63 KB).
+ *
+ * While one strip is on its way to the panel over SPI DMA, the next band is
+ * drawn into the other one. Every rendered row is hashed and compared with
+ * the hash of what the panel already shows; only runs of changed rows are
+ * pushed, so a ticking seconds field costs one digit-high band, not the
+ * whole widget.
+ */
+class DisplayDriver {
+public:
+  static const int16_t WIDTH      = 240;
+  static const int16_t HEIGHT     = 135;
+  static const int16_t STRIP_ROWS = 27;
+
+  DisplayDriver();
+
+  /** Initialize the panel, backlight, DMA and strips; returns false if the strips could not be allocated. */
+  bool begin(uint16_t background = TFT_BLACK);
+
+  /** Start a frame; opens the SPI transaction held across all DMA transfers. */
+  void beginFrame();
+
+  /** Render screen rows [top, top + rows) band by band through `painter`. */
+  void renderRows(int16_t top, int16_t rows, DisplayPainter& painter);
+
+  /** Wait for the last transfer, close the transaction and record the frame against `budgetUs`. */
+  void endFrame(uint32_t budgetUs, uint8_t deferred);
+
+  /** Running average cost of one band (render + push), for frame budgeting. */
+  uint32_t bandCostUs() const { return _bandCostUs; }
+
+  const DisplayStats& stats() const { return _stats; }
+
+private:
+  TFT_eSPI    _tft;
+  TFT_eSprite _stripA;
+  TFT_eSprite _stripB;
+  TFT_eSprite* _strips[2];
+  bool        _inFlight[2];  // a DMA transfer may still be reading this strip
+  uint8_t     _back;         // strip to draw into next
+  bool        _ready;
+  bool        _dma;
+  uint16_t    _background;
+  uint32_t    _rowHash[HEIGHT];  // what the panel currently shows
+  uint32_t    _frameStart;
+  uint32_t    _frameBytes;
+  uint32_t    _bandCostUs;
+  DisplayStats _stats;
+
+  void _push(uint8_t index, int16_t top, int16_t rows);
+  static uint32_t _hashRow(const uint16_t* row);
+};
+
+#endif
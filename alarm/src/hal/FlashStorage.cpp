@@ -0,0 +1,80 @@
+#include "hal/FlashStorage.h"
+#include <core/Log.h>
+
+FlashStorage::FlashStorage(const char* directory)
+  : _directory(directory)
+  , _mounted(false)
+{
+  for (uint8_t i = 0; i < MAX_AREAS; ++i) _blockSize[i] = 0;
+}
+
+bool FlashStorage::begin() {
+  if (!LittleFS.begin(true)) {
+    LOG_ERROR("LittleFS mount failed");
+    return false;
+  }
+  if (!LittleFS.exists(_directory)) LittleFS.mkdir(_directory);
+  _mounted = true;
+  LOG_INFO("LittleFS: %u of %u B used", (unsigned)usedBytes(), (unsigned)totalBytes());
+  return true;
+}
+
+bool FlashStorage::open(uint8_t area, uint16_t blocks, uint16_t blockSize) {
+  if (!_mounted || area >= MAX_AREAS) return false;
+  char path[48];
+  snprintf(path, sizeof(path), "%s/%u.bin", _directory, area);
+  size_t size = (size_t)blocks * blockSize;
+  _blockSize[area] = blockSize;
+
+  if (LittleFS.exists(path)) {
+    _files[area] = LittleFS.open(path, "r+");
+    if (_files[area] && _files[area].size() == size) return true;
+    _files[area].close();
+    LOG_WARN("%s has a different layout, starting over", path);
+  }
+
+  // Allocate the whole file up front, as zeros (= never written blocks)
+  _files[area] = LittleFS.open(path, "w+");
+  if (!_files[area]) {
+    LOG_ERROR("Cannot create %s", path);
+    return false;
+  }
+  uint8_t zeros[64] = {0};
+  for (size_t written = 0; written < size; written += sizeof(zeros)) {
+    size_t n = size - written < sizeof(zeros) ? size - written : sizeof(zeros);
+    if (_files[area].write(zeros, n) != n) {
+      LOG_ERROR("Cannot allocate %u B for %s", (unsigned)size, path);
+      return false;
+    }
+  }
+  _files[area].flush();
+  return true;
+}
+
+bool FlashStorage::_seek(uint8_t area, uint16_t block) {
+  return area < MAX_AREAS && _files[area] &&
+         _files[area].seek((uint32_t)block * _blockSize[area], SeekSet);
+}
+
+bool FlashStorage::read(uint8_t area, uint16_t block, uint8_t* buf, uint16_t len) {
+  if (!_seek(area, block)) return false;
+  return _files[area].read(buf, len) == len;
+}
+
+bool FlashStorage::write(uint8_t area, uint16_t block, const uint8_t* buf) {
+  if (!_seek(area, block)) return false;
+  if (_files[area].write(buf, _blockSize[area]) != _blockSize[area]) {
+    LOG_WARN("Flash write failed (area %u, block %u)", area, block);
+    return false;
+  }
+  _files[area].flush();
+  return true;
+}
+
+size_t FlashStorage::usedBytes() const {
+  return LittleFS.usedBytes();
+}
+
+size_t FlashStorage::totalBytes() const {
+  return LittleFS.totalBytes();
+}
@@ -0,0 +1,45 @@
+#ifndef FLASHSTORAGE_H
+#define FLASHSTORAGE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <core/BlockStorage.h>
+
+/**
+ * FlashStorage keeps BlockStorage areas as files on the LittleFS
+ * partition ("spiffs" in the default partition table), one file per area:
+ * <directory>/<area>.bin.
+ *
+ * Files are created at full size on first use, so later writes rewrite
+ * blocks in place and never grow a file. Each write is flushed, which is
+ * when LittleFS commits it: a power cut leaves either the old or the new
+ * block. A write costs one LittleFS block rewrite (4 KB erase), up to a
+ * few tens of ms.
+ */
+class FlashStorage : public BlockStorage {
+  public:
+    static const uint8_t MAX_AREAS = 4;
+
+    explicit FlashStorage(const char* directory);
+
+    /** Mount LittleFS, formatting it if it does not hold a file system yet. */
+    bool begin();
+
+    bool open(uint8_t area, uint16_t blocks, uint16_t blockSize) override;
+    bool read(uint8_t area, uint16_t block, uint8_t* buf, uint16_t len) override;
+    bool write(uint8_t area, uint16_t block, const uint8_t* buf) override;
+
+    /** File system usage, for the logs. */
+    size_t usedBytes() const;
+    size_t totalBytes() const;
+
+  private:
+    const char* _directory;
+    bool        _mounted;
+    File        _files[MAX_AREAS];
+    uint16_t    _blockSize[MAX_AREAS];
+
+    bool _seek(uint8_t area, uint16_t block);
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "I2cBus.h"
+#include <core/Log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+I2cBus::I2cBus()
+  : _deviceCount(0)
+  , _clockHz(0)
+  , _task(nullptr)
+{
+  _sync.store(nullptr);
+}
+
+bool I2cBus::begin(int sda, int scl) {
+  if (_task) return true;
+  _clockHz = FAST_MODE_HZ;
+  if (!Wire.begin(sda, scl, _clockHz)) {
+    LOG_ERROR("I2C bus init failed!");
+    return false;
+  }
+  // Above loop() priority and on its core, so queued input work preempts it right away
+  TaskHandle_t handle = nullptr;
+  xTaskCreatePinnedToCore(_run, "i2c", 3072, this, 2, &handle, ARDUINO_RUNNING_CORE);
+  _task = handle;
+  return _task != nullptr;
+}
+
+uint8_t I2cBus::addDevice(const char* name, uint8_t address, uint32_t maxClockHz) {
+  for (uint8_t i = 0; i < _deviceCount; ++i) {
+    if (_devices[i].address == address) return i;
+  }
+  if (_deviceCount == MAX_DEVICES) {
+    LOG_ERROR("I2C: no room for %s", name);
+    return INVALID_DEVICE;
+  }
+  Device& dev = _devices[_deviceCount];
+  dev.name = name;
+  dev.address = address;
+  dev.clockHz = maxClockHz < FAST_MODE_HZ ? maxClockHz : FAST_MODE_HZ;
+  dev.stats = I2cDeviceStats();
+  return _deviceCount++;
+}
+
+bool I2cBus::submit(Priority priority, uint8_t device,
+                    const uint8_t* write, uint8_t writeLen,
+                    uint8_t* read, uint8_t readLen,
+                    I2cCallback callback, void* context) {
+  if (device >= _deviceCount || writeLen > MAX_WRITE) return false;
+  Transfer t;
+  t.device = device;
+  t.writeLen = writeLen;
+  t.readLen = readLen;
+  if (writeLen) memcpy(t.write, write, writeLen);
+  t.read = read;
+  t.callback = callback;
+  t.context = context;
+  t.sync = nullptr;
+  return _enqueue(priority, t);
+}
+
+bool I2cBus::writeRegisterAsync(Priority priority, uint8_t device, uint8_t reg, uint8_t value) {
+  uint8_t buf[2] = { reg, value };
+  return submit(priority, device, buf, 2);
+}
+
+bool I2cBus::transfer(uint8_t device, const uint8_t* write, uint8_t writeLen,
+                      uint8_t* read, uint8_t readLen) {
+  if (!_task || device >= _deviceCount || writeLen > MAX_WRITE) return false;
+  SyncSlot slot;
+  slot.done.store(false);
+  Transfer t;
+  t.device = device;
+  t.writeLen = writeLen;
+  t.readLen = readLen;
+  if (writeLen) memcpy(t.write, write, writeLen);
+  t.read = read;
+  t.callback = nullptr;
+  t.context = nullptr;
+  t.sync = &slot;
+  t.queuedUs = micros();
+  // Not through the queues: loop() is here, not draining completions, so the bus task may be
+  // waiting for room for one. It serves _sync meanwhile.
+  Transfer* idle = nullptr;
+  while (!_sync.compare_exchange_strong(idle, &t, std::memory_order_acq_rel)) {
+    idle = nullptr;
+    delay(1);
+  }
+  xTaskNotifyGive((TaskHandle_t)_task);
+  while (!slot.done.load(std::memory_order_acquire)) delay(1);
+  return slot.result.ok;
+}
+
+bool I2cBus::writeRegister(uint8_t device, uint8_t reg, uint8_t value) {
+  uint8_t buf[2] = { reg, value };
+  return transfer(device, buf, 2);
+}
+
+bool I2cBus::readRegister(uint8_t device, uint8_t reg, uint8_t& value) {
+  return transfer(device, &reg, 1, &value, 1);
+}
+
+bool I2cBus::_enqueue(Priority priority, const Transfer& transfer) {
+  if (!_task) return false;
+  Transfer t = transfer;
+  t.queuedUs = micros();
+  if (!_queues[priority].push(t)) {
+    _devices[t.device].stats.errors++;
+    return false;
+  }
+  xTaskNotifyGive((TaskHandle_t)_task);
+  return true;
+}
+
+uint16_t I2cBus::dispatch() {
+  uint16_t delivered = 0;
+  Completion c;
+  while (_completions.pop(c)) {
+    c.callback(c.context, c.result);
+    delivered++;
+  }
+  return delivered;
+}
+
+bool I2cBus::_runSync() {
+  Transfer* t = _sync.exchange(nullptr, std::memory_order_acq_rel);
+  if (!t) return false;
+  _execute(*t);
+  return true;
+}
+
+void I2cBus::_run(void* self) {
+  I2cBus* bus = static_cast<I2cBus*>(self);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // Strict priority: re-scan from the top after every transaction
+    bool ran = true;
+    while (ran) {
+      ran = bus->_runSync();
+      for (uint8_t p = 0; p < PRIORITIES && !ran; ++p) {
+        Transfer t;
+        if (bus->_queues[p].pop(t)) {
+          bus->_execute(t);
+          ran = true;
+        }
+      }
+    }
+  }
+}
+
+void I2cBus::_execute(const Transfer& t) {
+  Device& dev = _devices[t.device];
+  uint32_t start = micros();
+  if (start - t.queuedUs > dev.stats.maxWaitUs) dev.stats.maxWaitUs = start - t.queuedUs;
+  if (dev.clockHz != _clockHz) {
+    _clockHz = dev.clockHz;
+    Wire.setClock(_clockHz);
+  }
+
+  bool ok = true;
+  uint8_t got = 0;
+  if (t.writeLen) {
+    Wire.beginTransmission(dev.address);
+    Wire.write(t.write, t.writeLen);
+    // Repeated start when a read follows, so nobody can slip in between
+    ok = Wire.endTransmission(t.readLen == 0) == 0;
+  }
+  if (ok && t.readLen) {
+    got = Wire.requestFrom(dev.address, t.readLen);
+    for (uint8_t i = 0; i < got; ++i) t.read[i] = Wire.read();
+    ok = got == t.readLen;
+  }
+
+  I2cResult result = { t.device, ok, got, (uint32_t)(micros() - start) };
+  dev.stats.transactions++;
+  dev.stats.bytes += t.writeLen + got;
+  dev.stats.busUs += result.busUs;
+  if (result.busUs > dev.stats.maxBusUs) dev.stats.maxBusUs = result.busUs;
+  if (!ok) dev.stats.errors++;
+
+  if (t.sync) {
+    t.sync->result = result;
+    t.sync->done.store(true, std::memory_order_release);
+  } else if (t.callback) {
+    Completion c = { t.callback, t.context, result };
+    // loop() drains completions; wait for it rather than lose a driver's state transition.
+    // A blocking transfer() from loop() cannot wait on that in turn: it runs meanwhile.
+    while (!_completions.push(c)) {
+      _runSync();
+      vTaskDelay(1);
+    }
+  }
+}
@@ -0,0 +1,145 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <atomic>
+#include <core/EventBus.h>
+
+/** Outcome of one I2C transaction. */
+struct I2cResult {
+  uint8_t  device;
+  bool     ok;       // address and data ACKed, all requested bytes read
+  uint8_t  length;   // bytes actually read
+  uint32_t busUs;    // time the transaction held the bus
+};
+
+/** Completion callback; runs in the context that calls I2cBus::dispatch(). */
+typedef void (*I2cCallback)(void* context, const I2cResult& result);
+
+/** Bus usage of one device. */
+struct I2cDeviceStats {
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t bytes;       // written plus read
+  uint32_t busUs;       // total time holding the bus
+  uint32_t maxBusUs;
+  uint32_t maxWaitUs;   // longest time a transaction waited in the queue
+};
+
+/**
+ * I2cBus owns the Wire peripheral. Drivers no longer touch Wire; they
+ * queue transactions here.
+ *
+ * A transaction is an optional register write (up to MAX_WRITE bytes)
+ * followed by an optional read into a caller-owned buffer. With both, they
+ * run as one combined write/repeated-start/read. Transactions are queued
+ * per priority. A dedicated task runs them one at a time, always taking
+ * the highest non-empty priority first. So a background sensor delays an
+ * input transaction by at most the one transaction already on the wire.
+ * Within a priority, order is preserved.
+ *
+ * Completions are queued back and delivered by dispatch() from loop()
+ * context, like AppBus. Driver state therefore never changes under the
+ * bus task. transfer() is a blocking variant for setup code. It bypasses
+ * the queues and runs next, even while the bus task waits for loop() to
+ * make room for a completion.
+ *
+ * The bus runs at the highest clock every device on it allows (400 kHz
+ * fast mode for all current sensors). The clock is switched per
+ * transaction if a slower device is added.
+ */
+class I2cBus {
+  public:
+    enum Priority : uint8_t { Input, Normal, Background, PRIORITIES };
+
+    static const uint8_t MAX_DEVICES = 6;
+    static const uint8_t INVALID_DEVICE = 0xFF;
+    static const uint8_t MAX_WRITE = 8;
+    static const uint16_t QUEUE_DEPTH = 16;
+    static const uint32_t FAST_MODE_HZ = 400000;
+
+    I2cBus();
+
+    /** Starts Wire and the bus task. */
+    bool begin(int sda = -1, int scl = -1);
+
+    /**
+     * Registers a device; returns its handle for submit()/transfer(), or
+     * INVALID_DEVICE if the table is full (every transaction on it fails).
+     * @param maxClockHz  Fastest SCL the device supports.
+     */
+    uint8_t addDevice(const char* name, uint8_t address, uint32_t maxClockHz = FAST_MODE_HZ);
+
+    /**
+     * Queue a transaction. read must stay valid until the callback ran
+     * (or, without a callback, until the device's next callback).
+     * @return false if the queue for this priority is full.
+     */
+    bool submit(Priority priority, uint8_t device,
+                const uint8_t* write, uint8_t writeLen,
+                uint8_t* read = nullptr, uint8_t readLen = 0,
+                I2cCallback callback = nullptr, void* context = nullptr);
+
+    /** Queue a single register write without completion. */
+    bool writeRegisterAsync(Priority priority, uint8_t device, uint8_t reg, uint8_t value);
+
+    /** Blocking transaction for setup code; yields while the bus task runs it. */
+    bool transfer(uint8_t device, const uint8_t* write, uint8_t writeLen,
+                  uint8_t* read = nullptr, uint8_t readLen = 0);
+    bool writeRegister(uint8_t device, uint8_t reg, uint8_t value);
+    bool readRegister(uint8_t device, uint8_t reg, uint8_t& value);
+
+    /** Deliver completed transactions to their callbacks; returns how many. */
+    uint16_t dispatch();
+
+    uint8_t deviceCount() const { return _deviceCount; }
+    const char* deviceName(uint8_t device) const { return _devices[device].name; }
+    const I2cDeviceStats& stats(uint8_t device) const { return _devices[device].stats; }
+
+  private:
+    struct SyncSlot {
+      I2cResult         result;
+      std::atomic<bool> done;
+    };
+
+    struct Transfer {
+      uint8_t     device;
+      uint8_t     writeLen;
+      uint8_t     readLen;
+      uint8_t     write[MAX_WRITE];
+      uint8_t*    read;
+      I2cCallback callback;
+      void*       context;
+      SyncSlot*   sync;
+      uint32_t    queuedUs;
+    };
+
+    struct Completion {
+      I2cCallback callback;
+      void*       context;
+      I2cResult   result;
+    };
+
+    struct Device {
+      const char*    name;
+      uint8_t        address;
+      uint32_t       clockHz;
+      I2cDeviceStats stats;
+    };
+
+    Device   _devices[MAX_DEVICES];
+    uint8_t  _deviceCount;
+    uint32_t _clockHz;
+    void*    _task;  // TaskHandle_t
+    EventQueue<Transfer, QUEUE_DEPTH>   _queues[PRIORITIES];
+    EventQueue<Completion, QUEUE_DEPTH> _completions;
+    std::atomic<Transfer*> _sync;  // transfer()'s, waiting for the bus task
+
+    bool _enqueue(Priority priority, const Transfer& transfer);
+    bool _runSync();
+    void _execute(const Transfer& transfer);
+    static void _run(void* self);
+};
+
+#endif
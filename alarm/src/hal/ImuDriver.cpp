@@ -0,0 +1,194 @@
+#include "ImuDriver.h"
+#include <core/Log.h>
+
+// LSM6DSO registers
+static const uint8_t REG_FIFO_CTRL1  = 0x07;
+static const uint8_t REG_FIFO_CTRL2  = 0x08;
+static const uint8_t REG_FIFO_CTRL3  = 0x09;
+static const uint8_t REG_FIFO_CTRL4  = 0x0A;
+static const uint8_t REG_INT1_CTRL   = 0x0D;
+static const uint8_t REG_WHO_AM_I    = 0x0F;
+static const uint8_t REG_CTRL1_XL    = 0x10;
+static const uint8_t REG_CTRL3_C     = 0x12;
+static const uint8_t REG_CTRL6_C     = 0x15;
+static const uint8_t REG_WAKE_UP_SRC = 0x1B;
+static const uint8_t REG_TAP_CFG0    = 0x56;
+static const uint8_t REG_TAP_CFG2    = 0x58;
+static const uint8_t REG_WAKE_UP_THS = 0x5B;
+static const uint8_t REG_WAKE_UP_DUR = 0x5C;
+static const uint8_t REG_MD1_CFG     = 0x5E;
+static const uint8_t REG_FIFO_DATA   = 0x78;
+
+static const uint8_t LSM6DSO_ID      = 0x6C;
+static const uint8_t XL_12HZ5_4G     = 0x18;
+static const uint8_t XL_52HZ_4G      = 0x38;
+static const uint8_t XL_LOW_POWER    = 0x10;  // CTRL6_C XL_HM_MODE
+static const uint8_t BDU_IF_INC      = 0x44;
+static const uint8_t FIFO_BYPASS     = 0x00;
+static const uint8_t FIFO_CONTINUOUS = 0x06;
+static const uint8_t FIFO_BDR_XL_52  = 0x03;
+static const uint8_t INT1_FIFO_TH    = 0x08;
+static const uint8_t MD1_INT1_WU     = 0x20;
+static const uint8_t TAG_XL          = 0x02;
+static const uint8_t WAKE_THS_187MG  = 3;     // 1 LSB = FS/64 = 62.5 mg at ±4 g
+static const uint8_t SAMPLE_BYTES    = 7;
+
+ImuDriver* ImuDriver::_instance = nullptr;
+
+ImuDriver::ImuDriver(I2cBus& bus, uint8_t intPin, uint8_t address)
+  : _bus(bus)
+  , _device(0)
+  , _address(address)
+  , _intPin(intPin)
+  , _ready(false)
+  , _active(false)
+  , _alarmActive(false)
+  , _busy(false)
+  , _bursts(0)
+  , _wakeSource(0)
+  , _scratch(0)
+  , _lastMotion(0)
+  , _stats()
+  , _pending(false)
+{
+}
+
+bool ImuDriver::begin() {
+  _device = _bus.addDevice("LSM6DSO", _address);
+  if (_device == I2cBus::INVALID_DEVICE) return false;
+  uint8_t id = 0;
+  if (!_bus.readRegister(_device, REG_WHO_AM_I, id) || id != LSM6DSO_ID) {
+    LOG_WARN("LSM6DSO not found");
+    return false;
+  }
+
+  // Queued in order ahead of anything update() submits
+  _write(REG_CTRL3_C, BDU_IF_INC);
+  // Wake-up: latched, cleared by reading WAKE_UP_SRC, slope filter, no duration
+  _write(REG_TAP_CFG0, 0x41);
+  _write(REG_TAP_CFG2, 0x80);
+  _write(REG_WAKE_UP_THS, WAKE_THS_187MG);
+  _write(REG_WAKE_UP_DUR, 0x00);
+  _write(REG_FIFO_CTRL1, WATERMARK);
+  _write(REG_FIFO_CTRL2, 0x00);
+  _enterIdle();
+
+  _instance = this;
+  pinMode(_intPin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(_intPin), _onInterrupt, RISING);
+  _ready = true;
+  return true;
+}
+
+void IRAM_ATTR ImuDriver::_onInterrupt() {
+  if (_instance) _instance->_pending = true;
+}
+
+void ImuDriver::_enterIdle() {
+  _write(REG_INT1_CTRL, 0x00);
+  _write(REG_FIFO_CTRL4, FIFO_BYPASS);
+  _write(REG_CTRL6_C, XL_LOW_POWER);
+  _write(REG_CTRL1_XL, XL_12HZ5_4G);
+  _write(REG_MD1_CFG, MD1_INT1_WU);
+  // Drop a wake-up latched during the switch
+  static const uint8_t wakeSrc = REG_WAKE_UP_SRC;
+  _bus.submit(I2cBus::Input, _device, &wakeSrc, 1, &_scratch, 1);
+  _stats.i2cTransactions++;
+  _active = false;
+}
+
+void ImuDriver::_enterActive() {
+  _write(REG_MD1_CFG, 0x00);
+  _write(REG_CTRL6_C, 0x00);
+  _write(REG_CTRL1_XL, XL_52HZ_4G);
+  _write(REG_FIFO_CTRL3, FIFO_BDR_XL_52);
+  _write(REG_FIFO_CTRL4, FIFO_CONTINUOUS);
+  _write(REG_INT1_CTRL, INT1_FIFO_TH);
+  _active = true;
+  _lastMotion = millis();
+}
+
+void ImuDriver::setAlarmActive(bool active) {
+  _alarmActive = active;
+  if (_ready && active && !_active) _enterActive();
+}
+
+void ImuDriver::update() {
+  if (!_ready) return;
+  _bursts = 0;
+  if (_active && !_alarmActive && millis() - _lastMotion >= ACTIVE_MS) {
+    _enterIdle();
+    return;
+  }
+  if (_busy) return;
+  // INT1 is level while the condition holds, so a high line also covers an edge missed during a burst
+  if (!_pending && digitalRead(_intPin) == LOW) return;
+  _pending = false;
+
+  if (_active) {
+    _readBatch();
+    return;
+  }
+  // Reading WAKE_UP_SRC releases the latched interrupt
+  static const uint8_t wakeSrc = REG_WAKE_UP_SRC;
+  if (_bus.submit(I2cBus::Input, _device, &wakeSrc, 1, &_wakeSource, 1, _onWakeSource, this)) {
+    _stats.i2cTransactions++;
+    _busy = true;
+  }
+}
+
+void ImuDriver::_onWakeSource(void* self, const I2cResult& result) {
+  ImuDriver* imu = static_cast<ImuDriver*>(self);
+  imu->_busy = false;
+  if (result.ok && !imu->_active && (imu->_wakeSource & 0x08)) {
+    imu->_stats.wakeups++;
+    imu->_enterActive();
+  }
+}
+
+void ImuDriver::_readBatch() {
+  // One combined transaction: the address rolls over from 0x7E back to 0x78 with IF_INC
+  static const uint8_t fifoData = REG_FIFO_DATA;
+  if (_bus.submit(I2cBus::Input, _device, &fifoData, 1, _fifo, sizeof(_fifo), _onBatch, this)) {
+    _stats.i2cTransactions++;
+    _busy = true;
+    _bursts++;
+  }
+}
+
+void ImuDriver::_onBatch(void* self, const I2cResult& result) {
+  ImuDriver* imu = static_cast<ImuDriver*>(self);
+  imu->_busy = false;
+  if (!result.ok) return;
+  unsigned long start = micros();
+  imu->_stats.batches++;
+
+  unsigned long now = millis();
+  const uint8_t* buf = imu->_fifo;
+  for (uint8_t off = 0; off + SAMPLE_BYTES <= result.length; off += SAMPLE_BYTES) {
+    if ((buf[off] >> 3) != TAG_XL) continue;
+    int16_t x = (int16_t)(buf[off + 1] | (buf[off + 2] << 8));
+    int16_t y = (int16_t)(buf[off + 3] | (buf[off + 4] << 8));
+    int16_t z = (int16_t)(buf[off + 5] | (buf[off + 6] << 8));
+    imu->_stats.samples++;
+
+    uint8_t detected = imu->_detector.feed(x, y, z);
+    if (detected & MotionDetector::Shake) {
+      AppBus::post(MotionEvent{MotionEvent::Shake, imu->_detector.eventMg(), now});
+    }
+    if (detected & MotionDetector::PickedUp) {
+      AppBus::post(MotionEvent{MotionEvent::PickedUp, imu->_detector.eventMg(), now});
+    }
+    if (imu->_detector.moving()) imu->_lastMotion = now;
+  }
+
+  imu->_stats.lastBatchUs = result.busUs + (micros() - start);
+  if (imu->_stats.lastBatchUs > imu->_stats.maxBatchUs) imu->_stats.maxBatchUs = imu->_stats.lastBatchUs;
+
+  // Drain a backlog (e.g. after a long loop() pass) one watermark burst at a time
+  if (imu->_active && imu->_bursts < MAX_BURSTS && digitalRead(imu->_intPin) == HIGH) imu->_readBatch();
+}
+
+void ImuDriver::_write(uint8_t reg, uint8_t value) {
+  if (_bus.writeRegisterAsync(I2cBus::Input, _device, reg, value)) _stats.i2cTransactions++;
+}
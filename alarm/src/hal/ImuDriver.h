@@ -0,0 +1,87 @@
+#ifndef IMUDRIVER_H
+#define IMUDRIVER_H
+
+#include <Arduino.h>
+#include <hal/I2cBus.h>
+#include <core/Events.h>
+#include <core/MotionDetector.h>
+
+/** Bus and CPU cost of the motion pipeline. */
+struct ImuStats {
+  uint32_t i2cTransactions;  // every register access and FIFO burst queued
+  uint32_t wakeups;          // wake-up interrupts taken while idle
+  uint32_t batches;          // FIFO watermark bursts read
+  uint32_t samples;          // accelerometer samples fed to the detector
+  uint32_t lastBatchUs;      // bus time of the burst plus filtering, last batch
+  uint32_t maxBatchUs;
+};
+
+/**
+ * ImuDriver runs the LSM6DSO accelerometer from its INT1 line instead of
+ * polling it.
+ *
+ * Idle: the accelerometer runs at 12.5 Hz in low-power mode with only the
+ * wake-up detector routed to INT1. Nothing is read over I2C until it fires.
+ *
+ * Active: after a wake-up, or while an alarm rings, samples are batched at
+ * 52 Hz in the hardware FIFO. INT1 rises at the FIFO watermark and update()
+ * queues exactly one Input-priority burst read of WATERMARK samples from
+ * FIFO_DATA_OUT (tag and data, 7 bytes each). MotionDetector filters each
+ * batch when the read completes, and detections are posted as MotionEvents.
+ * After ACTIVE_MS without motion the driver returns to idle.
+ */
+class ImuDriver {
+  public:
+    static const uint8_t WATERMARK = 16;  // samples per burst, 16 * 7 = 112 bytes < Wire buffer
+    static const uint8_t MAX_BURSTS = 8;  // per update(), about 2.5 s of samples
+    static const unsigned long ACTIVE_MS = 5000;
+
+    /**
+     * @param intPin   GPIO wired to INT1 (push-pull, active high).
+     * @param address  I2C address (0x6B with SDO/SA0 high).
+     */
+    ImuDriver(I2cBus& bus, uint8_t intPin = 35, uint8_t address = 0x6B);
+
+    /** Configures the sensor in idle mode; returns false if no LSM6DSO answers. */
+    bool begin();
+
+    /** Services INT1: a wake-up or a full FIFO watermark. Cheap when neither happened. */
+    void update();
+
+    /** Keep streaming (and detecting) while an alarm is active, regardless of motion. */
+    void setAlarmActive(bool active);
+
+    bool streaming() const { return _active; }
+    const ImuStats& stats() const { return _stats; }
+
+  private:
+    I2cBus&  _bus;
+    uint8_t  _device;
+    uint8_t  _address;
+    uint8_t  _intPin;
+    bool     _ready;
+    bool     _active;
+    bool     _alarmActive;
+    bool     _busy;         // a wake-source or FIFO read is queued
+    uint8_t  _bursts;       // FIFO bursts chained since the last update()
+    uint8_t  _wakeSource;
+    uint8_t  _scratch;
+    uint8_t  _fifo[WATERMARK * 7];
+    unsigned long _lastMotion;
+    MotionDetector _detector;
+    ImuStats _stats;
+    volatile bool _pending;
+
+    void _enterIdle();
+    void _enterActive();
+    void _readBatch();
+    void _write(uint8_t reg, uint8_t value);
+
+    static void _onWakeSource(void* self, const I2cResult& result);
+    static void _onBatch(void* self, const I2cResult& result);
+
+    static ImuDriver* _instance;
+    static void IRAM_ATTR _onInterrupt();
+};
+
+#endif
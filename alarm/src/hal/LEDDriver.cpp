@@ -1,4 +1,5 @@
 #include "LEDDriver.h"
+#include <core/Energy.h>
 
 LEDDriver::LEDDriver(std::initializer_list<uint8_t> pins) {
   _numPins = pins.size();
@@ -17,13 +18,17 @@ void LEDDriver::begin() {
 }
 
 void LEDDriver::setPattern(const bool pattern[]) {
+  uint8_t lit = 0;
   for (uint8_t i = 0; i < _numPins; i++) {
     digitalWrite(_pins[i], pattern[i] ? HIGH : LOW);
+    if (pattern[i]) lit++;
   }
+  Energy::set(RailLeds, lit);
 }
 
 void LEDDriver::clear() {
   for (uint8_t i = 0; i < _numPins; i++) {
     digitalWrite(_pins[i], LOW);
   }
+  Energy::set(RailLeds, 0);
 }
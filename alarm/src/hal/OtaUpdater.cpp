@@ -0,0 +1,262 @@
+#include "hal/OtaUpdater.h"
+#include <core/Log.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_image_format.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+extern WifiModule wifi;
+
+namespace {
+
+const char* const NVS_NAMESPACE = "ota";
+
+// The running slot, read in place as the patch's base
+class PartitionImage : public FirmwareImage {
+  public:
+    explicit PartitionImage(const esp_partition_t* partition) : _partition(partition) {}
+    bool read(uint32_t offset, uint8_t* data, size_t len) override {
+      return esp_partition_read(_partition, offset, data, len) == ESP_OK;
+    }
+
+  private:
+    const esp_partition_t* _partition;
+};
+
+// The other slot; each 4 KB sector is erased just before it is first written
+class PartitionWriter : public ByteSink {
+  public:
+    explicit PartitionWriter(const esp_partition_t* partition)
+      : _partition(partition), _handle(0), _started(false), _failed(false) {}
+
+    bool write(const uint8_t* data, size_t len) override {
+      if (_failed) return false;
+      if (!_started) {
+        _failed = esp_ota_begin(_partition, OTA_WITH_SEQUENTIAL_WRITES, &_handle) != ESP_OK;
+        _started = !_failed;
+      }
+      if (!_failed) _failed = esp_ota_write(_handle, data, len) != ESP_OK;
+      return !_failed;
+    }
+
+    // The IDF checks the image's own structure and checksum on top of the patch's hash
+    bool end() {
+      if (!_started || _failed) return false;
+      _started = false;
+      return esp_ota_end(_handle) == ESP_OK;
+    }
+
+    void abort() {
+      if (_started) esp_ota_abort(_handle);
+      _started = false;
+    }
+
+  private:
+    const esp_partition_t* _partition;
+    esp_ota_handle_t       _handle;
+    bool                   _started;
+    bool                   _failed;
+};
+
+void toHex(const uint8_t* bytes, size_t len, char* out) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; ++i) {
+    out[2 * i] = digits[bytes[i] >> 4];
+    out[2 * i + 1] = digits[bytes[i] & 0xF];
+  }
+  out[2 * len] = '\0';
+}
+
+}  // namespace
+
+OtaUpdater::OtaUpdater(const char* serverHost, uint16_t serverPort, const char* endpointPath)
+  : _host(serverHost)
+  , _port(serverPort)
+  , _path(endpointPath)
+  , _trial(false)
+  , _imageLength(0)
+  , _hashed(false)
+  , _result()
+{
+  _busy.store(false);
+  memset(_imageHash, 0, sizeof(_imageHash));
+  memset(_rejected, 0, sizeof(_rejected));
+}
+
+void OtaUpdater::begin() {
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);
+  prefs.getBytes("rejected", _rejected, sizeof(_rejected));
+  _trial = prefs.getBool("trial", false);
+  if (_trial) {
+    uint8_t boots = prefs.getUChar("boots", 0) + 1;
+    prefs.putUChar("boots", boots);
+    prefs.end();
+    if (boots > MAX_TRIAL_BOOTS) {
+      LOG_ERROR("New firmware did not come up in %u boots", MAX_TRIAL_BOOTS);
+      rollback();
+    }
+    LOG_WARN("New firmware on trial, boot %u of %u", boots, MAX_TRIAL_BOOTS);
+  } else {
+    prefs.end();
+  }
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  esp_partition_pos_t position = { running->address, running->size };
+  esp_image_metadata_t metadata;
+  if (esp_image_get_metadata(&position, &metadata) == ESP_OK) _imageLength = metadata.image_len;
+  LOG_INFO("Firmware: %s, %lu B", running->label, (unsigned long)_imageLength);
+}
+
+bool OtaUpdater::check() {
+  if (_trial || _imageLength == 0 || _busy.exchange(true)) return false;
+  // Next to the Wi-Fi stack like the request task; the patcher's buffers live on this stack
+  if (xTaskCreatePinnedToCore(_run, "ota", 12288, this, 1, nullptr, 0) != pdPASS) {
+    _busy.store(false);
+    return false;
+  }
+  return true;
+}
+
+void OtaUpdater::confirm() {
+  if (!_trial) return;
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);
+  prefs.putBool("trial", false);
+  prefs.remove("boots");
+  prefs.end();
+  esp_ota_mark_app_valid_cancel_rollback();
+  _trial = false;
+}
+
+// With two slots, the next update slot is the one this image was installed from
+void OtaUpdater::rollback() {
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);
+  uint8_t installed[Sha256::DIGEST_SIZE];
+  if (prefs.getBytes("image", installed, sizeof(installed)) == sizeof(installed)) {
+    prefs.putBytes("rejected", installed, sizeof(installed));
+  }
+  prefs.putBool("trial", false);
+  prefs.remove("boots");
+  prefs.end();
+
+  const esp_partition_t* previous = esp_ota_get_next_update_partition(nullptr);
+  if (!previous || esp_ota_set_boot_partition(previous) != ESP_OK) {
+    LOG_ERROR("No previous firmware to go back to");
+  } else {
+    LOG_WARN("Rolling back to %s", previous->label);
+  }
+  // The queued log records would not survive the restart
+  Log::drain();
+  ESP.restart();
+}
+
+void OtaUpdater::restart() {
+  LOG_INFO("Restarting into the new firmware");
+  Log::drain();
+  ESP.restart();
+}
+
+void OtaUpdater::_run(void* self) {
+  static_cast<OtaUpdater*>(self)->_check();
+  vTaskDelete(nullptr);
+}
+
+void OtaUpdater::_check() {
+  unsigned long start = millis();
+  _result = OtaEvent();
+  _result.result = OtaEvent::Failed;
+
+  if (!_hashRunning()) {
+    LOG_ERROR("Cannot read the running firmware");
+  } else {
+    // The hash names the base; the server answers with a patch made for exactly this image
+    char query[128];
+    char hex[2 * Sha256::DIGEST_SIZE + 1];
+    toHex(_imageHash, sizeof(_imageHash), hex);
+    snprintf(query, sizeof(query), "%s?from=%s", _path, hex);
+    // The deadline covers the body too: room to connect, then the whole download
+    int status = wifi.httpGetStream(_host, _port, query, *this, CONNECT_DEADLINE_MS + DOWNLOAD_LIMIT_MS);
+    _result.status = (int16_t)(status < INT16_MIN ? INT16_MIN : status > INT16_MAX ? INT16_MAX : status);
+  }
+
+  _result.ms = millis() - start;
+  AppBus::post(_result);
+  _busy.store(false);
+}
+
+bool OtaUpdater::_hashRunning() {
+  if (_hashed) return true;
+  PartitionImage image(esp_ota_get_running_partition());
+  _hashed = hashImage(image, _imageLength, _imageHash);
+  return _hashed;
+}
+
+bool OtaUpdater::onResponse(int status, Stream& body, int contentLength) {
+  if (status == 204) {
+    _result.result = OtaEvent::UpToDate;
+    return true;
+  }
+  if (status != 200) return false;
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  if (!target) {
+    LOG_ERROR("No OTA slot in the partition table");
+    return false;
+  }
+
+  PartitionImage base(running);
+  PartitionWriter writer(target);
+  DeltaPatcher patcher(base, _imageLength, _imageHash, writer);
+
+  // Read until the patch is complete; the server may not send a Content-Length
+  uint8_t chunk[256];
+  unsigned long start = millis();
+  bool checkedImage = false;
+  while (patcher.status() == DeltaPatcher::Running && millis() - start < DOWNLOAD_LIMIT_MS) {
+    size_t want = sizeof(chunk);
+    if (contentLength >= 0) {
+      if (patcher.patchBytes() >= (uint32_t)contentLength) break;
+      if ((uint32_t)contentLength - patcher.patchBytes() < want) want = contentLength - patcher.patchBytes();
+    }
+    size_t n = body.readBytes(chunk, want);
+    if (n == 0) break;
+    patcher.write(chunk, n);
+
+    // Once the header is in: do not fetch the image that was rolled back all over again
+    if (!checkedImage && patcher.header().imageSize) {
+      checkedImage = true;
+      if (memcmp(patcher.header().imageHash, _rejected, sizeof(_rejected)) == 0) {
+        _result.result = OtaEvent::Skipped;
+        break;
+      }
+    }
+  }
+  DeltaPatcher::Status result = _result.result == OtaEvent::Skipped ? DeltaPatcher::Running : patcher.finish();
+  _result.patch = result;
+  _result.patchBytes = patcher.patchBytes();
+  _result.imageBytes = patcher.header().imageSize;
+  if (result != DeltaPatcher::Done) {
+    writer.abort();
+    return _result.result == OtaEvent::Skipped;
+  }
+  if (!writer.end()) {
+    LOG_ERROR("The new firmware does not validate");
+    return false;
+  }
+
+  // Boot it next, on trial
+  if (esp_ota_set_boot_partition(target) != ESP_OK) return false;
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);
+  prefs.putBytes("image", patcher.header().imageHash, Sha256::DIGEST_SIZE);
+  prefs.putUChar("boots", 0);
+  prefs.putBool("trial", true);
+  prefs.end();
+  _result.result = OtaEvent::Installed;
+  return true;
+}
@@ -0,0 +1,78 @@
+#ifndef OTAUPDATER_H
+#define OTAUPDATER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <core/DeltaPatch.h>
+#include <core/Events.h>
+#include <hal/WifiModule.h>
+
+/**
+ * OtaUpdater: firmware updates over Wi-Fi into the other app slot (app0 /
+ * app1 of the default partition table), as delta patches (core/DeltaPatch.h).
+ *
+ * check() asks the server for a patch from the running image:
+ *   GET <path>?from=<SHA-256 of the running image, hex>
+ *   204                   up to date
+ *   200 + DeltaPatcher    the patch, or a full image if it has none for this base
+ * and applies it in a task of its own while it downloads: base bytes come
+ * from the running slot, the new image goes straight into the other one.
+ * Nothing is switched unless the image hashes to what the patch promised
+ * and the IDF accepts it; the outcome is posted as an OtaEvent. restart()
+ * then boots it, whenever main.cpp finds a good moment.
+ *
+ * A new image boots on trial. The bootloader of the Arduino core has no
+ * rollback, so the trial is kept in NVS: begin() counts trial boots and
+ * goes back to the previous slot after MAX_TRIAL_BOOTS (a crash loop), and
+ * main.cpp calls rollback() if the image is not confirm()ed in time. A
+ * rolled back image is remembered, and not downloaded again.
+ */
+class OtaUpdater : public ResponseHandler {
+  public:
+    static const uint8_t  MAX_TRIAL_BOOTS = 3;
+    static const uint32_t CONNECT_DEADLINE_MS = 30000;
+    static const uint32_t DOWNLOAD_LIMIT_MS = 5UL * 60UL * 1000UL;
+
+    OtaUpdater(const char* serverHost, uint16_t serverPort, const char* endpointPath);
+
+    /** Call first in setup(): books a trial boot, or rolls back and restarts. */
+    void begin();
+
+    /** Start a check in the background; false if one is running or the image is on trial. */
+    bool check();
+
+    bool busy() const { return _busy.load(); }
+
+    /** Running an image that has not been confirmed yet. */
+    bool onTrial() const { return _trial; }
+
+    /** The running image works: keep it. */
+    void confirm();
+
+    /** Boot the previous image again and remember this one as bad. Does not return. */
+    void rollback();
+
+    /** Boot the image check() installed. Does not return. */
+    void restart();
+
+  private:
+    const char*       _host;
+    uint16_t          _port;
+    const char*       _path;
+    bool              _trial;
+    std::atomic<bool> _busy;
+    uint32_t          _imageLength;  // of the running image, 0 until known
+    uint8_t           _imageHash[Sha256::DIGEST_SIZE];
+    bool              _hashed;
+    uint8_t           _rejected[Sha256::DIGEST_SIZE];  // last image rolled back, zeros if none
+    OtaEvent          _result;       // of the check in progress
+
+    static void _run(void* self);
+    void _check();
+    bool _hashRunning();
+
+    // ResponseHandler: patch into the other slot as the body streams in
+    bool onResponse(int status, Stream& body, int contentLength) override;
+};
+
+#endif
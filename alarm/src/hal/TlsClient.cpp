@@ -0,0 +1,361 @@
+#include "hal/TlsClient.h"
+#include <core/Log.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/net_sockets.h>
+#include <esp_heap_caps.h>
+
+// ---------------------------------------------------------------------------
+// TlsSessionCache
+// ---------------------------------------------------------------------------
+
+TlsSessionCache::TlsSessionCache() {
+  for (uint8_t i = 0; i < CAPACITY; i++) {
+    _entries[i].valid = false;
+    _entries[i].lastUse = 0;
+    mbedtls_ssl_session_init(&_entries[i].session);
+  }
+}
+
+TlsSessionCache::~TlsSessionCache() {
+  for (uint8_t i = 0; i < CAPACITY; i++) {
+    mbedtls_ssl_session_free(&_entries[i].session);
+  }
+}
+
+TlsSessionCache::Entry* TlsSessionCache::_find(const char* host, uint16_t port) {
+  for (uint8_t i = 0; i < CAPACITY; i++) {
+    if (_entries[i].valid && _entries[i].port == port && strcmp(_entries[i].host, host) == 0) {
+      return &_entries[i];
+    }
+  }
+  return nullptr;
+}
+
+bool TlsSessionCache::load(const char* host, uint16_t port, mbedtls_ssl_context* ssl) {
+  Entry* entry = _find(host, port);
+  if (!entry) return false;
+  if (mbedtls_ssl_set_session(ssl, &entry->session) != 0) {
+    invalidate(host, port);
+    return false;
+  }
+  entry->lastUse = millis();
+  return true;
+}
+
+void TlsSessionCache::store(const char* host, uint16_t port, const mbedtls_ssl_context* ssl) {
+  // Reuse the entry for this host, else a free one, else the least recently used
+  Entry* entry = _find(host, port);
+  for (uint8_t i = 0; !entry && i < CAPACITY; i++) {
+    if (!_entries[i].valid) entry = &_entries[i];
+  }
+  if (!entry) {
+    entry = &_entries[0];
+    for (uint8_t i = 1; i < CAPACITY; i++) {
+      if (_entries[i].lastUse < entry->lastUse) entry = &_entries[i];
+    }
+  }
+
+  mbedtls_ssl_session_free(&entry->session);
+  mbedtls_ssl_session_init(&entry->session);
+  if (mbedtls_ssl_get_session(ssl, &entry->session) != 0) {
+    entry->valid = false;
+    return;
+  }
+  strncpy(entry->host, host, sizeof(entry->host) - 1);
+  entry->host[sizeof(entry->host) - 1] = '\0';
+  entry->port = port;
+  entry->valid = true;
+  entry->lastUse = millis();
+}
+
+void TlsSessionCache::invalidate(const char* host, uint16_t port) {
+  Entry* entry = _find(host, port);
+  if (entry) {
+    entry->valid = false;
+    mbedtls_ssl_session_free(&entry->session);
+    mbedtls_ssl_session_init(&entry->session);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// TlsClient
+// ---------------------------------------------------------------------------
+
+TlsClient::TlsClient(TlsSessionCache& cache)
+  : _cache(cache)
+  , _configured(false)
+  , _connected(false)
+  , _insecure(false)
+  , _hasPin(false)
+  , _certVerified(false)
+  , _timeoutMs(5000)
+  , _peek(-1)
+  , _txBytes(0)
+  , _rxBytes(0)
+  , _minFreeHeap(0)
+{
+  memset(&_stats, 0, sizeof(_stats));
+  mbedtls_ssl_init(&_ssl);
+  mbedtls_ssl_config_init(&_conf);
+  mbedtls_entropy_init(&_entropy);
+  mbedtls_ctr_drbg_init(&_drbg);
+}
+
+TlsClient::~TlsClient() {
+  stop();
+  mbedtls_ssl_free(&_ssl);
+  mbedtls_ssl_config_free(&_conf);
+  mbedtls_ctr_drbg_free(&_drbg);
+  mbedtls_entropy_free(&_entropy);
+}
+
+void TlsClient::setPublicKeyPin(const uint8_t sha256[32]) {
+  memcpy(_pin, sha256, sizeof(_pin));
+  _hasPin = true;
+}
+
+bool TlsClient::_configure() {
+  if (_configured) return true;
+
+  static const char pers[] = "alarm-tls";
+  if (mbedtls_ctr_drbg_seed(&_drbg, mbedtls_entropy_func, &_entropy,
+                            (const unsigned char*)pers, sizeof(pers) - 1) != 0) {
+    return false;
+  }
+  if (mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT,
+                                  MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+    return false;
+  }
+  // No CA chain is loaded: _verify() accepts the chain iff the leaf key matches the pin
+  mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_verify(&_conf, _verify, this);
+  mbedtls_ssl_conf_rng(&_conf, mbedtls_ctr_drbg_random, &_drbg);
+  mbedtls_ssl_conf_read_timeout(&_conf, _timeoutMs);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+  if (mbedtls_ssl_setup(&_ssl, &_conf) != 0) {
+    return false;
+  }
+  _configured = true;
+  return true;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip.toString().c_str(), port, (int32_t)_timeoutMs);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, (int32_t)_timeoutMs);
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+  return connect(ip.toString().c_str(), port, timeoutMs);
+}
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  if (_connected) stop();
+  if (!_hasPin && !_insecure) {
+    LOG_WARN("TLS: no public key pin configured");
+    return 0;
+  }
+  if (!_configure()) {
+    LOG_ERROR("TLS: mbedTLS setup failed");
+    return 0;
+  }
+
+  unsigned long start = micros();
+  uint32_t freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  _minFreeHeap = freeBefore;
+  _txBytes = 0;
+  _rxBytes = 0;
+  _certVerified = false;
+  _peek = -1;
+
+  if (!WiFiClient::connect(host, port, timeoutMs)) {
+    _stats.failures++;
+    return 0;
+  }
+
+  mbedtls_ssl_session_reset(&_ssl);
+  mbedtls_ssl_set_hostname(&_ssl, host);
+  mbedtls_ssl_set_bio(&_ssl, this, _bioSend, nullptr, _bioRecv);
+  bool offered = _cache.load(host, port, &_ssl);
+
+  int ret;
+  while ((ret = mbedtls_ssl_handshake(&_ssl)) != 0) {
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      LOG_WARN("TLS handshake with %s failed: -0x%04x", host, -ret);
+      if (offered) _cache.invalidate(host, port);
+      _stats.failures++;
+      WiFiClient::stop();
+      return 0;
+    }
+  }
+  _sampleHeap();
+
+  // The verify callback only runs when a certificate was exchanged
+  _stats.lastResumed     = !_certVerified;
+  _stats.lastHandshakeUs = micros() - start;
+  _stats.lastHeapPeak    = freeBefore - _minFreeHeap;
+  _stats.lastTxBytes     = _txBytes;
+  _stats.lastRxBytes     = _rxBytes;
+  if (_stats.lastResumed) _stats.resumedHandshakes++;
+  else                    _stats.fullHandshakes++;
+
+  LOG_INFO("TLS %s handshake with %s: %lu us, heap peak %lu B, tx %lu B, rx %lu B",
+           _stats.lastResumed ? "resumed" : "full", host,
+           (unsigned long)_stats.lastHandshakeUs, (unsigned long)_stats.lastHeapPeak,
+           (unsigned long)_stats.lastTxBytes, (unsigned long)_stats.lastRxBytes);
+
+  // Refresh the cache every time: servers may rotate the ticket on resumption
+  _cache.store(host, port, &_ssl);
+  _connected = true;
+  return 1;
+}
+
+size_t TlsClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+  if (!_connected) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    int ret = mbedtls_ssl_write(&_ssl, buf + sent, size - sent);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+    if (ret < 0) {
+      stop();
+      break;
+    }
+    sent += ret;
+  }
+  return sent;
+}
+
+int TlsClient::available() {
+  if (!_connected) return 0;
+  int pending = mbedtls_ssl_get_bytes_avail(&_ssl);
+  if (pending == 0 && WiFiClient::available() > 0) {
+    // Let mbedTLS decrypt the next record without consuming application data
+    int ret = mbedtls_ssl_read(&_ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) stop();
+      return _peek >= 0 ? 1 : 0;
+    }
+    pending = mbedtls_ssl_get_bytes_avail(&_ssl);
+  }
+  return pending + (_peek >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+  if (size == 0) return 0;
+  size_t offset = 0;
+  if (_peek >= 0) {
+    buf[0] = (uint8_t)_peek;
+    _peek = -1;
+    offset = 1;
+    if (size == 1 || available() == 0) return 1;
+  }
+  if (!_connected) return offset ? (int)offset : -1;
+  int ret = mbedtls_ssl_read(&_ssl, buf + offset, size - offset);
+  if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return offset ? (int)offset : -1;
+  }
+  if (ret <= 0) {
+    stop();
+    return offset ? (int)offset : -1;
+  }
+  return ret + offset;
+}
+
+int TlsClient::peek() {
+  if (_peek < 0 && available() > 0) {
+    uint8_t b;
+    if (mbedtls_ssl_read(&_ssl, &b, 1) == 1) _peek = b;
+  }
+  return _peek;
+}
+
+void TlsClient::flush() {
+  WiFiClient::flush();
+}
+
+void TlsClient::stop() {
+  if (_connected) {
+    mbedtls_ssl_close_notify(&_ssl);
+    _connected = false;
+  }
+  _peek = -1;
+  WiFiClient::stop();
+}
+
+uint8_t TlsClient::connected() {
+  if (!_connected) return 0;
+  return WiFiClient::connected() || mbedtls_ssl_get_bytes_avail(&_ssl) > 0 || _peek >= 0;
+}
+
+void TlsClient::_sampleHeap() {
+  uint32_t freeNow = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  if (freeNow < _minFreeHeap) _minFreeHeap = freeNow;
+}
+
+int TlsClient::_bioSend(void* ctx, const unsigned char* buf, size_t len) {
+  TlsClient* self = static_cast<TlsClient*>(ctx);
+  self->_sampleHeap();
+  size_t n = self->WiFiClient::write(buf, len);
+  if (n == 0) return MBEDTLS_ERR_NET_SEND_FAILED;
+  self->_txBytes += n;
+  return (int)n;
+}
+
+int TlsClient::_bioRecv(void* ctx, unsigned char* buf, size_t len, uint32_t timeoutMs) {
+  TlsClient* self = static_cast<TlsClient*>(ctx);
+  self->_sampleHeap();
+  unsigned long start = millis();
+  while (self->WiFiClient::available() == 0) {
+    if (!self->WiFiClient::connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+    if (timeoutMs && millis() - start >= timeoutMs) return MBEDTLS_ERR_SSL_TIMEOUT;
+    delay(1);
+  }
+  int n = self->WiFiClient::read(buf, len);
+  if (n <= 0) return MBEDTLS_ERR_NET_RECV_FAILED;
+  self->_rxBytes += n;
+  return n;
+}
+
+int TlsClient::_verify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+  TlsClient* self = static_cast<TlsClient*>(ctx);
+  self->_certVerified = true;
+
+  // Only the leaf is checked; intermediates are irrelevant when the key is pinned
+  if (depth > 0 || self->_insecure) {
+    *flags = 0;
+    return 0;
+  }
+
+  // SPKI DER is written at the end of the buffer
+  unsigned char der[600];
+  int len = mbedtls_pk_write_pubkey_der(&crt->pk, der, sizeof(der));
+  if (len <= 0) {
+    *flags |= MBEDTLS_X509_BADCERT_OTHER;
+    return 0;
+  }
+  uint8_t digest[32];
+  mbedtls_sha256_ret(der + sizeof(der) - len, len, digest, 0);
+
+  if (memcmp(digest, self->_pin, sizeof(digest)) == 0) {
+    *flags = 0;
+  } else {
+    LOG_WARN("TLS: server public key does not match pin");
+    *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+#ifndef TLSCLIENT_H
+#define TLSCLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+
+/**
+ * TlsSessionCache keeps negotiated TLS sessions (session ID and/or ticket)
+ * per host:port so later connections can use an abbreviated handshake.
+ */
+class TlsSessionCache {
+  public:
+    static const uint8_t CAPACITY = 2;
+
+    TlsSessionCache();
+    ~TlsSessionCache();
+
+    /** Offer a cached session for host:port to the handshake; returns true if one was set. */
+    bool load(const char* host, uint16_t port, mbedtls_ssl_context* ssl);
+
+    /** Remember the session negotiated on ssl for host:port. */
+    void store(const char* host, uint16_t port, const mbedtls_ssl_context* ssl);
+
+    /** Drop the entry for host:port (e.g. after a failed handshake). */
+    void invalidate(const char* host, uint16_t port);
+
+  private:
+    struct Entry {
+      char                 host[48];
+      uint16_t             port;
+      bool                 valid;
+      unsigned long        lastUse;
+      mbedtls_ssl_session  session;
+    };
+    Entry _entries[CAPACITY];
+
+    Entry* _find(const char* host, uint16_t port);
+};
+
+/** Measurements of the most recent handshake, plus running totals. */
+struct TlsStats {
+  bool     lastResumed;     // abbreviated handshake (no certificate exchanged)
+  uint32_t lastHandshakeUs;
+  uint32_t lastHeapPeak;    // bytes of heap consumed at the handshake's worst point
+  uint32_t lastTxBytes;     // bytes on the wire during the handshake
+  uint32_t lastRxBytes;
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint32_t failures;
+};
+
+/**
+ * TlsClient: a WiFiClient that speaks TLS, usable anywhere HTTPClient
+ * accepts a WiFiClient.
+ *
+ * Unlike WiFiClientSecure it
+ * - resumes sessions across connections through a TlsSessionCache, which
+ *   skips the certificate exchange and public-key operations, and
+ * - authenticates the server by pinning the SHA-256 of its public key
+ *   (SubjectPublicKeyInfo), so no CA bundle is needed.
+ *
+ * The mbedTLS configuration and DRBG are set up once and reused; each
+ * connection only resets the SSL context.
+ */
+class TlsClient : public WiFiClient {
+  public:
+    explicit TlsClient(TlsSessionCache& cache);
+    ~TlsClient();
+
+    /** Pin the server public key (SHA-256 over the DER SubjectPublicKeyInfo). */
+    void setPublicKeyPin(const uint8_t sha256[32]);
+
+    /** Accept any certificate. For local testing only. */
+    void setInsecure() { _insecure = true; }
+
+    /** Handshake timeout in ms. */
+    void setHandshakeTimeout(uint32_t ms) { _timeoutMs = ms; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    // HTTPClient uses the timeout overloads; not every core version declares them virtual
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+
+    const TlsStats& stats() const { return _stats; }
+
+  private:
+    TlsSessionCache&          _cache;
+    mbedtls_ssl_context       _ssl;
+    mbedtls_ssl_config        _conf;
+    mbedtls_entropy_context   _entropy;
+    mbedtls_ctr_drbg_context  _drbg;
+    bool                      _configured;
+    bool                      _connected;
+    bool                      _insecure;
+    bool                      _hasPin;
+    bool                      _certVerified;  // set by the verify callback (full handshakes only)
+    uint8_t                   _pin[32];
+    uint32_t                  _timeoutMs;
+    int                       _peek;
+    TlsStats                  _stats;
+
+    // Handshake accounting, updated from the BIO callbacks
+    uint32_t _txBytes;
+    uint32_t _rxBytes;
+    uint32_t _minFreeHeap;
+
+    bool _configure();
+    void _sampleHeap();
+
+    static int _bioSend(void* ctx, const unsigned char* buf, size_t len);
+    static int _bioRecv(void* ctx, unsigned char* buf, size_t len, uint32_t timeoutMs);
+    static int _verify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+};
+
+#endif
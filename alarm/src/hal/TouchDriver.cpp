@@ -0,0 +1,122 @@
+#include "TouchDriver.h"
+#include <core/Log.h>
+
+// CAP1188 registers
+static const uint8_t REG_MAIN_CONTROL = 0x00;
+static const uint8_t REG_INPUT_STATUS = 0x03;
+static const uint8_t REG_INT_ENABLE   = 0x27;
+static const uint8_t REG_REPEAT       = 0x28;
+static const uint8_t REG_STANDBY_CFG  = 0x41;
+static const uint8_t REG_CONFIG2      = 0x44;
+static const uint8_t REG_MULTI_TOUCH  = 0x2A;
+static const uint8_t REG_LED_LINK     = 0x72;
+static const uint8_t REG_PRODUCT_ID   = 0xFD;
+static const uint8_t PRODUCT_ID       = 0x50;
+static const uint8_t MAIN_INT         = 0x01;
+
+TouchDriver* TouchDriver::_instance = nullptr;
+
+TouchDriver::TouchDriver(I2cBus& bus, std::initializer_list<uint8_t> pins, uint8_t alertPin, uint8_t address)
+  : _bus(bus)
+  , _device(0)
+  , _address(address)
+  , _alertPin(alertPin)
+  , _numChannels(0)
+  , _state(0)
+  , _mainControl(0)
+  , _ready(false)
+  , _busy(false)
+  , _status(0)
+  , _confirm(false)
+  , _confirmAt(0)
+  , _transactions(0)
+  , _alerts(0)
+  , _pending(false)
+{
+  for (auto pin : pins) {
+    if (_numChannels == MAX_CHANNELS) break;
+    _pins[_numChannels++] = pin;
+  }
+}
+
+bool TouchDriver::begin() {
+  _device = _bus.addDevice("CAP1188", _address);
+  if (_device == I2cBus::INVALID_DEVICE) return false;
+  uint8_t id = 0;
+  if (!_bus.readRegister(_device, REG_PRODUCT_ID, id) || id != PRODUCT_ID) {
+    LOG_WARN("CAP1188 not found");
+    return false;
+  }
+
+  // Multiple simultaneous touches, pad LEDs follow touches, standby defaults
+  _bus.writeRegister(_device, REG_MULTI_TOUCH, 0x00);
+  _bus.writeRegister(_device, REG_LED_LINK, 0xFF);
+  _bus.writeRegister(_device, REG_STANDBY_CFG, 0x30);
+
+  // Alert on the used channels only, on touch and on release (INT_REL_n = 0),
+  // and without repeat interrupts while a pad is held
+  uint8_t mask = (uint8_t)((1u << _numChannels) - 1);
+  uint8_t value = 0;
+  _bus.writeRegister(_device, REG_INT_ENABLE, mask);
+  _bus.writeRegister(_device, REG_REPEAT, 0x00);
+  _bus.readRegister(_device, REG_CONFIG2, value);
+  _bus.writeRegister(_device, REG_CONFIG2, value & ~0x01);
+
+  _bus.readRegister(_device, REG_MAIN_CONTROL, value);
+  _mainControl = value & ~MAIN_INT;
+  _bus.writeRegister(_device, REG_MAIN_CONTROL, _mainControl);
+
+  _instance = this;
+  pinMode(_alertPin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(_alertPin), _onAlert, FALLING);
+  _ready = true;
+  return true;
+}
+
+void IRAM_ATTR TouchDriver::_onAlert() {
+  if (_instance) {
+    _instance->_pending = true;
+    _instance->_alerts++;
+  }
+}
+
+void TouchDriver::update() {
+  if (!_ready || _busy) return;
+  unsigned long now = millis();
+  bool confirmDue = _confirm && (long)(now - _confirmAt) >= 0;
+  // ALERT stays low until INT is cleared, so a low line also catches an edge missed while it was held
+  if (!_pending && !confirmDue && digitalRead(_alertPin) == HIGH) return;
+
+  // Status read, then clearing INT to release ALERT; status bits of lifted pads clear with it
+  static const uint8_t statusReg = REG_INPUT_STATUS;
+  if (!_bus.submit(I2cBus::Input, _device, &statusReg, 1, &_status, 1, _onStatus, this)) return;
+  _bus.writeRegisterAsync(I2cBus::Input, _device, REG_MAIN_CONTROL, _mainControl);
+  _transactions += 2;
+  _busy = true;
+  _pending = false;
+  _confirm = false;
+}
+
+void TouchDriver::_onStatus(void* self, const I2cResult& result) {
+  TouchDriver* touch = static_cast<TouchDriver*>(self);
+  touch->_busy = false;
+  if (!result.ok) return;
+
+  unsigned long now = millis();
+  uint8_t status = touch->_status;
+  // New touches get one confirmation read; pads still held then report their release by alert
+  if (status & ~touch->_state) {
+    touch->_confirm = true;
+    touch->_confirmAt = now + CONFIRM_MS;
+  }
+
+  uint8_t changed = status ^ touch->_state;
+  touch->_state = status;
+  if (!changed) return;
+
+  for (uint8_t i = 0; i < touch->_numChannels; i++) {
+    if (!(changed & (1 << i))) continue;
+    ButtonEvent::Edge edge = (status & (1 << i)) ? ButtonEvent::Pressed : ButtonEvent::Released;
+    AppBus::post(ButtonEvent{touch->_pins[i], edge, now});
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef TOUCHDRIVER_H
+#define TOUCHDRIVER_H
+
+#include <Arduino.h>
+#include <initializer_list>
+#include <hal/I2cBus.h>
+#include <core/Events.h>
+
+/**
+ * TouchDriver reads a CAP1188 capacitive touch controller through its
+ * ALERT interrupt instead of polling the bus.
+ *
+ * The ALERT line is only watched from an ISR. update() touches I2C only
+ * after an alert. It then queues two Input-priority bus transactions: one
+ * combined write/read of the Sensor Input Status register for all eight
+ * channels, and one register write that clears the interrupt. When the read
+ * completes, each channel that changed produces the
+ * same ButtonEvent as ButtonDriver: Pressed on touch, Released on lift.
+ * Channel n is reported under the pin given for it, so touch pads can stand
+ * in for the buttons.
+ *
+ * A tap shorter than the time to service the alert can be lifted before INT
+ * is cleared, and then no release alert follows. So after a read that shows a
+ * touch, update() reads once more CONFIRM_MS later. That is one extra
+ * transaction per press, not polling.
+ */
+class TouchDriver {
+  public:
+    static const uint8_t MAX_CHANNELS = 8;
+    static const unsigned long CONFIRM_MS = 50;
+
+    /**
+     * @param pins      Pin number reported for channel 1, 2, ... (at most 8).
+     * @param alertPin  GPIO wired to the CAP1188 ALERT output (active low, open drain).
+     * @param address   I2C address (0x29 with AD floating).
+     */
+    TouchDriver(I2cBus& bus, std::initializer_list<uint8_t> pins, uint8_t alertPin = 13, uint8_t address = 0x29);
+
+    /** Configures the controller and attaches the interrupt; returns false if no CAP1188 answers. */
+    bool begin();
+
+    /** Posts ButtonEvents if the controller raised ALERT since the last call. */
+    void update();
+
+    /** Bitmask of channels currently touched (bit 0 = channel 1). */
+    uint8_t touched() const { return _state; }
+
+    /** I2C transactions issued by update(), for comparing with polling. */
+    uint32_t i2cTransactions() const { return _transactions; }
+
+    /** Alerts taken by the ISR. */
+    uint32_t alerts() const { return _alerts; }
+
+  private:
+    I2cBus&  _bus;
+    uint8_t  _device;
+    uint8_t  _address;
+    uint8_t  _alertPin;
+    uint8_t  _numChannels;
+    uint8_t  _pins[MAX_CHANNELS];
+    uint8_t  _state;
+    uint8_t  _mainControl;  // cached, so clearing INT needs no read-modify-write
+    bool     _ready;
+    bool     _busy;         // a status read is queued
+    uint8_t  _status;       // read target
+    bool     _confirm;      // a follow-up read is due at _confirmAt
+    unsigned long _confirmAt;
+    uint32_t _transactions;
+    volatile uint32_t _alerts;
+    volatile bool     _pending;
+
+    static void _onStatus(void* self, const I2cResult& result);
+
+    static TouchDriver* _instance;
+    static void IRAM_ATTR _onAlert();
+};
+
+#endif
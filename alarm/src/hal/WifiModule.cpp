@@ -1,44 +1,714 @@
 #include <hal/WifiModule.h>
+#include <core/Energy.h>
+#include <core/Log.h>
+#include <core/Trace.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <core/GzipWriter.h>
+#if WIFIMODULE_TLS
+#include <hal/TlsClient.h>
+#endif
+#include <utility>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// The request task, and the connection it keeps open between requests
+struct WifiModule::Worker {
+  WiFiClient    plain;
+  const char*   host = nullptr;      // of the open connection, nullptr if none
+  uint16_t      port = 0;
+  bool          persistent = false;  // the server kept it open after a response
+  unsigned long lastUseMs = 0;
+
+#ifdef ESP_PLATFORM
+  SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+  TaskHandle_t      task = nullptr;
+
+  bool start(WifiModule* module) {
+    // Next to the Wi-Fi stack on core 0, so loop() on core 1 keeps running during requests
+    return xTaskCreatePinnedToCore(_run, "net", 8192, module, 1, &task, 0) == pdPASS;
+  }
+  void acquire() { xSemaphoreTake(lock, portMAX_DELAY); }
+  void release() { xSemaphoreGive(lock); }
+  void wake() { xTaskNotifyGive(task); }
+  void sleep(uint32_t ms) { ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms)); }
+#else
+  std::mutex              lock;
+  std::mutex              wakeLock;
+  std::condition_variable wakeUp;
+  bool                    woken = false;
+
+  bool start(WifiModule* module) {
+    std::thread(_run, module).detach();
+    return true;
+  }
+  void acquire() { lock.lock(); }
+  void release() { lock.unlock(); }
+  void wake() {
+    std::lock_guard<std::mutex> guard(wakeLock);
+    woken = true;
+    wakeUp.notify_one();
+  }
+  void sleep(uint32_t ms) {
+    std::unique_lock<std::mutex> guard(wakeLock);
+    wakeUp.wait_for(guard, std::chrono::milliseconds(ms), [this] { return woken; });
+    woken = false;
+  }
+#endif
+};
+
+namespace {
+
+// Holds the request task's lock, if the task runs, for one exchange on the network.
+// Exchanges never overlap, so the radio is on the air exactly while one is held.
+template <typename Worker>
+class Guard {
+  public:
+    explicit Guard(Worker* worker) : _worker(worker) {
+      if (_worker) _worker->acquire();
+      Energy::set(RailRadio, RadioActive);
+    }
+    ~Guard() {
+      Energy::set(RailRadio, RadioIdle);
+      if (_worker) _worker->release();
+    }
+
+  private:
+    Worker* _worker;
+};
+
+// Held around the endpoint table and its breakers. Blocking calls consult them
+// before they wait for the request task, which uses them too.
+class EndpointLock {
+  public:
+#ifdef ESP_PLATFORM
+    EndpointLock() { xSemaphoreTake(mutex(), portMAX_DELAY); }
+    ~EndpointLock() { xSemaphoreGive(mutex()); }
+
+  private:
+    static SemaphoreHandle_t mutex() {
+      static SemaphoreHandle_t m = xSemaphoreCreateMutex();
+      return m;
+    }
+#else
+    EndpointLock() { mutex().lock(); }
+    ~EndpointLock() { mutex().unlock(); }
+
+  private:
+    static std::mutex& mutex() {
+      static std::mutex m;
+      return m;
+    }
+#endif
+};
+
+// Frames everything written to it as HTTP/1.1 chunks on the socket.
+// Small writes are staged so each chunk carries a useful amount of data.
+class ChunkedSink : public ByteSink {
+  public:
+    explicit ChunkedSink(WiFiClient& client) : _client(client), _len(0), _total(0), _ok(true) {}
+
+    bool write(const uint8_t* data, size_t len) override {
+      while (len > 0 && _ok) {
+        size_t n = min(len, sizeof(_buf) - _len);
+        memcpy(_buf + _len, data, n);
+        _len += n;
+        data += n;
+        len -= n;
+        if (_len == sizeof(_buf)) flush();
+      }
+      return _ok;
+    }
+
+    // Emit the staged chunk and the terminating zero-length chunk.
+    bool finish() {
+      flush();
+      if (_ok && _client.write((const uint8_t*)"0\r\n\r\n", 5) != 5) _ok = false;
+      return _ok;
+    }
+
+    uint32_t total() const { return _total; }
+
+  private:
+    WiFiClient& _client;
+    uint8_t     _buf[256];
+    size_t      _len;
+    uint32_t    _total;
+    bool        _ok;
+
+    void flush() {
+      if (_len == 0 || !_ok) return;
+      char header[8];
+      int n = snprintf(header, sizeof(header), "%X\r\n", (unsigned)_len);
+      _ok = _client.write((const uint8_t*)header, n) == (size_t)n &&
+            _client.write(_buf, _len) == _len &&
+            _client.write((const uint8_t*)"\r\n", 2) == 2;
+      _total += _len;
+      _len = 0;
+    }
+};
+
+// Wait for a full line of the response; returns false on timeout or disconnect.
+bool readLine(WiFiClient& client, String& line, unsigned long deadline) {
+  line = "";
+  while ((long)(deadline - millis()) > 0) {
+    if (!client.available()) {
+      if (!client.connected()) return false;
+      delay(1);
+      continue;
+    }
+    char c = client.read();
+    if (c == '\n') return true;
+    if (c != '\r') line += c;
+  }
+  return false;
+}
+
+// Reads responses off the socket until a deadline; gives up early once `cancel` is set.
+// One reader serves a whole batch: its buffer may already hold the next pipelined response.
+class ResponseReader {
+  public:
+    explicit ResponseReader(WiFiClient& net)
+      : _net(net), _deadline(0), _cancel(nullptr), _pos(0), _len(0), _error(0), _received(0) {}
+
+    // Start on the next response
+    void expect(unsigned long deadline, const std::atomic<bool>& cancel) {
+      _deadline = deadline;
+      _cancel = &cancel;
+      _error = 0;
+      _received = 0;
+    }
+
+    // Next byte, or -1 with error() set
+    int byte() {
+      while (_pos == _len) {
+        if (_cancel->load(std::memory_order_relaxed)) return _fail(WifiModule::HTTPC_ERROR_CANCELLED);
+        int n = _net.available();
+        if (n > 0) {
+          n = _net.read(_buf, min((size_t)n, sizeof(_buf)));
+          if (n > 0) {
+            _pos = 0;
+            _len = n;
+            break;
+          }
+        }
+        if (!_net.connected()) return _fail(HTTPC_ERROR_CONNECTION_LOST);
+        if ((long)(_deadline - millis()) <= 0) return _fail(HTTPC_ERROR_READ_TIMEOUT);
+        delay(1);
+      }
+      _received++;
+      return _buf[_pos++];
+    }
+
+    // One line without its CRLF
+    bool line(String& out) {
+      out = "";
+      for (;;) {
+        int c = byte();
+        if (c < 0) return false;
+        if (c == '\n') return true;
+        if (c != '\r') out += (char)c;
+      }
+    }
+
+    int error() const { return _error; }
+    uint32_t received() const { return _received; }
+
+  private:
+    WiFiClient&              _net;
+    unsigned long            _deadline;
+    const std::atomic<bool>* _cancel;
+    uint8_t                  _buf[64];
+    size_t                   _pos;
+    size_t                   _len;
+    int                      _error;
+    uint32_t                 _received;
+
+    int _fail(int error) {
+      _error = error;
+      return -1;
+    }
+};
+
+// Safe to pipeline, and to send again if the server closed without answering.
+// A POST may have been processed before the close (RFC 7230 6.3.1).
+bool idempotent(const HttpRequest& request) {
+  return strcmp(request.method, "GET") == 0;
+}
+
+// Keep up to `max` body bytes, note whether there were more
+void keep(HttpResponse& response, size_t max, int c) {
+  if (response.body.length() < max) response.body += (char)c;
+  else response.truncated = true;
+}
+
+// One response body as a Stream. It ends where the framing says, so a
+// pipelined response behind it stays in the reader for the next one.
+class BodyReader : public Stream {
+  public:
+    BodyReader(ResponseReader& in, long length, bool chunked)
+      : _in(in), _left(chunked ? 0 : length), _chunked(chunked), _started(false),
+        _ended(length == 0 && !chunked), _error(0), _peeked(-1), _keep(nullptr), _max(0) {
+      // read() already waits for the next byte, up to the request's deadline
+      setTimeout(0);
+    }
+
+    // Copy every byte read into `response`, up to `max`
+    void keepIn(HttpResponse& response, size_t max) {
+      _keep = &response;
+      _max = max;
+    }
+
+    // There is more to read until the body has ended
+    int available() override { return _peeked >= 0 || !_ended ? 1 : 0; }
+    int peek() override {
+      if (_peeked < 0) _peeked = _next();
+      return _peeked;
+    }
+    int read() override {
+      int c = _peeked >= 0 ? _peeked : _next();
+      _peeked = -1;
+      if (c >= 0 && _keep) keep(*_keep, _max, c);
+      return c;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+    // Read what is left of the body; false on error()
+    bool drain() {
+      while (read() >= 0) {}
+      return !_error;
+    }
+
+    bool ended() const { return _ended && _peeked < 0; }
+    int error() const { return _error; }
+
+  private:
+    ResponseReader& _in;
+    long            _left;     // of the body, or of the current chunk; -1 until the server closes
+    bool            _chunked;
+    bool            _started;  // past the first chunk
+    bool            _ended;
+    int             _error;
+    int             _peeked;
+    HttpResponse*   _keep;
+    size_t          _max;
+
+    int _next() {
+      if (_ended) return -1;
+      if (_chunked && _left == 0 && !_nextChunk()) return -1;
+      int c = _in.byte();
+      if (c < 0) {
+        _ended = true;
+        // Without a length, the body ends when the server closes the connection
+        if (_left >= 0 || _in.error() != HTTPC_ERROR_CONNECTION_LOST) _error = _in.error();
+        return -1;
+      }
+      if (_left > 0 && --_left == 0 && !_chunked) _ended = true;
+      return c;
+    }
+
+    // Step over the CRLF of the last chunk and read the next size; the last chunk ends the body
+    bool _nextChunk() {
+      String line;
+      if (_started && !_in.line(line)) return _fail();
+      _started = true;
+      if (!_in.line(line)) return _fail();
+      _left = strtol(line.c_str(), nullptr, 16);
+      if (_left > 0) return true;
+      // Trailers, up to the empty line
+      _ended = true;
+      do {
+        if (!_in.line(line)) return _fail();
+      } while (line.length() > 0);
+      return false;
+    }
+
+    bool _fail() {
+      _ended = true;
+      _error = _in.error();
+      return false;
+    }
+};
+
+// Read a response into `response`, or hand its body to `handler`; returns the
+// status or a negative error. `accepted` tells whether the handler took the body,
+// `keepAlive` whether the server leaves the connection open afterwards.
+int receive(ResponseReader& in, HttpResponse& response, size_t max, ResponseHandler* handler,
+            bool& accepted, bool& keepAlive) {
+  String line;
+  if (!in.line(line)) return in.error();
+  if (!line.startsWith("HTTP/1.")) return HTTPC_ERROR_NO_HTTP_SERVER;
+  keepAlive = !line.startsWith("HTTP/1.0");
+  int status = line.substring(9).toInt();
+
+  long length = -1;
+  bool chunked = false;
+  for (;;) {
+    if (!in.line(line)) return in.error();
+    if (line.length() == 0) break;
+    const char* h = line.c_str();
+    const char* value = strchr(h, ':');
+    if (!value) continue;
+    do value++; while (*value == ' ');
+    if (!strncasecmp(h, "Content-Length:", 15)) length = atol(value);
+    else if (!strncasecmp(h, "Transfer-Encoding:", 18)) chunked = !strcasecmp(value, "chunked");
+    else if (!strncasecmp(h, "Connection:", 11)) {
+      if (!strcasecmp(value, "close")) keepAlive = false;
+      else if (!strcasecmp(value, "keep-alive")) keepAlive = true;
+    }
+  }
+  if (status == 204 || status == 304) length = 0;
+  response.contentLength = length;
+  // No length: the body ends when the server closes the connection
+  if (!chunked && length < 0) keepAlive = false;
+
+  BodyReader body(in, chunked ? -1 : length, chunked);
+  accepted = true;
+  if (handler) {
+#if TRACE_RECORD
+    // What the handler read, so the trace can replay it
+    body.keepIn(response, TRACE_MAX_BODY);
+#endif
+    accepted = handler->onResponse(status, body, (int)length);
+    if (body.error()) return body.error();
+    if (!accepted && !body.ended() && (chunked || length < 0 || (size_t)length > max)) {
+      // Not worth reading the rest of a large refused body: drop the connection instead,
+      // at the price of the requests pipelined behind it
+      keepAlive = false;
+      return status;
+    }
+  } else {
+    body.keepIn(response, max);
+  }
+  if (!body.drain()) return body.error();
+  return status;
+}
+
+// What is left of a deadline, as an HTTPClient timeout
+uint16_t remainingMs(unsigned long deadline) {
+  long left = (long)(deadline - millis());
+  if (left <= 0) return 1;
+  return left > 0xFFFF ? 0xFFFF : (uint16_t)left;
+}
+
+// The outcome of a blocking call as the caller gets it, fail-fast ones included
+int traced(const char* method, const char* path, int status, unsigned long startMs,
+           const String* body = nullptr, long contentLength = -1) {
+#if TRACE_RECORD
+  if (status <= 0) body = nullptr;  // the caller's String was left as it was
+  TRACE_RESPONSE(method, path, status, millis() - startMs, contentLength,
+                 body ? (const uint8_t*)body->c_str() : nullptr, body ? body->length() : 0, false);
+#else
+  (void)method; (void)path; (void)startMs; (void)body; (void)contentLength;
+#endif
+  return status;
+}
+
+// A blocking call's response body, read only until the request's deadline. HTTPClient's
+// timeout applies per read, so a server trickling bytes would hold the caller past it.
+class DeadlineStream : public Stream {
+  public:
+    DeadlineStream(WiFiClient& net, unsigned long deadline) : _net(net), _deadline(deadline), _expired(false) {
+      setTimeout(remainingMs(deadline));
+    }
+
+    int available() override { return _net.available(); }
+    int peek() override { return _net.peek(); }
+    int read() override {
+      int c = _net.read();
+      if (c >= 0) return c;
+      if ((long)(_deadline - millis()) <= 0) _expired = true;
+      // Closed or past the deadline: readBytes() stops waiting for more
+      if (_expired || !_net.connected()) setTimeout(0);
+      return -1;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+    bool expired() const { return _expired; }
+
+  private:
+    WiFiClient&   _net;
+    unsigned long _deadline;
+    bool          _expired;
+};
+
+// Read a body HTTPClient left unchunked (HTTP/1.0) into `body`; 0, or
+// HTTPC_ERROR_READ_TIMEOUT if the deadline passed first
+int readBody(WiFiClient& net, long contentLength, String& body, unsigned long deadline) {
+  DeadlineStream in(net, deadline);
+  body = "";
+  char c;
+  while ((contentLength < 0 || (long)body.length() < contentLength) && in.readBytes(&c, 1) == 1) body += c;
+  if (!in.expired()) return 0;
+  body = "";
+  return HTTPC_ERROR_READ_TIMEOUT;
+}
+
+#if TRACE_RECORD
+// Keeps a copy of what a ResponseHandler reads off a streamed body, for the trace
+class TraceTee : public Stream {
+  public:
+    explicit TraceTee(Stream& body) : _body(body), _truncated(false) {}
+
+    int available() override { return _body.available(); }
+    int peek() override { return _body.peek(); }
+    int read() override {
+      int c = _body.read();
+      if (c >= 0) {
+        if (_copy.length() < TRACE_MAX_BODY) _copy += (char)c;
+        else _truncated = true;
+      }
+      return c;
+    }
+    size_t write(uint8_t) override { return 0; }
+
+    const String& copy() const { return _copy; }
+    bool truncated() const { return _truncated; }
+
+  private:
+    Stream& _body;
+    String  _copy;
+    bool    _truncated;
+};
+#endif
+
+}  // namespace
 
 WifiModule::WifiModule(const char* ssid, const char* password)
-  : _ssid(ssid), _password(password) {}
+  : _ssid(ssid), _password(password) {
+  for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+    _slots[i].state.store(Unknown);
+    _slots[i].cancel.store(false);
+  }
+}
 
 bool WifiModule::begin(unsigned long timeoutMs) {
   WiFi.begin(_ssid, _password);
   unsigned long start = millis();
-  Serial.printf("Connecting to Wi-Fi '%s'…\n", _ssid);
+  LOG_INFO("Connecting to Wi-Fi '%s'…", _ssid);
+  // Scanning and associating; after that the station stays on, retrying in the background if need be
+  Energy::set(RailRadio, RadioActive);
   while (WiFi.status() != WL_CONNECTED) {
     if (millis() - start > timeoutMs) {
-      Serial.println("  → Timeout.");
+      LOG_WARN("Wi-Fi connect timeout");
+      Energy::set(RailRadio, RadioIdle);
       return false;
     }
     delay(500);
-    Serial.print('.');
   }
-  Serial.println("\nWi-Fi connected.");
-  Serial.print("IP: "); Serial.println(WiFi.localIP());
+  Energy::set(RailRadio, RadioIdle);
+  LOG_INFO("Wi-Fi connected.");
+  LOG_INFO("IP: %s", WiFi.localIP().toString().c_str());
   return true;
 }
 
+void WifiModule::enableTls(const uint8_t publicKeyPin[32]) {
+#if WIFIMODULE_TLS
+  if (!_tls) {
+    _tlsCache = new TlsSessionCache();
+    _tls = new TlsClient(*_tlsCache);
+  }
+  _tls->setPublicKeyPin(publicKeyPin);
+#else
+  (void)publicKeyPin;
+  LOG_WARN("TLS not compiled in (WIFIMODULE_TLS=0), staying on HTTP");
+#endif
+}
+
+const TlsStats* WifiModule::tlsStats() const {
+#if WIFIMODULE_TLS
+  return _tls ? &_tls->stats() : nullptr;
+#else
+  return nullptr;
+#endif
+}
+
+WiFiClient& WifiModule::_transport(WiFiClient& plain) {
+#if WIFIMODULE_TLS
+  if (_tls) return *_tls;
+#endif
+  return plain;
+}
+
+int WifiModule::_admit(const char* host, uint16_t port, CircuitBreaker*& breaker) {
+  breaker = nullptr;
+  if (WiFi.status() != WL_CONNECTED) return HTTPC_ERROR_NOT_CONNECTED;
+
+  EndpointLock lock;
+
+  for (uint8_t i = 0; i < _endpointCount && !breaker; ++i) {
+    if (_endpoints[i].port == port && strcmp(_endpoints[i].host, host) == 0) breaker = &_endpoints[i].breaker;
+  }
+  if (!breaker && _endpointCount < MAX_ENDPOINTS) {
+    Endpoint& e = _endpoints[_endpointCount++];
+    e.host = host;
+    e.port = port;
+    // Seeds the backoff jitter; boot timing differs between devices
+    e.breaker = CircuitBreaker(micros() * 2654435761u ^ port);
+    breaker = &e.breaker;
+  }
+
+  if (breaker && !breaker->allow(millis())) return HTTPC_ERROR_CIRCUIT_OPEN;
+  return 0;
+}
+
+void WifiModule::_record(CircuitBreaker* breaker, const char* host, uint16_t port, int status,
+                         unsigned long startMs) {
+  if (!breaker) return;
+  // Any answer below 500 means the server is up, even if it refused this request
+  bool success = (status > 0 && status < 500) || status == HTTPC_ERROR_STREAM_REJECTED;
+  unsigned long now = millis();
+  CircuitBreaker::State before, after;
+  uint8_t failures;
+  uint32_t retryInMs;
+  {
+    EndpointLock lock;
+    before = breaker->state();
+    breaker->record(success, now, now - startMs);
+    after = breaker->state();
+    failures = breaker->consecutiveFailures();
+    retryInMs = breaker->retryInMs(now);
+  }
+
+  if (after == CircuitBreaker::Open) {
+    if (before == CircuitBreaker::Closed) {
+      LOG_WARN("%s:%u down after %u failures, failing fast for %lu ms",
+               host, port, failures, (unsigned long)retryInMs);
+    } else {
+      LOG_INFO("%s:%u probe failed, next in %lu ms", host, port, (unsigned long)retryInMs);
+    }
+  } else if (before == CircuitBreaker::HalfOpen) {
+    LOG_INFO("%s:%u reachable again", host, port);
+  }
+}
+
+void WifiModule::_abandon(CircuitBreaker* breaker) {
+  if (!breaker) return;
+  EndpointLock lock;
+  breaker->abandon();
+}
+
+bool WifiModule::_connect(WiFiClient& net, const char* host, uint16_t port, unsigned long deadline) {
+  long left = (long)(deadline - millis());
+  if (left <= 0) return false;
+#if WIFIMODULE_TLS
+  // Not every core declares the timeout overload virtual
+  if (_tls) {
+    // The request task's kept-alive connection, if any, is gone with it
+    if (_worker) _worker->host = nullptr;
+    return _tls->connect(host, port, (int32_t)left);
+  }
+#endif
+  return net.connect(host, port, (int32_t)left);
+}
+
 int WifiModule::httpGet(const char* host,
                        uint16_t port,
                        const char* path,
-                       String& responseBody) {
+                       String& responseBody,
+                       uint32_t deadlineMs) {
 
-  WiFiClient net;
+  // Fail fast without waiting for the request task
+  CircuitBreaker* breaker;
+  int status = _admit(host, port, breaker);
+  if (status) return traced("GET", path, status, millis());
+  Guard<Worker> guard(_worker);
+  unsigned long start = millis();
+  unsigned long deadline = start + (deadlineMs ? deadlineMs : _deadlineMs);
+
+  WiFiClient plain;
+  WiFiClient& net = _transport(plain);
   HTTPClient http;
-  
-  http.begin(net, host, port, path);
-  
-  int status = http.GET();
+
+  // Connect ourselves, within the deadline; HTTPClient reuses the open connection.
+  // HTTP/1.0 keeps the body unchunked, so it can be read against the deadline.
+  http.useHTTP10(true);
+  if (_connect(net, host, port, deadline)) {
+    http.begin(net, host, port, path, _tls != nullptr);
+    http.setTimeout(remainingMs(deadline));
+    status = http.GET();
+  } else {
+    status = HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  long contentLength = -1;
   if (status > 0) {
-    responseBody = http.getString();
+    contentLength = http.getSize();
+    int error = readBody(http.getStream(), contentLength, responseBody, deadline);
+    if (error) status = error;
+  }
+  if (status <= 0) {
+    LOG_WARN("GET failed, code=%d", status);
+  }
+  http.end();
+  _record(breaker, host, port, status, start);
+  return traced("GET", path, status, start, &responseBody, contentLength);
+}
+
+int WifiModule::httpGetStream(const char* host,
+                             uint16_t port,
+                             const char* path,
+                             ResponseHandler& handler,
+                             uint32_t deadlineMs) {
+
+  // Fail fast without waiting for the request task
+  CircuitBreaker* breaker;
+  int status = _admit(host, port, breaker);
+  if (status) return traced("GET", path, status, millis());
+  Guard<Worker> guard(_worker);
+  unsigned long start = millis();
+  unsigned long deadline = start + (deadlineMs ? deadlineMs : _deadlineMs);
+
+  WiFiClient plain;
+  WiFiClient& net = _transport(plain);
+  HTTPClient http;
+
+  // HTTP/1.0 keeps the server from answering with chunked encoding,
+  // so the stream carries the raw body
+  http.useHTTP10(true);
+  if (_connect(net, host, port, deadline)) {
+    http.begin(net, host, port, path, _tls != nullptr);
+    http.setTimeout(remainingMs(deadline));
+    status = http.GET();
   } else {
-    Serial.printf("GET failed, code=%d\n", status);
+    status = HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  if (status > 0) {
+    bool accepted;
+    DeadlineStream stream(http.getStream(), deadline);
+#if TRACE_RECORD
+    // Called from another task (OtaUpdater's), the trace would drop it: no copy then
+    if (Trace::recordingHere()) {
+      // The trace keeps the HTTP status; a replay runs the handler on the body again
+      TraceTee body(stream);
+      body.setTimeout(remainingMs(deadline));
+      accepted = handler.onResponse(status, body, http.getSize());
+      TRACE_RESPONSE("GET", path, status, millis() - start, http.getSize(),
+                     (const uint8_t*)body.copy().c_str(), body.copy().length(), body.truncated());
+    } else {
+      accepted = handler.onResponse(status, stream, http.getSize());
+    }
+#else
+    accepted = handler.onResponse(status, stream, http.getSize());
+#endif
+    if (stream.expired()) {
+      LOG_WARN("GET %s: deadline passed while reading the body", path);
+      status = HTTPC_ERROR_READ_TIMEOUT;
+    } else if (!accepted) {
+      status = HTTPC_ERROR_STREAM_REJECTED;
+    }
+  } else {
+    LOG_WARN("GET failed, code=%d", status);
+    traced("GET", path, status, start);
   }
   http.end();
+  _record(breaker, host, port, status, start);
   return status;
 }
 
@@ -46,26 +716,551 @@ int WifiModule::httpPost(const char* host,
   uint16_t port,
   const char* path,
   const char* jsonPayload,
-  String& responseBody) {
+  String& responseBody,
+  uint32_t deadlineMs) {
 
-  WiFiClient net;
+  return httpPost(host, port, path,
+                  (const uint8_t*)jsonPayload, strlen(jsonPayload),
+                  "application/json", responseBody, deadlineMs);
+}
+
+int WifiModule::httpPost(const char* host,
+  uint16_t port,
+  const char* path,
+  const uint8_t* body,
+  size_t length,
+  const char* contentType,
+  String& responseBody,
+  uint32_t deadlineMs) {
+
+  // Fail fast without waiting for the request task
+  CircuitBreaker* breaker;
+  int status = _admit(host, port, breaker);
+  if (status) return traced("POST", path, status, millis());
+  Guard<Worker> guard(_worker);
+  unsigned long start = millis();
+  unsigned long deadline = start + (deadlineMs ? deadlineMs : _deadlineMs);
+
+  WiFiClient plain;
+  WiFiClient& net = _transport(plain);
   HTTPClient http;
-  
-  http.begin(net, host, port, path);
 
-  // Set content type
-  http.addHeader("Content-Type", "application/json");
-  String body = String(jsonPayload);
-  // Send the POST
-  int status = http.POST(body);
+  // HTTP/1.0 keeps the response unchunked, so it can be read against the deadline
+  http.useHTTP10(true);
+  if (_connect(net, host, port, deadline)) {
+    http.begin(net, host, port, path, _tls != nullptr);
+    http.setTimeout(remainingMs(deadline));
+    // Set content type
+    http.addHeader("Content-Type", contentType);
+    // Send the POST straight from the caller's buffer
+    status = http.POST((uint8_t*)body, length);
+  } else {
+    status = HTTPC_ERROR_CONNECTION_REFUSED;
+  }
 
+  long contentLength = -1;
   if (status > 0) {
     // Read full response body
-    responseBody = http.getString();
-  } else {
-    Serial.printf("POST failed, code=%d\n", status);
+    contentLength = http.getSize();
+    int error = readBody(http.getStream(), contentLength, responseBody, deadline);
+    if (error) status = error;
+  }
+  if (status <= 0) {
+    LOG_WARN("POST failed, code=%d", status);
   }
   http.end();
+  _record(breaker, host, port, status, start);
 
-  return status;
+  return traced("POST", path, status, start, &responseBody, contentLength);
+}
+
+int WifiModule::httpPostStream(const char* host,
+  uint16_t port,
+  const char* path,
+  const char* contentType,
+  BodySource& body,
+  bool gzip,
+  String& responseBody,
+  uint32_t deadlineMs) {
+
+  _streamBytesIn = 0;
+  _streamBytesOut = 0;
+
+  // Fail fast without waiting for the request task
+  CircuitBreaker* breaker;
+  int status = _admit(host, port, breaker);
+  if (status) return traced("POST", path, status, millis());
+  Guard<Worker> guard(_worker);
+  unsigned long start = millis();
+  unsigned long deadline = start + (deadlineMs ? deadlineMs : _deadlineMs);
+
+  WiFiClient plain;
+  WiFiClient& net = _transport(plain);
+  if (!_connect(net, host, port, deadline)) {
+    LOG_WARN("POST %s: connect failed", path);
+    _record(breaker, host, port, HTTPC_ERROR_CONNECTION_REFUSED, start);
+    return traced("POST", path, HTTPC_ERROR_CONNECTION_REFUSED, start);
+  }
+
+  // Request head; the body length is unknown up front, so it is sent chunked
+  net.printf("POST %s HTTP/1.1\r\n"
+             "Host: %s:%u\r\n"
+             "Content-Type: %s\r\n"
+             "%s"
+             "Transfer-Encoding: chunked\r\n"
+             "Connection: close\r\n\r\n",
+             path, host, port, contentType,
+             gzip ? "Content-Encoding: gzip\r\n" : "");
+
+  ChunkedSink chunks(net);
+  bool sent;
+  if (gzip) {
+    GzipWriter compressor(chunks);
+    sent = body.writeTo(compressor) && compressor.finish();
+    _streamBytesIn = compressor.bytesIn();
+  } else {
+    sent = body.writeTo(chunks);
+  }
+  sent = sent && chunks.finish();
+  _streamBytesOut = chunks.total();
+  if (!_streamBytesIn) _streamBytesIn = _streamBytesOut;
+
+  if (!sent) {
+    LOG_WARN("POST %s: send failed", path);
+    net.stop();
+    _record(breaker, host, port, HTTPC_ERROR_SEND_PAYLOAD_FAILED, start);
+    return traced("POST", path, HTTPC_ERROR_SEND_PAYLOAD_FAILED, start);
+  }
+
+  // Status line: "HTTP/1.1 200 OK"
+  String line;
+  if (!readLine(net, line, deadline) || !line.startsWith("HTTP/")) {
+    net.stop();
+    _record(breaker, host, port, HTTPC_ERROR_READ_TIMEOUT, start);
+    return traced("POST", path, HTTPC_ERROR_READ_TIMEOUT, start);
+  }
+  status = line.substring(line.indexOf(' ') + 1).toInt();
+
+  // Headers: only Content-Length matters here
+  long contentLength = -1;
+  while (readLine(net, line, deadline) && line.length() > 0) {
+    if (line.startsWith("Content-Length:") || line.startsWith("content-length:")) {
+      contentLength = line.substring(15).toInt();
+    }
+  }
+
+  // Body, bounded so a misbehaving server cannot exhaust the heap
+  responseBody = "";
+  while ((long)(deadline - millis()) > 0 &&
+         (contentLength < 0 || (long)responseBody.length() < contentLength) &&
+         responseBody.length() < MAX_RESPONSE_BYTES) {
+    if (net.available()) {
+      responseBody += (char)net.read();
+    } else if (!net.connected()) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  net.stop();
+  _record(breaker, host, port, status, start);
+  return traced("POST", path, status, start, &responseBody, contentLength);
+}
+
+HttpRequest HttpRequest::get(const char* host, uint16_t port, const char* path) {
+  HttpRequest r = { "GET", host, port, path, nullptr, nullptr, 0, nullptr, false, 0, 0, nullptr };
+  return r;
+}
+
+HttpRequest HttpRequest::post(const char* host, uint16_t port, const char* path,
+                              const char* contentType, const uint8_t* body, size_t length) {
+  HttpRequest r = { "POST", host, port, path, contentType, body, length, nullptr, false, 0, 0, nullptr };
+  return r;
+}
+
+HttpRequest HttpRequest::postStream(const char* host, uint16_t port, const char* path,
+                                    const char* contentType, BodySource& source, bool gzip) {
+  HttpRequest r = { "POST", host, port, path, contentType, nullptr, 0, &source, gzip, 0, 0, nullptr };
+  return r;
+}
+
+WifiModule::Handle WifiModule::submit(const HttpRequest& request, HttpCallback callback, void* context) {
+  if (!_worker) {
+    _worker = new Worker();
+    if (!_worker->start(this)) {
+      LOG_ERROR("Request task failed to start");
+      delete _worker;
+      _worker = nullptr;
+      return INVALID_HANDLE;
+    }
+  }
+
+  uint8_t index = 0;
+  while (index < MAX_IN_FLIGHT && _slots[index].state.load(std::memory_order_acquire) != Unknown) index++;
+  if (index == MAX_IN_FLIGHT || request.length > MAX_INLINE_BODY) {
+    _requestStats.rejected++;
+    return INVALID_HANDLE;
+  }
+
+  Slot& slot = _slots[index];
+  // Handles encode the slot, so a stale one never matches the slot's next request
+  _nextHandle = _nextHandle % (0xFFFF / MAX_IN_FLIGHT) + 1;
+  slot.handle = _nextHandle * MAX_IN_FLIGHT + index;
+  slot.seq = _nextSeq++;
+  slot.request = request;
+  if (request.body) {
+    memcpy(slot.body, request.body, request.length);
+    slot.request.body = slot.body;
+  }
+  slot.callback = callback;
+  slot.context = context;
+  slot.submittedMs = millis();
+  slot.attempts = 0;
+  slot.written = false;
+  slot.breaker = nullptr;
+  slot.received = 0;
+  slot.response = HttpResponse();
+  slot.response.handle = slot.handle;
+  slot.cancel.store(false, std::memory_order_relaxed);
+  slot.state.store(Queued, std::memory_order_release);
+
+  _requestStats.submitted++;
+  _worker->wake();
+  return slot.handle;
+}
+
+WifiModule::Slot* WifiModule::_find(Handle handle) const {
+  if (handle == INVALID_HANDLE) return nullptr;
+  Slot* slot = const_cast<Slot*>(&_slots[handle % MAX_IN_FLIGHT]);
+  if (slot->handle != handle || slot->state.load(std::memory_order_acquire) == Unknown) return nullptr;
+  return slot;
+}
+
+WifiModule::RequestState WifiModule::state(Handle handle) const {
+  Slot* slot = _find(handle);
+  if (!slot || slot->cancel.load(std::memory_order_relaxed)) return Unknown;
+  return (RequestState)slot->state.load(std::memory_order_acquire);
+}
+
+bool WifiModule::take(Handle handle, HttpResponse& response) {
+  Slot* slot = _find(handle);
+  if (!slot || slot->state.load(std::memory_order_acquire) != Done) return false;
+  bool cancelled = slot->cancel.load(std::memory_order_relaxed);
+  if (!cancelled) {
+    response = std::move(slot->response);
+    _trace(*slot, response);
+  }
+  slot->state.store(Unknown, std::memory_order_release);
+  return !cancelled;
+}
+
+bool WifiModule::cancel(Handle handle) {
+  Slot* slot = _find(handle);
+  if (!slot || slot->cancel.load(std::memory_order_relaxed)) return false;
+
+  // Still queued: take it back before the request task does
+  uint8_t expected = Queued;
+  if (slot->state.compare_exchange_strong(expected, Unknown, std::memory_order_acq_rel)) {
+    _requestStats.cancelled++;
+    return true;
+  }
+  // Running: the task drops it at its next check. Done: dispatch() discards it.
+  slot->cancel.store(true, std::memory_order_relaxed);
+  _requestStats.cancelled++;
+  return true;
+}
+
+uint8_t WifiModule::dispatch() {
+  uint8_t delivered = 0;
+  for (;;) {
+    // Oldest first, so callbacks see completions in submission order
+    Slot* next = nullptr;
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+      Slot& slot = _slots[i];
+      if (slot.state.load(std::memory_order_acquire) != Done) continue;
+      if (!slot.callback && !slot.cancel.load(std::memory_order_relaxed)) continue;  // left for take()
+      if (!next || (int32_t)(slot.seq - next->seq) < 0) next = &slot;
+    }
+    if (!next) return delivered;
+
+    // Free the slot first, so the callback can submit the next request
+    bool cancelled = next->cancel.load(std::memory_order_relaxed);
+    HttpCallback callback = next->callback;
+    void* context = next->context;
+    HttpResponse response(std::move(next->response));
+    if (!cancelled) _trace(*next, response);
+    next->state.store(Unknown, std::memory_order_release);
+    if (cancelled) continue;
+    callback(context, response);
+    delivered++;
+  }
+}
+
+uint8_t WifiModule::inFlight() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+    if (_slots[i].state.load(std::memory_order_acquire) != Unknown) count++;
+  }
+  return count;
+}
+
+void WifiModule::_trace(const Slot& slot, HttpResponse& response) {
+  // Latency as the caller sees it, so a replay delivers it as late. A handler's
+  // rejection keeps the HTTP status: a replay runs the handler on the body again.
+  const HttpRequest& request = slot.request;
+  TRACE_RESPONSE(request.method, request.path,
+                 response.status == HTTPC_ERROR_STREAM_REJECTED ? slot.received : response.status,
+                 response.queuedMs + response.latencyMs, response.contentLength,
+                 (const uint8_t*)response.body.c_str(), response.body.length(), response.truncated);
+  // The copy of what a handler read was only for the trace
+  if (request.handler) {
+    response.body = String();
+    response.truncated = false;
+  }
+}
+
+void WifiModule::_run(void* self) {
+  WifiModule* module = static_cast<WifiModule*>(self);
+  for (;;) {
+    module->_worker->sleep(KEEPALIVE_MS);
+    module->_serve();
+  }
+}
+
+void WifiModule::_serve() {
+  Worker& w = *_worker;
+  Slot* batch[MAX_IN_FLIGHT];
+  uint8_t count;
+  while ((count = _nextBatch(batch)) > 0) {
+    Guard<Worker> guard(_worker);
+    _exchange(batch, count);
+  }
+
+  // Close an idle connection before the server times it out under a request
+  if (w.host && millis() - w.lastUseMs >= KEEPALIVE_MS) {
+    Guard<Worker> guard(_worker);
+    _transport(w.plain).stop();
+    w.host = nullptr;
+  }
+}
+
+uint8_t WifiModule::_nextBatch(Slot** batch) {
+  Worker& w = *_worker;
+  uint8_t count = 0;
+  for (;;) {
+    // The oldest queued request, then the ones behind it to the same host:port
+    Slot* next = nullptr;
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+      Slot& slot = _slots[i];
+      if (slot.state.load(std::memory_order_acquire) != Queued) continue;
+      if (count && (slot.request.port != batch[0]->request.port ||
+                    strcmp(slot.request.host, batch[0]->request.host) != 0)) continue;
+      if (!next || (int32_t)(slot.seq - next->seq) < 0) next = &slot;
+    }
+    if (!next) return count;
+
+    uint8_t expected = Queued;
+    if (!next->state.compare_exchange_strong(expected, Running, std::memory_order_acq_rel)) continue;
+    batch[count++] = next;
+    // Nothing goes behind a POST: the requests behind it would have to be sent again without it
+    if (!idempotent(next->request)) return count;
+
+    // Pipeline only onto a connection this server has already kept open
+    const HttpRequest& first = batch[0]->request;
+    bool pipeline = w.host && w.persistent && w.port == first.port && strcmp(w.host, first.host) == 0;
+    if (!pipeline || count == MAX_IN_FLIGHT) return count;
+  }
+}
+
+void WifiModule::_exchange(Slot** batch, uint8_t count) {
+  Worker& w = *_worker;
+  WiFiClient& net = _transport(w.plain);
+  unsigned long start = millis();
+
+  // Fail fast what was cancelled, or what Wi-Fi state or a breaker rejects
+  uint8_t admitted = 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    Slot& slot = *batch[i];
+    slot.response.queuedMs = start - slot.submittedMs;
+    if (slot.response.queuedMs > _requestStats.maxQueuedMs) _requestStats.maxQueuedMs = slot.response.queuedMs;
+    if (slot.cancel.load(std::memory_order_relaxed)) {
+      _complete(slot, HTTPC_ERROR_CANCELLED);
+      continue;
+    }
+    int rejected = _admit(slot.request.host, slot.request.port, slot.breaker);
+    if (rejected) {
+      slot.breaker = nullptr;
+      _complete(slot, rejected);
+      continue;
+    }
+    batch[admitted++] = &slot;
+  }
+  if (!admitted) return;
+
+  const HttpRequest& target = batch[0]->request;
+  bool reused = w.host && w.port == target.port && strcmp(w.host, target.host) == 0 && net.connected();
+  if (!reused) {
+    if (w.host) net.stop();
+    w.host = nullptr;
+    w.persistent = false;
+    unsigned long deadline = start + (target.deadlineMs ? target.deadlineMs : _deadlineMs);
+    if (!_connect(net, target.host, target.port, deadline)) {
+      LOG_WARN("%s %s: connect failed", target.method, target.path);
+      _record(batch[0]->breaker, target.host, target.port, HTTPC_ERROR_CONNECTION_REFUSED, start);
+      _complete(*batch[0], HTTPC_ERROR_CONNECTION_REFUSED);
+      _requeue(batch, 1, admitted, false);
+      return;
+    }
+    w.host = target.host;
+    w.port = target.port;
+    _requestStats.connections++;
+    // Whether this server keeps connections open is unknown until its first response
+    _requeue(batch, 1, admitted, false);
+    admitted = 1;
+  }
+
+  uint8_t sent = 0;
+  while (sent < admitted) {
+    Slot& slot = *batch[sent];
+    slot.response.reused = reused || sent > 0;
+    if (!_send(net, slot)) break;
+    slot.written = true;
+    if (slot.response.reused) _requestStats.reused++;
+    if (sent > 0) _requestStats.pipelined++;
+    sent++;
+  }
+  if (sent < admitted) {
+    net.stop();
+    w.host = nullptr;
+    if (reused && sent == 0) {
+      // The server closed the kept-alive connection while it was idle
+      _requeue(batch, 0, admitted, true);
+      return;
+    }
+    LOG_WARN("%s %s: send failed", batch[sent]->request.method, batch[sent]->request.path);
+    _requeue(batch, 0, sent, true);
+    _record(batch[sent]->breaker, target.host, target.port, HTTPC_ERROR_SEND_PAYLOAD_FAILED, start);
+    _complete(*batch[sent], HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    _requeue(batch, sent + 1, admitted, false);
+    return;
+  }
+
+  // Responses come back in request order
+  ResponseReader in(net);
+  for (uint8_t i = 0; i < sent; ++i) {
+    Slot& slot = *batch[i];
+    unsigned long deadline = start + (slot.request.deadlineMs ? slot.request.deadlineMs : _deadlineMs);
+    size_t max = slot.request.maxResponse ? slot.request.maxResponse : MAX_RESPONSE_BYTES;
+    in.expect(deadline, slot.cancel);
+    bool accepted = true;
+    bool keepAlive = false;
+    int status = receive(in, slot.response, max, slot.request.handler, accepted, keepAlive);
+
+    if (status <= 0) {
+      net.stop();
+      w.host = nullptr;
+      if (status == HTTPC_ERROR_CONNECTION_LOST && slot.response.reused && in.received() == 0) {
+        // Closed before answering anything: the requests never reached it, send them again
+        _requeue(batch, i, sent, true);
+        return;
+      }
+      if (status == HTTPC_ERROR_CANCELLED) {
+        _abandon(slot.breaker);
+      } else {
+        LOG_WARN("%s %s failed, code=%d", slot.request.method, slot.request.path, status);
+        _record(slot.breaker, target.host, target.port, status, start);
+      }
+      _complete(slot, status);
+      _requeue(batch, i + 1, sent, true);
+      return;
+    }
+
+    _record(slot.breaker, target.host, target.port, status, start);
+    slot.received = status;
+    _complete(slot, accepted ? status : HTTPC_ERROR_STREAM_REJECTED);
+    w.persistent = keepAlive;
+    w.lastUseMs = millis();
+    if (!keepAlive) {
+      net.stop();
+      w.host = nullptr;
+      _requeue(batch, i + 1, sent, true);
+      return;
+    }
+  }
+}
+
+bool WifiModule::_send(WiFiClient& net, Slot& slot) {
+  const HttpRequest& r = slot.request;
+  size_t head;
+  if (!r.contentType) {
+    head = net.printf("%s %s HTTP/1.1\r\nHost: %s:%u\r\n\r\n", r.method, r.path, r.host, r.port);
+    return head > 0;
+  }
+
+  if (!r.source) {
+    head = net.printf("%s %s HTTP/1.1\r\nHost: %s:%u\r\nContent-Type: %s\r\nContent-Length: %u\r\n\r\n",
+                      r.method, r.path, r.host, r.port, r.contentType, (unsigned)r.length);
+    slot.response.bytesIn = slot.response.bytesOut = r.length;
+    return head > 0 && net.write(r.body, r.length) == r.length;
+  }
+
+  // Generated body: its length is unknown up front, so it is sent chunked
+  head = net.printf("%s %s HTTP/1.1\r\nHost: %s:%u\r\nContent-Type: %s\r\n%s"
+                    "Transfer-Encoding: chunked\r\n\r\n",
+                    r.method, r.path, r.host, r.port, r.contentType,
+                    r.gzip ? "Content-Encoding: gzip\r\n" : "");
+  ChunkedSink chunks(net);
+  bool sent = head > 0;
+  if (sent && r.gzip) {
+    GzipWriter compressor(chunks);
+    sent = r.source->writeTo(compressor) && compressor.finish();
+    slot.response.bytesIn = compressor.bytesIn();
+  } else if (sent) {
+    sent = r.source->writeTo(chunks);
+  }
+  sent = sent && chunks.finish();
+  slot.response.bytesOut = chunks.total();
+  if (!r.gzip) slot.response.bytesIn = slot.response.bytesOut;
+  return sent;
+}
+
+void WifiModule::_complete(Slot& slot, int status) {
+  slot.response.status = status;
+  slot.response.latencyMs = millis() - slot.submittedMs - slot.response.queuedMs;
+  slot.breaker = nullptr;
+  slot.state.store(Done, std::memory_order_release);
+}
+
+void WifiModule::_requeue(Slot** batch, uint8_t from, uint8_t count, bool retry) {
+  for (uint8_t i = from; i < count; ++i) {
+    Slot& slot = *batch[i];
+    if (slot.cancel.load(std::memory_order_relaxed)) {
+      _abandon(slot.breaker);
+      _complete(slot, HTTPC_ERROR_CANCELLED);
+      continue;
+    }
+    if (retry && slot.attempts > 0) {
+      // Already sent twice without an answer
+      _record(slot.breaker, slot.request.host, slot.request.port, HTTPC_ERROR_CONNECTION_LOST,
+              slot.submittedMs + slot.response.queuedMs);
+      _complete(slot, HTTPC_ERROR_CONNECTION_LOST);
+      continue;
+    }
+    if (slot.written && !idempotent(slot.request)) {
+      // Sent, but the server may have acted on it: the caller decides whether to send it again
+      _abandon(slot.breaker);
+      _complete(slot, HTTPC_ERROR_CONNECTION_LOST);
+      continue;
+    }
+    _abandon(slot.breaker);
+    slot.breaker = nullptr;
+    if (retry) {
+      slot.attempts++;
+      _requestStats.retried++;
+    }
+    slot.written = false;
+    slot.response = HttpResponse();
+    slot.response.handle = slot.handle;
+    slot.state.store(Queued, std::memory_order_release);
+  }
 }
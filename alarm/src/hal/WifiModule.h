@@ -2,26 +2,300 @@
 #define WIFIMODULE_H
 
 #include <Arduino.h>
+#include <atomic>
+#include <core/ByteSink.h>
+#include <core/CircuitBreaker.h>
 
+// Build with -DWIFIMODULE_TLS=0 to drop the mbedTLS transport (e.g. for the native host build)
+#ifndef WIFIMODULE_TLS
+#define WIFIMODULE_TLS 1
+#endif
+
+class WiFiClient;
+class TlsClient;
+class TlsSessionCache;
+struct TlsStats;
+
+/**
+ * Consumes an HTTP response body straight from the socket.
+ * Used with WifiModule::httpGetStream(), or as a submitted request's handler,
+ * to avoid buffering the body in a String. A request's handler runs on the
+ * request task, so it must not touch what loop() uses until the request's
+ * completion is delivered.
+ */
+class ResponseHandler {
+public:
+  virtual ~ResponseHandler() {}
+
+  /**
+   * Called once the status line and headers have been received.
+   * @param status        HTTP status code.
+   * @param body          The body, readable with Stream::read()/readBytes().
+   * @param contentLength Content-Length, or -1 if the server did not send one.
+   * @return false if the body was rejected.
+   */
+  virtual bool onResponse(int status, Stream& body, int contentLength) = 0;
+};
+
+/**
+ * A request for WifiModule::submit(). Build it with get(), post() or
+ * postStream(). Everything it points to except a post() body, which
+ * submit() copies, must stay valid until the request has completed.
+ */
+struct HttpRequest {
+  const char*    method;
+  const char*    host;
+  uint16_t       port;
+  const char*    path;
+  const char*    contentType;  // POST only
+  const uint8_t* body;         // post(): up to WifiModule::MAX_INLINE_BODY bytes
+  size_t         length;
+  BodySource*    source;       // postStream(): runs on the request task, sent chunked
+  bool           gzip;         // compress `source` while sending
+  size_t         maxResponse;  // response body bytes kept; 0 = WifiModule::MAX_RESPONSE_BYTES
+  uint32_t       deadlineMs;   // from when it goes out; 0 = the module default
+  ResponseHandler* handler;    // reads the body on the request task instead of keeping it
+
+  static HttpRequest get(const char* host, uint16_t port, const char* path);
+  static HttpRequest post(const char* host, uint16_t port, const char* path,
+                          const char* contentType, const uint8_t* body, size_t length);
+  static HttpRequest postStream(const char* host, uint16_t port, const char* path,
+                                const char* contentType, BodySource& source, bool gzip);
+};
+
+/** Outcome of a submitted request. */
+struct HttpResponse {
+  uint16_t handle;
+  int      status;         // HTTP status, or negative (HTTPC_ERROR_*)
+  String   body;           // at most the request's maxResponse bytes; empty with a handler
+  long     contentLength;  // as announced by the server, -1 if it did not
+  bool     truncated;      // the body was longer than maxResponse
+  bool     reused;         // sent on a kept-alive connection
+  uint32_t bytesIn;        // request body bytes before compression
+  uint32_t bytesOut;       // request body bytes on the wire
+  uint32_t queuedMs;       // waiting for the request task
+  uint32_t latencyMs;      // from going out to the last response byte
+};
+
+/** Completion callback; runs in the context that calls WifiModule::dispatch(). */
+typedef void (*HttpCallback)(void* context, const HttpResponse& response);
+
+/** Counters of the request task. */
+struct RequestStats {
+  uint32_t submitted;
+  uint32_t rejected;     // queue full
+  uint32_t cancelled;
+  uint32_t connections;  // opened by the request task
+  uint32_t reused;       // requests sent on a kept-alive connection
+  uint32_t pipelined;    // sent while an earlier response was still outstanding
+  uint32_t retried;      // re-sent after the server closed a kept-alive connection
+  uint32_t maxQueuedMs;
+};
+
+/**
+ * WifiModule: Wi-Fi station plus HTTP(S) requests to the backend.
+ *
+ * Requests either block the caller (httpGet() and friends) or are queued
+ * with submit() and run on a request task, which the first submit()
+ * starts. A queued request is identified by a handle. Its outcome arrives
+ * through a callback from dispatch(), called from loop() like
+ * I2cBus::dispatch(), or by polling state() and take(). Up to
+ * MAX_IN_FLIGHT requests can be queued or running; submit() fails beyond
+ * that. cancel() drops a request at any point. One still on the wire
+ * closes its connection. A request with a handler has its body read off
+ * the socket by the handler, on the request task, and only the outcome
+ * comes back through dispatch().
+ *
+ * The request task keeps its connection open (HTTP/1.1 keep-alive) while
+ * requests to the same host:port follow each other within KEEPALIVE_MS.
+ * Once the server has kept a connection open, further queued requests to
+ * it are pipelined: all are written before the first response is read.
+ * Only GETs are, with at most one POST after them: a POST may have been
+ * acted on by a server that closed without answering. GETs the server left
+ * unanswered that way are sent again, once, on a new connection, and such
+ * a POST fails with HTTPC_ERROR_CONNECTION_LOST. Blocking calls made while the task runs
+ * wait for the request it is on, then use their own connection; ones that
+ * fail fast (below) return without waiting.
+ *
+ * Every request has a deadline that covers connecting, sending and waiting
+ * for the response (DEFAULT_DEADLINE_MS unless the call passes one). Each
+ * host:port has a CircuitBreaker: after a few failures in a row, requests
+ * to it fail fast with HTTPC_ERROR_CIRCUIT_OPEN, and a single probe goes
+ * out after an exponential, jittered backoff. With Wi-Fi down, requests
+ * fail fast with HTTPC_ERROR_NOT_CONNECTED. Either way a failure costs
+ * microseconds instead of a socket timeout.
+ */
 class WifiModule {
 public:
+  static const int HTTPC_ERROR_STREAM_REJECTED = -100;
+  static const int HTTPC_ERROR_CIRCUIT_OPEN = -101;
+  static const uint32_t DEFAULT_DEADLINE_MS = 4000;
+  static const int HTTPC_ERROR_CANCELLED = -102;
+  static const uint8_t MAX_ENDPOINTS = 4;
+  static const uint8_t MAX_IN_FLIGHT = 4;
+  static const size_t MAX_INLINE_BODY = 192;
+  static const size_t MAX_RESPONSE_BYTES = 1024;
+  static const uint32_t KEEPALIVE_MS = 4000;
+
+  typedef uint16_t Handle;
+  static const Handle INVALID_HANDLE = 0;
+
+  enum RequestState : uint8_t { Unknown, Queued, Running, Done, Cancelled };
+
   WifiModule(const char* ssid, const char* password);
 
   bool begin(unsigned long timeoutMs = 30000);
 
+  // Switch all requests to HTTPS. The server is authenticated by pinning the SHA-256 of
+  // its DER SubjectPublicKeyInfo (no CA bundle), and TLS sessions are cached and resumed
+  // across requests so only the first connection pays for a full handshake.
+  void enableTls(const uint8_t publicKeyPin[32]);
+  bool tlsEnabled() const { return _tls != nullptr; }
+
+  // Handshake measurements (time, heap peak, bytes, full vs. resumed), or nullptr without TLS.
+  const TlsStats* tlsStats() const;
+
+  // Deadline for requests that do not pass their own.
+  void setDefaultDeadline(uint32_t ms) { _deadlineMs = ms; }
+
   // Perform an HTTP GET; returns HTTP status or negative on error.
-  int httpGet(const char* host, uint16_t port, const char* path, String& responseBody);
+  int httpGet(const char* host, uint16_t port, const char* path, String& responseBody,
+              uint32_t deadlineMs = 0);
+
+  // Perform an HTTP GET and hand the body to `handler` as a Stream. Returns the HTTP
+  // status, negative on transport error, or HTTPC_ERROR_STREAM_REJECTED if the handler
+  // rejected the body.
+  int httpGetStream(const char* host, uint16_t port, const char* path, ResponseHandler& handler,
+                    uint32_t deadlineMs = 0);
 
   // Perform an HTTP POST with a JSON payload; returns HTTP status or negative on error.
   int httpPost(const char* host,
                uint16_t port,
                const char* path,
                const char* jsonPayload,
-               String& responseBody);
+               String& responseBody,
+               uint32_t deadlineMs = 0);
+
+  // Perform an HTTP POST with a raw body of the given Content-Type; the body is sent
+  // without an intermediate String copy. Returns HTTP status or negative on error.
+  int httpPost(const char* host,
+               uint16_t port,
+               const char* path,
+               const uint8_t* body,
+               size_t length,
+               const char* contentType,
+               String& responseBody,
+               uint32_t deadlineMs = 0);
+
+  // Perform an HTTP POST whose body is generated on the fly by `body` and sent with
+  // chunked transfer encoding. With gzip=true the body is compressed while it is
+  // written (Content-Encoding: gzip) using a bounded ~4 KB working buffer, so the
+  // uncompressed body never has to sit in RAM. Returns HTTP status or negative on error.
+  int httpPostStream(const char* host,
+                     uint16_t port,
+                     const char* path,
+                     const char* contentType,
+                     BodySource& body,
+                     bool gzip,
+                     String& responseBody,
+                     uint32_t deadlineMs = 0);
+
+  // Queue a request; returns its handle, or INVALID_HANDLE if MAX_IN_FLIGHT requests are
+  // pending. Without a callback, the response waits for take().
+  Handle submit(const HttpRequest& request, HttpCallback callback = nullptr, void* context = nullptr);
+
+  // Where a request is; Unknown once its completion was delivered or taken.
+  RequestState state(Handle handle) const;
+
+  // Collect the response of a Done request submitted without a callback.
+  bool take(Handle handle, HttpResponse& response);
+
+  // Drop a request; its callback will not run. Returns false if it already completed.
+  bool cancel(Handle handle);
+
+  // Deliver completed requests to their callbacks; returns how many.
+  uint8_t dispatch();
+
+  // Requests queued, running, or completed but not yet delivered or taken.
+  uint8_t inFlight() const;
+
+  const RequestStats& requestStats() const { return _requestStats; }
+
+  // Byte counts of the last httpPostStream() call, for compression-ratio metrics.
+  uint32_t lastStreamBytesIn()  const { return _streamBytesIn; }
+  uint32_t lastStreamBytesOut() const { return _streamBytesOut; }
+
+  // Health of each host:port requested so far (up to MAX_ENDPOINTS), for metrics.
+  uint8_t endpointCount() const { return _endpointCount; }
+  const char* endpointHost(uint8_t index) const { return _endpoints[index].host; }
+  uint16_t endpointPort(uint8_t index) const { return _endpoints[index].port; }
+  const CircuitBreaker& endpointHealth(uint8_t index) const { return _endpoints[index].breaker; }
 
 private:
+  struct Worker;  // the request task and its connection
+
+  struct Slot {
+    std::atomic<uint8_t> state;   // RequestState
+    std::atomic<bool>    cancel;
+    Handle        handle;
+    uint32_t      seq;            // submission order
+    HttpRequest   request;
+    uint8_t       body[MAX_INLINE_BODY];
+    HttpCallback  callback;
+    void*         context;
+    unsigned long submittedMs;
+    uint8_t       attempts;
+    bool          written;        // on the wire in the current attempt
+    CircuitBreaker* breaker;      // while admitted
+    int           received;       // HTTP status, also when the handler rejected the body
+    HttpResponse  response;
+  };
+
+  struct Endpoint {
+    const char*    host;  // the caller's string, which outlives the module
+    uint16_t       port;
+    CircuitBreaker breaker;
+  };
+
   const char* _ssid;
   const char* _password;
+  uint32_t _streamBytesIn = 0;
+  uint32_t _streamBytesOut = 0;
+  TlsSessionCache* _tlsCache = nullptr;
+  TlsClient* _tls = nullptr;
+  uint32_t _deadlineMs = DEFAULT_DEADLINE_MS;
+  Endpoint _endpoints[MAX_ENDPOINTS];
+  uint8_t _endpointCount = 0;
+  Worker* _worker = nullptr;
+  Slot _slots[MAX_IN_FLIGHT];
+  uint32_t _nextSeq = 0;
+  uint16_t _nextHandle = 0;
+  RequestStats _requestStats = RequestStats();
+
+  // The TLS client when enabled, otherwise `plain`
+  WiFiClient& _transport(WiFiClient& plain);
+
+  // 0 if the request may go out, else the fail-fast error; `breaker` is null past MAX_ENDPOINTS
+  int _admit(const char* host, uint16_t port, CircuitBreaker*& breaker);
+  // Feed the outcome to the breaker and log state changes
+  void _record(CircuitBreaker* breaker, const char* host, uint16_t port, int status,
+               unsigned long startMs);
+  // Give back a probe that was admitted but never went out
+  void _abandon(CircuitBreaker* breaker);
+  // Connect within what is left of the deadline
+  bool _connect(WiFiClient& net, const char* host, uint16_t port, unsigned long deadline);
+
+  // Request task: take queued requests in order and run them, pipelined where possible
+  static void _run(void* self);
+  void _serve();
+  uint8_t _nextBatch(Slot** batch);
+  void _exchange(Slot** batch, uint8_t count);
+  bool _send(WiFiClient& net, Slot& slot);
+  void _complete(Slot& slot, int status);
+  void _requeue(Slot** batch, uint8_t from, uint8_t count, bool retry);
+  Slot* _find(Handle handle) const;
+  // Record a completion as delivered, with TRACE_RECORD
+  void _trace(const Slot& slot, HttpResponse& response);
 };
 
 #endif
@@ -1,56 +1,240 @@
 #include <hal/LEDDriver.h>
+#include <hal/I2cBus.h>
 #include <hal/DHTDriver.h>
 #include <hal/BuzzerDriver.h>
 #include <hal/ButtonDriver.h>
+#include <hal/TouchDriver.h>
+#include <hal/ImuDriver.h>
+#include <hal/DisplayDriver.h>
 #include <hal/WifiModule.h>
+#include <hal/FlashStorage.h>
+#include <hal/OtaUpdater.h>
 #include <core/AlarmScheduler.h>
 #include <core/PuzzleGame.h>
 #include <core/TimeSync.h>
 #include <credentials.h>
 #include <core/AlarmConfig.h>
-
-
-// Global Variables for Alarm Input
-static uint8_t* userSequence  = nullptr;  // Holds the player's input (LED indices)
-volatile uint8_t inputIndex = 0;          // Next free index for player input
-volatile bool waitingForInput = false;    // Flag set when waiting for player's input
-volatile bool alarmCancel = false;        // Flag set when a button cancels the alarm warning phase
+#include <core/Events.h>
+#include <core/TelemetryEndpoint.h>
+#include <core/StatusScreen.h>
+#include <core/TimerWheel.h>
+#include <core/Log.h>
+#include <core/SensorHistory.h>
+#include <core/Trace.h>
+#include <core/Energy.h>
+#if TRACE_RECORD
+#include <LittleFS.h>
+#endif
+
+
+// Alarm input state
+// Only touched from AppBus handlers and the alarm flow, which all run in loop() context.
+struct AlarmInput {
+  uint8_t* sequence;  // Holds the player's input (LED indices)
+  uint8_t  index;     // Next free index for player input
+  bool     waiting;   // Set while waiting for player's input
+  bool     cancel;    // Set when a button cancels the alarm warning phase
+  uint8_t  attempt;   // Current puzzle attempt, for the display
+};
+static AlarmInput alarmInput = {nullptr, 0, false, false, 0};
 
 // Server connection setup
 const char* server = "18.188.56.179";
 const char* sensorPath = "/api/sensor";
 const char* metricsPath = "/api/metrics";
+const char* energyPath = "/api/energy";
+const char* backendPath = "/api/backend";
+const char* firmwarePath = "/api/firmware";
+
+// Telemetry uploads (CBOR, with JSON fallback negotiated per endpoint)
+TelemetryEndpoint sensorEndpoint(server, 5000, sensorPath);
+TelemetryEndpoint metricsEndpoint(server, 5000, metricsPath);
+TelemetryEndpoint energyEndpoint(server, 5000, energyPath);
+TelemetryEndpoint backendEndpoint(server, 5000, backendPath);
+
+// Records whose upload failed; re-sent as one compressed batch once the server is reachable
+TelemetryBacklog<SensorRecord, 48>  sensorBacklog;   // 4h at one sample per 5min
+TelemetryBacklog<MetricsRecord, 16> metricsBacklog;
+TelemetryBacklog<EnergyRecord, 24>  energyBacklog;   // a day of hourly reports
+
+// Uploads run on WifiModule's request task; these are the records in flight
+static SensorRecord  sensorUpload;
+static MetricsRecord metricsUpload;
+static EnergyRecord  energyUpload;
+
+// A backlog and where it goes; the context of its batch uploads
+template <typename Record, uint8_t N>
+struct BacklogUpload {
+  TelemetryEndpoint&           endpoint;
+  TelemetryBacklog<Record, N>& backlog;
+};
+
+static BacklogUpload<SensorRecord, 48>  sensorFlush  = { sensorEndpoint, sensorBacklog };
+static BacklogUpload<MetricsRecord, 16> metricsFlush = { metricsEndpoint, metricsBacklog };
+static BacklogUpload<EnergyRecord, 24>  energyFlush  = { energyEndpoint, energyBacklog };
+
+template <typename Record, uint8_t N>
+static void flushBacklog(BacklogUpload<Record, N>& upload);
+
+template <typename Record, uint8_t N>
+static void onBacklogUploaded(void* context, int status) {
+  BacklogUpload<Record, N>& upload = *static_cast<BacklogUpload<Record, N>*>(context);
+  TelemetryBacklog<Record, N>& backlog = upload.backlog;
+  uint32_t rejected = backlog.rejected();
+  uint8_t limit = backlog.batchLimit();
+  bool more = backlog.uploadFinished(status);
+  if (backlog.rejected() != rejected) {
+    LOG_WARN("Batch %s refused with %d, %lu records dropped", upload.endpoint.path(), status,
+             (unsigned long)(backlog.rejected() - rejected));
+  } else if (backlog.batchLimit() != limit) {
+    LOG_WARN("Batch %s too large, retrying with %u records", upload.endpoint.path(), backlog.batchLimit());
+  }
+  // On at once after a split, or when one batch did not cover the whole backlog
+  if (more) flushBacklog(upload);
+}
+
+// Upload a backlog as one batch after a successful single post
+template <typename Record, uint8_t N>
+static void flushBacklog(BacklogUpload<Record, N>& upload) {
+  TelemetryBacklog<Record, N>& backlog = upload.backlog;
+  if (backlog.count() == 0 || backlog.uploading()) return;
+  uint8_t count = backlog.beginUpload();
+  if (!upload.endpoint.postBatchAsync(backlog.data(), count, onBacklogUploaded<Record, N>, &upload)) {
+    backlog.uploadFailed();
+  }
+}
+
+// On-flash sensor history: raw samples, 5-minute and hourly rollups
+FlashStorage historyStorage("/history");
+SensorHistory history(historyStorage);
 
 // AlarmScheduler and PuzzleGame modules
 AlarmScheduler alarmScheduler;
 PuzzleGame puzzle(4, 4, 3 , 1000);
 
-// Button Callback
-// This callback is triggered on a release edge
-void onButtonPressed(uint8_t buttonPin) {
-  Serial.print("Button pressed on pin: ");
-  Serial.println(buttonPin);
+// TFT status UI; each update() spends at most about one frame budget
+DisplayDriver display;
+StatusScreen statusScreen(display, alarmScheduler);
+const uint32_t UI_FRAME_BUDGET_US = 8000;
+
+// Show the alarm flow's progress on the puzzle line
+static void showPuzzle(PuzzleView::Phase phase, uint8_t attempt = 0, uint8_t entered = 0) {
+  statusScreen.setPuzzle(PuzzleView{phase, attempt, entered, puzzle.getCurrentSteps()});
+  statusScreen.update(UI_FRAME_BUDGET_US);
+}
+
+static void onSensorUploaded(void*, int status) {
+  if (status > 0) {
+    LOG_INFO("POST %s -> %d", sensorPath, status);
+  } else {
+    LOG_WARN("HTTP POST failed, err=%d", status);
+  }
+  if (status >= 200 && status < 300) {
+    flushBacklog(sensorFlush);
+  } else {
+    sensorBacklog.push(sensorUpload);
+  }
+}
+
+static void onMetricsUploaded(void*, int status) {
+  if (status > 0 && status < 300) {
+    LOG_INFO("Metrics POST ok: %d", status);
+    flushBacklog(metricsFlush);
+  } else {
+    LOG_WARN("Metrics POST failed: %d", status);
+    metricsBacklog.push(metricsUpload);
+  }
+}
+
+static void onEnergyUploaded(void*, int status) {
+  if (status > 0 && status < 300) {
+    flushBacklog(energyFlush);
+  } else {
+    LOG_WARN("Energy POST failed: %d", status);
+    energyBacklog.push(energyUpload);
+  }
+}
+
+// Energy accounting: the charge of each subsystem per hour and per alarm, logged and uploaded
+static EnergyTotals energyHourStart;
+static EnergyTotals energyAlarmStart;
+
+static void reportEnergy(EnergyRecord::Window window, const EnergyTotals& from, const EnergyTotals& to) {
+  EnergyRecord record;
+  record.timestamp = (uint32_t)time(nullptr);
+  record.window = window;
+  uint32_t elapsedMs = energyTimeMs(from, to, RailBoard, 0);
+  record.seconds = (elapsedMs + 500) / 1000;
+  energyCharge(Energy::profile(), from, to, record.microampHours);
+
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < ENERGY_RAILS; ++i) total += record.microampHours[i];
+  uint32_t ledMs = 0;
+  for (uint8_t lit = 1; lit < ENERGY_STATES; ++lit) ledMs += lit * energyTimeMs(from, to, RailLeds, lit);
+  const uint32_t* q = record.microampHours;
+  LOG_INFO("Energy (%s, %lu s): %.2f mAh = board %.2f, cpu %.2f, radio %.2f, buzzer %.2f, leds %.2f, sensor %.3f",
+           window == EnergyRecord::Alarm ? "alarm" : "hour", (unsigned long)record.seconds, total / 1000.0f,
+           q[RailBoard] / 1000.0f, q[RailCpu] / 1000.0f, q[RailRadio] / 1000.0f, q[RailBuzzer] / 1000.0f,
+           q[RailLeds] / 1000.0f, q[RailSensor] / 1000.0f);
+  LOG_INFO("Energy (%s): CPU busy %lu ms, radio on %lu ms (on the air %lu ms), buzzer %lu ms, "
+           "%lu LED-ms, DHT20 converting %lu ms",
+           window == EnergyRecord::Alarm ? "alarm" : "hour",
+           (unsigned long)energyTimeMs(from, to, RailCpu, CpuBusy),
+           (unsigned long)(elapsedMs - energyTimeMs(from, to, RailRadio, RadioOff)),
+           (unsigned long)energyTimeMs(from, to, RailRadio, RadioActive),
+           (unsigned long)energyTimeMs(from, to, RailBuzzer, SwitchOn), (unsigned long)ledMs,
+           (unsigned long)energyTimeMs(from, to, RailSensor, SwitchOn));
+
+  if (energyEndpoint.postAsync(record, onEnergyUploaded, nullptr)) {
+    energyUpload = record;
+  } else {
+    energyBacklog.push(record);
+  }
+}
+
+// Event handlers, wired to AppBus at compile time below
+void onButtonEvent(const ButtonEvent& event);
+void onAlarmEvent(const AlarmEvent& event);
+void onSensorSample(const SensorSample& sample);
+void onConfigUpdate(const ConfigUpdate& update);
+void onMotionEvent(const MotionEvent& event);
+void onOtaEvent(const OtaEvent& event);
+
+template <> struct Subscribers<ButtonEvent>  { typedef HandlerList<ButtonEvent, &onButtonEvent> type; };
+template <> struct Subscribers<AlarmEvent>   { typedef HandlerList<AlarmEvent, &onAlarmEvent> type; };
+template <> struct Subscribers<SensorSample> { typedef HandlerList<SensorSample, &onSensorSample> type; };
+template <> struct Subscribers<ConfigUpdate> { typedef HandlerList<ConfigUpdate, &onConfigUpdate> type; };
+template <> struct Subscribers<MotionEvent>  { typedef HandlerList<MotionEvent, &onMotionEvent> type; };
+template <> struct Subscribers<OtaEvent>     { typedef HandlerList<OtaEvent, &onOtaEvent> type; };
+
+// Button Handler
+// Acts on release edges, like a classic "click"
+void onButtonEvent(const ButtonEvent& event) {
+  if (event.edge != ButtonEvent::Released) return;
+
+  LOG_DEBUG("Button pressed on pin: %u", event.pin);
 
   // If not waiting for player input, use the button to cancel the alarm warning
-  if (!waitingForInput) {
-    alarmCancel = true;
-    Serial.println("Alarm cancellation triggered by button press.");
+  if (!alarmInput.waiting) {
+    alarmInput.cancel = true;
+    LOG_INFO("Alarm cancellation triggered by button press.");
   }
   else {
     // Otherwise, record the player's input
     const uint8_t buttonMapping[4] = {39, 38, 37, 36};
     uint8_t pressedIndex = 0;
     for (uint8_t i = 0; i < 4; i++) {
-      if (buttonPin == buttonMapping[i]) {
+      if (event.pin == buttonMapping[i]) {
         pressedIndex = i;
         break;
       }
     }
-    if (inputIndex < puzzle.getCurrentSteps()) {
-      userSequence[inputIndex] = pressedIndex;
-      inputIndex++;
-      Serial.print("Recorded input index: ");
-      Serial.println(pressedIndex);
+    if (alarmInput.index < puzzle.getCurrentSteps()) {
+      alarmInput.sequence[alarmInput.index] = pressedIndex;
+      alarmInput.index++;
+      LOG_DEBUG("Recorded input index: %u", pressedIndex);
+      statusScreen.setPuzzle(PuzzleView{PuzzleView::Input, alarmInput.attempt, alarmInput.index,
+                                        puzzle.getCurrentSteps()});
     }
   }
 }
@@ -76,15 +260,33 @@ const int buzzer = 15;
 const int LEDC_CHANNEL = 0;
 BuzzerDriver buzzerDriver(buzzer, LEDC_CHANNEL);
 
+// Shared I2C bus (400 kHz) for the DHT20, CAP1188 and LSM6DSO
+I2cBus i2c;
+
 // ButtonDriver setup
-ButtonDriver buttonDriver({39, 38, 37, 36}, onButtonPressed);
+ButtonDriver buttonDriver({39, 38, 37, 36});
+
+// CAP1188 touch pads 1-4 act as the four buttons (ALERT on GPIO 13)
+TouchDriver touchDriver(i2c, {39, 38, 37, 36}, 13);
+
+// ImuDriver setup (LSM6DSO, INT1 on GPIO 35)
+ImuDriver imu(i2c, 35);
 
 // DHTDriver setup
-DHTDriver dhtDriver;
+DHTDriver dhtDriver(i2c);
 
 // Wifi setup
 WifiModule wifi(WIFI_SSID, WIFI_PASS);
 
+// Firmware updates: delta patches from the backend into the other app slot
+OtaUpdater ota(server, 5000, firmwarePath);
+
+// HTTPS: define BACKEND_TLS_PIN in credentials.h as the 32-byte SHA-256 of the
+// server's public key, e.g. {0x3a, 0x7f, ...}, to switch all backend calls to TLS
+#ifdef BACKEND_TLS_PIN
+static const uint8_t backendPin[32] = BACKEND_TLS_PIN;
+#endif
+
 // TimeSync setup
 const char* ntpServer1 = "pool.ntp.org";
 const char* ntpServer2 = "time.nist.gov";
@@ -92,182 +294,605 @@ const long gmtOffset_sec = -28800;      // California Standard Time (-8 hours fr
 const int daylightOffset_sec = 3600;    // DST adjustment: +1 hour (effective: -7 hours)
 TimeSync timeManager(ntpServer1, ntpServer2, gmtOffset_sec, daylightOffset_sec);
 
-unsigned long lastPostTime = 0;
 const int interval = 300UL * 1000UL; // 5min
+const uint32_t HISTORY_SAMPLE_MS = 60UL * 1000UL;      // DHT20 reads for the history
+const uint32_t HISTORY_FLUSH_MS = 15UL * 60UL * 1000UL;  // bounds what a power cut loses
+const uint32_t ENERGY_REPORT_MS = 60UL * 60UL * 1000UL;
+const uint32_t OTA_CHECK_MS = 6UL * 60UL * 60UL * 1000UL;
+const uint16_t OTA_JITTER_MS = 60000;
+const uint32_t OTA_CONFIRM_MS = 10UL * 60UL * 1000UL;  // a new image that has not reached the backend by then goes back
+const uint32_t OTA_RESTART_CHECK_MS = 60UL * 1000UL;
+const uint16_t OTA_QUIET_MINUTES = 15;                  // no restart this close to an alarm
+static bool sensorUploadDue = false;                    // set every interval by uploadJob
+
+// Periodic work runs as timer jobs; loop() sleeps until the next one is due
+StaticTimerWheel<12> timers(10, 0);
+const uint32_t INPUT_POLL_MS = 20;     // buttons are polled; bounds input latency and idle sleeps
+const uint16_t CONFIG_JITTER_MS = 5000;
+static TimerWheel::Handle alarmCooldown = TimerWheel::INVALID;
+static TimerWheel::Handle otaRestart = TimerWheel::INVALID;
+
+// Only its pending() state matters
+static void cooldownJob(void*) {}
+
+// delay() that books the wait as CPU idle time
+static void idleFor(unsigned long ms) {
+  Energy::set(RailCpu, CpuIdle);
+  delay(ms);
+  Energy::set(RailCpu, CpuBusy);
+}
 
-// Alarm Callback
+// Pump button input and deliver the resulting events while the alarm flow blocks loop()
+static void pollInput() {
+  buttonDriver.update();
+  touchDriver.update();
+  imu.update();
+  i2c.dispatch();
+  wifi.dispatch();
+  AppBus::dispatch();
+  statusScreen.update(UI_FRAME_BUDGET_US);
+}
+
+// Alarm Handler
 // This function is invoked when the alarm time is reached
-void alarmCallback() {
-  static unsigned long lastFire = 0;
-  unsigned long now = millis();
-  // if fired in the last 60s, bail out
-  if (now - lastFire < 60UL * 1000UL) return;
-  // otherwise record this fire time
-  lastFire = now;
-  Serial.println("Alarm triggered!");
+void onAlarmEvent(const AlarmEvent& event) {
+  // if fired in the last 60s, bail out; otherwise start a new cooldown
+  if (timers.pending(alarmCooldown)) return;
+  alarmCooldown = timers.schedule(60UL * 1000UL, cooldownJob, nullptr);
+  LOG_INFO("Alarm %02u:%02u triggered!", event.hour, event.minute);
+  Energy::totals(energyAlarmStart);
 
   // 1) Warning phase (buzz until button release)
-  Serial.println("Warning: Buzz until a button release.");
-  alarmCancel = false;
-  while (!alarmCancel) {
+  LOG_INFO("Warning: Buzz until a button release.");
+  alarmInput.cancel = false;
+  imu.setAlarmActive(true);
+  showPuzzle(PuzzleView::Ringing);
+  while (!alarmInput.cancel) {
     buzzerDriver.notify(500, 200, 1000);
     unsigned long start = millis();
-    while (millis() - start < 1000 && !alarmCancel) {
-      buttonDriver.update();
-      delay(10);
+    while (millis() - start < 1000 && !alarmInput.cancel) {
+      pollInput();
+      idleFor(10);
     }
   }
-  delay(3000);
+  idleFor(3000);
 
   uint8_t attempts = 0;
   uint32_t reactionTime = 0;
   bool success = false;
 
-    delete[] userSequence;             
-    userSequence    = new uint8_t[puzzle.getCurrentSteps()];
+    delete[] alarmInput.sequence;
+    alarmInput.sequence = new uint8_t[puzzle.getCurrentSteps()];
 
   do {
     attempts++;
+    alarmInput.attempt = attempts;
 
     uint8_t steps = puzzle.getCurrentSteps();
     const uint8_t* seq = puzzle.generateSequence();
 
-    Serial.printf("Attempt #%u: showing %u-step pattern\n", attempts, steps);
+    LOG_INFO("Attempt #%u: showing %u-step pattern", attempts, steps);
+    showPuzzle(PuzzleView::Showing, attempts);
 
     // Display the sequence
     for (uint8_t i = 0; i < steps; ++i) {
       bool pat[4] = {false};
       pat[seq[i]] = true;
       ledDriver.setPattern(pat);
-      delay(puzzle.getBlinkInterval());
+      idleFor(puzzle.getBlinkInterval());
       ledDriver.clear();
-      delay(200);
+      idleFor(200);
     }
 
     // Capture user input
-    waitingForInput = true;
-    inputIndex = 0;   
+    alarmInput.waiting = true;
+    alarmInput.index = 0;
+    showPuzzle(PuzzleView::Input, attempts);
     unsigned long startMs = millis();
-    while (inputIndex < steps) {
-      buttonDriver.update();
-      delay(10);
+    while (alarmInput.index < steps) {
+      pollInput();
+      idleFor(10);
     }
     reactionTime = millis() - startMs;
-    waitingForInput = false;
+    alarmInput.waiting = false;
 
     // Compare against the current seq
     success = true;
     for (uint8_t i = 0; i < steps; ++i) {
-      if (userSequence[i] != seq[i]) {
+      if (alarmInput.sequence[i] != seq[i]) {
         success = false;
         break;
       }
     }
 
     if (!success) {
-      Serial.println("Wrong pattern — generating a new one!");
+      LOG_INFO("Wrong pattern — generating a new one!");
       buzzerDriver.notify(300, 200, 500);
-      delay(500);
+      idleFor(500);
     }
   } while (!success);
 
   // 3) Success
-  Serial.printf("Correct in %u attempts, %lums reaction\n",
-                attempts, reactionTime);
+  LOG_INFO("Correct in %u attempts, %lums reaction",
+           attempts, (unsigned long)reactionTime);
   buzzerDriver.notify(1000, 200, 500);
+  showPuzzle(PuzzleView::Solved, attempts);
+  imu.setAlarmActive(false);
 
-  // 4) Record & send metrics
+  // 4) Record & send metrics; the result arrives in onMetricsUploaded()
   puzzle.recordPerformance(attempts, reactionTime);
-  String response;
-  String payload = String("{\"timestamp\":\"") + timeManager.getFormattedTime() +
-                   String("\",\"attempts\":") + attempts +
-                   String(",\"reaction_time\":") + reactionTime +
-                   String("}");
-  int status = wifi.httpPost(server, 5000, metricsPath, payload.c_str(), response);
-  if (status > 0 && status < 300) {
-    Serial.printf("Metrics POST ok: %d\n", status);
+  MetricsRecord record = { (uint32_t)timeManager.getEpochTime(), attempts, reactionTime };
+  if (metricsEndpoint.postAsync(record, onMetricsUploaded, nullptr)) {
+    metricsUpload = record;
+  } else {
+    metricsBacklog.push(record);
+  }
+
+  EnergyTotals now;
+  Energy::totals(now);
+  reportEnergy(EnergyRecord::Alarm, energyAlarmStart, now);
+}
+
+// Sensor Handler
+// Records each DHT20 sample in the history and uploads one per interval
+void onSensorSample(const SensorSample& sample) {
+  SensorRecord record = {
+    (uint32_t)sample.timestamp,
+    toCenti(sample.temperature),
+    toCentiUnsigned(sample.humidity)
+  };
+
+  statusScreen.setEnvironment(sample.temperature, sample.humidity);
+  history.append(record);
+
+  // Every sample goes into the history; one per interval is uploaded
+  if (!sensorUploadDue) return;
+  sensorUploadDue = false;
+
+  LOG_INFO("Temperature: %.2f C  |  Humidity: %.2f %%",
+           sample.temperature, sample.humidity);
+
+  const DisplayStats& ui = display.stats();
+  LOG_INFO("Display: %lu frames, last %lu us (max %lu), last %lu B over SPI (%lu B total), "
+           "%lu over budget, %lu deferred",
+           (unsigned long)ui.frames, (unsigned long)ui.lastFrameUs, (unsigned long)ui.maxFrameUs,
+           (unsigned long)ui.lastSpiBytes, (unsigned long)ui.totalSpiBytes,
+           (unsigned long)ui.overBudget, (unsigned long)ui.deferred);
+
+  const ImuStats& motion = imu.stats();
+  LOG_INFO("IMU: %lu I2C transactions, %lu wake-ups, %lu batches / %lu samples, "
+           "last batch %lu us (max %lu)",
+           (unsigned long)motion.i2cTransactions, (unsigned long)motion.wakeups,
+           (unsigned long)motion.batches, (unsigned long)motion.samples,
+           (unsigned long)motion.lastBatchUs, (unsigned long)motion.maxBatchUs);
+
+  for (uint8_t i = 0; i < i2c.deviceCount(); ++i) {
+    const I2cDeviceStats& bus = i2c.stats(i);
+    LOG_INFO("I2C %s: %lu transactions, %lu errors, %lu B, %lu us on bus (max %lu), max wait %lu us",
+             i2c.deviceName(i), (unsigned long)bus.transactions, (unsigned long)bus.errors,
+             (unsigned long)bus.bytes, (unsigned long)bus.busUs, (unsigned long)bus.maxBusUs,
+             (unsigned long)bus.maxWaitUs);
+  }
+
+  const HistoryStats& stored = history.stats();
+  LOG_INFO("History: %lu samples, %lu rejected, %lu block writes (%lu failed)",
+           (unsigned long)stored.appended, (unsigned long)stored.rejected,
+           (unsigned long)stored.blockWrites, (unsigned long)stored.writeErrors);
+
+  for (uint8_t i = 0; i < wifi.endpointCount(); ++i) {
+    const CircuitBreaker& breaker = wifi.endpointHealth(i);
+    const BreakerStats& health = breaker.stats();
+    LOG_INFO("Backend %s:%u %s: %lu requests, %lu failed, %lu failed fast, %lu trips, "
+             "last %lu ms (max %lu)",
+             wifi.endpointHost(i), wifi.endpointPort(i), CircuitBreaker::stateName(breaker.state()),
+             (unsigned long)health.requests, (unsigned long)health.failures,
+             (unsigned long)health.rejected, (unsigned long)health.trips,
+             (unsigned long)health.lastLatencyMs, (unsigned long)health.maxLatencyMs);
+  }
+
+  const RequestStats& requests = wifi.requestStats();
+  LOG_INFO("Requests: %lu queued, %lu rejected, %lu cancelled, %lu connections, %lu reused, "
+           "%lu pipelined, %lu retried, max wait %lu ms",
+           (unsigned long)requests.submitted, (unsigned long)requests.rejected,
+           (unsigned long)requests.cancelled, (unsigned long)requests.connections,
+           (unsigned long)requests.reused, (unsigned long)requests.pipelined,
+           (unsigned long)requests.retried, (unsigned long)requests.maxQueuedMs);
+
+  LogStats logs = Log::stats();
+  LOG_INFO("Log: %lu records, %lu dropped, ring high water %u B",
+           (unsigned long)logs.written, (unsigned long)logs.dropped, logs.highWater);
+
+#if TRACE_RECORD
+  TraceStats trace = Trace::stats();
+  LOG_INFO("Trace: %lu records, %lu B, %lu dropped",
+           (unsigned long)trace.records, (unsigned long)trace.bytes, (unsigned long)trace.dropped);
+#endif
+
+  // The result arrives in onSensorUploaded(); while a batch is still going, queue behind it
+  if (sensorEndpoint.postAsync(record, onSensorUploaded, nullptr)) {
+    sensorUpload = record;
   } else {
-    Serial.printf("Metrics POST failed: %d\n", status);
+    sensorBacklog.push(record);
+  }
+}
+
+// Config Handler
+void onConfigUpdate(const ConfigUpdate& update) {
+  if (update.count == 0) {
+    LOG_INFO("Alarm config updated: no alarms");
+  } else {
+    LOG_INFO("Alarm config updated: %u alarm(s), first %02u:%02u",
+             update.count, update.hour, update.minute);
+  }
+  statusScreen.alarmsChanged();
+}
+
+// Motion Handler
+// A shake dismisses the warning phase like a button; the puzzle still needs buttons
+void onMotionEvent(const MotionEvent& event) {
+  if (event.kind == MotionEvent::Shake) {
+    LOG_INFO("Shake detected (%u mg)", event.magnitudeMg);
+    if (!alarmInput.waiting) {
+      alarmInput.cancel = true;
+    }
+  } else {
+    LOG_INFO("Clock picked up (%u mg)", event.magnitudeMg);
+  }
+}
+
+// Restart into an installed update once no alarm is close; the check runs every minute
+static void otaRestartJob(void*) {
+  uint8_t hour, minute, daysAhead;
+  time_t t = time(nullptr);
+  struct tm now;
+  localtime_r(&t, &now);
+  // An alarm due this minute that checkAlarm() hasn't fired yet is inside the window too
+  if (alarmScheduler.nextAlarm(now, hour, minute, daysAhead, true)) {
+    int32_t minutes = daysAhead * 1440L + hour * 60 + minute - (now.tm_hour * 60 + now.tm_min);
+    if (minutes <= OTA_QUIET_MINUTES) return;
+  }
+  history.flush();
+#if TRACE_RECORD
+  Trace::flush();
+#endif
+  ota.restart();
+}
+
+// Update Handler
+void onOtaEvent(const OtaEvent& event) {
+  // The check ran on OtaUpdater's task, which the trace ignores; a replay gets its outcome from here
+  TRACE_RESPONSE("GET", firmwarePath, event.status, event.ms, -1, nullptr, 0, false);
+  switch (event.result) {
+    case OtaEvent::UpToDate:
+      LOG_DEBUG("Firmware up to date (%lu ms)", (unsigned long)event.ms);
+      return;
+    case OtaEvent::Skipped:
+      LOG_WARN("Firmware update skipped: the server offers the image that was rolled back");
+      return;
+    case OtaEvent::Failed:
+      LOG_WARN("Firmware update failed: HTTP %d, patch %s after %lu B",
+               event.status, DeltaPatcher::statusName((DeltaPatcher::Status)event.patch),
+               (unsigned long)event.patchBytes);
+      return;
+    case OtaEvent::Installed:
+      break;
   }
+  LOG_INFO("Firmware update installed: %lu B downloaded for a %lu B image (%.1f %%) in %lu ms",
+           (unsigned long)event.patchBytes, (unsigned long)event.imageBytes,
+           event.imageBytes ? 100.0f * event.patchBytes / event.imageBytes : 0.0f,
+           (unsigned long)event.ms);
+  if (!timers.pending(otaRestart)) otaRestart = timers.every(OTA_RESTART_CHECK_MS, otaRestartJob, nullptr);
+}
+
+// Serial commands, one per line:
+//   history [hours]   sensor history as CSV (centi-units), from the finest tier that covers it
+//   trace [prev]      with TRACE_RECORD, this boot's input trace (or the previous one's) as hex,
+//                     for tools/replay
+// Output is streamed a few points per poll, so a long dump does not hold up alarms or input.
+static char commandLine[32];
+static uint8_t commandLength = 0;
+const uint8_t HISTORY_DUMP_BATCH = 4;  // about 160 B, what 115200 baud sends in one poll
+
+struct HistoryDump {
+  bool                active;
+  SensorHistory::Tier tier;
+  uint32_t            next;    // timestamp to continue from
+  uint32_t            to;
+  uint32_t            points;
+  uint8_t             batch;
+  unsigned long       startMs;
+};
+static HistoryDump historyDump = {};
+
+static bool printHistoryPoint(void*, const HistoryPoint& p) {
+  Serial.printf("%lu,%d,%d,%d,%u,%u,%u\n", (unsigned long)p.timestamp,
+                p.temperatureCenti, p.temperatureMin, p.temperatureMax,
+                p.humidityCenti, p.humidityMin, p.humidityMax);
+  historyDump.next = p.timestamp + 1;
+  return ++historyDump.batch < HISTORY_DUMP_BATCH;
+}
+
+#if TRACE_RECORD
+// Input trace for tools/replay: this boot's, and the one before, which a reset would otherwise lose
+const char* TRACE_PATH = "/trace.bin";
+const char* TRACE_PREVIOUS_PATH = "/trace.prev";
+const uint32_t TRACE_MAX_BYTES = 256UL * 1024UL;  // a few days of a normal household
+const uint8_t TRACE_DUMP_LINES = 2;               // of 32 bytes, as hex
+static File traceFile;
+
+struct TraceDump {
+  File     file;
+  uint32_t left;
+};
+static TraceDump traceDump;
+
+static void startTrace() {
+  if (LittleFS.exists(TRACE_PATH)) {
+    LittleFS.remove(TRACE_PREVIOUS_PATH);
+    LittleFS.rename(TRACE_PATH, TRACE_PREVIOUS_PATH);
+  }
+  traceFile = LittleFS.open(TRACE_PATH, "w");
+  if (!traceFile) {
+    LOG_WARN("Input trace disabled.");
+    return;
+  }
+  Trace::begin(traceFile, TRACE_MAX_BYTES);
+}
+
+static void startTraceDump(const char* path) {
+  Trace::flush();
+  if (traceDump.file) traceDump.file.close();
+  traceDump.file = LittleFS.open(path, "r");
+  if (!traceDump.file) {
+    Serial.printf("# no %s\n", path);
+    return;
+  }
+  // Only what is there now; recording goes on meanwhile
+  traceDump.left = traceDump.file.size();
+  Serial.printf("# trace %s, %lu B\n", path, (unsigned long)traceDump.left);
+}
+
+static void continueTraceDump() {
+  if (!traceDump.file) return;
+  for (uint8_t line = 0; line < TRACE_DUMP_LINES && traceDump.left > 0; ++line) {
+    uint8_t bytes[32];
+    char hex[2 * sizeof(bytes) + 1];
+    size_t n = traceDump.file.read(bytes, traceDump.left < sizeof(bytes) ? traceDump.left : sizeof(bytes));
+    if (n == 0) {
+      traceDump.left = 0;
+      break;
+    }
+    for (size_t i = 0; i < n; ++i) sprintf(hex + 2 * i, "%02x", bytes[i]);
+    Serial.println(hex);
+    traceDump.left -= n;
+  }
+  if (traceDump.left == 0) {
+    Serial.println("# end of trace");
+    traceDump.file.close();
+  }
+}
+#endif
+
+static void continueHistoryDump() {
+  if (!historyDump.active) return;
+  historyDump.batch = 0;
+  uint32_t n = history.query(historyDump.tier, historyDump.next, historyDump.to, printHistoryPoint, nullptr);
+  historyDump.points += n;
+  if (n < HISTORY_DUMP_BATCH) {
+    Serial.printf("# %lu points in %lu ms\n", (unsigned long)historyDump.points,
+                  millis() - historyDump.startMs);
+    historyDump.active = false;
+  }
+}
+
+static void runCommand(const char* line) {
+#if TRACE_RECORD
+  if (strncmp(line, "trace", 5) == 0) {
+    startTraceDump(strstr(line + 5, "prev") ? TRACE_PREVIOUS_PATH : TRACE_PATH);
+    return;
+  }
+#endif
+  unsigned long hours = 24;
+  if (strncmp(line, "history", 7) != 0 || sscanf(line + 7, "%lu", &hours) == 0) {
+    Serial.println(TRACE_RECORD ? "commands: history [hours], trace [prev]" : "commands: history [hours]");
+    return;
+  }
+  static const char* const tierNames[SensorHistory::TIER_COUNT] = { "raw", "5min", "hourly" };
+  uint32_t now = timeManager.getEpochTime();
+  historyDump.next = now - hours * 3600UL;
+  historyDump.to = now;
+  historyDump.tier = history.tierFor(historyDump.next);
+  historyDump.points = 0;
+  historyDump.startMs = millis();
+  historyDump.active = true;
+  Serial.printf("# %s, last %lu h\n", tierNames[historyDump.tier], hours);
+  Serial.println("timestamp,temperature,temperature_min,temperature_max,humidity,humidity_min,humidity_max");
+}
+
+static void readCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (commandLength < sizeof(commandLine) - 1) commandLine[commandLength++] = c;
+      continue;
+    }
+    commandLine[commandLength] = '\0';
+    if (commandLength > 0) runCommand(commandLine);
+    commandLength = 0;
+  }
+}
+
+// Timer jobs
+static void pollJob(void*) {
+  readCommands();
+  continueHistoryDump();
+#if TRACE_RECORD
+  continueTraceDump();
+#endif
+  buttonDriver.update();
+  touchDriver.update();
+  imu.update();
+  dhtDriver.update();
+}
+
+// Check if the alarm time has been reached
+static void alarmJob(void*) {
+  TRACE_CLOCK();
+  alarmScheduler.checkAlarm();
+}
+
+// A new image that got a schedule from the backend, even an empty one, works well enough to keep
+static void confirmFirmware() {
+  if (!ota.onTrial() || alarmConfig.fetches() == 0) return;
+  ota.confirm();
+  LOG_INFO("New firmware confirmed.");
+}
+
+// Refresh the remote alarm; jittered so a fleet of clocks does not poll in lockstep.
+// The fetch runs on WifiModule's request task and is applied from wifi.dispatch().
+static void configJob(void*) {
+  confirmFirmware();
+  alarmConfig.refresh();
+}
+
+// DHTDriver posts the SensorSample; it is stored and uploaded in onSensorSample()
+static void sensorJob(void*) {
+  dhtDriver.requestRead();
+}
+
+static void uploadJob(void*) {
+  sensorUploadDue = true;
+  LOG_INFO("Next update in (ms): %d", interval);
+}
+
+// Backend health: every host's circuit breaker, as one batch. The counters run
+// since boot, so a lost upload needs no backlog: the next one covers it.
+static void onBackendsUploaded(void*, int status) {
+  if (status < 200 || status >= 300) LOG_WARN("Backend health POST failed: %d", status);
+}
+
+static void reportBackends() {
+  uint8_t count = wifi.endpointCount();
+  if (count == 0 || backendEndpoint.busy()) return;
+  BackendRecord records[WifiModule::MAX_ENDPOINTS];
+  uint32_t now = (uint32_t)time(nullptr);
+  for (uint8_t i = 0; i < count; ++i) {
+    const CircuitBreaker& breaker = wifi.endpointHealth(i);
+    const BreakerStats& health = breaker.stats();
+    BackendRecord& record = records[i];
+    record.timestamp = now;
+    snprintf(record.host, sizeof(record.host), "%s:%u", wifi.endpointHost(i), wifi.endpointPort(i));
+    record.state = breaker.state();
+    record.requests = health.requests;
+    record.failures = health.failures;
+    record.rejected = health.rejected;
+    record.trips = health.trips;
+  }
+  // The endpoint copies the records
+  backendEndpoint.postBatchAsync(records, count, onBackendsUploaded, nullptr);
+}
+
+static void energyJob(void*) {
+  EnergyTotals now;
+  Energy::totals(now);
+  reportEnergy(EnergyRecord::Hour, energyHourStart, now);
+  energyHourStart = now;
+  reportBackends();
+}
+
+// Ask the backend for a newer firmware; the download runs in OtaUpdater's task
+static void otaJob(void*) {
+  if (!timers.pending(otaRestart)) ota.check();
+}
+
+// Still unconfirmed: the new image never got through to the backend
+static void otaTrialJob(void*) {
+  confirmFirmware();
+  if (!ota.onTrial()) return;
+  LOG_ERROR("New firmware not confirmed in %lu s", (unsigned long)(OTA_CONFIRM_MS / 1000));
+  ota.rollback();
+}
+
+static void historyFlushJob(void*) {
+  history.flush();
+#if TRACE_RECORD
+  Trace::flush();
+#endif
 }
 
 void setup() {
+  // From power-on, so the first hour includes the boot
+  Energy::begin();
   Serial.begin(115200);
+  // Log calls so far were written out synchronously; from here a background task drains them
+  Log::begin(Serial);
   delay(1000);
+  // Ahead of the modules a new image could fail in: counts its trial boots, rolls it back after too many
+  ota.begin();
   
   // Initialize modules
     wifi.begin(30000);
+#ifdef BACKEND_TLS_PIN
+  wifi.enableTls(backendPin);
+#endif
   ledDriver.begin();
   buzzerDriver.begin();
+  if (display.begin()) {
+    statusScreen.begin();
+    statusScreen.update(UI_FRAME_BUDGET_US);
+  }
   buttonDriver.begin();
+  i2c.begin();
   dhtDriver.begin();
+  if (!historyStorage.begin() || !history.begin()) {
+    LOG_WARN("Sensor history disabled.");
+  }
+#if TRACE_RECORD
+  // On the LittleFS the history mounted; records from here on, the NTP sync and alarm fetch included
+  startTrace();
+#endif
+  if (!touchDriver.begin()) {
+    LOG_WARN("Touch input disabled.");
+  }
+  if (!imu.begin()) {
+    LOG_WARN("Motion input disabled.");
+  }
   
   // Initialize time synchronization
   timeManager.begin();
   if (timeManager.sync()) {
-    Serial.println("Time synchronized successfully!");
+    LOG_INFO("Time synchronized successfully!");
   } else {
-    Serial.println("Time synchronization failed!");
+    LOG_WARN("Time synchronization failed!");
   }
 
   // initialize alarm fetcher
   alarmConfig.begin();
-  
-  // Register the alarm callback
-  alarmScheduler.setCallback(alarmCallback);
-
+  confirmFirmware();
+
+  // Setup took a while; start the jobs from now
+  timers.advance(millis());
+  timers.every(INPUT_POLL_MS, pollJob, nullptr);
+  timers.every(1000, alarmJob, nullptr, 0, 100);
+  timers.every(HISTORY_SAMPLE_MS, sensorJob, nullptr);
+  timers.every(interval, uploadJob, nullptr);
+  timers.every(HISTORY_FLUSH_MS, historyFlushJob, nullptr);
+  timers.every(ENERGY_REPORT_MS, energyJob, nullptr);
+  timers.every(alarmConfig.period(), configJob, nullptr, CONFIG_JITTER_MS);
+  timers.every(OTA_CHECK_MS, otaJob, nullptr, OTA_JITTER_MS);
+  if (ota.onTrial()) timers.schedule(OTA_CONFIRM_MS, otaTrialJob, nullptr);
 }
 
 void loop() {
+  // Run due jobs, then deliver everything they and the ISRs produced
+  timers.advance(millis());
+  i2c.dispatch();
+  wifi.dispatch();
+  AppBus::dispatch();
 
-  // refresh remote alarm periodically
-  alarmConfig.update();
-  
-  // Check if the alarm time has been reached
-  alarmScheduler.checkAlarm();
-  buttonDriver.update();
-  
-  // Sensor reading and HTTP sending
-  if (millis() - lastPostTime >= interval) {
-    lastPostTime = millis();
-
-    if (!dhtDriver.read()) {
-      return;
-
-    }
-
-    float temperature = dhtDriver.getTemperature();
-    float humidity    = dhtDriver.getHumidity();
-
-    String timestamp = timeManager.getFormattedTime();
-    String payload = String("{\"timestamp\":\"") + timestamp +
-                     String("\",\"temperature\":") + String(temperature, 2) +
-                     String(",\"humidity\":")    + String(humidity, 2) +
-                     String("}");
-
-    Serial.printf("Temperature: %.2f C  |  Humidity: %.2f %%\n",
-                  dhtDriver.getTemperature(), dhtDriver.getHumidity());
-    
-    String response;
-    int status = wifi.httpPost(
-      server,            // domain
-      5000,              // port
-      sensorPath,        // path
-      payload.c_str(),   // JSON body
-      response           // response body
-    );
- 
-    if (status > 0) {
-      Serial.printf("POST %s -> %d\nResponse: %s\n", sensorPath, status, response.c_str());
-    } else {
-      Serial.printf("HTTP POST failed, err=%d\n", status);
-    }
-    
-    Serial.println("Next update in (ms): " + String(interval));
-    Serial.println();
-
-  }
-  
-  delay(1000);
+  statusScreen.update(UI_FRAME_BUDGET_US);
 
+  uint32_t idle = timers.msUntilNext(millis());
+  if (idle > 0) idleFor(idle < INPUT_POLL_MS ? idle : INPUT_POLL_MS);
 }
@@ -0,0 +1,262 @@
+#include "bench_cases.h"
+#include <core/AlarmConfig.h>
+#include <core/AlarmScheduler.h>
+#include <core/Events.h>
+#include <core/PuzzleGame.h>
+#include <core/TelemetryEncoder.h>
+#include <hal/ButtonDriver.h>
+#include <stdio.h>
+#include <time.h>
+
+// AlarmConfig.cpp refers to the firmware's global; no case does network I/O
+WifiModule wifi("bench", "");
+
+namespace {
+
+volatile uint32_t sink;  // keeps the optimizer from dropping results
+
+// Out of line, so the direct call and the bus both pay for a real call
+__attribute__((noinline)) void onBenchButton(const ButtonEvent& event) {
+  sink += event.pin + event.edge;
+}
+
+}  // namespace
+
+// The only subscriber in these builds; main.cpp is not linked into them
+template <>
+struct Subscribers<ButtonEvent> {
+  typedef HandlerList<ButtonEvent, onBenchButton> type;
+};
+
+namespace {
+
+// Read-only Stream over a body in memory, handed to AlarmConfig::onResponse()
+class BufferStream : public Stream {
+  public:
+    BufferStream(const char* data, size_t len) : _data(data), _len(len), _pos(0) { setTimeout(0); }
+    int available() override { return (int)(_len - _pos); }
+    int read() override { return _pos < _len ? (uint8_t)_data[_pos++] : -1; }
+    int peek() override { return _pos < _len ? (uint8_t)_data[_pos] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+  private:
+    const char* _data;
+    size_t      _len;
+    size_t      _pos;
+};
+
+AlarmScheduler* scheduler;
+AlarmConfig*    config;
+PuzzleGame*     puzzle;
+ButtonDriver*   buttons;
+struct tm       now;
+
+const JsonEncoder json;
+const CborEncoder cbor;
+
+SensorRecord sensorAt(uint32_t i) {
+  return SensorRecord{ (uint32_t)(1700000000UL + i * 300), (int16_t)(2150 + (int16_t)(i % 64) - 32),
+                       (uint16_t)(4025 + i % 100) };
+}
+
+// --- AlarmScheduler ---------------------------------------------------------
+
+// A full schedule, every entry twelve hours away from now, so nothing fires
+void setupSchedule() {
+  scheduler = new AlarmScheduler();
+  time_t t = time(nullptr);
+  localtime_r(&t, &now);
+  for (uint8_t i = 0; i < AlarmScheduler::MAX_ALARMS; ++i) {
+    scheduler->addAlarm((now.tm_hour + 12) % 24, i * 7);
+  }
+}
+
+void teardownSchedule() {
+  delete scheduler;
+}
+
+void runCheckAlarm(uint32_t) {
+  scheduler->checkAlarm();
+}
+
+void runNextAlarm(uint32_t i) {
+  uint8_t hour, minute, days;
+  now.tm_min = i % 60;
+  scheduler->nextAlarm(now, hour, minute, days);
+  sink += hour + minute + days;
+}
+
+// --- PuzzleGame -------------------------------------------------------------
+
+// Steps stay at 4, within both the sequence buffer and the history
+void setupPuzzle() {
+  puzzle = new PuzzleGame(4, 4, 5, 1000);
+}
+
+void teardownPuzzle() {
+  delete puzzle;
+}
+
+void runGenerate(uint32_t) {
+  sink += puzzle->generateSequence()[0];
+}
+
+void runRecord(uint32_t i) {
+  puzzle->recordPerformance(1 + i % 4, 1000 + (i % 7) * 700);
+}
+
+// --- Payloads ---------------------------------------------------------------
+
+void none() {}
+
+void runJsonSensor(uint32_t i) {
+  uint8_t buf[TELEMETRY_MAX_RECORD];
+  sink += json.encode(sensorAt(i), buf, sizeof(buf));
+}
+
+void runCborSensor(uint32_t i) {
+  uint8_t buf[TELEMETRY_MAX_RECORD];
+  sink += cbor.encode(sensorAt(i), buf, sizeof(buf));
+}
+
+void runCborMetrics(uint32_t i) {
+  uint8_t buf[TELEMETRY_MAX_RECORD];
+  MetricsRecord record = { (uint32_t)(1700000000UL + i * 60), (uint8_t)(1 + i % 4), 1500 + i % 3000 };
+  sink += cbor.encode(record, buf, sizeof(buf));
+}
+
+// A backlog flush: 16 records with the batch framing, as TelemetryEndpoint sends them
+void runBatch(const TelemetryEncoder& enc, uint32_t i) {
+  const uint16_t count = 16;
+  uint8_t buf[count * (TELEMETRY_MAX_RECORD + 2) + 8];
+  size_t n = enc.beginBatch(count, buf, sizeof(buf));
+  for (uint16_t r = 0; r < count; ++r) {
+    if (r) n += enc.batchSeparator(buf + n, sizeof(buf) - n);
+    n += enc.encode(sensorAt(i + r), buf + n, sizeof(buf) - n);
+  }
+  n += enc.endBatch(buf + n, sizeof(buf) - n);
+  sink += n;
+}
+
+void runJsonBatch(uint32_t i) {
+  runBatch(json, i);
+}
+
+void runCborBatch(uint32_t i) {
+  runBatch(cbor, i);
+}
+
+// --- AlarmConfig ------------------------------------------------------------
+
+const char SCHEDULE[] =
+  "{\"alarms\":[{\"hour\":7,\"minute\":30,\"days\":62},"
+  "{\"hour\":9,\"minute\":0,\"days\":65},{\"hour\":22,\"minute\":15}]}";
+
+const char FULL_SCHEDULE[] =
+  "{\"alarms\":[{\"hour\":6,\"minute\":0,\"days\":2},{\"hour\":6,\"minute\":15,\"days\":4},"
+  "{\"hour\":6,\"minute\":30,\"days\":8},{\"hour\":6,\"minute\":45,\"days\":16},"
+  "{\"hour\":7,\"minute\":0,\"days\":32},{\"hour\":8,\"minute\":30,\"days\":65},"
+  "{\"hour\":12,\"minute\":0},{\"hour\":22,\"minute\":15}],\"etag\":\"a1b2c3d4\"}";
+
+void setupConfig() {
+  scheduler = new AlarmScheduler();
+  config = new AlarmConfig(*scheduler, "127.0.0.1", 5000, "/api/alarm");
+}
+
+void teardownConfig() {
+  delete config;
+  delete scheduler;
+}
+
+void parse(const char* body, size_t len) {
+  BufferStream stream(body, len);
+  ResponseHandler& handler = *config;
+  sink += handler.onResponse(200, stream, (int)len);
+  // Drain the ConfigUpdate the first parse posts; nothing subscribes here
+  AppBus::dispatch();
+}
+
+void runParse(uint32_t) {
+  parse(SCHEDULE, sizeof(SCHEDULE) - 1);
+}
+
+void runParseFull(uint32_t) {
+  parse(FULL_SCHEDULE, sizeof(FULL_SCHEDULE) - 1);
+}
+
+// --- AppBus -----------------------------------------------------------------
+
+// One button edge to one handler, the three ways main.cpp could deliver it.
+// post + dispatch() also polls the other event types' empty queues.
+
+ButtonEvent buttonEdge(uint32_t i) {
+  return ButtonEvent{ (uint8_t)(36 + i % 4), i & 1 ? ButtonEvent::Released : ButtonEvent::Pressed, i };
+}
+
+void runBusPost(uint32_t i) {
+  AppBus::post(buttonEdge(i));
+  sink += AppBus::dispatch();
+}
+
+void runBusPublish(uint32_t i) {
+  AppBus::publish(buttonEdge(i));
+}
+
+void runDirectCall(uint32_t i) {
+  onBenchButton(buttonEdge(i));
+}
+
+// --- ButtonDriver -----------------------------------------------------------
+
+// The firmware's pins; all idle, so update() polls without posting edges
+void setupButtons() {
+  buttons = new ButtonDriver({39, 38, 37, 36});
+  buttons->begin();
+}
+
+void teardownButtons() {
+  delete buttons;
+}
+
+void runButtons(uint32_t) {
+  buttons->update();
+}
+
+}  // namespace
+
+const BenchCase BENCH_CASES[] = {
+  { "alarm.check",            2000, setupSchedule, runCheckAlarm,  teardownSchedule },
+  { "alarm.next",            20000, setupSchedule, runNextAlarm,   teardownSchedule },
+  { "puzzle.generate",       20000, setupPuzzle,   runGenerate,    teardownPuzzle },
+  { "puzzle.record",          2000, setupPuzzle,   runRecord,      teardownPuzzle },
+  { "payload.json.sensor",    2000, none,          runJsonSensor,  none },
+  { "payload.cbor.sensor",   20000, none,          runCborSensor,  none },
+  { "payload.cbor.metrics",  20000, none,          runCborMetrics, none },
+  { "payload.json.batch",      200, none,          runJsonBatch,   none },
+  { "payload.cbor.batch",     2000, none,          runCborBatch,   none },
+  { "config.parse",            500, setupConfig,   runParse,       teardownConfig },
+  { "config.parse.full",       200, setupConfig,   runParseFull,   teardownConfig },
+  { "bus.post.dispatch",     20000, none,          runBusPost,     none },
+  { "bus.publish",           20000, none,          runBusPublish,  none },
+  { "bus.direct",            20000, none,          runDirectCall,  none },
+  { "button.update",         20000, setupButtons,  runButtons,     teardownButtons },
+};
+
+const uint8_t BENCH_CASE_COUNT = sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]);
+
+size_t benchFormat(const BenchResult& r, char* buf, size_t capacity) {
+  int n = snprintf(buf, capacity, "%s,%u,%lu,%s,%.1f,%.1f,%ld,%ld", r.name, r.runs,
+                   (unsigned long)r.iterations, r.unit, r.min, r.median, (long)r.heap, (long)r.stack);
+  return n < 0 ? 0 : ((size_t)n < capacity ? (size_t)n : capacity - 1);
+}
+
+double benchMedian(double* samples, uint8_t count) {
+  for (uint8_t i = 1; i < count; ++i) {
+    double v = samples[i];
+    uint8_t j = i;
+    for (; j > 0 && samples[j - 1] > v; --j) samples[j] = samples[j - 1];
+    samples[j] = v;
+  }
+  if (count == 0) return 0;
+  return count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+}
@@ -0,0 +1,52 @@
+#ifndef BENCH_CASES_H
+#define BENCH_CASES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Benchmark cases shared by the host runner (core_bench.cpp) and the
+// on-target runner (bench_target.cpp), so both time the same code on the
+// same inputs.
+//
+// A case allocates what it needs in setup() and frees it in teardown(), so
+// the target runner can tell its heap footprint and leaks apart. run(i) is
+// the timed operation, called `iterations` times per run with i counting up.
+
+struct BenchCase {
+  const char* name;
+  uint32_t    iterations;  // per run, sized for about 10 ms on the ESP32
+  void      (*setup)();
+  void      (*run)(uint32_t i);
+  void      (*teardown)();
+};
+
+extern const BenchCase BENCH_CASES[];
+extern const uint8_t   BENCH_CASE_COUNT;
+
+// One result row. Both runners print the same CSV, so core_bench --compare
+// works on host results and on lines captured from the serial monitor alike.
+//   case,runs,iterations,unit,min,median,heap,stack
+// min/median are per operation over the runs, in `unit` (ns on the host,
+// cycles on the target). heap is the bytes a case holds between setup()
+// and teardown(), stack the peak bytes of stack it used; -1 where the
+// runner cannot measure them.
+struct BenchResult {
+  const char* name;
+  uint8_t     runs;
+  uint32_t    iterations;
+  const char* unit;
+  double      min;
+  double      median;
+  int32_t     heap;
+  int32_t     stack;
+};
+
+static const char* const BENCH_HEADER = "case,runs,iterations,unit,min,median,heap,stack";
+
+/** Format a result as one CSV line (no newline); returns its length. */
+size_t benchFormat(const BenchResult& result, char* buf, size_t capacity);
+
+/** Median of `count` per-op samples; sorts them in place. */
+double benchMedian(double* samples, uint8_t count);
+
+#endif
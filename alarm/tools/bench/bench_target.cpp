@@ -0,0 +1,112 @@
+// On-target runner for the benchmark cases in bench_cases.cpp. Built by the
+// `bench` environment of platformio.ini in place of main.cpp:
+//
+//   pio run -e bench -t upload && pio device monitor -e bench | tee target.csv
+//   ./core_bench --compare base.csv target.csv
+//
+// For every case it reports, in the CSV format of bench_cases.h:
+//   min/median  CPU cycles per operation (ESP.getCycleCount()) over RUNS runs
+//   heap        free heap given up between setup() and teardown()
+//   stack       peak stack use: each case runs in a task of its own with
+//               STACK_BYTES of stack, and the high-water mark is read when
+//               it is done
+// A case that does not give all its heap back in teardown() gets a
+// "# leak" line, which core_bench skips along with the rest of the serial
+// output. Send 'r' over Serial to run the cases again.
+//
+// Log records are queued as in the firmware, so their cost is in the
+// numbers, but the log task discards them to keep the output parsable.
+
+#include "bench_cases.h"
+#include <Arduino.h>
+#include <core/Log.h>
+#include <sys/time.h>
+
+namespace {
+
+const uint8_t  RUNS = 7;
+const uint32_t STACK_BYTES = 8192;
+
+class NullPrint : public Print {
+  public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+NullPrint discard;
+
+struct Job {
+  const BenchCase* bench;
+  TaskHandle_t     caller;
+  double           perOp[RUNS];
+  int32_t          held;
+  int32_t          leaked;
+};
+
+void caseTask(void* arg) {
+  Job& job = *static_cast<Job*>(arg);
+  const BenchCase& c = *job.bench;
+
+  uint32_t freeBefore = ESP.getFreeHeap();
+  c.setup();
+  for (uint32_t i = 0; i < c.iterations; ++i) c.run(i);  // warm-up: caches, lazy allocations
+  for (uint8_t r = 0; r < RUNS; ++r) {
+    uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < c.iterations; ++i) c.run(i);
+    job.perOp[r] = (double)(ESP.getCycleCount() - start) / c.iterations;
+  }
+  job.held = (int32_t)(freeBefore - ESP.getFreeHeap());
+  c.teardown();
+  job.leaked = (int32_t)(freeBefore - ESP.getFreeHeap());
+
+  // Stay around until the caller has read the stack high-water mark
+  xTaskNotifyGive(job.caller);
+  vTaskSuspend(nullptr);
+}
+
+void runAll() {
+  Serial.println(BENCH_HEADER);
+  for (uint8_t i = 0; i < BENCH_CASE_COUNT; ++i) {
+    Job job;
+    job.bench = &BENCH_CASES[i];
+    job.caller = xTaskGetCurrentTaskHandle();
+
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(caseTask, "bench", STACK_BYTES, &job, 1, &task,
+                                ARDUINO_RUNNING_CORE) != pdPASS) {
+      Serial.printf("# %s: cannot create task\n", job.bench->name);
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t unused = uxTaskGetStackHighWaterMark(task);  // bytes on the ESP32
+    vTaskDelete(task);
+
+    BenchResult result = { job.bench->name, RUNS, job.bench->iterations, "cycles", 0, 0,
+                           job.held, (int32_t)(STACK_BYTES - unused) };
+    result.median = benchMedian(job.perOp, RUNS);
+    result.min = job.perOp[0];
+    char line[160];
+    benchFormat(result, line, sizeof(line));
+    Serial.println(line);
+    if (job.leaked > 0) Serial.printf("# leak %s %ld\n", job.bench->name, (long)job.leaked);
+  }
+  Serial.printf("# done, %u cases at %u MHz\n", BENCH_CASE_COUNT, (unsigned)ESP.getCpuFreqMHz());
+}
+
+}  // namespace
+
+void setup() {
+  Serial.begin(115200);
+
+  // checkAlarm() and the JSON encoder need a valid clock; there is no SNTP here
+  struct timeval now = { 1700000000, 0 };
+  settimeofday(&now, nullptr);
+  Log::begin(discard);
+
+  runAll();
+}
+
+void loop() {
+  if (Serial.read() == 'r') runAll();
+  delay(50);
+}
@@ -0,0 +1,210 @@
+// Host microbenchmarks of the firmware's core modules (cases in
+// tools/bench/bench_cases.cpp), with a regression check against an earlier
+// run.
+//
+//   g++ -std=gnu++11 -O2 -DWIFIMODULE_TLS=0 -Itools/native -Isrc -I.pio/libdeps/ttgo-lora32-v1/ArduinoJson/src -o core_bench tools/bench/core_bench.cpp tools/bench/bench_cases.cpp tools/native/*.cpp src/core/AlarmConfig.cpp src/core/AlarmScheduler.cpp src/core/PuzzleGame.cpp src/core/TelemetryEncoder.cpp src/core/TelemetryEndpoint.cpp src/core/GzipWriter.cpp src/core/CircuitBreaker.cpp src/core/Energy.cpp src/core/Log.cpp src/core/LogFormat.cpp src/hal/ButtonDriver.cpp src/hal/WifiModule.cpp -lpthread
+//
+//   ./core_bench [--runs N] [--filter TEXT] [--baseline FILE] [--tolerance PCT]
+//   ./core_bench --compare BASE NEW [--tolerance PCT]
+//
+// Runs every case whose name contains TEXT: one untimed warm-up run, then
+// --runs (default 11) timed runs of at least 5 ms each. The runs go round
+// robin over the cases, so a burst of load on the machine slows one run of
+// every case instead of every run of one. Prints one CSV line per case
+// (format in bench_cases.h) to stdout, with min and median ns per
+// operation.
+//
+// --baseline compares the run against an earlier output; --compare
+// compares two saved outputs, e.g. lines captured from bench_target on the
+// ESP32. Cases are matched by name and compared on min, the least noisy
+// statistic, and on heap and stack where both sides have them. The table
+// goes to stderr with --baseline and to stdout with --compare. The exit
+// status is 1 if any case got worse by more than --tolerance percent
+// (default 10).
+
+#include "bench_cases.h"
+#include <Arduino.h>
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+const uint8_t MAX_RUNS = 31;
+const double  MIN_RUN_NS = 5e6;  // the host is far faster than the iteration counts assume
+
+struct Row {
+  std::string unit;
+  double      min;
+  int32_t     heap;
+  int32_t     stack;
+};
+
+typedef std::map<std::string, Row> Results;
+
+double nsFor(const BenchCase& c, uint32_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; ++i) c.run(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+// One untimed run, also sizing the timed runs to at least MIN_RUN_NS each
+uint32_t calibrate(const BenchCase& c) {
+  c.setup();
+  double warmup = nsFor(c, c.iterations);
+  c.teardown();
+  if (warmup >= MIN_RUN_NS) return c.iterations;
+  return (uint32_t)(c.iterations * (MIN_RUN_NS / (warmup + 1)) + 1);
+}
+
+double timedRun(const BenchCase& c, uint32_t iterations) {
+  c.setup();
+  double ns = nsFor(c, iterations);
+  c.teardown();
+  return ns / iterations;
+}
+
+// Accepts any text with result lines in it: other lines (serial noise, the header) are skipped
+bool load(const char* path, Results& results) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char name[64], unit[16];
+    unsigned runs;
+    unsigned long iterations;
+    double min, median;
+    long heap, stack;
+    if (sscanf(line, "%63[^,],%u,%lu,%15[^,],%lf,%lf,%ld,%ld", name, &runs, &iterations, unit,
+               &min, &median, &heap, &stack) != 8) {
+      continue;
+    }
+    results[name] = Row{ unit, min, (int32_t)heap, (int32_t)stack };
+  }
+  fclose(f);
+  return true;
+}
+
+// Worse by more than the tolerance; byte counts also need to grow by more than a few words
+bool worse(double base, double now, double tolerance, double slack) {
+  return now > base * (1 + tolerance / 100) && now - base > slack;
+}
+
+int compare(const Results& base, const Results& now, double tolerance, FILE* out) {
+  int regressions = 0;
+  fprintf(out, "%-22s %12s %12s %8s  %s\n", "case", "base", "new", "change", "");
+  for (const auto& entry : now) {
+    auto b = base.find(entry.first);
+    if (b == base.end()) {
+      fprintf(out, "%-22s %12s %12.1f %8s  new\n", entry.first.c_str(), "-", entry.second.min, "");
+      continue;
+    }
+    const Row& was = b->second;
+    const Row& is = entry.second;
+    if (was.unit != is.unit) {
+      fprintf(out, "%-22s %s vs %s, not comparable\n", entry.first.c_str(), was.unit.c_str(), is.unit.c_str());
+      continue;
+    }
+
+    std::string notes;
+    if (worse(was.min, is.min, tolerance, 0)) notes += " SLOWER";
+    if (was.heap >= 0 && is.heap >= 0 && worse(was.heap, is.heap, tolerance, 16)) notes += " HEAP";
+    if (was.stack >= 0 && is.stack >= 0 && worse(was.stack, is.stack, tolerance, 16)) notes += " STACK";
+    if (!notes.empty()) regressions++;
+
+    double change = was.min > 0 ? (is.min / was.min - 1) * 100 : 0;
+    fprintf(out, "%-22s %12.1f %12.1f %+7.1f%% %s\n", entry.first.c_str(), was.min, is.min, change,
+            notes.c_str());
+  }
+  for (const auto& entry : base) {
+    if (!now.count(entry.first)) fprintf(out, "%-22s %12.1f %12s %8s  gone\n", entry.first.c_str(), entry.second.min, "-", "");
+  }
+  fprintf(out, "%d regression%s beyond %.0f%%\n", regressions, regressions == 1 ? "" : "s", tolerance);
+  return regressions ? 1 : 0;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: core_bench [--runs N] [--filter TEXT] [--baseline FILE] [--tolerance PCT]\n"
+          "       core_bench --compare BASE NEW [--tolerance PCT]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint8_t runs = 11;
+  const char* filter = "";
+  const char* baseline = nullptr;
+  const char* compareWith[2] = { nullptr, nullptr };
+  double tolerance = 10;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--runs" && hasValue) runs = (uint8_t)atoi(argv[++i]);
+    else if (arg == "--filter" && hasValue) filter = argv[++i];
+    else if (arg == "--baseline" && hasValue) baseline = argv[++i];
+    else if (arg == "--tolerance" && hasValue) tolerance = atof(argv[++i]);
+    else if (arg == "--compare" && i + 2 < argc) {
+      compareWith[0] = argv[++i];
+      compareWith[1] = argv[++i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (runs < 1) runs = 1;
+  if (runs > MAX_RUNS) runs = MAX_RUNS;
+
+  if (compareWith[0]) {
+    Results base, now;
+    if (!load(compareWith[0], base) || !load(compareWith[1], now)) return 2;
+    return compare(base, now, tolerance, stdout);
+  }
+
+  Results base;
+  if (baseline && !load(baseline, base)) return 2;
+  for (auto it = base.begin(); it != base.end();) {
+    if (strstr(it->first.c_str(), filter)) ++it;
+    else it = base.erase(it);
+  }
+
+  // Log records still get formatted, as on a device without the log task, but go nowhere
+  nativeSetSerialOutput(nullptr);
+
+  const BenchCase* cases[256];
+  uint32_t iterations[256];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < BENCH_CASE_COUNT; ++i) {
+    if (!strstr(BENCH_CASES[i].name, filter)) continue;
+    cases[count] = &BENCH_CASES[i];
+    iterations[count] = calibrate(BENCH_CASES[i]);
+    count++;
+  }
+
+  static double perOp[256][MAX_RUNS];
+  for (uint8_t r = 0; r < runs; ++r) {
+    for (uint8_t i = 0; i < count; ++i) perOp[i][r] = timedRun(*cases[i], iterations[i]);
+  }
+
+  Results now;
+  printf("%s\n", BENCH_HEADER);
+  for (uint8_t i = 0; i < count; ++i) {
+    BenchResult result = { cases[i]->name, runs, iterations[i], "ns", 0, 0, -1, -1 };
+    result.median = benchMedian(perOp[i], runs);
+    result.min = perOp[i][0];
+    char line[160];
+    benchFormat(result, line, sizeof(line));
+    printf("%s\n", line);
+    now[result.name] = Row{ result.unit, result.min, result.heap, result.stack };
+  }
+
+  return baseline ? compare(base, now, tolerance, stderr) : 0;
+}
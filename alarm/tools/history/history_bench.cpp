@@ -0,0 +1,285 @@
+// Host benchmark and self-check for the sensor history (src/core/SensorHistory.*,
+// src/core/SeriesBlock.*).
+//
+//   g++ -std=c++11 -O2 -Isrc -o history_bench tools/history/history_bench.cpp src/core/SensorHistory.cpp src/core/SeriesBlock.cpp src/core/TelemetryEncoder.cpp
+//   ./history_bench [days]             (default: 400)
+//
+// Feeds `days` of one-per-minute DHT20-like samples through SensorHistory on
+// a RAM-backed BlockStorage, flushing every 15 minutes like the firmware,
+// and reports:
+//   append   - time per sample (encoding, rollups, block writes)
+//   per tier - points kept, bytes per point (whole blocks, headers included)
+//              and how far back the ring reaches
+//   queries  - time and storage reads for typical UI/serial ranges
+// Two signals are run: "indoor" (slow daily swing, sensor noise) and
+// "noisy" (large random steps every sample), a worst case for compression.
+//
+// Checks, failing the run on any mismatch:
+// - the raw tier returns the last day's samples exactly
+// - 5-minute and hourly rollups match mean/min/max computed from the samples
+// - a restart (flush, new SensorHistory on the same storage) mid-hour
+//   loses nothing and leaves the rollups of that hour intact
+// - a restart without flush (power loss) keeps every tier in time order
+
+#include <core/SensorHistory.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+const uint32_t START = 1700000000UL;  // 2023-11-14, a whole hour
+const uint32_t SAMPLE_SEC = 60;
+const uint32_t FLUSH_SEC = 15 * 60;
+const uint32_t DAY = 24 * 3600;
+
+bool gOk = true;
+
+class RamStorage : public BlockStorage {
+  public:
+    uint32_t headerReads = 0, blockReads = 0, writes = 0;
+
+    bool open(uint8_t area, uint16_t blocks, uint16_t blockSize) override {
+      if (area >= _areas.size()) _areas.resize(area + 1);
+      size_t size = (size_t)blocks * blockSize;
+      if (_areas[area].size() != size) _areas[area].assign(size, 0);
+      _blockSize = blockSize;
+      return true;
+    }
+    bool read(uint8_t area, uint16_t block, uint8_t* buf, uint16_t len) override {
+      if (len < _blockSize) headerReads++;
+      else blockReads++;
+      memcpy(buf, &_areas[area][(size_t)block * _blockSize], len);
+      return true;
+    }
+    bool write(uint8_t area, uint16_t block, const uint8_t* buf) override {
+      writes++;
+      memcpy(&_areas[area][(size_t)block * _blockSize], buf, _blockSize);
+      return true;
+    }
+    void resetCounters() { headerReads = blockReads = writes = 0; }
+
+    uint16_t usedBlocks(uint8_t area) const {
+      uint16_t used = 0;
+      for (size_t i = 0; i < _areas[area].size(); i += _blockSize) {
+        if (_areas[area][i] | _areas[area][i + 1] | _areas[area][i + 2] | _areas[area][i + 3]) used++;
+      }
+      return used;
+    }
+
+  private:
+    std::vector<std::vector<uint8_t>> _areas;
+    uint16_t _blockSize = 0;
+};
+
+struct Sample {
+  uint32_t ts;
+  int16_t  t;
+  uint16_t h;
+};
+
+// Sample timestamps come from time(nullptr) when the reading lands; allow a second of jitter
+std::vector<Sample> generate(uint32_t days, bool noisy) {
+  std::vector<Sample> out;
+  srand(7);
+  double drift = 0;
+  for (uint32_t i = 0; i < days * DAY / SAMPLE_SEC; ++i) {
+    uint32_t ts = START + i * SAMPLE_SEC + (rand() % 10 == 0 ? 1 : 0);
+    double day = 2 * M_PI * (i * SAMPLE_SEC % DAY) / DAY;
+    double year = 2 * M_PI * i * SAMPLE_SEC / (365.0 * DAY);
+    double t, h;
+    if (noisy) {
+      t = 2000 + (rand() % 2001) - 1000;
+      h = 4000 + (rand() % 4001) - 2000;
+    } else {
+      drift += (rand() % 3) - 1;
+      if (drift > 30 || drift < -30) drift *= 0.9;
+      t = 2100 + 150 * sin(day) + 300 * sin(year) + drift + (rand() % 5) - 2;
+      h = 4200 - 400 * sin(day) + 800 * cos(year) - 2 * drift + (rand() % 7) - 3;
+    }
+    out.push_back(Sample{ ts, (int16_t)lround(t), (uint16_t)lround(h) });
+  }
+  return out;
+}
+
+struct Collector {
+  std::vector<HistoryPoint> points;
+};
+
+bool collect(void* context, const HistoryPoint& point) {
+  static_cast<Collector*>(context)->points.push_back(point);
+  return true;
+}
+
+bool countOnly(void* context, const HistoryPoint&) {
+  ++*static_cast<uint32_t*>(context);
+  return true;
+}
+
+void fail(const char* what, uint32_t ts) {
+  if (gOk) printf("FAIL: %s at %u\n", what, ts);
+  gOk = false;
+}
+
+int16_t roundedMean(int64_t sum, int64_t n) {
+  return (int16_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+}
+
+// Compare a rollup tier with mean/min/max recomputed from the samples
+void checkRollups(SensorHistory& history, SensorHistory::Tier tier, const std::vector<Sample>& samples,
+                  uint32_t from, uint32_t to) {
+  uint32_t size = SensorHistory::TIERS[tier].bucketSec;
+  Collector c;
+  history.query(tier, from, to, collect, &c);
+  if (c.points.empty()) fail("no rollups", from);
+
+  size_t i = 0;
+  for (const HistoryPoint& p : c.points) {
+    while (i < samples.size() && samples[i].ts < p.timestamp) i++;
+    int64_t tSum = 0, hSum = 0, n = 0;
+    int16_t tMin = 32767, tMax = -32768;
+    uint16_t hMin = 65535, hMax = 0;
+    for (size_t j = i; j < samples.size() && samples[j].ts < p.timestamp + size; ++j, ++n) {
+      tSum += samples[j].t;
+      hSum += samples[j].h;
+      if (samples[j].t < tMin) tMin = samples[j].t;
+      if (samples[j].t > tMax) tMax = samples[j].t;
+      if (samples[j].h < hMin) hMin = samples[j].h;
+      if (samples[j].h > hMax) hMax = samples[j].h;
+    }
+    if (n == 0 || p.temperatureCenti != roundedMean(tSum, n) ||
+        p.humidityCenti != (uint16_t)roundedMean(hSum, n) ||
+        p.temperatureMin != tMin || p.temperatureMax != tMax ||
+        p.humidityMin != hMin || p.humidityMax != hMax) {
+      fail(tier == SensorHistory::Hourly ? "hourly rollup" : "5-minute rollup", p.timestamp);
+    }
+  }
+}
+
+void checkOrdered(SensorHistory& history, const char* what) {
+  for (uint8_t t = 0; t < SensorHistory::TIER_COUNT; ++t) {
+    Collector c;
+    history.query((SensorHistory::Tier)t, 0, 0xFFFFFFFF, collect, &c);
+    for (size_t i = 1; i < c.points.size(); ++i) {
+      if (c.points[i].timestamp <= c.points[i - 1].timestamp) fail(what, c.points[i].timestamp);
+    }
+  }
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void run(const char* name, uint32_t days, bool noisy) {
+  std::vector<Sample> samples = generate(days, noisy);
+  RamStorage storage;
+  SensorHistory* history = new SensorHistory(storage);
+  history->begin();
+
+  // Restart once, mid-hour, about halfway through
+  size_t restartAt = samples.size() / 2 + 37;
+  uint32_t nextFlush = START + FLUSH_SEC;
+  double appendMs = 0;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    if (i == restartAt) {
+      history->flush();
+      delete history;
+      history = new SensorHistory(storage);
+      history->begin();
+    }
+    SensorRecord record = { samples[i].ts, samples[i].t, samples[i].h };
+    auto t0 = std::chrono::steady_clock::now();
+    if (!history->append(record)) fail("append", record.timestamp);
+    if (record.timestamp >= nextFlush) {
+      history->flush();
+      nextFlush += FLUSH_SEC;
+    }
+    appendMs += msSince(t0);
+  }
+
+  uint32_t now = samples.back().ts;
+  history->flush();
+  printf("%s: %u days, %zu samples every %u s, flush every %u min\n",
+         name, days, samples.size(), SAMPLE_SEC, FLUSH_SEC / 60);
+  printf("  append %.0f ns/sample, %.1f block writes/day\n",
+         appendMs * 1e6 / samples.size(), (double)history->stats().blockWrites / days);
+
+  printf("  %-8s %8s %9s %8s %13s %12s\n", "tier", "points", "blocks", "B/point", "reaches back", "sized for");
+  const char* names[] = { "raw", "5 min", "hourly" };
+  for (uint8_t t = 0; t < SensorHistory::TIER_COUNT; ++t) {
+    SensorHistory::Tier tier = (SensorHistory::Tier)t;
+    uint32_t points = 0;
+    history->query(tier, 0, 0xFFFFFFFF, countOnly, &points);
+    const SensorHistory::TierSpec& spec = SensorHistory::TIERS[t];
+    uint32_t span = history->newest(tier) - history->oldest(tier);
+    uint16_t used = storage.usedBlocks(t);
+    printf("  %-8s %8u %4u/%-4u %8.2f %11.1f d %10.1f d\n", names[t], points, used, spec.blocks,
+           points ? (double)used * SERIES_BLOCK_SIZE / points : 0.0,
+           span / 86400.0, spec.retentionSec / 86400.0);
+  }
+
+  // Typical ranges: UI sparkline (last hour/day), serial dumps (week, year)
+  struct Range { const char* name; SensorHistory::Tier tier; uint32_t seconds; };
+  const Range ranges[] = {
+    { "last hour, raw", SensorHistory::Raw, 3600 },
+    { "last day, raw", SensorHistory::Raw, DAY },
+    { "last week, 5 min", SensorHistory::FiveMinute, 7 * DAY },
+    { "last year, hourly", SensorHistory::Hourly, 365 * DAY },
+  };
+  printf("  %-18s %7s %10s %13s %12s\n", "query", "points", "us", "header reads", "block reads");
+  for (const Range& r : ranges) {
+    uint32_t points = 0;
+    storage.resetCounters();
+    const int reps = 20;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < reps; ++k) {
+      points = 0;
+      history->query(r.tier, now - r.seconds, now, countOnly, &points);
+    }
+    double us = msSince(t0) * 1000 / reps;
+    printf("  %-18s %7u %10.1f %13u %12u\n", r.name, points, us,
+           storage.headerReads / reps, storage.blockReads / reps);
+  }
+
+  // Raw tier: the last day, exactly
+  Collector raw;
+  history->query(SensorHistory::Raw, now - DAY + 1, now, collect, &raw);
+  size_t first = samples.size() - raw.points.size();
+  if (raw.points.size() < DAY / SAMPLE_SEC - 1) fail("raw tier short", now);
+  for (size_t i = 0; i < raw.points.size(); ++i) {
+    const Sample& s = samples[first + i];
+    const HistoryPoint& p = raw.points[i];
+    if (p.timestamp != s.ts || p.temperatureCenti != s.t || p.humidityCenti != s.h) fail("raw sample", s.ts);
+  }
+
+  // Rollups over the retained range, including the restart hour
+  checkRollups(*history, SensorHistory::FiveMinute, samples, now - 7 * DAY, now);
+  checkRollups(*history, SensorHistory::Hourly, samples, START, now);
+  uint32_t restartHour = samples[restartAt].ts - samples[restartAt].ts % 3600;
+  Collector around;
+  history->query(SensorHistory::Hourly, restartHour, restartHour, collect, &around);
+  if (around.points.size() != 1) fail("restart hour missing", restartHour);
+
+  // Power loss: reopen from storage as it is, without the final flush
+  SensorHistory reopened(storage);
+  reopened.begin();
+  checkOrdered(reopened, "order after power loss");
+  if (reopened.newest(SensorHistory::Raw) > now) fail("newer than written", now);
+
+  delete history;
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t days = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 400;
+  if (days < 8) days = 8;
+  run("indoor", days, false);
+  run("noisy", days, true);
+  printf(gOk ? "selftest passed\n" : "selftest FAILED\n");
+  return gOk ? 0 : 1;
+}
@@ -0,0 +1,651 @@
+// Fleet load generator for the alarm backend.
+//
+// Simulates N alarm clocks against one server. Every virtual device runs the
+// firmware's schedule (alarm poll every 60 s, sensor upload every 5 min,
+// one metrics upload per solved alarm) with its own random phase, and sends
+// the bytes the firmware sends:
+//   - request heads come from httpRequestHead(), the native HTTPClient's copy
+//     of the ESP32 library's format (GET /api/alarm uses HTTP/1.0, like
+//     WifiModule::httpGetStream());
+//   - bodies are encoded by the firmware's TelemetryEncoder, CBOR first with
+//     the per-device JSON fallback on 415, like TelemetryEndpoint;
+//   - alarm responses are parsed and applied by a real AlarmConfig and
+//     AlarmScheduler per device, so malformed or oversized schedules show up
+//     as rejections.
+// A device has at most one request in flight, as the blocking firmware does;
+// requests that come due while it is busy wait for it. All devices share one
+// epoll loop with non-blocking sockets, one TCP connection per request.
+//
+// Build (from alarm/, ArduinoJson 6 from the PlatformIO library cache):
+//   g++ -std=gnu++11 -O2 -DWIFIMODULE_TLS=0 -Itools/native -Isrc -I.pio/libdeps/ttgo-lora32-v1/ArduinoJson/src -o fleet_loadgen tools/loadgen/fleet_loadgen.cpp tools/native/*.cpp src/core/AlarmConfig.cpp src/core/AlarmScheduler.cpp src/core/TelemetryEncoder.cpp src/core/GzipWriter.cpp src/hal/WifiModule.cpp src/core/Log.cpp src/core/LogFormat.cpp src/core/CircuitBreaker.cpp src/core/Energy.cpp -lpthread
+//
+//   ./fleet_loadgen --server 127.0.0.1:5000 --devices 5000 --duration 60 [--speedup 10]
+//                   [--max-inflight 2000] [--timeout-ms 5000] [--json] [--verbose]
+//
+// --speedup divides every period, so 5000 devices at --speedup 10 offer the
+// load of 50000 real ones. The report lists throughput, status codes and
+// latency percentiles per endpoint; "lag" is how long requests waited for a
+// free slot (device busy or --max-inflight reached) and should stay near
+// zero, otherwise the generator rather than the server is the bottleneck.
+
+#include <core/AlarmConfig.h>
+#include <core/AlarmScheduler.h>
+#include <core/TelemetryEncoder.h>
+#include <hal/WifiModule.h>
+#include <HTTPClient.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+// AlarmConfig.cpp refers to the firmware's global; the load generator does its own I/O
+WifiModule wifi("loadgen", "");
+
+namespace {
+
+enum Kind { ALARM, SENSOR, METRICS, KIND_COUNT };
+const char* const KIND_NAME[KIND_COUNT] = { "alarm", "sensor", "metrics" };
+const char* const KIND_PATH[KIND_COUNT] = { "/api/alarm", "/api/sensor", "/api/metrics" };
+
+struct Options {
+  std::string host = "127.0.0.1";
+  uint16_t    port = 5000;
+  uint32_t    devices = 1000;
+  double      duration = 30;       // s
+  double      speedup = 1;
+  uint32_t    maxInflight = 2000;
+  uint32_t    timeoutMs = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+  double      period[KIND_COUNT] = { 60, 300, 86400 };  // s, firmware defaults; metrics = one alarm per day
+  bool        json = false;
+  bool        verbose = false;
+};
+
+uint64_t nowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// xorshift32: cheap per-device randomness that does not disturb rand()
+uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+double uniform(uint32_t& state) {
+  return (nextRandom(state) & 0xFFFFFF) / double(0x1000000);
+}
+
+// Read-only Stream over a received body, handed to AlarmConfig::onResponse()
+class BufferStream : public Stream {
+  public:
+    BufferStream(const char* data, size_t len) : _data(data), _len(len), _pos(0) { setTimeout(0); }
+    int available() override { return (int)(_len - _pos); }
+    int read() override { return _pos < _len ? (uint8_t)_data[_pos++] : -1; }
+    int peek() override { return _pos < _len ? (uint8_t)_data[_pos] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+  private:
+    const char* _data;
+    size_t      _len;
+    size_t      _pos;
+};
+
+struct Device {
+  AlarmScheduler scheduler;
+  AlarmConfig    config;
+  uint32_t       rng;
+  bool           binary;       // CBOR until the server answers 415
+  bool           busy;         // a request is in flight
+  uint64_t       pendingSince[KIND_COUNT];  // due while busy; 0 = nothing pending
+  float          temperature;
+  float          humidity;
+
+  Device(const Options& opt, uint32_t seed)
+    : config(scheduler, opt.host.c_str(), opt.port, KIND_PATH[ALARM])
+    , rng(seed ? seed : 1)
+    , binary(!opt.json)
+    , busy(false)
+    , temperature(19 + 4 * uniform(rng))
+    , humidity(35 + 15 * uniform(rng))
+  {
+    for (int k = 0; k < KIND_COUNT; ++k) pendingSince[k] = 0;
+  }
+};
+
+struct Request {
+  int         fd;
+  uint32_t    device;
+  Kind        kind;
+  bool        binary;
+  std::string out;
+  size_t      sent;
+  std::string in;
+  uint64_t    startUs;
+  uint64_t    deadlineUs;
+};
+
+struct KindStats {
+  uint64_t started = 0;
+  uint64_t ok = 0;            // 2xx
+  uint64_t httpErrors = 0;    // any other status
+  uint64_t connectErrors = 0;
+  uint64_t ioErrors = 0;      // reset or closed before a complete response
+  uint64_t timeouts = 0;
+  uint64_t bytesOut = 0;
+  uint64_t bytesIn = 0;
+  uint64_t rejected = 0;      // alarm: 200 but AlarmConfig refused the body
+  uint64_t fallbacks = 0;     // telemetry: 415 switched a device to JSON
+  std::map<int, uint64_t> statuses;
+  std::vector<uint32_t>   latencyUs;
+  std::vector<uint32_t>   lagUs;
+};
+
+struct Due {
+  uint64_t at;
+  uint32_t device;
+  Kind     kind;
+  bool operator>(const Due& o) const { return at > o.at; }
+};
+
+struct ResponseHead {
+  int    status = 0;
+  long   contentLength = -1;
+  bool   chunked = false;
+  size_t bodyStart = 0;
+};
+
+bool parseHead(const std::string& in, ResponseHead& head) {
+  size_t end = in.find("\r\n\r\n");
+  if (end == std::string::npos) return false;
+  head.bodyStart = end + 4;
+  size_t sp = in.find(' ');
+  head.status = sp < end ? atoi(in.c_str() + sp + 1) : 0;
+
+  size_t line = in.find("\r\n") + 2;
+  while (line < end) {
+    size_t eol = in.find("\r\n", line);
+    size_t colon = in.find(':', line);
+    if (colon < eol) {
+      std::string name = in.substr(line, colon - line);
+      const char* value = in.c_str() + colon + 1;
+      while (*value == ' ') value++;
+      if (!strcasecmp(name.c_str(), "Content-Length")) head.contentLength = atol(value);
+      if (!strcasecmp(name.c_str(), "Transfer-Encoding") && !strncasecmp(value, "chunked", 7)) head.chunked = true;
+    }
+    line = eol + 2;
+  }
+  return true;
+}
+
+// Decode a chunked body starting at `from`; returns true once the last chunk has arrived.
+bool dechunk(const std::string& in, size_t from, std::string& body) {
+  body.clear();
+  size_t pos = from;
+  while (true) {
+    size_t eol = in.find("\r\n", pos);
+    if (eol == std::string::npos) return false;
+    long len = strtol(in.c_str() + pos, nullptr, 16);
+    if (len == 0) return in.find("\r\n", eol + 2) != std::string::npos;  // end of (empty) trailers
+    if (in.size() < eol + 2 + len + 2) return false;
+    body.append(in, eol + 2, len);
+    pos = eol + 2 + len + 2;
+  }
+}
+
+class LoadGenerator {
+  public:
+    explicit LoadGenerator(const Options& opt) : _opt(opt), _epoll(epoll_create1(0)), _inflight(0) {}
+
+    bool run() {
+      if (!_resolve()) return false;
+
+      for (uint32_t i = 0; i < _opt.devices; ++i) {
+        _devices.emplace_back(new Device(_opt, 0x9E3779B9u * (i + 1)));
+      }
+
+      // Spread each device's first request of every kind over one period
+      uint64_t start = nowUs();
+      for (uint32_t i = 0; i < _opt.devices; ++i) {
+        for (int k = 0; k < KIND_COUNT; ++k) {
+          _due.push(Due{ start + (uint64_t)(uniform(_devices[i]->rng) * _periodUs((Kind)k)), i, (Kind)k });
+        }
+      }
+
+      _startUs = start;
+      uint64_t stopUs = start + (uint64_t)(_opt.duration * 1e6);
+      uint64_t nextReport = start + 1000000;
+      uint64_t lastDone = 0;
+      std::vector<epoll_event> events(1024);
+
+      while (true) {
+        uint64_t now = nowUs();
+        bool scheduling = now < stopUs;
+        if (!scheduling && _inflight == 0) break;
+
+        if (scheduling) _fireDue(now);
+        _startWaiting(now);
+        _expire(now);
+
+        if (now >= nextReport) {
+          uint64_t done = _completed();
+          printf("t=%5.1fs inflight=%-5u waiting=%-5zu done=%-8llu (%llu/s)\n",
+                 (now - start) / 1e6, _inflight, _waiting.size(),
+                 (unsigned long long)done, (unsigned long long)(done - lastDone));
+          fflush(stdout);
+          lastDone = done;
+          nextReport += 1000000;
+        }
+
+        int timeoutMs = 10;
+        if (scheduling && !_due.empty() && _due.top().at > now) {
+          timeoutMs = (int)std::min<uint64_t>(10, (_due.top().at - now) / 1000);
+        }
+        int n = epoll_wait(_epoll, events.data(), (int)events.size(), timeoutMs);
+        for (int i = 0; i < n; ++i) _onEvent(events[i].data.fd, events[i].events);
+
+        // Drain the ConfigUpdate events AlarmConfig posts; nobody subscribes here
+        AppBus::dispatch();
+      }
+
+      _endUs = nowUs();
+      _report();
+      return true;
+    }
+
+  private:
+    const Options&                        _opt;
+    int                                   _epoll;
+    uint32_t                              _inflight;
+    sockaddr_storage                      _addr;
+    socklen_t                             _addrLen;
+    std::vector<std::unique_ptr<Device> > _devices;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due> > _due;
+    std::deque<Due>                       _waiting;   // due, but over --max-inflight
+    std::vector<std::unique_ptr<Request> > _requests;  // indexed by fd
+    KindStats                             _stats[KIND_COUNT];
+    uint64_t                              _startUs;
+    uint64_t                              _endUs;
+    uint64_t                              _nextExpire = 0;
+    CborEncoder                           _cbor;
+    JsonEncoder                           _json;
+
+    uint64_t _periodUs(Kind kind) const {
+      return (uint64_t)(_opt.period[kind] * 1e6 / _opt.speedup);
+    }
+
+    bool _resolve() {
+      struct addrinfo hints = {};
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      struct addrinfo* res = nullptr;
+      std::string port = std::to_string(_opt.port);
+      if (getaddrinfo(_opt.host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+        fprintf(stderr, "cannot resolve %s\n", _opt.host.c_str());
+        return false;
+      }
+      memcpy(&_addr, res->ai_addr, res->ai_addrlen);
+      _addrLen = res->ai_addrlen;
+      freeaddrinfo(res);
+      return true;
+    }
+
+    uint64_t _completed() const {
+      uint64_t n = 0;
+      for (int k = 0; k < KIND_COUNT; ++k) {
+        const KindStats& s = _stats[k];
+        n += s.ok + s.httpErrors + s.connectErrors + s.ioErrors + s.timeouts;
+      }
+      return n;
+    }
+
+    void _fireDue(uint64_t now) {
+      while (!_due.empty() && _due.top().at <= now) {
+        Due d = _due.top();
+        _due.pop();
+
+        // Next occurrence, with up to a second of jitter like the firmware's delay(1000) loop
+        Device& dev = *_devices[d.device];
+        uint64_t jitter = (uint64_t)(uniform(dev.rng) * 1e6 / _opt.speedup);
+        _due.push(Due{ d.at + _periodUs(d.kind) + jitter, d.device, d.kind });
+
+        if (dev.busy) {
+          if (!dev.pendingSince[d.kind]) dev.pendingSince[d.kind] = d.at;
+        } else {
+          _waiting.push_back(d);
+          dev.busy = true;
+        }
+      }
+    }
+
+    void _startWaiting(uint64_t now) {
+      while (!_waiting.empty() && _inflight < _opt.maxInflight) {
+        Due d = _waiting.front();
+        _waiting.pop_front();
+        _stats[d.kind].lagUs.push_back((uint32_t)std::min<uint64_t>(now - d.at, UINT32_MAX));
+        _start(d.device, d.kind, now);
+      }
+    }
+
+    // After a device's request finished, start whatever came due meanwhile (oldest first)
+    void _next(uint32_t device) {
+      Device& dev = *_devices[device];
+      dev.busy = false;
+      int pick = -1;
+      for (int k = 0; k < KIND_COUNT; ++k) {
+        if (dev.pendingSince[k] && (pick < 0 || dev.pendingSince[k] < dev.pendingSince[pick])) pick = k;
+      }
+      if (pick < 0 || nowUs() >= _startUs + (uint64_t)(_opt.duration * 1e6)) return;
+      _waiting.push_back(Due{ dev.pendingSince[pick], device, (Kind)pick });
+      dev.pendingSince[pick] = 0;
+      dev.busy = true;
+    }
+
+    std::string _buildRequest(Device& dev, Kind kind) {
+      std::string host = _opt.host;
+      if (kind == ALARM) {
+        return httpRequestHead("GET", host.c_str(), _opt.port, KIND_PATH[kind], true, true, "");
+      }
+
+      const TelemetryEncoder& enc = dev.binary ? (const TelemetryEncoder&)_cbor : (const TelemetryEncoder&)_json;
+      uint8_t body[TELEMETRY_MAX_RECORD];
+      size_t len;
+      uint32_t ts = (uint32_t)time(nullptr);
+      if (kind == SENSOR) {
+        dev.temperature += (float)(uniform(dev.rng) - 0.5) * 0.2f;
+        dev.humidity += (float)(uniform(dev.rng) - 0.5) * 0.5f;
+        SensorRecord record = { ts, toCenti(dev.temperature), toCentiUnsigned(dev.humidity) };
+        len = enc.encode(record, body, sizeof(body));
+      } else {
+        MetricsRecord record = { ts, (uint8_t)(1 + nextRandom(dev.rng) % 3),
+                                 1500 + nextRandom(dev.rng) % 13500 };
+        len = enc.encode(record, body, sizeof(body));
+      }
+
+      // Header order matches HTTPClient: Content-Type from addHeader(), then Content-Length
+      std::string headers = std::string("Content-Type: ") + enc.contentType() + "\r\n" +
+                            "Content-Length: " + std::to_string(len) + "\r\n";
+      std::string out = httpRequestHead("POST", host.c_str(), _opt.port, KIND_PATH[kind], false, true, headers);
+      out.append((const char*)body, len);
+      return out;
+    }
+
+    void _start(uint32_t device, Kind kind, uint64_t now) {
+      Device& dev = *_devices[device];
+      KindStats& s = _stats[kind];
+      s.started++;
+
+      int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      if (fd < 0) {
+        s.connectErrors++;
+        _next(device);
+        return;
+      }
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      if (connect(fd, (sockaddr*)&_addr, _addrLen) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        s.connectErrors++;
+        _next(device);
+        return;
+      }
+
+      std::unique_ptr<Request> req(new Request());
+      req->fd = fd;
+      req->device = device;
+      req->kind = kind;
+      req->binary = dev.binary;
+      req->out = _buildRequest(dev, kind);
+      req->sent = 0;
+      req->startUs = now;
+      req->deadlineUs = now + (uint64_t)_opt.timeoutMs * 1000;
+
+      epoll_event ev = {};
+      ev.events = EPOLLOUT | EPOLLIN | EPOLLRDHUP;
+      ev.data.fd = fd;
+      epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+
+      if ((size_t)fd >= _requests.size()) _requests.resize(fd + 1);
+      _requests[fd] = std::move(req);
+      _inflight++;
+    }
+
+    // With `retry` the device re-sends the same kind right away instead of moving on
+    void _finish(Request& req, int outcome, bool retry = false) {
+      KindStats& s = _stats[req.kind];
+      uint64_t now = nowUs();
+      switch (outcome) {
+        case 0:  s.latencyUs.push_back((uint32_t)std::min<uint64_t>(now - req.startUs, UINT32_MAX)); break;
+        case HTTPC_ERROR_CONNECTION_REFUSED: s.connectErrors++; break;
+        case HTTPC_ERROR_READ_TIMEOUT:       s.timeouts++; break;
+        default:                             s.ioErrors++; break;
+      }
+      s.bytesOut += req.sent;
+      s.bytesIn += req.in.size();
+
+      uint32_t device = req.device;
+      Kind kind = req.kind;
+      int fd = req.fd;
+      epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+      close(fd);
+      _requests[fd].reset();
+      _inflight--;
+      if (retry) _waiting.push_front(Due{ now, device, kind });
+      else _next(device);
+    }
+
+    // Classify a complete response, feed alarm bodies to the device's AlarmConfig
+    void _complete(Request& req, const ResponseHead& head, const char* body, size_t bodyLen) {
+      KindStats& s = _stats[req.kind];
+      Device& dev = *_devices[req.device];
+      s.statuses[head.status]++;
+      if (head.status >= 200 && head.status < 300) s.ok++;
+      else s.httpErrors++;
+
+      if (req.kind == ALARM && head.status == 200) {
+        BufferStream stream(body, bodyLen);
+        ResponseHandler& handler = dev.config;
+        if (!handler.onResponse(head.status, stream, (int)head.contentLength)) s.rejected++;
+      }
+      // Like TelemetryEndpoint: fall back to JSON and retry once
+      bool retry = req.kind != ALARM && head.status == HTTP_CODE_UNSUPPORTED_MEDIA_TYPE && req.binary;
+      if (retry) {
+        dev.binary = false;
+        s.fallbacks++;
+      }
+      _finish(req, 0, retry);
+    }
+
+    // Returns true once the request is finished (completed or failed)
+    bool _tryComplete(Request& req, bool eof) {
+      ResponseHead head;
+      if (!parseHead(req.in, head)) {
+        if (eof) _finish(req, HTTPC_ERROR_CONNECTION_LOST);
+        return eof;
+      }
+      if (head.chunked) {
+        std::string body;
+        if (dechunk(req.in, head.bodyStart, body)) {
+          _complete(req, head, body.data(), body.size());
+          return true;
+        }
+      } else if (head.contentLength >= 0) {
+        if (req.in.size() >= head.bodyStart + (size_t)head.contentLength) {
+          _complete(req, head, req.in.data() + head.bodyStart, (size_t)head.contentLength);
+          return true;
+        }
+      } else if (eof) {
+        // No length: the body ends with the connection
+        _complete(req, head, req.in.data() + head.bodyStart, req.in.size() - head.bodyStart);
+        return true;
+      }
+      if (eof) _finish(req, HTTPC_ERROR_CONNECTION_LOST);
+      return eof;
+    }
+
+    void _onEvent(int fd, uint32_t events) {
+      if ((size_t)fd >= _requests.size() || !_requests[fd]) return;
+      Request& req = *_requests[fd];
+
+      if (req.sent < req.out.size() && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        ssize_t n = send(fd, req.out.data() + req.sent, req.out.size() - req.sent, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN) {
+          // Nothing got through: the connect itself failed
+          _finish(req, req.sent == 0 ? HTTPC_ERROR_CONNECTION_REFUSED : HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+          return;
+        }
+        if (n > 0) req.sent += n;
+        if (req.sent == req.out.size()) {
+          epoll_event ev = {};
+          ev.events = EPOLLIN | EPOLLRDHUP;
+          ev.data.fd = fd;
+          epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &ev);
+        }
+      }
+
+      if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        char buf[4096];
+        while (true) {
+          ssize_t n = recv(fd, buf, sizeof(buf), 0);
+          if (n > 0) {
+            req.in.append(buf, n);
+            continue;
+          }
+          if (n < 0 && errno == EAGAIN) {
+            _tryComplete(req, false);
+            return;
+          }
+          if (n < 0 && req.sent == 0) {
+            _finish(req, HTTPC_ERROR_CONNECTION_REFUSED);
+            return;
+          }
+          _tryComplete(req, true);
+          return;
+        }
+      }
+    }
+
+    void _expire(uint64_t now) {
+      if (now < _nextExpire) return;
+      _nextExpire = now + 50000;
+      for (size_t fd = 0; fd < _requests.size(); ++fd) {
+        if (_requests[fd] && now >= _requests[fd]->deadlineUs) _finish(*_requests[fd], HTTPC_ERROR_READ_TIMEOUT);
+      }
+    }
+
+    static double percentile(const std::vector<uint32_t>& sorted, double p) {
+      if (sorted.empty()) return 0;
+      size_t i = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+      return sorted[i] / 1000.0;
+    }
+
+    void _report() {
+      double secs = (_endUs - _startUs) / 1e6;
+      double offered = 0;
+      for (int k = 0; k < KIND_COUNT; ++k) offered += _opt.devices / (_opt.period[k] / _opt.speedup);
+
+      printf("\n%u devices, %.1f s, speedup %.0fx, offered %.1f req/s, %s bodies\n\n",
+             _opt.devices, secs, _opt.speedup, offered, _opt.json ? "JSON" : "CBOR");
+      printf("%-8s %8s %9s %7s %7s %7s %7s %8s %8s %8s %8s %8s %9s\n",
+             "endpoint", "requests", "req/s", "2xx", "non2xx", "conn", "io", "timeout",
+             "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+
+      for (int k = 0; k < KIND_COUNT; ++k) {
+        KindStats& s = _stats[k];
+        std::sort(s.latencyUs.begin(), s.latencyUs.end());
+        uint64_t done = s.ok + s.httpErrors + s.connectErrors + s.ioErrors + s.timeouts;
+        printf("%-8s %8llu %9.1f %7llu %7llu %7llu %7llu %8llu %8.2f %8.2f %8.2f %8.2f %9.2f\n",
+               KIND_NAME[k], (unsigned long long)done, done / secs,
+               (unsigned long long)s.ok, (unsigned long long)s.httpErrors,
+               (unsigned long long)s.connectErrors, (unsigned long long)s.ioErrors,
+               (unsigned long long)s.timeouts,
+               percentile(s.latencyUs, 50), percentile(s.latencyUs, 90),
+               percentile(s.latencyUs, 99), percentile(s.latencyUs, 99.9),
+               s.latencyUs.empty() ? 0.0 : s.latencyUs.back() / 1000.0);
+      }
+
+      printf("\n");
+      for (int k = 0; k < KIND_COUNT; ++k) {
+        KindStats& s = _stats[k];
+        std::sort(s.lagUs.begin(), s.lagUs.end());
+        printf("%-8s out %.1f KB, in %.1f KB, lag p99 %.2f ms, statuses:",
+               KIND_NAME[k], s.bytesOut / 1024.0, s.bytesIn / 1024.0, percentile(s.lagUs, 99));
+        for (std::map<int, uint64_t>::const_iterator it = s.statuses.begin(); it != s.statuses.end(); ++it) {
+          printf(" %d=%llu", it->first, (unsigned long long)it->second);
+        }
+        if (k == ALARM) printf(", schedules rejected %llu", (unsigned long long)s.rejected);
+        else printf(", JSON fallbacks %llu", (unsigned long long)s.fallbacks);
+        printf("\n");
+      }
+    }
+};
+
+void usage() {
+  fprintf(stderr,
+          "usage: fleet_loadgen [--server host:port] [--devices N] [--duration s] [--speedup x]\n"
+          "                     [--max-inflight N] [--timeout-ms ms] [--alarm-period s]\n"
+          "                     [--sensor-period s] [--metrics-period s] [--json] [--verbose]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--server" && hasValue) {
+      std::string hp = argv[++i];
+      size_t colon = hp.find(':');
+      opt.host = hp.substr(0, colon);
+      if (colon != std::string::npos) opt.port = (uint16_t)atoi(hp.c_str() + colon + 1);
+    }
+    else if (arg == "--devices" && hasValue)        opt.devices = (uint32_t)atol(argv[++i]);
+    else if (arg == "--duration" && hasValue)       opt.duration = atof(argv[++i]);
+    else if (arg == "--speedup" && hasValue)        opt.speedup = std::max(0.001, atof(argv[++i]));
+    else if (arg == "--max-inflight" && hasValue)   opt.maxInflight = (uint32_t)atol(argv[++i]);
+    else if (arg == "--timeout-ms" && hasValue)     opt.timeoutMs = (uint32_t)atol(argv[++i]);
+    else if (arg == "--alarm-period" && hasValue)   opt.period[ALARM] = atof(argv[++i]);
+    else if (arg == "--sensor-period" && hasValue)  opt.period[SENSOR] = atof(argv[++i]);
+    else if (arg == "--metrics-period" && hasValue) opt.period[METRICS] = atof(argv[++i]);
+    else if (arg == "--json")                       opt.json = true;
+    else if (arg == "--verbose")                    opt.verbose = true;
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  if (!opt.verbose) nativeSetSerialOutput(nullptr);  // thousands of AlarmConfigs would log every fetch
+
+  // One socket per in-flight request
+  struct rlimit lim;
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+    if (lim.rlim_cur < opt.maxInflight + 64) {
+      opt.maxInflight = (uint32_t)(lim.rlim_cur - 64);
+      fprintf(stderr, "file descriptor limit: --max-inflight lowered to %u\n", opt.maxInflight);
+    }
+  }
+
+  LoadGenerator gen(opt);
+  return gen.run() ? 0 : 1;
+}
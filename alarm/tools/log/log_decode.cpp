@@ -0,0 +1,274 @@
+// Host decoder for the firmware's binary log stream (src/core/Log.*, LOG_BINARY=1).
+//
+//   g++ -std=c++11 -O2 -Isrc -o log_decode tools/log/log_decode.cpp src/core/LogFormat.cpp
+//   ./log_decode [--src DIR] [capture.bin]     (stdin if no file, e.g. from the serial port)
+//   ./log_decode --selftest [iterations]
+//
+// The format table is rebuilt by scanning DIR (default: src) for
+// LOG_ERROR/WARN/INFO/DEBUG calls and hashing their format strings like the
+// firmware does at compile time. Bytes outside log frames (ROM boot
+// messages, panics) are passed through unchanged.
+//
+// --selftest encodes a set of records, decodes them again and compares the
+// result with snprintf. It also reports what a log call costs on the device
+// side (encode only) against formatting the text in place.
+
+#include <core/LogFormat.h>
+#include <chrono>
+#include <dirent.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+std::map<uint32_t, std::string> formats;
+
+// Parse one or more adjacent C string literals starting at s[i]; returns false if there is none
+bool parseLiteral(const std::string& s, size_t& i, std::string& out) {
+  bool any = false;
+  for (;;) {
+    while (i < s.size() && isspace((unsigned char)s[i])) ++i;
+    if (i >= s.size() || s[i] != '"') return any;
+    any = true;
+    for (++i; i < s.size() && s[i] != '"'; ++i) {
+      if (s[i] != '\\') {
+        out += s[i];
+        continue;
+      }
+      char c = s[++i];
+      switch (c) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case '0': out += '\0'; break;
+        case 'x': {
+          int v = 0, n = 0;
+          while (n < 2 && isxdigit((unsigned char)s[i + 1])) {
+            char h = s[++i];
+            v = v * 16 + (isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+            n++;
+          }
+          out += (char)v;
+          break;
+        }
+        default: out += c; break;
+      }
+    }
+    ++i;
+  }
+}
+
+void addFormat(const std::string& fmt, const std::string& where) {
+  uint32_t id = logHash(fmt.c_str());
+  auto it = formats.find(id);
+  if (it != formats.end() && it->second != fmt) {
+    fprintf(stderr, "warning: hash collision 0x%08x: \"%s\" and \"%s\" (%s)\n",
+            id, it->second.c_str(), fmt.c_str(), where.c_str());
+  }
+  formats[id] = fmt;
+}
+
+void scanFile(const std::string& path) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return;
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  fclose(f);
+
+  static const char* macros[] = { "LOG_ERROR(", "LOG_WARN(", "LOG_INFO(", "LOG_DEBUG(" };
+  for (const char* m : macros) {
+    size_t pos = 0;
+    while ((pos = text.find(m, pos)) != std::string::npos) {
+      pos += strlen(m);
+      size_t i = pos;
+      std::string fmt;
+      if (parseLiteral(text, i, fmt)) addFormat(fmt, path);
+    }
+  }
+}
+
+void scanDir(const std::string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  while (struct dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..") continue;
+    std::string path = dir + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) continue;
+    if (S_ISDIR(st.st_mode)) {
+      scanDir(path);
+    } else if (name.size() > 2 && (name.compare(name.size() - 2, 2, ".h") == 0 ||
+                                   (name.size() > 4 && name.compare(name.size() - 4, 4, ".cpp") == 0))) {
+      scanFile(path);
+    }
+  }
+  closedir(d);
+}
+
+uint32_t le32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Decode one record (without the sync bytes) into a text line
+std::string decodeRecord(const uint8_t* r, size_t len) {
+  uint8_t level = r[1];
+  uint32_t id = le32(r + 2);
+  uint32_t time = le32(r + 6);
+  char line[512];
+  int n = snprintf(line, sizeof(line), "[%8u] %c ", time, logLevelTag(level));
+  auto it = formats.find(id);
+  if (it != formats.end()) {
+    logFormat(line + n, sizeof(line) - n, it->second.c_str(), r + LOG_HEADER, len - LOG_HEADER);
+  } else {
+    snprintf(line + n, sizeof(line) - n, "<unknown format 0x%08x, %u argument bytes>", id,
+             (unsigned)(len - LOG_HEADER));
+  }
+  return line;
+}
+
+// Stream decoder: frames become lines, everything else passes through
+void decode(FILE* in, FILE* out) {
+  std::vector<uint8_t> buf;
+  uint8_t chunk[4096];
+  size_t n;
+  uint32_t frames = 0, bad = 0;
+  bool atLineStart = true;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0 || !buf.empty()) {
+    buf.insert(buf.end(), chunk, chunk + n);
+    size_t i = 0;
+    while (i < buf.size()) {
+      if (buf[i] == LOG_SYNC0) {
+        if (i + 3 > buf.size()) break;  // need sync + length
+        if (buf[i + 1] == LOG_SYNC1) {
+          uint8_t len = buf[i + 2];
+          if (len >= LOG_HEADER && len <= LOG_MAX_RECORD) {
+            if (i + 2 + len > buf.size()) break;
+            if (!atLineStart) fputc('\n', out);
+            fprintf(out, "%s\n", decodeRecord(&buf[i + 2], len).c_str());
+            atLineStart = true;
+            frames++;
+            i += 2 + len;
+            continue;
+          }
+          bad++;
+        }
+      }
+      fputc(buf[i], out);
+      atLineStart = buf[i] == '\n';
+      ++i;
+    }
+    buf.erase(buf.begin(), buf.begin() + i);
+    if (n == 0) {
+      // End of input: flush an incomplete tail as raw bytes
+      fwrite(buf.data(), 1, buf.size(), out);
+      break;
+    }
+  }
+  fprintf(stderr, "%u frames decoded, %u bad frame headers, %zu formats known\n",
+          frames, bad, formats.size());
+}
+
+// --- Self-test ----------------------------------------------------------------
+
+volatile size_t sink;
+
+template <typename... Args>
+bool roundTrip(std::string& stream, const char* fmt, Args... args) {
+  addFormat(fmt, "selftest");
+  uint8_t rec[LOG_MAX_RECORD];
+  size_t argLen = logEncode(rec + LOG_HEADER, LOG_MAX_ARGS, args...);
+  rec[0] = (uint8_t)(LOG_HEADER + argLen);
+  rec[1] = LOG_LEVEL_INFO;
+  uint32_t id = logHash(fmt);
+  for (int i = 0; i < 4; ++i) rec[2 + i] = (uint8_t)(id >> (8 * i));
+  for (int i = 0; i < 4; ++i) rec[6 + i] = (uint8_t)(1234 >> (8 * i));
+  stream += (char)LOG_SYNC0;
+  stream += (char)LOG_SYNC1;
+  stream.append((const char*)rec, rec[0]);
+
+  char expect[256];
+  snprintf(expect, sizeof(expect), fmt, args...);
+  std::string got = decodeRecord(rec, rec[0]).substr(13);
+  if (got != expect) {
+    fprintf(stderr, "mismatch for \"%s\":\n  expected \"%s\"\n  got      \"%s\"\n", fmt, expect, got.c_str());
+    return false;
+  }
+  return true;
+}
+
+template <typename... Args>
+void bench(const char* label, long iterations, const char* fmt, Args... args) {
+  uint8_t rec[LOG_MAX_ARGS];
+  auto t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) sink += logEncode(rec, sizeof(rec), args...);
+  double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iterations;
+  size_t bytes = logEncode(rec, sizeof(rec), args...) + LOG_HEADER;
+
+  char text[256];
+  t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) sink += snprintf(text, sizeof(text), fmt, args...);
+  double formatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iterations;
+  int textLen = snprintf(text, sizeof(text), fmt, args...);
+
+  printf("%-10s encode %6.1f ns, %3zu B | snprintf %6.1f ns, %3d B\n",
+         label, encodeNs, bytes, formatNs, textLen + 12);
+}
+
+int selftest(long iterations) {
+  std::string stream = "boot text\n";
+  bool ok = true;
+  ok &= roundTrip(stream, "plain message");
+  ok &= roundTrip(stream, "POST %s failed, code=%d", "/api/sensor", -11);
+  ok &= roundTrip(stream, "Alarm %02u:%02u (days 0x%02x)", 7u, 5u, 0x3Eu);
+  ok &= roundTrip(stream, "Temperature: %.2f C  |  Humidity: %.2f %%", 21.5, 40.25);
+  ok &= roundTrip(stream, "%-6s|%6d|%-4u|%c", "ab", -42, 17u, 'z');
+  ok &= roundTrip(stream, "big %llu neg %lld hex %llx", 1ULL << 40, -(1LL << 40), 0xDEADBEEFCAFEULL);
+  stream += "trailing text\n";
+
+  // Truncated and unknown records must not derail the stream
+  FILE* tmp = tmpfile();
+  fwrite(stream.data(), 1, stream.size(), tmp);
+  rewind(tmp);
+  decode(tmp, stdout);
+  fclose(tmp);
+
+  printf("\nper call on the device side vs formatting in place (%ld iterations):\n", iterations);
+  bench("short", iterations, "Alarm triggered!");
+  bench("ints", iterations, "Alarm %02u:%02u (days 0x%02x)", 7u, 5u, 0x3Eu);
+  bench("floats", iterations, "Temperature: %.2f C  |  Humidity: %.2f %%", 21.5, 40.25);
+  bench("string", iterations, "POST %s failed, code=%d", "/api/sensor", -11);
+
+  printf(ok ? "selftest passed\n" : "SELFTEST FAILED\n");
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string src = "src";
+  const char* input = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--selftest") return selftest(i + 1 < argc ? atol(argv[i + 1]) : 1000000);
+    if (a == "--src" && i + 1 < argc) src = argv[++i];
+    else input = argv[i];
+  }
+
+  formats[LOG_ID_DROPPED] = LOG_DROPPED_FORMAT;
+  scanDir(src);
+
+  FILE* in = input ? fopen(input, "rb") : stdin;
+  if (!in) {
+    perror(input);
+    return 1;
+  }
+  decode(in, stdout);
+  return 0;
+}
@@ -0,0 +1,811 @@
+// Local mock of the alarm backend (/api/alarm, /api/sensor, /api/metrics, /api/energy,
+// /api/backend, /api/firmware).
+//
+// Serves the schedule the firmware polls and accepts telemetry uploads in any
+// form the device sends: JSON or CBOR, with Content-Length or chunked, plain or
+// gzip. Faults are injected per endpoint. With a fixed --seed, the same
+// request sequence always gets the same faults:
+//
+//   --latency  EP:MS[-MS][@RATE]  delay the response (fixed or uniform range)
+//   --error    EP:STATUS[@RATE]   answer STATUS with {"error":"injected"}
+//   --timeout  EP:MS[@RATE]       read the request, never answer, close after MS (0 = wait for client)
+//   --drip     EP:MS[@RATE]       send the response one byte every MS
+//   --reject   EP:WHAT            415 for bodies that are WHAT: cbor, json or gzip
+//
+// EP is alarm, sensor, metrics, energy, backend, firmware or * (all). RATE is a
+// probability (0.25) or /N for every N-th request on that endpoint. Without
+// @RATE the fault always applies. Faults are checked in the order above, and
+// the first one that fires wins, except --latency, which combines with the
+// others.
+//
+// The alarm schedule is the --alarm body (a JSON document, sent as is, so
+// it may be invalid on purpose), optionally changed over time by an
+// --alarm-script file with one change per line:
+//   T <seconds> <body>    at <seconds> after start
+//   N <count> <body>      after the <count>-th GET /api/alarm
+//   # comment
+// It can also be replaced at run time with `PUT /mock/alarm` (body = new
+// schedule). GET /mock/stats returns the request counters as JSON.
+//
+// --firmware PATCH (repeatable) serves firmware patches made by
+// tools/ota/ota_diff, all for the same image. GET /api/firmware?from=HASH
+// answers 204 if HASH is that image, else the patch made for base HASH,
+// else the full-image patch, else 404. Each download is logged with its
+// size against the image's.
+//
+// --record FILE appends one JSON line per request with the decoded body
+// (text for JSON, hex for CBOR/binary), for regression diffs.
+//
+// Responses close the connection, like the real backend, unless
+// --keep-alive is given. Then connections stay open until the client sends
+// "Connection: close" or closes them, and pipelined requests are answered
+// in order.
+//
+//   g++ -std=c++11 -O2 -o mock_backend tools/mock/mock_backend.cpp -lz
+//   ./mock_backend [--port 5000] [--seed 1] [--record payloads.jsonl] [--keep-alive]
+//                  [--firmware PATCH]... [faults...]
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <zlib.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum Endpoint { ALARM, SENSOR, METRICS, ENERGY, BACKEND, FIRMWARE, ENDPOINT_COUNT, OTHER = ENDPOINT_COUNT };
+const char* const ENDPOINT_NAME[ENDPOINT_COUNT] = { "alarm", "sensor", "metrics", "energy", "backend", "firmware" };
+const char* const ENDPOINT_PATH[ENDPOINT_COUNT] = { "/api/alarm", "/api/sensor", "/api/metrics", "/api/energy",
+                                                    "/api/backend", "/api/firmware" };
+
+uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// splitmix64: deterministic, one stream per endpoint so faults do not depend
+// on how requests to different endpoints interleave
+struct Rng {
+  uint64_t state;
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// When a fault applies: always, with a probability, or every N-th request
+struct Rate {
+  double   probability = 1;
+  uint32_t every = 0;
+
+  bool fires(uint64_t requestIndex, Rng& rng) const {
+    if (every) return requestIndex % every == 0;
+    if (probability >= 1) return true;
+    return rng.uniform() < probability;
+  }
+};
+
+struct Fault {
+  bool     enabled = false;
+  uint32_t a = 0;  // latency min / status / hold ms / ms per byte
+  uint32_t b = 0;  // latency max
+  Rate     rate;
+};
+
+struct EndpointConfig {
+  Fault latency, error, timeout, drip;
+  bool  rejectCbor = false, rejectJson = false, rejectGzip = false;
+};
+
+struct EndpointStats {
+  uint64_t requests = 0;
+  uint64_t bytes = 0;
+  uint64_t delayed = 0, errors = 0, timeouts = 0, drips = 0, rejected = 0;
+  uint64_t reused = 0;  // arrived on a connection that had already served a request
+};
+
+struct AlarmChange {
+  bool        byTime;
+  uint64_t    at;  // ms after start, or alarm GET count
+  std::string body;
+};
+
+// A patch file, indexed by the hashes in its header (src/core/DeltaPatch.h)
+struct FirmwarePatch {
+  std::string base, image;  // hex SHA-256; base is empty for a full image
+  uint32_t    imageSize;
+  std::string data;
+};
+
+struct Request {
+  std::string method, path, query, contentType, contentEncoding;
+  std::string body;  // decoded: de-chunked and inflated
+  size_t      wireBytes = 0;
+  size_t      consumed = 0;  // bytes of `in` this request took up
+  bool        close = false; // "Connection: close"
+};
+
+enum ConnState { READING, WAITING, WRITING, HOLDING };
+
+struct Conn {
+  int         fd;
+  ConnState   state = READING;
+  std::string in;
+  std::string out;
+  size_t      sent = 0;
+  uint32_t    dripMs = 0;
+  uint64_t    wakeAt = 0;  // for WAITING, dripping WRITING and HOLDING
+  bool        keepAlive = false;  // read the next request after this response
+  uint32_t    served = 0;
+};
+
+struct Timer {
+  uint64_t at;
+  int      fd;
+  bool operator>(const Timer& o) const { return at > o.at; }
+};
+
+bool gunzip(const std::string& in, std::string& out) {
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) return false;
+  z.next_in = (Bytef*)in.data();
+  z.avail_in = (uInt)in.size();
+  char buf[4096];
+  int rc;
+  do {
+    z.next_out = (Bytef*)buf;
+    z.avail_out = sizeof(buf);
+    rc = inflate(&z, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - z.avail_out);
+  } while (rc == Z_OK);
+  inflateEnd(&z);
+  return rc == Z_STREAM_END;
+}
+
+// Parse a full request out of `in`. Returns 1 when complete, 0 if more data is
+// needed, -1 if malformed.
+int parseRequest(const std::string& in, Request& req) {
+  size_t end = in.find("\r\n\r\n");
+  if (end == std::string::npos) return in.size() > 16384 ? -1 : 0;
+
+  size_t sp1 = in.find(' ');
+  size_t sp2 = in.find(' ', sp1 + 1);
+  if (sp1 == std::string::npos || sp2 == std::string::npos || sp2 > end) return -1;
+  req.method = in.substr(0, sp1);
+  req.path = in.substr(sp1 + 1, sp2 - sp1 - 1);
+  size_t question = req.path.find('?');
+  if (question != std::string::npos) {
+    req.query = req.path.substr(question + 1);
+    req.path.erase(question);
+  }
+
+  long contentLength = 0;
+  bool chunked = false;
+  size_t line = in.find("\r\n") + 2;
+  while (line < end) {
+    size_t eol = in.find("\r\n", line);
+    size_t colon = in.find(':', line);
+    if (colon < eol) {
+      std::string name = in.substr(line, colon - line);
+      size_t v = in.find_first_not_of(' ', colon + 1);
+      std::string value = v < eol ? in.substr(v, eol - v) : std::string();
+      if (!strcasecmp(name.c_str(), "Content-Length")) contentLength = atol(value.c_str());
+      else if (!strcasecmp(name.c_str(), "Transfer-Encoding")) chunked = !strcasecmp(value.c_str(), "chunked");
+      else if (!strcasecmp(name.c_str(), "Content-Type")) req.contentType = value;
+      else if (!strcasecmp(name.c_str(), "Content-Encoding")) req.contentEncoding = value;
+      else if (!strcasecmp(name.c_str(), "Connection")) req.close = !strcasecmp(value.c_str(), "close");
+    }
+    line = eol + 2;
+  }
+
+  std::string raw;
+  size_t pos = end + 4;
+  if (chunked) {
+    while (true) {
+      size_t eol = in.find("\r\n", pos);
+      if (eol == std::string::npos) return 0;
+      long len = strtol(in.c_str() + pos, nullptr, 16);
+      if (len < 0) return -1;
+      if (len == 0) {
+        size_t trailer = in.find("\r\n", eol + 2);
+        if (trailer == std::string::npos) return 0;
+        req.consumed = trailer + 2;
+        break;
+      }
+      if (in.size() < eol + 2 + len + 2) return 0;
+      raw.append(in, eol + 2, len);
+      pos = eol + 2 + len + 2;
+    }
+  } else {
+    if (in.size() < pos + contentLength) return 0;
+    raw.assign(in, pos, contentLength);
+    req.consumed = pos + contentLength;
+  }
+
+  req.wireBytes = raw.size();
+  if (!strcasecmp(req.contentEncoding.c_str(), "gzip")) {
+    if (!gunzip(raw, req.body)) return -1;
+  } else {
+    req.body.swap(raw);
+  }
+  return 1;
+}
+
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); ++i) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+    else if (c < 0x20) { char buf[8]; snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+    else out += (char)c;
+  }
+  return out;
+}
+
+bool isText(const std::string& s) {
+  for (size_t i = 0; i < s.size(); ++i) {
+    unsigned char c = s[i];
+    if (c < 0x20 && c != '\n' && c != '\r' && c != '\t') return false;
+    if (c >= 0x7F) return false;
+  }
+  return true;
+}
+
+std::string hex(const std::string& s) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < s.size(); ++i) {
+    out += digits[(unsigned char)s[i] >> 4];
+    out += digits[(unsigned char)s[i] & 0xF];
+  }
+  return out;
+}
+
+std::string response(int status, const std::string& body, bool keepAlive = false,
+                     const char* contentType = "application/json") {
+  const char* reason = status == 200 ? "OK" : status == 201 ? "Created" : status == 204 ? "No Content"
+                     : status == 400 ? "Bad Request"
+                     : status == 404 ? "Not Found" : status == 415 ? "Unsupported Media Type"
+                     : status == 429 ? "Too Many Requests" : status == 500 ? "Internal Server Error"
+                     : status == 502 ? "Bad Gateway" : status == 503 ? "Service Unavailable" : "Status";
+  char head[256];
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+           status, reason, contentType, body.size(), keepAlive ? "keep-alive" : "close");
+  return head + body;
+}
+
+class MockBackend {
+  public:
+    EndpointConfig config[ENDPOINT_COUNT];
+    std::vector<AlarmChange> script;
+    std::vector<FirmwarePatch> firmware;
+    std::string alarmBody = "{\"alarms\":[{\"hour\":7,\"minute\":30,\"days\":62}]}";
+    FILE* record = nullptr;
+    uint64_t seed = 1;
+    bool quiet = false;
+    bool keepAlive = false;
+
+    bool run(uint16_t port) {
+      _listen = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      int one = 1;
+      setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+      if (bind(_listen, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(_listen, 1024) < 0) {
+        perror("listen");
+        return false;
+      }
+
+      for (int e = 0; e < ENDPOINT_COUNT; ++e) _rng[e].state = seed * 0x100000001B3ULL + e;
+      _start = nowMs();
+      _epoll = epoll_create1(0);
+      _watch(_listen, EPOLLIN, EPOLL_CTL_ADD);
+      fprintf(stderr, "mock backend on :%u (seed %llu)\n", port, (unsigned long long)seed);
+
+      std::vector<epoll_event> events(256);
+      while (true) {
+        _applyScript(false);
+        int timeout = _timers.empty() ? 100 : (int)std::min<uint64_t>(100, _timers.top().at > nowMs() ? _timers.top().at - nowMs() : 0);
+        int n = epoll_wait(_epoll, events.data(), (int)events.size(), timeout);
+        for (int i = 0; i < n; ++i) {
+          int fd = events[i].data.fd;
+          if (fd == _listen) _accept();
+          else _onEvent(fd, events[i].events);
+        }
+        _runTimers();
+      }
+    }
+
+  private:
+    int _listen = -1;
+    int _epoll = -1;
+    uint64_t _start = 0;
+    uint64_t _alarmGets = 0;
+    size_t _scriptPos = 0;
+    Rng _rng[ENDPOINT_COUNT];
+    EndpointStats _stats[ENDPOINT_COUNT];
+    std::map<int, std::unique_ptr<Conn> > _conns;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> > _timers;
+
+    void _watch(int fd, uint32_t events, int op) {
+      epoll_event ev = {};
+      ev.events = events;
+      ev.data.fd = fd;
+      epoll_ctl(_epoll, op, fd, &ev);
+    }
+
+    void _accept() {
+      while (true) {
+        int fd = accept4(_listen, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) return;
+        std::unique_ptr<Conn> c(new Conn());
+        c->fd = fd;
+        _conns[fd] = std::move(c);
+        _watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+      }
+    }
+
+    void _close(int fd) {
+      epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+      close(fd);
+      _conns.erase(fd);
+    }
+
+    // Script entries are in file order; each fires once when its condition is met
+    void _applyScript(bool afterAlarmGet) {
+      while (_scriptPos < script.size()) {
+        const AlarmChange& c = script[_scriptPos];
+        bool due = c.byTime ? nowMs() - _start >= c.at : (afterAlarmGet && _alarmGets >= c.at);
+        if (!due) return;
+        alarmBody = c.body;
+        if (!quiet) fprintf(stderr, "[%6.1fs] alarm schedule -> %s\n", (nowMs() - _start) / 1000.0, alarmBody.c_str());
+        _scriptPos++;
+      }
+    }
+
+    void _onEvent(int fd, uint32_t events) {
+      auto it = _conns.find(fd);
+      if (it == _conns.end()) return;
+      Conn& c = *it->second;
+
+      if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        char buf[4096];
+        while (true) {
+          ssize_t n = recv(fd, buf, sizeof(buf), 0);
+          if (n > 0) {
+            // Kept even while answering: a pipelining client sends ahead
+            c.in.append(buf, n);
+            continue;
+          }
+          if (n < 0 && errno == EAGAIN) break;
+          // Client went away (e.g. gave up on a held or slow response)
+          _close(fd);
+          return;
+        }
+        if (c.state == READING) _next(c);
+      }
+      if ((events & EPOLLOUT) && c.state == WRITING && !c.dripMs) _write(c);
+    }
+
+    // Answer the next complete request in the connection's input, if there is one
+    void _next(Conn& c) {
+      Request req;
+      int rc = parseRequest(c.in, req);
+      if (rc < 0) {
+        c.keepAlive = false;
+        _respond(c, response(400, "{\"error\":\"bad request\"}"), 0, 0);
+      } else if (rc > 0) {
+        c.in.erase(0, req.consumed);
+        c.keepAlive = keepAlive && !req.close;
+        _handle(c, req);
+      }
+    }
+
+    void _handle(Conn& c, Request& req) {
+      int e = OTHER;
+      for (int i = 0; i < ENDPOINT_COUNT; ++i) {
+        if (req.path == ENDPOINT_PATH[i]) e = i;
+      }
+
+      if (e == OTHER) {
+        _handleControl(c, req);
+        return;
+      }
+
+      EndpointStats& s = _stats[e];
+      const EndpointConfig& cfg = config[e];
+      uint64_t index = ++s.requests;
+      if (c.served++) s.reused++;
+      s.bytes += req.wireBytes;
+      Rng& rng = _rng[e];
+
+      uint32_t delay = 0;
+      if (cfg.latency.enabled && cfg.latency.rate.fires(index, rng)) {
+        delay = cfg.latency.a;
+        if (cfg.latency.b > cfg.latency.a) delay += (uint32_t)(rng.next() % (cfg.latency.b - cfg.latency.a + 1));
+        s.delayed++;
+      }
+
+      int status;
+      std::string body;
+      const char* type = "application/json";
+      bool isCbor = req.contentType.find("cbor") != std::string::npos;
+      bool isGzip = !strcasecmp(req.contentEncoding.c_str(), "gzip");
+
+      if (e == ALARM && req.method == "GET") {
+        _alarmGets++;
+        _applyScript(true);
+      }
+
+      if (cfg.error.enabled && cfg.error.rate.fires(index, rng)) {
+        status = (int)cfg.error.a;
+        body = "{\"error\":\"injected\"}";
+        s.errors++;
+      } else if (cfg.timeout.enabled && cfg.timeout.rate.fires(index, rng)) {
+        s.timeouts++;
+        _log(e, req, 0);
+        c.state = HOLDING;
+        if (cfg.timeout.a) _schedule(c, nowMs() + cfg.timeout.a);
+        return;
+      } else if (e == ALARM) {
+        if (req.method != "GET") {
+          status = 405;
+          body = "{\"error\":\"method\"}";
+        } else {
+          status = 200;
+          body = alarmBody;
+        }
+      } else if (e == FIRMWARE) {
+        if (req.method != "GET") {
+          status = 405;
+          body = "{\"error\":\"method\"}";
+        } else {
+          const FirmwarePatch* patch = _firmwareFor(req.query, status);
+          if (patch) {
+            body = patch->data;
+            type = "application/octet-stream";
+          } else if (status == 404) {
+            body = "{\"error\":\"no firmware\"}";
+          }
+        }
+      } else if (req.method != "POST") {
+        status = 405;
+        body = "{\"error\":\"method\"}";
+      } else if ((cfg.rejectCbor && isCbor) || (cfg.rejectJson && !isCbor) || (cfg.rejectGzip && isGzip)) {
+        status = 415;
+        body = "{\"error\":\"unsupported media type\"}";
+        s.rejected++;
+      } else {
+        status = 201;
+        body = "{\"status\":\"ok\"}";
+      }
+
+      uint32_t drip = 0;
+      if (cfg.drip.enabled && cfg.drip.rate.fires(index, rng)) {
+        drip = cfg.drip.a;
+        s.drips++;
+      }
+
+      _log(e, req, status);
+      _respond(c, response(status, body, c.keepAlive, type), delay, drip);
+    }
+
+    // The patch for the base in `from=`, or the full image; 204 if the base is the image
+    const FirmwarePatch* _firmwareFor(const std::string& query, int& status) {
+      size_t at = query.find("from=");
+      std::string from = at == std::string::npos ? std::string() : query.substr(at + 5, 64);
+      const FirmwarePatch* full = nullptr;
+      const FirmwarePatch* delta = nullptr;
+      for (size_t i = 0; i < firmware.size(); ++i) {
+        if (firmware[i].base.empty()) full = &firmware[i];
+        else if (firmware[i].base == from) delta = &firmware[i];
+      }
+      double t = (nowMs() - _start) / 1000.0;
+      if (firmware.empty()) {
+        status = 404;
+        return nullptr;
+      }
+      if (from == firmware[0].image) {
+        status = 204;
+        if (!quiet) fprintf(stderr, "[%6.1fs] firmware from %.8s: up to date\n", t, from.c_str());
+        return nullptr;
+      }
+      const FirmwarePatch* patch = delta ? delta : full;
+      status = patch ? 200 : 404;
+      if (!quiet) {
+        if (patch) {
+          fprintf(stderr, "[%6.1fs] firmware from %.8s: %s, %zu B for a %u B image (%.1f %%)\n", t,
+                  from.c_str(), delta ? "delta" : "full image", patch->data.size(), patch->imageSize,
+                  100.0 * patch->data.size() / patch->imageSize);
+        } else {
+          fprintf(stderr, "[%6.1fs] firmware from %.8s: no patch for this base\n", t, from.c_str());
+        }
+      }
+      return patch;
+    }
+
+    // /mock/* control API for tests driving the mock from outside
+    void _handleControl(Conn& c, Request& req) {
+      if (req.path == "/mock/alarm" && (req.method == "PUT" || req.method == "POST")) {
+        alarmBody = req.body;
+        if (!quiet) fprintf(stderr, "[%6.1fs] alarm schedule -> %s (PUT)\n", (nowMs() - _start) / 1000.0, alarmBody.c_str());
+        _respond(c, response(200, "{\"status\":\"ok\"}", c.keepAlive), 0, 0);
+        return;
+      }
+      if (req.path == "/mock/stats" && req.method == "GET") {
+        std::string out = "{";
+        for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+          const EndpointStats& s = _stats[e];
+          char buf[256];
+          snprintf(buf, sizeof(buf),
+                   "%s\"%s\":{\"requests\":%llu,\"bytes\":%llu,\"delayed\":%llu,\"errors\":%llu,"
+                   "\"timeouts\":%llu,\"drips\":%llu,\"rejected\":%llu,\"reused\":%llu}",
+                   e ? "," : "", ENDPOINT_NAME[e],
+                   (unsigned long long)s.requests, (unsigned long long)s.bytes,
+                   (unsigned long long)s.delayed, (unsigned long long)s.errors,
+                   (unsigned long long)s.timeouts, (unsigned long long)s.drips,
+                   (unsigned long long)s.rejected, (unsigned long long)s.reused);
+          out += buf;
+        }
+        out += "}";
+        _respond(c, response(200, out, c.keepAlive), 0, 0);
+        return;
+      }
+      _respond(c, response(404, "{\"error\":\"not found\"}", c.keepAlive), 0, 0);
+    }
+
+    void _log(int e, const Request& req, int status) {
+      double t = (nowMs() - _start) / 1000.0;
+      if (!quiet) {
+        fprintf(stderr, "[%6.1fs] %s %s -> %s%d (%zu B%s%s)\n", t, req.method.c_str(), req.path.c_str(),
+                status ? "" : "hold ", status, req.body.size(),
+                req.contentType.empty() ? "" : ", ", req.contentType.c_str());
+      }
+      if (!record) return;
+      fprintf(record, "{\"t\":%.3f,\"endpoint\":\"%s\",\"method\":\"%s\",\"status\":%d,"
+                      "\"type\":\"%s\",\"encoding\":\"%s\",\"wire\":%zu,\"bytes\":%zu,",
+              t, ENDPOINT_NAME[e], req.method.c_str(), status,
+              jsonEscape(req.contentType).c_str(), jsonEscape(req.contentEncoding).c_str(),
+              req.wireBytes, req.body.size());
+      if (isText(req.body)) fprintf(record, "\"body\":\"%s\"}\n", jsonEscape(req.body).c_str());
+      else fprintf(record, "\"hex\":\"%s\"}\n", hex(req.body).c_str());
+      fflush(record);
+    }
+
+    void _schedule(Conn& c, uint64_t at) {
+      c.wakeAt = at;
+      _timers.push(Timer{ at, c.fd });
+    }
+
+    void _respond(Conn& c, const std::string& out, uint32_t delayMs, uint32_t dripMs) {
+      c.out = out;
+      c.sent = 0;
+      c.dripMs = dripMs;
+      if (delayMs) {
+        c.state = WAITING;
+        _schedule(c, nowMs() + delayMs);
+        return;
+      }
+      _beginWrite(c);
+    }
+
+    void _beginWrite(Conn& c) {
+      c.state = WRITING;
+      if (c.dripMs) {
+        _write(c);
+        return;
+      }
+      _watch(c.fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP, EPOLL_CTL_MOD);
+      _write(c);
+    }
+
+    void _write(Conn& c) {
+      size_t want = c.dripMs ? 1 : c.out.size() - c.sent;
+      ssize_t n = send(c.fd, c.out.data() + c.sent, want, MSG_NOSIGNAL);
+      if (n < 0 && errno != EAGAIN) {
+        _close(c.fd);
+        return;
+      }
+      if (n > 0) c.sent += n;
+      if (c.sent == c.out.size()) {
+        if (!c.keepAlive) {
+          shutdown(c.fd, SHUT_WR);
+          _close(c.fd);
+          return;
+        }
+        c.state = READING;
+        c.out.clear();
+        c.sent = 0;
+        c.dripMs = 0;
+        _watch(c.fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+        _next(c);
+        return;
+      }
+      if (c.dripMs) _schedule(c, nowMs() + c.dripMs);
+    }
+
+    void _runTimers() {
+      uint64_t now = nowMs();
+      while (!_timers.empty() && _timers.top().at <= now) {
+        Timer t = _timers.top();
+        _timers.pop();
+        auto it = _conns.find(t.fd);
+        // Stale if the connection closed or the fd was reused since
+        if (it == _conns.end() || it->second->wakeAt != t.at) continue;
+        Conn& c = *it->second;
+        if (c.state == WAITING) _beginWrite(c);
+        else if (c.state == WRITING) _write(c);
+        else if (c.state == HOLDING) _close(c.fd);
+      }
+    }
+};
+
+// "sensor:503@0.2" -> endpoints, value part and rate
+bool parseSpec(const char* spec, std::vector<int>& endpoints, std::string& value, Rate& rate) {
+  std::string s(spec);
+  size_t colon = s.find(':');
+  std::string ep = s.substr(0, colon);
+  std::string rest = colon == std::string::npos ? std::string() : s.substr(colon + 1);
+  size_t at = rest.find('@');
+  value = rest.substr(0, at);
+  if (at != std::string::npos) {
+    std::string r = rest.substr(at + 1);
+    if (!r.empty() && r[0] == '/') rate.every = (uint32_t)atoi(r.c_str() + 1);
+    else rate.probability = atof(r.c_str());
+  }
+
+  endpoints.clear();
+  for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+    if (ep == "*" || ep == ENDPOINT_NAME[e]) endpoints.push_back(e);
+  }
+  return !endpoints.empty();
+}
+
+bool loadPatch(const char* path, std::vector<FirmwarePatch>& firmware) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  FirmwarePatch patch;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) patch.data.append(buf, n);
+  fclose(f);
+
+  const std::string& d = patch.data;
+  if (d.size() < 76 || d.compare(0, 4, "OTD1") != 0) {
+    fprintf(stderr, "%s: not a firmware patch\n", path);
+    return false;
+  }
+  const unsigned char* h = (const unsigned char*)d.data();
+  uint32_t baseSize = h[4] | h[5] << 8 | h[6] << 16 | (uint32_t)h[7] << 24;
+  patch.imageSize = h[8] | h[9] << 8 | h[10] << 16 | (uint32_t)h[11] << 24;
+  if (baseSize) patch.base = hex(d.substr(12, 32));
+  patch.image = hex(d.substr(44, 32));
+  if (!firmware.empty() && firmware[0].image != patch.image) {
+    fprintf(stderr, "%s: patches for a different image than %s\n", path, firmware[0].image.c_str());
+    return false;
+  }
+  firmware.push_back(patch);
+  return true;
+}
+
+bool loadScript(const char* path, std::vector<AlarmChange>& script) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[4096];
+  while (fgets(line, sizeof(line), f)) {
+    char kind;
+    unsigned long long at;
+    int consumed = 0;
+    if (line[0] == '#' || sscanf(line, " %c %llu %n", &kind, &at, &consumed) < 2 || !consumed) continue;
+    std::string body(line + consumed);
+    while (!body.empty() && (body.back() == '\n' || body.back() == '\r')) body.pop_back();
+    if (kind == 'T') script.push_back(AlarmChange{ true, at * 1000, body });
+    else if (kind == 'N') script.push_back(AlarmChange{ false, at, body });
+  }
+  fclose(f);
+  return true;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: mock_backend [--port P] [--seed S] [--record FILE] [--quiet] [--keep-alive]\n"
+          "                    [--alarm BODY] [--alarm-script FILE] [--firmware PATCH]...\n"
+          "                    [--latency EP:MS[-MS][@RATE]] [--error EP:STATUS[@RATE]]\n"
+          "                    [--timeout EP:MS[@RATE]] [--drip EP:MS[@RATE]] [--reject EP:cbor|json|gzip]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  MockBackend mock;
+  uint16_t port = 5000;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    std::vector<int> eps;
+    std::string value;
+    Rate rate;
+
+    if (arg == "--port" && hasValue) port = (uint16_t)atoi(argv[++i]);
+    else if (arg == "--seed" && hasValue) mock.seed = strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--quiet") mock.quiet = true;
+    else if (arg == "--keep-alive") mock.keepAlive = true;
+    else if (arg == "--alarm" && hasValue) mock.alarmBody = argv[++i];
+    else if (arg == "--alarm-script" && hasValue) {
+      if (!loadScript(argv[++i], mock.script)) {
+        fprintf(stderr, "cannot read %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--firmware" && hasValue) {
+      if (!loadPatch(argv[++i], mock.firmware)) {
+        fprintf(stderr, "cannot load %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--record" && hasValue) {
+      mock.record = fopen(argv[++i], "a");
+      if (!mock.record) {
+        perror(argv[i]);
+        return 1;
+      }
+    }
+    else if ((arg == "--latency" || arg == "--error" || arg == "--timeout" || arg == "--drip") && hasValue) {
+      if (!parseSpec(argv[++i], eps, value, rate)) {
+        usage();
+        return 2;
+      }
+      for (size_t k = 0; k < eps.size(); ++k) {
+        EndpointConfig& cfg = mock.config[eps[k]];
+        Fault& f = arg == "--latency" ? cfg.latency : arg == "--error" ? cfg.error
+                 : arg == "--timeout" ? cfg.timeout : cfg.drip;
+        f.enabled = true;
+        f.rate = rate;
+        f.a = (uint32_t)atol(value.c_str());
+        size_t dash = value.find('-');
+        f.b = dash == std::string::npos ? f.a : (uint32_t)atol(value.c_str() + dash + 1);
+      }
+    }
+    else if (arg == "--reject" && hasValue) {
+      if (!parseSpec(argv[++i], eps, value, rate)) {
+        usage();
+        return 2;
+      }
+      for (size_t k = 0; k < eps.size(); ++k) {
+        EndpointConfig& cfg = mock.config[eps[k]];
+        if (value == "cbor") cfg.rejectCbor = true;
+        else if (value == "json") cfg.rejectJson = true;
+        else if (value == "gzip") cfg.rejectGzip = true;
+      }
+    }
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  return mock.run(port) ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+// Runs the firmware's network paths natively against a backend, normally
+// mock_backend, to check retry, batching and timeout behavior without hardware.
+//
+// Every cycle does what one pass of the firmware's loop() does over the
+// network: fetch the schedule through AlarmConfig, post a sensor record
+// through TelemetryEndpoint, and flush the backlog after a success, the same
+// way main.cpp does. Every --metrics-every cycles it posts a metrics record.
+// Each call's status and duration are printed, then a summary. Sample
+// values depend only on the cycle number, so two runs against a mock with
+// the same --seed produce the same request sequence.
+//
+// With --async, a cycle does what the firmware's loop() does now: queue the
+// alarm refresh and the uploads on WifiModule's request task, then keep
+// calling dispatch() until every request and the batch flushes they trigger
+// have completed. It prints how long the loop was blocked (queueing plus
+// the slowest dispatch) against how long the cycle took on the network.
+//
+// Build (from alarm/, see tools/README.md for the native build):
+//   g++ -std=gnu++11 -O2 -DWIFIMODULE_TLS=0 -Itools/native -Isrc -I.pio/libdeps/ttgo-lora32-v1/ArduinoJson/src -o mock_device tools/mock/mock_device.cpp tools/native/*.cpp src/core/AlarmConfig.cpp src/core/AlarmScheduler.cpp src/core/TelemetryEncoder.cpp src/core/TelemetryEndpoint.cpp src/core/GzipWriter.cpp src/hal/WifiModule.cpp src/core/Log.cpp src/core/LogFormat.cpp src/core/CircuitBreaker.cpp src/core/Energy.cpp -lpthread
+//
+//   ./mock_device [--server host:port] [--cycles N] [--metrics-every N] [--interval-ms MS] [--async] [--firmware-log]
+
+#include <core/AlarmConfig.h>
+#include <core/AlarmScheduler.h>
+#include <core/TelemetryEndpoint.h>
+#include <hal/WifiModule.h>
+#include <string>
+
+WifiModule wifi("native", "");
+
+namespace {
+
+struct CallStats {
+  uint32_t calls = 0;
+  uint32_t ok = 0;
+  uint64_t totalUs = 0;
+  uint32_t maxUs = 0;
+
+  void add(bool success, uint32_t us) {
+    calls++;
+    if (success) ok++;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  void print(const char* name) const {
+    printf("%-8s %4u calls, %4u ok, avg %8.1f ms, max %8.1f ms\n", name, calls, ok,
+           calls ? totalUs / 1000.0 / calls : 0.0, maxUs / 1000.0);
+  }
+};
+
+// Same policy as onSensorUploaded(), onMetricsUploaded() and flushBacklog() in main.cpp
+template <typename Record, uint8_t N>
+struct AsyncUpload {
+  TelemetryEndpoint*           endpoint;
+  TelemetryBacklog<Record, N>* backlog;
+  Record                       record;
+  int                          status;
+  int                          batchStatus;
+  uint8_t                      batched;
+  unsigned long                startUs;       // submit of the post, then of the first batch
+  uint32_t                     postUs;        // submit to completion callback
+  uint32_t                     batchUs;       // first batch submit to the last batch's callback
+
+  AsyncUpload(TelemetryEndpoint& e, TelemetryBacklog<Record, N>& b, const Record& r)
+    : endpoint(&e), backlog(&b), record(r), status(0), batchStatus(0), batched(0),
+      startUs(0), postUs(0), batchUs(0) {}
+
+  bool start() {
+    startUs = micros();
+    if (endpoint->postAsync(record, onPosted, this)) return true;
+    backlog->push(record);
+    return false;
+  }
+
+  static void onPosted(void* self, int status) {
+    AsyncUpload* u = static_cast<AsyncUpload*>(self);
+    u->status = status;
+    u->postUs = micros() - u->startUs;
+    if (status < 200 || status >= 300) {
+      u->backlog->push(u->record);
+      return;
+    }
+    if (u->backlog->count() == 0 || u->backlog->uploading()) return;
+    u->startUs = micros();
+    u->batched = u->backlog->beginUpload();
+    if (!u->endpoint->postBatchAsync(u->backlog->data(), u->batched, onBatch, u)) u->backlog->uploadFailed();
+  }
+
+  static void onBatch(void* self, int status) {
+    AsyncUpload* u = static_cast<AsyncUpload*>(self);
+    u->batchStatus = status;
+    u->batchUs = micros() - u->startUs;
+    if (!u->backlog->uploadFinished(status)) return;
+    u->batched = u->backlog->beginUpload();
+    if (!u->endpoint->postBatchAsync(u->backlog->data(), u->batched, onBatch, u)) u->backlog->uploadFailed();
+  }
+};
+
+// Same policy as flushBacklog() in main.cpp, blocking: batches until the
+// backlog is empty or a batch fails
+template <typename Record, uint8_t N>
+int flushBacklog(TelemetryEndpoint& endpoint, TelemetryBacklog<Record, N>& backlog) {
+  int status = 0;
+  while (backlog.count() > 0) {
+    String response;
+    uint8_t count = backlog.beginUpload();
+    status = endpoint.postBatch(backlog.data(), count, response);
+    if (!backlog.uploadFinished(status)) break;
+  }
+  return status;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string host = "127.0.0.1";
+  uint16_t port = 5000;
+  uint32_t cycles = 10;
+  uint32_t metricsEvery = 5;
+  uint32_t intervalMs = 0;
+  bool async = false;
+  bool firmwareLog = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--server" && hasValue) {
+      std::string hp = argv[++i];
+      size_t colon = hp.find(':');
+      host = hp.substr(0, colon);
+      if (colon != std::string::npos) port = (uint16_t)atoi(hp.c_str() + colon + 1);
+    }
+    else if (arg == "--cycles" && hasValue)        cycles = (uint32_t)atol(argv[++i]);
+    else if (arg == "--metrics-every" && hasValue) metricsEvery = (uint32_t)atol(argv[++i]);
+    else if (arg == "--interval-ms" && hasValue)   intervalMs = (uint32_t)atol(argv[++i]);
+    else if (arg == "--async")                     async = true;
+    else if (arg == "--firmware-log")              firmwareLog = true;
+    else {
+      fprintf(stderr, "usage: mock_device [--server host:port] [--cycles N] [--metrics-every N] "
+                      "[--interval-ms MS] [--async] [--firmware-log]\n");
+      return 2;
+    }
+  }
+  if (!firmwareLog) nativeSetSerialOutput(nullptr);
+
+  AlarmScheduler scheduler;
+  AlarmConfig alarmConfig(scheduler, host.c_str(), port, "/api/alarm");
+  TelemetryEndpoint sensorEndpoint(host.c_str(), port, "/api/sensor");
+  TelemetryEndpoint metricsEndpoint(host.c_str(), port, "/api/metrics");
+  TelemetryBacklog<SensorRecord, 48>  sensorBacklog;
+  TelemetryBacklog<MetricsRecord, 16> metricsBacklog;
+  CallStats alarmStats, sensorStats, metricsStats, batchStats, blockedStats, cycleStats;
+
+  for (uint32_t cycle = 1; cycle <= cycles; ++cycle) {
+    uint32_t ts = 1700000000u + cycle * 300;
+
+    if (async) {
+      uint8_t before = scheduler.alarmCount();
+      SensorRecord sample = { ts, (int16_t)(2100 + (cycle * 37) % 300), (uint16_t)(4000 + (cycle * 53) % 1500) };
+      MetricsRecord result = { ts, (uint8_t)(1 + cycle % 3), 2000 + cycle * 100 };
+      AsyncUpload<SensorRecord, 48> sensor(sensorEndpoint, sensorBacklog, sample);
+      AsyncUpload<MetricsRecord, 16> metrics(metricsEndpoint, metricsBacklog, result);
+      bool withMetrics = metricsEvery && cycle % metricsEvery == 0;
+
+      unsigned long t0 = micros();
+      alarmConfig.refresh();
+      sensor.start();
+      if (withMetrics) metrics.start();
+      uint32_t blockedUs = micros() - t0;
+
+      // The loop: deliver completions (which may queue batch flushes) until all is done.
+      // AlarmConfig's callback is internal; its refresh is done once dispatch() has cleared it.
+      uint32_t alarmUs = alarmConfig.refreshing() ? 0 : micros() - t0;
+      while (wifi.inFlight() > 0) {
+        unsigned long d0 = micros();
+        wifi.dispatch();
+        AppBus::dispatch();
+        uint32_t dispatchUs = micros() - d0;
+        if (dispatchUs > blockedUs) blockedUs = dispatchUs;
+        if (!alarmUs && !alarmConfig.refreshing()) alarmUs = micros() - t0;
+        delay(1);
+      }
+      uint32_t cycleUs = micros() - t0;
+      if (!alarmUs) alarmUs = cycleUs;
+
+      bool alarmOk = scheduler.alarmCount() > 0;
+      alarmStats.add(alarmOk, alarmUs);
+      sensorStats.add(sensor.status >= 200 && sensor.status < 300, sensor.postUs);
+      if (sensor.batched) batchStats.add(sensor.batchStatus >= 200 && sensor.batchStatus < 300, sensor.batchUs);
+      if (withMetrics) metricsStats.add(metrics.status >= 200 && metrics.status < 300, metrics.postUs);
+      blockedStats.add(true, blockedUs);
+      cycleStats.add(true, cycleUs);
+
+      printf("cycle %3u: alarm %s %7.1f ms (%u->%u alarms) | sensor %4d %7.1f ms %s",
+             cycle, alarmOk ? "ok  " : "fail", alarmUs / 1000.0, before, scheduler.alarmCount(),
+             sensor.status, sensor.postUs / 1000.0, sensorEndpoint.encoder().contentType());
+      if (sensor.batched) printf(" | batch of %u -> %d", sensor.batched, sensor.batchStatus);
+      printf(" | backlog %u", sensorBacklog.count());
+      if (withMetrics) printf(" | metrics %4d %7.1f ms", metrics.status, metrics.postUs / 1000.0);
+      printf(" | blocked %6.2f ms of %7.1f ms\n", blockedUs / 1000.0, cycleUs / 1000.0);
+
+      if (intervalMs) delay(intervalMs);
+      continue;
+    }
+
+    // begin() performs one fetch and applies the schedule on success
+    unsigned long t0 = micros();
+    uint8_t before = scheduler.alarmCount();
+    alarmConfig.begin();
+    uint32_t alarmUs = micros() - t0;
+    bool alarmOk = scheduler.alarmCount() > 0;
+    alarmStats.add(alarmOk, alarmUs);
+    AppBus::dispatch();
+
+    String response;
+    SensorRecord sample = { ts, (int16_t)(2100 + (cycle * 37) % 300), (uint16_t)(4000 + (cycle * 53) % 1500) };
+    t0 = micros();
+    int sensorStatus = sensorEndpoint.post(sample, response);
+    uint32_t sensorUs = micros() - t0;
+    sensorStats.add(sensorStatus >= 200 && sensorStatus < 300, sensorUs);
+
+    int batchStatus = 0;
+    uint8_t batched = sensorBacklog.count();
+    if (sensorStatus >= 200 && sensorStatus < 300) {
+      t0 = micros();
+      batchStatus = flushBacklog(sensorEndpoint, sensorBacklog);
+      if (batched) batchStats.add(batchStatus >= 200 && batchStatus < 300, micros() - t0);
+    } else {
+      sensorBacklog.push(sample);
+    }
+
+    printf("cycle %3u: alarm %s %7.1f ms (%u->%u alarms) | sensor %4d %7.1f ms %s",
+           cycle, alarmOk ? "ok  " : "fail", alarmUs / 1000.0, before, scheduler.alarmCount(),
+           sensorStatus, sensorUs / 1000.0, sensorEndpoint.encoder().contentType());
+    if (batched && batchStatus) printf(" | batch of %u -> %d", batched, batchStatus);
+    printf(" | backlog %u", sensorBacklog.count());
+
+    if (metricsEvery && cycle % metricsEvery == 0) {
+      MetricsRecord result = { ts, (uint8_t)(1 + cycle % 3), 2000 + cycle * 100 };
+      t0 = micros();
+      int metricsStatus = metricsEndpoint.post(result, response);
+      uint32_t metricsUs = micros() - t0;
+      bool ok = metricsStatus >= 200 && metricsStatus < 300;
+      metricsStats.add(ok, metricsUs);
+      if (ok) flushBacklog(metricsEndpoint, metricsBacklog);
+      else metricsBacklog.push(result);
+      printf(" | metrics %4d %7.1f ms", metricsStatus, metricsUs / 1000.0);
+    }
+    printf("\n");
+
+    if (intervalMs) delay(intervalMs);
+  }
+
+  printf("\n");
+  alarmStats.print("alarm");
+  sensorStats.print("sensor");
+  batchStats.print("batch");
+  metricsStats.print("metrics");
+  if (async) {
+    blockedStats.print("blocked");
+    cycleStats.print("cycle");
+    const RequestStats& requests = wifi.requestStats();
+    printf("requests: %lu queued, %lu rejected, %lu connections, %lu reused, %lu pipelined, %lu retried, "
+           "max wait %lu ms\n",
+           (unsigned long)requests.submitted, (unsigned long)requests.rejected,
+           (unsigned long)requests.connections, (unsigned long)requests.reused,
+           (unsigned long)requests.pipelined, (unsigned long)requests.retried,
+           (unsigned long)requests.maxQueuedMs);
+  }
+  printf("backlog left: %u sensor (%lu dropped), %u metrics\n",
+         sensorBacklog.count(), (unsigned long)sensorBacklog.dropped(), metricsBacklog.count());
+  for (uint8_t i = 0; i < wifi.endpointCount(); ++i) {
+    const CircuitBreaker& breaker = wifi.endpointHealth(i);
+    const BreakerStats& health = breaker.stats();
+    printf("breaker %s:%u %s: %lu requests, %lu failures, %lu failed fast, %lu trips\n",
+           wifi.endpointHost(i), wifi.endpointPort(i), CircuitBreaker::stateName(breaker.state()),
+           (unsigned long)health.requests, (unsigned long)health.failures,
+           (unsigned long)health.rejected, (unsigned long)health.trips);
+  }
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include <Arduino.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+static FILE* serialOut = stdout;
+
+void nativeSetSerialOutput(FILE* out) {
+  serialOut = out;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialOut) fputc(c, serialOut);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+  if (serialOut) fwrite(buf, 1, len, serialOut);
+  return len;
+}
+
+// ---- Stream ----
+
+int Stream::_timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    delay(1);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t len) {
+  size_t n = 0;
+  while (n < len) {
+    int c = _timedRead();
+    if (c < 0) break;
+    buf[n++] = (uint8_t)c;
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String out;
+  int c = _timedRead();
+  while (c >= 0 && c != terminator) {
+    out += (char)c;
+    c = _timedRead();
+  }
+  return out;
+}
+
+// ---- Time ----
+
+static uint64_t (*clockNow)() = nullptr;
+static void (*clockSleep)(uint64_t) = nullptr;
+
+static uint64_t wallMicros() {
+  static uint64_t origin = 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+  if (!origin) origin = now;
+  return now - origin;
+}
+
+void nativeSetClock(uint64_t (*nowMicros)(), void (*sleepMicros)(uint64_t)) {
+  clockNow = nowMicros;
+  clockSleep = sleepMicros;
+}
+
+unsigned long micros() {
+  return (unsigned long)(uint32_t)(clockNow ? clockNow() : wallMicros());
+}
+
+unsigned long millis() {
+  return (unsigned long)(uint32_t)((clockNow ? clockNow() : wallMicros()) / 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (clockSleep) clockSleep(us);
+  else usleep(us);
+}
+
+void delay(unsigned long ms) {
+  if (clockSleep) clockSleep((uint64_t)ms * 1000);
+  else usleep(ms * 1000);
+}
+
+void yield() {}
+
+static bool epochSet = false;
+static uint64_t epochMs;
+static uint64_t epochSetAtMicros;
+
+void nativeSetEpoch(uint64_t ms) {
+  epochMs = ms;
+  epochSetAtMicros = clockNow ? clockNow() : wallMicros();
+  epochSet = true;
+}
+
+#ifndef __THROW
+#define __THROW
+#endif
+
+// Replaces the C library's time() for this program; the library's own callers keep theirs
+extern "C" time_t time(time_t* out) __THROW {
+  time_t now;
+  if (epochSet) {
+    uint64_t elapsed = (clockNow ? clockNow() : wallMicros()) - epochSetAtMicros;
+    now = (time_t)((epochMs + elapsed / 1000) / 1000);
+  } else {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    now = ts.tv_sec;
+  }
+  if (out) *out = now;
+  return now;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char*, const char*, const char*) {
+  // Same POSIX TZ trick the ESP32 core uses; the sign is inverted in TZ notation
+  char tz[32];
+  long offset = -(gmtOffsetSec + daylightOffsetSec);
+  snprintf(tz, sizeof(tz), "UTC%+ld:%02ld", offset / 3600, labs(offset % 3600) / 60);
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+// Like the ESP32 core: waits up to `ms` for a clock set past 2016
+bool getLocalTime(struct tm* info, uint32_t ms) {
+  unsigned long start = millis();
+  for (;;) {
+    time_t now = time(nullptr);
+    if (localtime_r(&now, info) && info->tm_year > 2016 - 1900) return true;
+    if (millis() - start > ms) return false;
+    delay(10);
+  }
+}
+
+// ---- GPIO, LEDC, random ----
+
+static uint8_t pinLevels[64];
+static void (*pinIsr[64])() = {};
+static int pinIsrMode[64];
+static bool pinsInitialized = false;
+
+static void initPins() {
+  if (pinsInitialized) return;
+  memset(pinLevels, HIGH, sizeof(pinLevels));
+  pinsInitialized = true;
+}
+
+void nativeSetPin(uint8_t pin, uint8_t level) {
+  initPins();
+  if (pin >= 64) return;
+  uint8_t old = pinLevels[pin];
+  pinLevels[pin] = level;
+  if (pinIsr[pin] && old != level) {
+    int mode = pinIsrMode[pin];
+    if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) pinIsr[pin]();
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  initPins();
+  return pin < 64 ? pinLevels[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  initPins();
+  if (pin < 64) pinLevels[pin] = value ? HIGH : LOW;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin >= 64) return;
+  pinIsr[pin] = isr;
+  pinIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < 64) pinIsr[pin] = nullptr;
+}
+
+static long (*randomSource)(long, long) = nullptr;
+
+void nativeSetRandom(long (*source)(long min, long max)) {
+  randomSource = source;
+}
+
+long random(long max) {
+  return random(0, max);
+}
+
+long random(long min, long max) {
+  if (randomSource) return randomSource(min, max);
+  return max > min ? min + rand() % (max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+  srand(seed);
+}
+
+void   ledcAttachPin(uint8_t, uint8_t) {}
+double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+double ledcWriteTone(uint8_t, double freq) { return freq; }
+void   ledcWrite(uint8_t, uint32_t) {}
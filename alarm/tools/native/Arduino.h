@@ -0,0 +1,235 @@
+// Minimal Arduino core for building firmware modules on Linux.
+//
+// Covers what src/ uses: String, Print/Stream, Serial (stdout), timing,
+// stub GPIO/LEDC and the ESP32 time helpers. Timing is real wall-clock
+// time unless a tool installs its own clock with nativeSetClock(), and
+// time() is the host's unless a tool sets it with nativeSetEpoch().
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <initializer_list>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define IRAM_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class String {
+  public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { _fmt(v, decimals); }
+    String(double v, unsigned int decimals = 2) { _fmt(v, decimals); }
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool reserve(unsigned int n) { _s.reserve(n); return true; }
+    char operator[](unsigned int i) const { return _s[i]; }
+
+    String& operator+=(const String& o) { _s += o._s; return *this; }
+    String& operator+=(const char* o) { _s += o; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    bool concat(const char* o, unsigned int n) { _s.append(o, n); return true; }
+
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return _s == o; }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool equals(const char* o) const { return _s == o; }
+    bool startsWith(const char* p) const { return _s.compare(0, strlen(p), p) == 0; }
+    bool endsWith(const char* p) const {
+      size_t n = strlen(p);
+      return _s.size() >= n && _s.compare(_s.size() - n, n, p) == 0;
+    }
+    int indexOf(char c) const { size_t p = _s.find(c); return p == std::string::npos ? -1 : (int)p; }
+    int indexOf(const char* s) const { size_t p = _s.find(s); return p == std::string::npos ? -1 : (int)p; }
+    String substring(unsigned int from) const { return from >= _s.size() ? String() : String(_s.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const {
+      return from >= _s.size() ? String() : String(_s.substr(from, to - from));
+    }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    void trim() {
+      size_t a = _s.find_first_not_of(" \t\r\n");
+      size_t b = _s.find_last_not_of(" \t\r\n");
+      _s = a == std::string::npos ? std::string() : _s.substr(a, b - a + 1);
+    }
+    void toLowerCase() { for (auto& c : _s) c = (char)tolower(c); }
+
+    // ArduinoJson writes into String through these
+    size_t write(uint8_t c) { _s += (char)c; return 1; }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+
+  private:
+    std::string _s;
+    void _fmt(double v, unsigned int decimals) {
+      char buf[48];
+      snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+      _s = buf;
+    }
+};
+
+class Print;
+
+class Printable {
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+      size_t n = 0;
+      while (len--) n += write(*buf++);
+      return n;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+    size_t print(const Printable& p) { return p.printTo(*this); }
+    size_t print(const struct tm* t, const char* fmt) {
+      char buf[64];
+      strftime(buf, sizeof(buf), fmt, t);
+      return write(buf);
+    }
+
+    template <typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + write("\r\n"); }
+    size_t println(const struct tm* t, const char* fmt) { size_t n = print(t, fmt); return n + write("\r\n"); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+      char buf[512];
+      va_list ap;
+      va_start(ap, fmt);
+      int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+      va_end(ap);
+      if (n < 0) return 0;
+      return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+    }
+};
+
+class Stream : public Print {
+  public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { _timeout = ms; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    // Waits up to the timeout for each byte, like the Arduino core
+    size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+    size_t readBytes(uint8_t* buf, size_t len);
+    String readStringUntil(char terminator);
+
+  protected:
+    unsigned long _timeout;
+    int _timedRead();
+};
+
+/** Serial writes to stdout, or wherever nativeSetSerialOutput() points it. */
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+extern HardwareSerial Serial;
+
+/** Redirect Serial output; nullptr silences it (e.g. for thousands of simulated devices). */
+void nativeSetSerialOutput(FILE* out);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+/**
+ * Replace the time source behind millis()/micros()/delay(), e.g. with a
+ * virtual clock for replay. Pass nullptrs to restore wall-clock time.
+ */
+void nativeSetClock(uint64_t (*nowMicros)(), void (*sleepMicros)(uint64_t));
+
+/**
+ * Set the wall clock, as SNTP does on the ESP32: time() then counts on
+ * from epochMs at the pace of the clock above. src/ calls the C library's
+ * time() directly, so the shim interposes it.
+ */
+void nativeSetEpoch(uint64_t epochMs);
+
+// GPIO is a plain array of levels (inputs idle HIGH, as with pull-ups).
+// Tools drive inputs with nativeSetPin(), which also runs an attached ISR on a matching edge.
+void nativeSetPin(uint8_t pin, uint8_t level);
+
+int  digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void pinMode(uint8_t pin, uint8_t mode);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/** Draw random() values from `source` instead of rand(), e.g. replayed ones; nullptr restores rand(). */
+void nativeSetRandom(long (*source)(long min, long max));
+
+void   ledcAttachPin(uint8_t pin, uint8_t channel);
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution);
+double ledcWriteTone(uint8_t channel, double freq);
+void   ledcWrite(uint8_t channel, uint32_t duty);
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+#endif
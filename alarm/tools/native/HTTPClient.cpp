@@ -0,0 +1,196 @@
+#include <HTTPClient.h>
+#include <strings.h>
+
+std::string httpRequestHead(const char* method, const char* host, uint16_t port, const char* uri,
+                            bool http10, bool reuse, const std::string& extraHeaders) {
+  std::string head = std::string(method) + " " + (uri && *uri ? uri : "/") + " HTTP/1." + (http10 ? "0" : "1");
+  head += "\r\nHost: ";
+  head += host;
+  if (port != 80 && port != 443) head += ":" + std::to_string(port);
+  head += "\r\nUser-Agent: ESP32HTTPClient";
+  if (!http10) head += "\r\nAccept-Encoding: identity;q=1,chunked;q=0.1,*;q=0";
+  head += "\r\nConnection: ";
+  head += reuse ? "keep-alive" : "close";
+  head += "\r\n";
+  head += extraHeaders;
+  head += "\r\n";
+  return head;
+}
+
+HTTPClient::HTTPClient()
+  : _client(nullptr)
+  , _port(80)
+  , _http10(false)
+  , _reuse(true)
+  , _chunked(false)
+  , _timeoutMs(HTTPCLIENT_DEFAULT_TCP_TIMEOUT)
+  , _connectTimeoutMs(HTTPCLIENT_DEFAULT_TCP_TIMEOUT)
+  , _size(-1)
+{}
+
+bool HTTPClient::begin(WiFiClient& client, const char* host, uint16_t port, const char* uri, bool) {
+  _client = &client;
+  _host = host;
+  _port = port;
+  _uri = uri ? uri : "/";
+  _headers.clear();
+  _size = -1;
+  return true;
+}
+
+void HTTPClient::end() {
+  if (_client) _client->stop();
+  _client = nullptr;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+  std::string key = std::string(name.c_str()) + ": ";
+  if (replace) {
+    size_t at = _headers.find(key);
+    if (at != std::string::npos) _headers.erase(at, _headers.find("\r\n", at) + 2 - at);
+  }
+  std::string line = key + value.c_str() + "\r\n";
+  _headers = first ? line + _headers : _headers + line;
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], size_t count) {
+  _collected.clear();
+  for (size_t i = 0; i < count; ++i) _collected.push_back(std::make_pair(std::string(headerKeys[i]), std::string()));
+}
+
+String HTTPClient::header(const char* name) {
+  for (size_t i = 0; i < _collected.size(); ++i) {
+    if (strcasecmp(_collected[i].first.c_str(), name) == 0) return String(_collected[i].second);
+  }
+  return String();
+}
+
+int HTTPClient::GET() {
+  return sendRequest("GET");
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+  return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::sendRequest(const char* type, uint8_t* payload, size_t size) {
+  if (!_client) return HTTPC_ERROR_NOT_CONNECTED;
+  // Like the ESP32 core, keep a connection the caller already opened
+  if (!_client->connected() && !_client->connect(_host.c_str(), _port, _connectTimeoutMs)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  _client->setTimeout(_timeoutMs);
+
+  if (payload && size > 0) addHeader("Content-Length", String((unsigned long)size));
+  std::string head = httpRequestHead(type, _host.c_str(), _port, _uri.c_str(), _http10, _reuse, _headers);
+  if (_client->write((const uint8_t*)head.data(), head.size()) != head.size()) return HTTPC_ERROR_SEND_HEADER_FAILED;
+  if (payload && size > 0 && _client->write(payload, size) != size) return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+
+  return _readResponseHead();
+}
+
+bool HTTPClient::_readLine(std::string& line) {
+  line.clear();
+  unsigned long start = millis();
+  while (millis() - start < _timeoutMs) {
+    int c = _client->read();
+    if (c < 0) {
+      if (!_client->connected()) return false;
+      delay(1);
+      continue;
+    }
+    if (c == '\n') return true;
+    if (c != '\r') line += (char)c;
+  }
+  return false;
+}
+
+int HTTPClient::_readResponseHead() {
+  std::string line;
+  int status = 0;
+  _size = -1;
+  _chunked = false;
+  for (size_t i = 0; i < _collected.size(); ++i) _collected[i].second.clear();
+
+  while (true) {
+    if (!_readLine(line)) return _client->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+    if (status == 0) {
+      if (line.compare(0, 5, "HTTP/") != 0) return HTTPC_ERROR_NO_HTTP_SERVER;
+      size_t sp = line.find(' ');
+      status = sp == std::string::npos ? 0 : atoi(line.c_str() + sp + 1);
+      // Like the ESP32 library, skip interim 100 Continue responses
+      if (status == 100) status = -1;
+      continue;
+    }
+    if (line.empty()) {
+      if (status == -1) {
+        status = 0;
+        continue;
+      }
+      return status;
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = line.substr(0, colon);
+    std::string value = line.substr(line.find_first_not_of(' ', colon + 1) == std::string::npos
+                                    ? line.size() : line.find_first_not_of(' ', colon + 1));
+    if (strcasecmp(name.c_str(), "Content-Length") == 0) _size = atoi(value.c_str());
+    if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0 && strcasecmp(value.c_str(), "chunked") == 0) _chunked = true;
+    for (size_t i = 0; i < _collected.size(); ++i) {
+      if (strcasecmp(_collected[i].first.c_str(), name.c_str()) == 0) _collected[i].second = value;
+    }
+  }
+}
+
+String HTTPClient::getString() {
+  if (!_client) return String();
+  std::string body;
+  char buf[256];
+
+  if (_chunked) {
+    std::string line;
+    while (_readLine(line)) {
+      long len = strtol(line.c_str(), nullptr, 16);
+      if (len <= 0) break;
+      while (len > 0) {
+        size_t n = _client->readBytes(buf, len < (long)sizeof(buf) ? (size_t)len : sizeof(buf));
+        if (n == 0) return String(body);
+        body.append(buf, n);
+        len -= n;
+      }
+      _readLine(line);  // CRLF after the chunk data
+    }
+    return String(body);
+  }
+
+  // Without Content-Length the body ends when the server closes the connection
+  unsigned long lastData = millis();
+  while (_size < 0 || (int)body.size() < _size) {
+    size_t want = sizeof(buf);
+    if (_size >= 0 && (size_t)(_size - body.size()) < want) want = _size - body.size();
+    int n = _client->read((uint8_t*)buf, want);
+    if (n > 0) {
+      body.append(buf, n);
+      lastData = millis();
+    } else if (!_client->connected() || millis() - lastData >= _timeoutMs) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  return String(body);
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:  return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED:  return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED:       return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:     return "connection lost";
+    case HTTPC_ERROR_NO_HTTP_SERVER:      return "no HTTP server";
+    case HTTPC_ERROR_READ_TIMEOUT:        return "read Timeout";
+    default:                              return String();
+  }
+}
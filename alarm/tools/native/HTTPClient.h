@@ -0,0 +1,85 @@
+// Native HTTPClient: the subset of the arduino-esp32 HTTPClient that src/ uses,
+// on top of the native WiFiClient. Requests are formatted exactly like the
+// ESP32 library formats them (see httpRequestHead()).
+
+#ifndef NATIVE_HTTPCLIENT_H
+#define NATIVE_HTTPCLIENT_H
+
+#include <WiFiClient.h>
+#include <string>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT 5000
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_UNSUPPORTED_MEDIA_TYPE 415
+
+/**
+ * Request line and headers as sent by the ESP32 HTTPClient, including the
+ * terminating blank line. `extraHeaders` are complete "Name: value\r\n" lines.
+ * Shared with the host tools so simulated devices send the same bytes.
+ */
+std::string httpRequestHead(const char* method, const char* host, uint16_t port, const char* uri,
+                            bool http10, bool reuse, const std::string& extraHeaders);
+
+class HTTPClient {
+  public:
+    HTTPClient();
+    ~HTTPClient() { end(); }
+
+    bool begin(WiFiClient& client, const char* host, uint16_t port, const char* uri = "/", bool https = false);
+    void end();
+
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void collectHeaders(const char* headerKeys[], size_t count);
+    String header(const char* name);
+
+    void useHTTP10(bool usehttp10 = true) { _http10 = usehttp10; }
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t ms) { _timeoutMs = ms; }
+    void setConnectTimeout(int32_t ms) { _connectTimeoutMs = ms; }
+
+    int GET();
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload) { return POST((uint8_t*)payload.c_str(), payload.length()); }
+    int sendRequest(const char* type, uint8_t* payload = nullptr, size_t size = 0);
+
+    int getSize() const { return _size; }
+    WiFiClient& getStream() { return *_client; }
+    WiFiClient* getStreamPtr() { return _client; }
+    String getString();
+
+    bool connected() { return _client && _client->connected(); }
+    static String errorToString(int error);
+
+  private:
+    WiFiClient* _client;
+    std::string _host;
+    uint16_t    _port;
+    std::string _uri;
+    std::string _headers;
+    bool        _http10;
+    bool        _reuse;
+    bool        _chunked;
+    uint16_t    _timeoutMs;
+    int32_t     _connectTimeoutMs;
+    int         _size;
+    std::vector<std::pair<std::string, std::string> > _collected;
+
+    int _readResponseHead();
+    bool _readLine(std::string& line);
+};
+
+#endif
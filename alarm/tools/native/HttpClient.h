@@ -0,0 +1,2 @@
+// The firmware includes both spellings; on a case-sensitive file system they are one header.
+#include <HTTPClient.h>
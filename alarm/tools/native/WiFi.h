@@ -0,0 +1,26 @@
+// Native WiFi: the host network is always "connected".
+
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <WiFiClient.h>
+
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+class WiFiClass {
+  public:
+    void begin(const char*, const char*) {}
+    int status() { return WL_CONNECTED; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    int RSSI() { return -50; }
+    void mode(int) {}
+    void setSleep(bool) {}
+    void disconnect(bool = false) {}
+};
+
+extern WiFiClass WiFi;
+
+#endif
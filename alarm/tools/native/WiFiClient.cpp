@@ -0,0 +1,143 @@
+#include <WiFiClient.h>
+#include <WiFi.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _addr[0], _addr[1], _addr[2], _addr[3]);
+  return String(buf);
+}
+
+WiFiClient::WiFiClient() : _fd(-1), _rxPos(0), _rxLen(0) {}
+
+WiFiClient::~WiFiClient() {
+  stop();
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, 3000);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, 3000);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+  return connect(ip.toString().c_str(), port, timeoutMs);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  stop();
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* res = nullptr;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &res) != 0 || !res) return 0;
+
+  int fd = socket(res->ai_family, SOCK_STREAM, 0);
+  if (fd < 0) {
+    freeaddrinfo(res);
+    return 0;
+  }
+
+  // Non-blocking connect so the timeout is honored, then back to blocking I/O
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (rc < 0 && errno == EINPROGRESS) {
+    struct pollfd p = { fd, POLLOUT, 0 };
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (poll(&p, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+      rc = 0;
+    }
+  }
+  if (rc < 0) {
+    close(fd);
+    return 0;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+  _fd = fd;
+  _rxPos = _rxLen = 0;
+  setNoDelay(true);
+  return 1;
+}
+
+void WiFiClient::setNoDelay(bool nodelay) {
+  if (_fd < 0) return;
+  int one = nodelay ? 1 : 0;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+  if (_fd < 0) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(_fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    sent += n;
+  }
+  return sent;
+}
+
+size_t WiFiClient::_fill() {
+  if (_rxPos < _rxLen) return _rxLen - _rxPos;
+  if (_fd < 0) return 0;
+  ssize_t n = recv(_fd, _rx, sizeof(_rx), MSG_DONTWAIT);
+  _rxPos = 0;
+  _rxLen = n > 0 ? (size_t)n : 0;
+  return _rxLen;
+}
+
+int WiFiClient::available() {
+  return (int)_fill();
+}
+
+int WiFiClient::read() {
+  if (!_fill()) return -1;
+  return _rx[_rxPos++];
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+  size_t have = _fill();
+  if (!have) return -1;
+  size_t n = size < have ? size : have;
+  memcpy(buf, _rx + _rxPos, n);
+  _rxPos += n;
+  return (int)n;
+}
+
+int WiFiClient::peek() {
+  if (!_fill()) return -1;
+  return _rx[_rxPos];
+}
+
+void WiFiClient::stop() {
+  if (_fd >= 0) close(_fd);
+  _fd = -1;
+  _rxPos = _rxLen = 0;
+}
+
+uint8_t WiFiClient::connected() {
+  if (_fd < 0) return 0;
+  if (_rxPos < _rxLen) return 1;
+  char c;
+  ssize_t n = recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0) return 1;
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 1;
+  return 0;
+}
@@ -0,0 +1,68 @@
+// Native WiFiClient: a blocking POSIX TCP socket with the Arduino Client API.
+
+#ifndef NATIVE_WIFICLIENT_H
+#define NATIVE_WIFICLIENT_H
+
+#include <Arduino.h>
+
+class IPAddress : public Printable {
+  public:
+    IPAddress() : _addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr{a, b, c, d} {}
+    uint8_t operator[](int i) const { return _addr[i]; }
+    String toString() const;
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+
+  private:
+    uint8_t _addr[4];
+};
+
+class Client : public Stream {
+  public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    using Stream::read;
+};
+
+class WiFiClient : public Client {
+  public:
+    WiFiClient();
+    ~WiFiClient();
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    virtual int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    virtual int connect(const char* host, uint16_t port, int32_t timeoutMs);
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() { return _fd >= 0; }
+
+    void setNoDelay(bool nodelay);
+    int fd() const { return _fd; }
+
+  private:
+    int     _fd;
+    uint8_t _rx[1024];
+    size_t  _rxPos;
+    size_t  _rxLen;
+
+    // Pull whatever the socket has without blocking; returns buffered byte count
+    size_t _fill();
+};
+
+#endif
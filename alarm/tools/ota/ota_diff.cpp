@@ -0,0 +1,483 @@
+// Builds firmware patches for OtaUpdater (format in src/core/DeltaPatch.h),
+// and applies them on the host with the firmware's own DeltaPatcher.
+//
+//   g++ -std=c++11 -O2 -Isrc -o ota_diff tools/ota/ota_diff.cpp src/core/DeltaPatch.cpp src/core/Sha256.cpp
+//
+//   ota_diff BASE IMAGE PATCH        patch from BASE to IMAGE (bsdiff + LZSS)
+//   ota_diff --full IMAGE PATCH      IMAGE as a patch for any base (LZSS only)
+//   ota_diff --apply BASE PATCH OUT  apply PATCH to BASE
+//   ota_diff --hash IMAGE            the SHA-256 the device sends as ?from=
+//
+// BASE and IMAGE are firmware.bin files as PlatformIO builds them
+// (.pio/build/<env>/firmware.bin), byte for byte what is in the app slot.
+// Every patch is applied again before it is written, so a patch that is
+// written is known to reproduce IMAGE. The report compares the patch with
+// the image it replaces, and with the full-image patch.
+//
+// The diff is Colin Percival's bsdiff: a suffix array of BASE finds long
+// approximate matches, which become add runs (mostly zero bytes where only
+// addresses moved) and copy runs for the new bytes in between. LZSS then
+// removes the zeros and repeats within a 2 KB window, which is what the
+// device can afford to keep.
+
+#include <core/DeltaPatch.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+bool readFile(const char* path, Bytes& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+bool writeFile(const char* path, const Bytes& data) {
+  FILE* f = fopen(path, "wb");
+  if (!f || fwrite(data.data(), 1, data.size(), f) != data.size()) {
+    perror(path);
+    if (f) fclose(f);
+    return false;
+  }
+  return fclose(f) == 0;
+}
+
+void sha256(const Bytes& data, uint8_t digest[Sha256::DIGEST_SIZE]) {
+  Sha256 hash;
+  hash.update(data.data(), data.size());
+  hash.finish(digest);
+}
+
+std::string hex(const uint8_t* bytes, size_t len) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < len; ++i) {
+    out += digits[bytes[i] >> 4];
+    out += digits[bytes[i] & 0xF];
+  }
+  return out;
+}
+
+// ---- bsdiff ----
+
+struct Instruction {
+  uint32_t add, copy;
+  int64_t  seek;
+  size_t   addAt, copyAt;  // into the diff and extra bytes
+};
+
+// Suffix array of `data` by prefix doubling, with the empty suffix first as bsdiff expects
+std::vector<int32_t> suffixArray(const Bytes& data) {
+  int32_t n = (int32_t)data.size();
+  std::vector<int32_t> sa(n), rank(n), next(n);
+  for (int32_t i = 0; i < n; ++i) {
+    sa[i] = i;
+    rank[i] = data[i];
+  }
+  for (int32_t k = 1; n > 1; k *= 2) {
+    auto key = [&](int32_t i) { return std::make_pair(rank[i], i + k < n ? rank[i + k] : -1); };
+    std::sort(sa.begin(), sa.end(), [&](int32_t a, int32_t b) { return key(a) < key(b); });
+    next[sa[0]] = 0;
+    for (int32_t i = 1; i < n; ++i) next[sa[i]] = next[sa[i - 1]] + (key(sa[i - 1]) < key(sa[i]) ? 1 : 0);
+    rank.swap(next);
+    if (rank[sa[n - 1]] == n - 1) break;
+  }
+  sa.insert(sa.begin(), n);
+  return sa;
+}
+
+int64_t matchLength(const uint8_t* a, int64_t aLen, const uint8_t* b, int64_t bLen) {
+  int64_t i = 0;
+  while (i < aLen && i < bLen && a[i] == b[i]) i++;
+  return i;
+}
+
+// Longest match of `target` among the suffixes sa[lo..hi] of base
+int64_t search(const std::vector<int32_t>& sa, const Bytes& base, const uint8_t* target, int64_t targetLen,
+               int64_t lo, int64_t hi, int64_t& pos) {
+  int64_t baseLen = (int64_t)base.size();
+  while (hi - lo >= 2) {
+    int64_t mid = lo + (hi - lo) / 2;
+    int64_t n = std::min(baseLen - sa[mid], targetLen);
+    if (memcmp(base.data() + sa[mid], target, n) < 0) lo = mid;
+    else hi = mid;
+  }
+  int64_t x = matchLength(base.data() + sa[lo], baseLen - sa[lo], target, targetLen);
+  int64_t y = matchLength(base.data() + sa[hi], baseLen - sa[hi], target, targetLen);
+  pos = x > y ? sa[lo] : sa[hi];
+  return x > y ? x : y;
+}
+
+void bsdiff(const Bytes& base, const Bytes& image, std::vector<Instruction>& program, Bytes& diff, Bytes& extra) {
+  std::vector<int32_t> sa = suffixArray(base);
+  int64_t oldSize = (int64_t)base.size(), newSize = (int64_t)image.size();
+  const uint8_t* o = base.data();
+  const uint8_t* n = image.data();
+
+  int64_t scan = 0, len = 0, pos = 0, lastScan = 0, lastPos = 0, lastOffset = 0;
+  while (scan < newSize) {
+    int64_t oldScore = 0;
+    int64_t scsc;
+    for (scsc = scan += len; scan < newSize; scan++) {
+      len = search(sa, base, n + scan, newSize - scan, 0, oldSize, pos);
+      for (; scsc < scan + len; scsc++) {
+        if (scsc + lastOffset < oldSize && o[scsc + lastOffset] == n[scsc]) oldScore++;
+      }
+      if ((len == oldScore && len != 0) || len > oldScore + 8) break;
+      if (scan + lastOffset < oldSize && o[scan + lastOffset] == n[scan]) oldScore--;
+    }
+    if (len == oldScore && scan != newSize) continue;
+
+    // Extend the last match forward and this one backward, then split their overlap
+    int64_t s = 0, best = 0, lenForward = 0;
+    for (int64_t i = 0; lastScan + i < scan && lastPos + i < oldSize;) {
+      if (o[lastPos + i] == n[lastScan + i]) s++;
+      i++;
+      if (s * 2 - i > best * 2 - lenForward) {
+        best = s;
+        lenForward = i;
+      }
+    }
+    int64_t lenBack = 0;
+    if (scan < newSize) {
+      s = 0;
+      best = 0;
+      for (int64_t i = 1; scan >= lastScan + i && pos >= i; i++) {
+        if (o[pos - i] == n[scan - i]) s++;
+        if (s * 2 - i > best * 2 - lenBack) {
+          best = s;
+          lenBack = i;
+        }
+      }
+    }
+    if (lastScan + lenForward > scan - lenBack) {
+      int64_t overlap = lastScan + lenForward - (scan - lenBack);
+      int64_t lenSplit = 0;
+      s = 0;
+      best = 0;
+      for (int64_t i = 0; i < overlap; i++) {
+        if (n[lastScan + lenForward - overlap + i] == o[lastPos + lenForward - overlap + i]) s++;
+        if (n[scan - lenBack + i] == o[pos - lenBack + i]) s--;
+        if (s > best) {
+          best = s;
+          lenSplit = i + 1;
+        }
+      }
+      lenForward += lenSplit - overlap;
+      lenBack -= lenSplit;
+    }
+
+    Instruction in;
+    in.add = (uint32_t)lenForward;
+    in.copy = (uint32_t)(scan - lenBack - (lastScan + lenForward));
+    in.seek = pos - lenBack - (lastPos + lenForward);
+    in.addAt = diff.size();
+    in.copyAt = extra.size();
+    for (int64_t i = 0; i < lenForward; i++) diff.push_back((uint8_t)(n[lastScan + i] - o[lastPos + i]));
+    extra.insert(extra.end(), n + lastScan + lenForward, n + scan - lenBack);
+
+    // An empty instruction only moves the base position: fold it into the one before
+    if (in.add == 0 && in.copy == 0 && !program.empty()) program.back().seek += in.seek;
+    else program.push_back(in);
+
+    lastScan = scan - lenBack;
+    lastPos = pos - lenBack;
+    lastOffset = pos - scan;
+  }
+}
+
+// ---- Patch stream ----
+
+void putVarint(Bytes& out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t)v);
+}
+
+Bytes serialize(const std::vector<Instruction>& program, const Bytes& diff, const Bytes& extra) {
+  Bytes out;
+  for (size_t i = 0; i < program.size(); ++i) {
+    const Instruction& in = program[i];
+    putVarint(out, in.add);
+    putVarint(out, in.copy);
+    putVarint(out, (uint64_t)(in.seek << 1) ^ (uint64_t)(in.seek >> 63));
+    out.insert(out.end(), diff.begin() + in.addAt, diff.begin() + in.addAt + in.add);
+    out.insert(out.end(), extra.begin() + in.copyAt, extra.begin() + in.copyAt + in.copy);
+  }
+  return out;
+}
+
+class BitWriter {
+  public:
+    explicit BitWriter(Bytes& out) : _out(out), _bits(0), _count(0) {}
+    void put(uint32_t value, uint8_t count) {
+      _bits = _bits << count | (value & ((1u << count) - 1));
+      _count += count;
+      while (_count >= 8) {
+        _count -= 8;
+        _out.push_back((uint8_t)(_bits >> _count));
+      }
+    }
+    void flush() {
+      if (_count) _out.push_back((uint8_t)(_bits << (8 - _count)));
+      _count = 0;
+    }
+
+  private:
+    Bytes&   _out;
+    uint64_t _bits;
+    uint8_t  _count;
+};
+
+// LZSS with hash chains and one step of lazy matching, in DeltaPatcher's token format
+Bytes lzss(const Bytes& in) {
+  const int64_t WINDOW = DeltaPatcher::WINDOW;
+  const int64_t MIN_MATCH = DeltaPatcher::MIN_MATCH;
+  const int64_t MAX_MATCH = DeltaPatcher::MAX_MATCH;
+  const uint32_t HASH_SIZE = 1 << 15;
+  const int MAX_CHAIN = 256;
+
+  int64_t n = (int64_t)in.size();
+  std::vector<int64_t> head(HASH_SIZE, -1), prev(n, -1);
+  auto hashAt = [&](int64_t i) {
+    return ((uint32_t)in[i] << 10 ^ (uint32_t)in[i + 1] << 5 ^ in[i + 2]) & (HASH_SIZE - 1);
+  };
+  auto insert = [&](int64_t i) {
+    if (i + MIN_MATCH > n) return;
+    uint32_t h = hashAt(i);
+    prev[i] = head[h];
+    head[h] = i;
+  };
+  auto longest = [&](int64_t i, int64_t& distance) {
+    int64_t best = 0;
+    if (i + MIN_MATCH > n) return best;
+    int64_t limit = std::min(MAX_MATCH, n - i);
+    int chain = MAX_CHAIN;
+    for (int64_t j = head[hashAt(i)]; j >= 0 && i - j <= WINDOW && chain-- > 0; j = prev[j]) {
+      int64_t len = 0;
+      while (len < limit && in[j + len] == in[i + len]) len++;
+      if (len > best) {
+        best = len;
+        distance = i - j;
+        if (len == limit) break;
+      }
+    }
+    return best;
+  };
+
+  Bytes out;
+  BitWriter bits(out);
+  int64_t i = 0;
+  while (i < n) {
+    int64_t distance = 0;
+    int64_t len = longest(i, distance);
+    if (len >= MIN_MATCH && i + 1 < n) {
+      // Take a literal if the match one byte later is longer
+      insert(i);
+      int64_t nextDistance = 0;
+      int64_t next = longest(i + 1, nextDistance);
+      if (next > len) {
+        bits.put(1, 1);
+        bits.put(in[i], 8);
+        i++;
+        continue;
+      }
+      bits.put(0, 1);
+      bits.put((uint32_t)(distance - 1), 11);
+      bits.put((uint32_t)(len - MIN_MATCH), 8);
+      for (int64_t k = 1; k < len; ++k) insert(i + k);
+      i += len;
+      continue;
+    }
+    insert(i);
+    if (len >= MIN_MATCH) {
+      bits.put(0, 1);
+      bits.put((uint32_t)(distance - 1), 11);
+      bits.put((uint32_t)(len - MIN_MATCH), 8);
+      for (int64_t k = 1; k < len; ++k) insert(i + k);
+      i += len;
+    } else {
+      bits.put(1, 1);
+      bits.put(in[i], 8);
+      i++;
+    }
+  }
+  bits.flush();
+  return out;
+}
+
+void putLe32(Bytes& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+Bytes makePatch(const Bytes* base, const Bytes& image) {
+  std::vector<Instruction> program;
+  Bytes diff, extra;
+  if (base) {
+    bsdiff(*base, image, program, diff, extra);
+  } else {
+    Instruction all = { 0, (uint32_t)image.size(), 0, 0, 0 };
+    program.push_back(all);
+    extra = image;
+  }
+
+  Bytes patch(DELTA_MAGIC, DELTA_MAGIC + sizeof(DELTA_MAGIC));
+  putLe32(patch, base ? (uint32_t)base->size() : 0);
+  putLe32(patch, (uint32_t)image.size());
+  uint8_t digest[Sha256::DIGEST_SIZE] = {};
+  if (base) sha256(*base, digest);
+  patch.insert(patch.end(), digest, digest + sizeof(digest));
+  sha256(image, digest);
+  patch.insert(patch.end(), digest, digest + sizeof(digest));
+
+  Bytes body = lzss(serialize(program, diff, extra));
+  patch.insert(patch.end(), body.begin(), body.end());
+  return patch;
+}
+
+// ---- Applying ----
+
+class MemoryImage : public FirmwareImage {
+  public:
+    explicit MemoryImage(const Bytes& data) : _data(data) {}
+    bool read(uint32_t offset, uint8_t* data, size_t len) override {
+      if (offset + len > _data.size()) return false;
+      memcpy(data, _data.data() + offset, len);
+      return true;
+    }
+
+  private:
+    const Bytes& _data;
+};
+
+class MemorySink : public ByteSink {
+  public:
+    bool write(const uint8_t* data, size_t len) override {
+      bytes.insert(bytes.end(), data, data + len);
+      return true;
+    }
+    Bytes bytes;
+};
+
+// In pieces of odd sizes, the way a socket would deliver it
+DeltaPatcher::Status apply(const Bytes& base, const Bytes& patch, Bytes& image) {
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  sha256(base, digest);
+  MemoryImage baseImage(base);
+  MemorySink out;
+  DeltaPatcher patcher(baseImage, (uint32_t)base.size(), digest, out);
+  for (size_t at = 0; at < patch.size();) {
+    size_t n = std::min(patch.size() - at, (size_t)(1 + at % 1460));
+    if (!patcher.write(patch.data() + at, n)) break;
+    at += n;
+  }
+  image.swap(out.bytes);
+  return patcher.finish();
+}
+
+bool verified(const Bytes* base, const Bytes& image, const Bytes& patch) {
+  Bytes none, result;
+  DeltaPatcher::Status status = apply(base ? *base : none, patch, result);
+  if (status != DeltaPatcher::Done || result != image) {
+    fprintf(stderr, "the patch does not reproduce the image (%s)\n", DeltaPatcher::statusName(status));
+    return false;
+  }
+  return true;
+}
+
+double percent(size_t part, size_t whole) {
+  return whole ? 100.0 * part / whole : 0;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: ota_diff BASE IMAGE PATCH\n"
+          "       ota_diff --full IMAGE PATCH\n"
+          "       ota_diff --apply BASE PATCH OUT\n"
+          "       ota_diff --hash IMAGE\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string mode = argc > 1 ? argv[1] : "";
+  uint8_t digest[Sha256::DIGEST_SIZE];
+
+  if (mode == "--hash" && argc == 3) {
+    Bytes image;
+    if (!readFile(argv[2], image)) return 1;
+    sha256(image, digest);
+    printf("%s\n", hex(digest, sizeof(digest)).c_str());
+    return 0;
+  }
+
+  if (mode == "--apply" && argc == 5) {
+    Bytes base, patch, image;
+    if (!readFile(argv[2], base) || !readFile(argv[3], patch)) return 1;
+    DeltaPatcher::Status status = apply(base, patch, image);
+    if (status != DeltaPatcher::Done) {
+      fprintf(stderr, "%s: %s after %zu B of output\n", argv[3], DeltaPatcher::statusName(status), image.size());
+      return 1;
+    }
+    if (!writeFile(argv[4], image)) return 1;
+    sha256(image, digest);
+    printf("%s: %zu B, %s\n", argv[4], image.size(), hex(digest, sizeof(digest)).c_str());
+    return 0;
+  }
+
+  bool full = mode == "--full" && argc == 4;
+  if (!full && (argc != 4 || mode[0] == '-')) {
+    usage();
+    return 2;
+  }
+
+  Bytes base, image;
+  const char* imagePath = argv[2];
+  const char* patchPath = argv[3];
+  if (!full) {
+    if (!readFile(argv[1], base) || !readFile(argv[2], image)) return 1;
+  } else if (!readFile(imagePath, image)) {
+    return 1;
+  }
+  if (image.empty() || (!full && base.empty())) {
+    fprintf(stderr, "empty image\n");
+    return 1;
+  }
+
+  Bytes whole = makePatch(nullptr, image);
+  if (!verified(nullptr, image, whole)) return 1;
+  if (full) {
+    if (!writeFile(patchPath, whole)) return 1;
+    sha256(image, digest);
+    printf("image  %8zu B  %s\n", image.size(), hex(digest, sizeof(digest)).c_str());
+    printf("patch  %8zu B  %.1f %% of the image (full image, any base)\n", whole.size(),
+           percent(whole.size(), image.size()));
+    return 0;
+  }
+
+  Bytes patch = makePatch(&base, image);
+  if (!verified(&base, image, patch)) return 1;
+  if (!writeFile(patchPath, patch)) return 1;
+  sha256(base, digest);
+  printf("base   %8zu B  %s\n", base.size(), hex(digest, sizeof(digest)).c_str());
+  sha256(image, digest);
+  printf("image  %8zu B  %s\n", image.size(), hex(digest, sizeof(digest)).c_str());
+  printf("patch  %8zu B  %.1f %% of the image, %.1f %% of the full-image patch (%zu B)\n", patch.size(),
+         percent(patch.size(), image.size()), percent(patch.size(), whole.size()), whole.size());
+  return 0;
+}
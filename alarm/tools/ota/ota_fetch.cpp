@@ -0,0 +1,176 @@
+// Does what OtaUpdater does on the device, natively: asks the server for a
+// patch from BASE, and applies it as it downloads, through the firmware's
+// own WifiModule and DeltaPatcher. With mock_backend --firmware this tests
+// an update end to end on Linux, faults included (--drip, --timeout).
+//
+//   g++ -std=gnu++11 -O2 -DWIFIMODULE_TLS=0 -Itools/native -Isrc -o ota_fetch tools/ota/ota_fetch.cpp tools/native/*.cpp src/core/DeltaPatch.cpp src/core/Sha256.cpp src/core/GzipWriter.cpp src/hal/WifiModule.cpp src/core/Log.cpp src/core/LogFormat.cpp src/core/CircuitBreaker.cpp src/core/Energy.cpp -lpthread
+//
+//   ./ota_fetch [--server host:port] [--path /api/firmware] BASE OUT
+//
+// BASE stands for the running slot and OUT for the other one. The request,
+// the read loop and the checks are OtaUpdater's. It prints how many bytes
+// came over the wire against the size of the image they produced, and
+// exits 0 if OUT holds the new image or BASE is up to date.
+
+#include <core/DeltaPatch.h>
+#include <hal/WifiModule.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+WifiModule wifi("native", "");
+
+namespace {
+
+class FileImage : public FirmwareImage {
+  public:
+    explicit FileImage(const std::vector<uint8_t>& data) : _data(data) {}
+    bool read(uint32_t offset, uint8_t* data, size_t len) override {
+      if (offset + len > _data.size()) return false;
+      memcpy(data, _data.data() + offset, len);
+      return true;
+    }
+
+  private:
+    const std::vector<uint8_t>& _data;
+};
+
+class FileSink : public ByteSink {
+  public:
+    explicit FileSink(FILE* f) : _f(f) {}
+    bool write(const uint8_t* data, size_t len) override { return fwrite(data, 1, len, _f) == len; }
+
+  private:
+    FILE* _f;
+};
+
+// OtaUpdater::onResponse() without the partitions
+class PatchDownload : public ResponseHandler {
+  public:
+    PatchDownload(const std::vector<uint8_t>& base, const uint8_t* baseHash, FILE* out)
+      : image(base), sink(out), patcher(image, (uint32_t)base.size(), baseHash, sink), upToDate(false) {}
+
+    bool onResponse(int status, Stream& body, int contentLength) override {
+      if (status == 204) {
+        upToDate = true;
+        return true;
+      }
+      if (status != 200) return false;
+
+      uint8_t chunk[256];
+      unsigned long start = millis();
+      while (patcher.status() == DeltaPatcher::Running && millis() - start < 5UL * 60UL * 1000UL) {
+        size_t want = sizeof(chunk);
+        if (contentLength >= 0) {
+          if (patcher.patchBytes() >= (uint32_t)contentLength) break;
+          if ((uint32_t)contentLength - patcher.patchBytes() < want) want = contentLength - patcher.patchBytes();
+        }
+        size_t n = body.readBytes(chunk, want);
+        if (n == 0) break;
+        patcher.write(chunk, n);
+      }
+      return patcher.finish() == DeltaPatcher::Done;
+    }
+
+    FileImage    image;
+    FileSink     sink;
+    DeltaPatcher patcher;
+    bool         upToDate;
+};
+
+void usage() {
+  fprintf(stderr, "usage: ota_fetch [--server host:port] [--path /api/firmware] BASE OUT\n");
+}
+
+std::string hex(const uint8_t* bytes, size_t len) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < len; ++i) {
+    out += digits[bytes[i] >> 4];
+    out += digits[bytes[i] & 0xF];
+  }
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string host = "127.0.0.1";
+  uint16_t port = 5000;
+  std::string path = "/api/firmware";
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--server" && hasValue) {
+      std::string hp = argv[++i];
+      size_t colon = hp.find(':');
+      host = hp.substr(0, colon);
+      if (colon != std::string::npos) port = (uint16_t)atoi(hp.c_str() + colon + 1);
+    }
+    else if (arg == "--path" && hasValue) path = argv[++i];
+    else if (arg[0] != '-') files.push_back(argv[i]);
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (files.size() != 2) {
+    usage();
+    return 2;
+  }
+  nativeSetSerialOutput(nullptr);
+
+  FILE* f = fopen(files[0], "rb");
+  if (!f) {
+    perror(files[0]);
+    return 1;
+  }
+  std::vector<uint8_t> base;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) base.insert(base.end(), buf, buf + n);
+  fclose(f);
+
+  // The device hashes its slot the same way, up to the image's length
+  uint8_t baseHash[Sha256::DIGEST_SIZE];
+  FileImage image(base);
+  hashImage(image, (uint32_t)base.size(), baseHash);
+
+  FILE* out = fopen(files[1], "wb");
+  if (!out) {
+    perror(files[1]);
+    return 1;
+  }
+  PatchDownload download(base, baseHash, out);
+  std::string query = path + "?from=" + hex(baseHash, sizeof(baseHash));
+  unsigned long start = millis();
+  // OtaUpdater's deadline: 30 s to connect plus the 5 min download limit
+  int status = wifi.httpGetStream(host.c_str(), port, query.c_str(), download, 30000 + 5UL * 60UL * 1000UL);
+  unsigned long took = millis() - start;
+  fclose(out);
+
+  printf("GET %s?from=%s... -> %d in %lu ms\n", path.c_str(), hex(baseHash, 4).c_str(), status, took);
+  if (download.upToDate) {
+    remove(files[1]);
+    printf("up to date\n");
+    return 0;
+  }
+  const DeltaPatcher& p = download.patcher;
+  if (p.patchBytes() == 0) {
+    remove(files[1]);
+    printf("failed: no patch\n");
+    return 1;
+  }
+  if (p.status() != DeltaPatcher::Done) {
+    remove(files[1]);
+    printf("failed: %s after %u B of patch, %u B of image\n", DeltaPatcher::statusName(p.status()),
+           p.patchBytes(), p.imageBytes());
+    return 1;
+  }
+  printf("%s: %u B downloaded for a %u B image (%.1f %%), %s\n", p.header().baseSize ? "delta" : "full image",
+         p.patchBytes(), p.imageBytes(), 100.0 * p.patchBytes() / p.imageBytes(),
+         hex(p.header().imageHash, sizeof(p.header().imageHash)).c_str());
+  return 0;
+}
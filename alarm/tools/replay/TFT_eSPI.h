@@ -0,0 +1,35 @@
+// What hal/DisplayDriver.h and core/StatusScreen.cpp use of TFT_eSPI. The
+// calls draw nothing, so StatusScreen's layout and text formatting run (and
+// count in the profile) without a panel.
+
+#ifndef REPLAY_TFT_ESPI_H
+#define REPLAY_TFT_ESPI_H
+
+#include <Arduino.h>
+
+#define TFT_BLACK    0x0000
+#define TFT_WHITE    0xFFFF
+#define TFT_DARKGREY 0x7BEF
+#define TFT_ORANGE   0xFDA0
+#define TFT_RED      0xF800
+#define TFT_GREEN    0x07E0
+
+#define TL_DATUM 0
+#define ML_DATUM 3
+#define BR_DATUM 8
+
+class TFT_eSPI {
+  public:
+    void setTextColor(uint16_t) {}
+    void setTextDatum(uint8_t) {}
+    int16_t drawString(const char*, int32_t, int32_t, uint8_t) { return 0; }
+    void fillCircle(int32_t, int32_t, int32_t, uint32_t) {}
+    void drawCircle(int32_t, int32_t, int32_t, uint32_t) {}
+};
+
+class TFT_eSprite : public TFT_eSPI {
+  public:
+    explicit TFT_eSprite(TFT_eSPI*) {}
+};
+
+#endif
@@ -0,0 +1,6 @@
+// hal/I2cBus.h includes Wire.h; the replay's I2cBus (replay_hal.cpp) does not use it.
+
+#ifndef REPLAY_WIRE_H
+#define REPLAY_WIRE_H
+
+#endif
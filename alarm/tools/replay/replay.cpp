@@ -0,0 +1,298 @@
+// Replays an input trace (src/core/Trace.h) through the firmware's own
+// main.cpp on the host, on a virtual clock.
+//
+//   g++ -std=gnu++11 -O2 -DWIFIMODULE_TLS=0 -Itools/replay -Itools/native -Isrc -I.pio/libdeps/ttgo-lora32-v1/ArduinoJson/src -o replay tools/replay/*.cpp tools/native/*.cpp src/main.cpp src/core/*.cpp src/hal/ButtonDriver.cpp src/hal/LEDDriver.cpp src/hal/BuzzerDriver.cpp
+//
+//   ./replay [--realtime] [--tail SEC] [--quiet] TRACE
+//
+// TRACE is a trace file, or a serial capture with the output of the
+// firmware's `trace` command in it (the last dump in it is used).
+//
+// setup() and loop() run as on the device. Virtual time passes only in
+// delay(), so a day replays in seconds, or at the recorded pace with
+// --realtime. While it passes, the recorded inputs go in when they are due:
+//   Clock     sets the wall clock, as SNTP did
+//   Button    drives the pin; the real ButtonDriver polls and debounces it
+//   Sensor    posts the SensorSample the DHTDriver posted
+// Responses and random draws are handed out in order as the firmware asks
+// for them (replay_wifi.cpp, random()). The stand-in drivers are in
+// replay_hal.cpp.
+//
+// The firmware's serial output goes to stdout (--quiet drops it), with
+// virtual timestamps, so two firmware versions replayed on one trace can
+// be diffed. A summary goes to stderr: what was replayed, the CPU time the
+// firmware took and its slowest loop() pass, and the divergences, i.e.
+// requests and draws the trace had no answer for, and recorded ones left
+// unused. The exit status is 1 if there were any.
+
+#include "replay.h"
+#include <Arduino.h>
+#include <core/Events.h>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+void setup();
+void loop();
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char* const DUMP_START = "# trace ";
+const char* const DUMP_END = "# end of trace";
+
+struct Counts {
+  uint32_t clock, button, sensor, response, random;
+};
+
+std::vector<uint8_t>                        trace;
+std::vector<TraceEvent>                     timeline;   // inputs that go in at their time
+std::map<uint32_t, std::deque<TraceEvent> > responses;  // by request key, in order
+std::deque<long>                            draws;
+size_t   nextEvent = 0;
+uint32_t lastMs = 0;  // of the last record
+uint64_t nowUs = 0;
+bool     realtime = false;
+Clock::time_point realStart;
+Clock::duration   slept(0);  // real time spent pacing --realtime
+
+Counts   recorded = {};
+uint32_t servedResponses = 0, unmatchedResponses = 0;
+uint32_t servedDraws = 0, unmatchedDraws = 0;
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Hex lines between the dump markers; anything else (log lines the log task
+// printed meanwhile, serial noise) is skipped
+bool parseCapture(FILE* f) {
+  std::vector<uint8_t> dump;
+  bool inDump = false, found = false;
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, DUMP_START, strlen(DUMP_START)) == 0) {
+      dump.clear();
+      inDump = true;
+      continue;
+    }
+    if (strncmp(line, DUMP_END, strlen(DUMP_END)) == 0) {
+      if (inDump) trace = dump, found = true;
+      inDump = false;
+      continue;
+    }
+    if (!inDump) continue;
+    size_t n = strcspn(line, "\r\n");
+    bool hex = n > 0 && n % 2 == 0;
+    for (size_t i = 0; i < n && hex; ++i) hex = hexValue(line[i]) >= 0;
+    if (!hex) continue;
+    for (size_t i = 0; i < n; i += 2) dump.push_back((uint8_t)(hexValue(line[i]) << 4 | hexValue(line[i + 1])));
+  }
+  return found;
+}
+
+bool load(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) trace.insert(trace.end(), buf, buf + n);
+
+  TraceReader probe(trace.data(), trace.size());
+  if (!probe.valid()) {
+    trace.clear();
+    rewind(f);
+    if (!parseCapture(f)) {
+      fprintf(stderr, "%s: neither a trace nor a capture of the `trace` command\n", path);
+      fclose(f);
+      return false;
+    }
+  }
+  fclose(f);
+
+  TraceReader reader(trace.data(), trace.size());
+  TraceEvent event;
+  while (reader.next(event)) {
+    lastMs = event.ms;
+    switch (event.type) {
+      case TraceClock:    recorded.clock++;    timeline.push_back(event); break;
+      case TraceButton:   recorded.button++;   timeline.push_back(event); break;
+      case TraceSensor:   recorded.sensor++;   timeline.push_back(event); break;
+      case TraceResponse: recorded.response++; responses[event.key].push_back(event); break;
+      case TraceRandom:   recorded.random++;   draws.push_back(event.value); break;
+    }
+  }
+  if (reader.truncated()) fprintf(stderr, "# the trace ends in a partial record, replaying up to it\n");
+  return true;
+}
+
+void apply(const TraceEvent& e) {
+  switch (e.type) {
+    case TraceClock:
+      nativeSetEpoch((uint64_t)e.epoch * 1000 + e.epochMs);
+      break;
+    case TraceButton:
+      nativeSetPin(e.pin, e.level);
+      break;
+    case TraceSensor:
+      AppBus::post(SensorSample{ e.temperature, e.humidity, time(nullptr) });
+      break;
+    default:
+      break;
+  }
+}
+
+// With --realtime, wait until `us` of virtual time have passed in real time too
+void pace(uint64_t us) {
+  if (!realtime) return;
+  Clock::time_point due = realStart + std::chrono::microseconds(us);
+  Clock::time_point now = Clock::now();
+  if (due <= now) return;
+  std::this_thread::sleep_until(due);
+  slept += Clock::now() - now;
+}
+
+uint64_t virtualMicros() {
+  return nowUs;
+}
+
+// delay() on the virtual clock: the inputs due meanwhile go in at their time
+void virtualSleep(uint64_t us) {
+  uint64_t until = nowUs + us;
+  while (nextEvent < timeline.size() && (uint64_t)timeline[nextEvent].ms * 1000 <= until) {
+    uint64_t at = (uint64_t)timeline[nextEvent].ms * 1000;
+    if (at > nowUs) {
+      pace(at);
+      nowUs = at;
+    }
+    apply(timeline[nextEvent++]);
+  }
+  pace(until);
+  nowUs = until;
+}
+
+long replayedRandom(long min, long max) {
+  if (!draws.empty()) {
+    long value = draws.front();
+    draws.pop_front();
+    if (value >= min && value < max) {
+      servedDraws++;
+      return value;
+    }
+  }
+  unmatchedDraws++;
+  return max > min ? min + rand() % (max - min) : min;
+}
+
+std::string clockTime(uint64_t ms) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%02lu:%02lu:%02lu.%03lu", (unsigned long)(ms / 3600000),
+           (unsigned long)(ms / 60000 % 60), (unsigned long)(ms / 1000 % 60), (unsigned long)(ms % 1000));
+  return buf;
+}
+
+double msOf(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void usage() {
+  fprintf(stderr, "usage: replay [--realtime] [--tail SEC] [--quiet] TRACE\n");
+}
+
+}  // namespace
+
+bool replayResponse(const char* method, const char* path, TraceEvent& response) {
+  auto it = responses.find(Trace::requestKey(method, path));
+  if (it == responses.end() || it->second.empty()) {
+    unmatchedResponses++;
+    fprintf(stderr, "# %s %s at %s: no recorded response left\n", method, path,
+            clockTime(nowUs / 1000).c_str());
+    return false;
+  }
+  response = it->second.front();
+  it->second.pop_front();
+  servedResponses++;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  uint32_t tailMs = 60000;
+  bool quiet = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--realtime") realtime = true;
+    else if (arg == "--quiet") quiet = true;
+    else if (arg == "--tail" && i + 1 < argc) tailMs = (uint32_t)(atof(argv[++i]) * 1000);
+    else if (!path && arg[0] != '-') path = argv[i];
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (!path) {
+    usage();
+    return 2;
+  }
+  if (!load(path)) return 2;
+
+  uint64_t endUs = ((uint64_t)lastMs + tailMs) * 1000;
+  fprintf(stderr, "# %lu records up to %s: %lu clock, %lu button, %lu sensor, %lu response, %lu random\n",
+          (unsigned long)(timeline.size() + recorded.response + recorded.random), clockTime(lastMs).c_str(), (unsigned long)recorded.clock,
+          (unsigned long)recorded.button, (unsigned long)recorded.sensor,
+          (unsigned long)recorded.response, (unsigned long)recorded.random);
+
+  // A device boots with its clock at 0 and the buttons released
+  if (quiet) nativeSetSerialOutput(nullptr);
+  nativeSetClock(virtualMicros, virtualSleep);
+  nativeSetEpoch(0);
+  nativeSetRandom(replayedRandom);
+
+  realStart = Clock::now();
+  setup();
+
+  uint64_t passes = 0;
+  Clock::duration slowest(0);
+  uint64_t slowestAtMs = 0;
+  while (nowUs < endUs) {
+    uint64_t before = nowUs;
+    Clock::duration sleptBefore = slept;
+    Clock::time_point start = Clock::now();
+    loop();
+    Clock::duration took = Clock::now() - start - (slept - sleptBefore);
+    if (took > slowest) {
+      slowest = took;
+      slowestAtMs = before / 1000;
+    }
+    passes++;
+    // On the device a pass takes time; here one that never sleeps would spin forever
+    if (nowUs == before) virtualSleep(1000);
+  }
+  Clock::duration cpu = Clock::now() - realStart - slept;
+
+  size_t unusedResponses = 0;
+  for (const auto& entry : responses) unusedResponses += entry.second.size();
+  fprintf(stderr, "# replayed %s in %.0f ms of CPU: %llu loop() passes, slowest %.3f ms at %s\n",
+          clockTime(nowUs / 1000).c_str(), msOf(cpu), (unsigned long long)passes, msOf(slowest),
+          clockTime(slowestAtMs).c_str());
+  fprintf(stderr, "# responses: %lu served, %lu unmatched, %lu unused\n", (unsigned long)servedResponses,
+          (unsigned long)unmatchedResponses, (unsigned long)unusedResponses);
+  fprintf(stderr, "# random draws: %lu served, %lu unmatched, %lu unused\n", (unsigned long)servedDraws,
+          (unsigned long)unmatchedDraws, (unsigned long)draws.size());
+
+  bool diverged = unmatchedResponses || unusedResponses || unmatchedDraws || !draws.empty();
+  if (diverged) fprintf(stderr, "# the firmware diverged from the recording\n");
+  return diverged ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <core/Trace.h>
+
+// Between the replay engine (replay.cpp) and the replay's WifiModule
+// (replay_wifi.cpp).
+
+/**
+ * The next recorded outcome of `method path`, in the order the device got
+ * them; false once there are none left, which counts as a divergence.
+ */
+bool replayResponse(const char* method, const char* path, TraceEvent& response);
+
+#endif
@@ -0,0 +1,254 @@
+// Stand-ins for the drivers whose hardware a replay does not have. They
+// implement the real headers in src/hal, so main.cpp builds unchanged:
+//
+//   I2cBus       no devices; nothing is ever queued
+//   DHTDriver    reads do nothing; the engine posts the recorded samples
+//   TouchDriver  begin() fails, as on a clock without the CAP1188
+//   ImuDriver    begin() fails, as on a clock without the LSM6DSO
+//   DisplayDriver  paints StatusScreen into a sprite that draws nothing
+//   FlashStorage   blocks in RAM, so SensorHistory runs as on the device
+//   OtaUpdater     no slots: check() asks for the recorded response at once,
+//                  installs nothing and never restarts
+//
+// ButtonDriver, LEDDriver and BuzzerDriver are the real ones on the native
+// GPIO shim; the engine drives the button pins.
+
+#include <hal/DHTDriver.h>
+#include <hal/DisplayDriver.h>
+#include <hal/FlashStorage.h>
+#include <hal/I2cBus.h>
+#include <hal/ImuDriver.h>
+#include <hal/OtaUpdater.h>
+#include <hal/TouchDriver.h>
+#include <vector>
+
+extern WifiModule wifi;
+
+// ---- I2cBus ----
+
+I2cBus::I2cBus() : _deviceCount(0), _clockHz(FAST_MODE_HZ), _task(nullptr) {
+  _sync.store(nullptr);
+}
+
+bool I2cBus::begin(int, int) {
+  return true;
+}
+
+uint8_t I2cBus::addDevice(const char*, uint8_t, uint32_t) {
+  return INVALID_DEVICE;
+}
+
+bool I2cBus::submit(Priority, uint8_t, const uint8_t*, uint8_t, uint8_t*, uint8_t, I2cCallback, void*) {
+  return false;
+}
+
+bool I2cBus::writeRegisterAsync(Priority, uint8_t, uint8_t, uint8_t) {
+  return false;
+}
+
+bool I2cBus::transfer(uint8_t, const uint8_t*, uint8_t, uint8_t*, uint8_t) {
+  return false;
+}
+
+bool I2cBus::writeRegister(uint8_t, uint8_t, uint8_t) {
+  return false;
+}
+
+bool I2cBus::readRegister(uint8_t, uint8_t, uint8_t&) {
+  return false;
+}
+
+uint16_t I2cBus::dispatch() {
+  return 0;
+}
+
+// ---- DHTDriver ----
+
+DHTDriver::DHTDriver(I2cBus& bus)
+  : _bus(bus), _device(0), _state(Idle), _triggeredAt(0), _triggerFailed(false), _temperature(NAN),
+    _humidity(NAN) {}
+
+void DHTDriver::begin() {}
+
+bool DHTDriver::requestRead() {
+  return true;
+}
+
+void DHTDriver::update() {}
+
+float DHTDriver::getTemperature() {
+  return _temperature;
+}
+
+float DHTDriver::getHumidity() {
+  return _humidity;
+}
+
+// ---- TouchDriver ----
+
+TouchDriver::TouchDriver(I2cBus& bus, std::initializer_list<uint8_t>, uint8_t alertPin, uint8_t address)
+  : _bus(bus), _device(0), _address(address), _alertPin(alertPin), _numChannels(0), _state(0),
+    _mainControl(0), _ready(false), _busy(false), _status(0), _confirm(false), _confirmAt(0),
+    _transactions(0), _alerts(0), _pending(false) {}
+
+bool TouchDriver::begin() {
+  return false;
+}
+
+void TouchDriver::update() {}
+
+// ---- ImuDriver ----
+
+ImuDriver::ImuDriver(I2cBus& bus, uint8_t intPin, uint8_t address)
+  : _bus(bus), _device(0), _address(address), _intPin(intPin), _ready(false), _active(false),
+    _alarmActive(false), _busy(false), _bursts(0), _wakeSource(0), _scratch(0), _lastMotion(0),
+    _stats(), _pending(false) {}
+
+bool ImuDriver::begin() {
+  return false;
+}
+
+void ImuDriver::update() {}
+
+void ImuDriver::setAlarmActive(bool active) {
+  _alarmActive = active;
+}
+
+// ---- DisplayDriver ----
+
+// The band cost stays at the driver's initial estimate: virtual time does
+// not pass while painting, and StatusScreen's budgeting should match the device's
+DisplayDriver::DisplayDriver()
+  : _stripA(&_tft)
+  , _stripB(&_tft)
+  , _strips{&_stripA, &_stripB}
+  , _inFlight{false, false}
+  , _back(0)
+  , _ready(false)
+  , _dma(false)
+  , _background(TFT_BLACK)
+  , _frameStart(0)
+  , _frameBytes(0)
+  , _bandCostUs(3000)
+  , _stats()
+{}
+
+bool DisplayDriver::begin(uint16_t background) {
+  _background = background;
+  _ready = true;
+  return true;
+}
+
+void DisplayDriver::beginFrame() {
+  _frameStart = micros();
+}
+
+void DisplayDriver::renderRows(int16_t top, int16_t rows, DisplayPainter& painter) {
+  if (!_ready) return;
+  for (; rows > 0; top += STRIP_ROWS, rows -= STRIP_ROWS) {
+    painter.paint(*_strips[_back], top);
+    _back ^= 1;
+    _stats.bandsRendered++;
+  }
+}
+
+void DisplayDriver::endFrame(uint32_t budgetUs, uint8_t deferred) {
+  _stats.frames++;
+  _stats.lastFrameUs = micros() - _frameStart;
+  if (_stats.lastFrameUs > _stats.maxFrameUs) _stats.maxFrameUs = _stats.lastFrameUs;
+  if (_stats.lastFrameUs > budgetUs) _stats.overBudget++;
+  _stats.deferred += deferred;
+}
+
+// ---- FlashStorage ----
+
+static std::vector<uint8_t> areas[FlashStorage::MAX_AREAS];
+
+FlashStorage::FlashStorage(const char* directory) : _directory(directory), _mounted(false) {
+  for (uint8_t i = 0; i < MAX_AREAS; ++i) _blockSize[i] = 0;
+}
+
+bool FlashStorage::begin() {
+  _mounted = true;
+  return true;
+}
+
+// Zeros, like the never written blocks of a fresh file: the history starts empty
+bool FlashStorage::open(uint8_t area, uint16_t blocks, uint16_t blockSize) {
+  if (!_mounted || area >= MAX_AREAS) return false;
+  areas[area].assign((size_t)blocks * blockSize, 0);
+  _blockSize[area] = blockSize;
+  return true;
+}
+
+bool FlashStorage::read(uint8_t area, uint16_t block, uint8_t* buf, uint16_t len) {
+  if (area >= MAX_AREAS || !_blockSize[area] || len > _blockSize[area]) return false;
+  size_t offset = (size_t)block * _blockSize[area];
+  if (offset + len > areas[area].size()) return false;
+  memcpy(buf, areas[area].data() + offset, len);
+  return true;
+}
+
+bool FlashStorage::write(uint8_t area, uint16_t block, const uint8_t* buf) {
+  if (area >= MAX_AREAS || !_blockSize[area]) return false;
+  size_t offset = (size_t)block * _blockSize[area];
+  if (offset + _blockSize[area] > areas[area].size()) return false;
+  memcpy(areas[area].data() + offset, buf, _blockSize[area]);
+  return true;
+}
+
+size_t FlashStorage::usedBytes() const {
+  size_t used = 0;
+  for (uint8_t i = 0; i < MAX_AREAS; ++i) used += areas[i].size();
+  return used;
+}
+
+size_t FlashStorage::totalBytes() const {
+  return 1408 * 1024;  // the littlefs partition of the default 4 MB layout
+}
+
+// ---- OtaUpdater ----
+
+OtaUpdater::OtaUpdater(const char* serverHost, uint16_t serverPort, const char* endpointPath)
+  : _host(serverHost)
+  , _port(serverPort)
+  , _path(endpointPath)
+  , _trial(false)
+  , _imageLength(0)
+  , _hashed(false)
+  , _result()
+{
+  _busy.store(false);
+}
+
+void OtaUpdater::begin() {}
+
+// In line rather than in a task: the trace keys the response by path alone
+bool OtaUpdater::check() {
+  _result = OtaEvent();
+  _result.result = OtaEvent::Failed;
+  int status = wifi.httpGetStream(_host, _port, _path, *this, CONNECT_DEADLINE_MS);
+  _result.status = (int16_t)status;
+  AppBus::post(_result);
+  return true;
+}
+
+void OtaUpdater::confirm() {}
+
+void OtaUpdater::rollback() {}
+
+void OtaUpdater::restart() {}
+
+// A patch needs the device's image as its base; read it past and skip it
+bool OtaUpdater::onResponse(int status, Stream& body, int) {
+  if (status == 204) {
+    _result.result = OtaEvent::UpToDate;
+    return true;
+  }
+  if (status != 200) return false;
+  uint8_t chunk[256];
+  size_t n;
+  while ((n = body.readBytes(chunk, sizeof(chunk))) > 0) _result.patchBytes += n;
+  _result.result = OtaEvent::Skipped;
+  return true;
+}
@@ -0,0 +1,272 @@
+// The replay's WifiModule: every request gets the outcome the device got
+// for the same method and path, in the same order, after the recorded
+// latency of virtual time. There is no request task. Queued requests
+// complete from dispatch() once their latency has passed, and blocking
+// calls sleep it off, which lets the engine feed in the inputs due
+// meanwhile. A request the trace has no outcome for fails with
+// HTTPC_ERROR_CONNECTION_REFUSED and counts as a divergence.
+
+#include "replay.h"
+#include <core/GzipWriter.h>
+#include <hal/WifiModule.h>
+#include <HTTPClient.h>
+
+namespace {
+
+// Read-only Stream over a recorded body, for ResponseHandlers
+class BodyStream : public Stream {
+  public:
+    BodyStream(const uint8_t* data, size_t length) : _data(data), _length(length), _pos(0) {
+      setTimeout(0);
+    }
+    int available() override { return (int)(_length - _pos); }
+    int read() override { return _pos < _length ? _data[_pos++] : -1; }
+    int peek() override { return _pos < _length ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+  private:
+    const uint8_t* _data;
+    size_t         _length;
+    size_t         _pos;
+};
+
+class CountingSink : public ByteSink {
+  public:
+    CountingSink() : total(0) {}
+    bool write(const uint8_t*, size_t len) override {
+      total += len;
+      return true;
+    }
+    uint32_t total;
+};
+
+// A blocking call: the recorded outcome, after the recorded latency
+int exchange(const char* method, const char* path, String* responseBody, ResponseHandler* handler) {
+  TraceEvent r;
+  if (!replayResponse(method, path, r)) return HTTPC_ERROR_CONNECTION_REFUSED;
+  delay(r.latencyMs);
+  if (r.status <= 0) return r.status;
+  if (responseBody) {
+    *responseBody = "";
+    responseBody->concat((const char*)r.body, r.bodyLength);
+  }
+  if (handler) {
+    BodyStream body(r.body, r.bodyLength);
+    if (!handler->onResponse(r.status, body, (int)r.contentLength)) return WifiModule::HTTPC_ERROR_STREAM_REJECTED;
+  }
+  return r.status;
+}
+
+// The device runs a request's handler on its request task; here it runs
+// on the recorded body just before the completion is delivered
+void runHandler(const HttpRequest& request, HttpResponse& response) {
+  if (!request.handler) return;
+  if (response.status > 0) {
+    BodyStream body((const uint8_t*)response.body.c_str(), response.body.length());
+    if (!request.handler->onResponse(response.status, body, (int)response.contentLength)) {
+      response.status = WifiModule::HTTPC_ERROR_STREAM_REJECTED;
+    }
+  }
+  response.body = String();
+  response.truncated = false;
+}
+
+}  // namespace
+
+WifiModule::WifiModule(const char* ssid, const char* password)
+  : _ssid(ssid), _password(password) {
+  for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+    _slots[i].state.store(Unknown);
+    _slots[i].cancel.store(false);
+  }
+}
+
+// Wi-Fi is not in the trace; the recorded responses tell whether it was up
+bool WifiModule::begin(unsigned long) {
+  return true;
+}
+
+void WifiModule::enableTls(const uint8_t*) {}
+
+const TlsStats* WifiModule::tlsStats() const {
+  return nullptr;
+}
+
+int WifiModule::httpGet(const char*, uint16_t, const char* path, String& responseBody, uint32_t) {
+  return exchange("GET", path, &responseBody, nullptr);
+}
+
+int WifiModule::httpGetStream(const char*, uint16_t, const char* path, ResponseHandler& handler, uint32_t) {
+  return exchange("GET", path, nullptr, &handler);
+}
+
+int WifiModule::httpPost(const char*, uint16_t, const char* path, const char*, String& responseBody, uint32_t) {
+  return exchange("POST", path, &responseBody, nullptr);
+}
+
+int WifiModule::httpPost(const char*, uint16_t, const char* path, const uint8_t*, size_t, const char*,
+                         String& responseBody, uint32_t) {
+  return exchange("POST", path, &responseBody, nullptr);
+}
+
+int WifiModule::httpPostStream(const char*, uint16_t, const char* path, const char*, BodySource& body,
+                               bool gzip, String& responseBody, uint32_t) {
+  CountingSink wire;
+  if (gzip) {
+    GzipWriter compressor(wire);
+    body.writeTo(compressor);
+    compressor.finish();
+    _streamBytesIn = compressor.bytesIn();
+  } else {
+    body.writeTo(wire);
+    _streamBytesIn = wire.total;
+  }
+  _streamBytesOut = wire.total;
+  return exchange("POST", path, &responseBody, nullptr);
+}
+
+HttpRequest HttpRequest::get(const char* host, uint16_t port, const char* path) {
+  HttpRequest r = { "GET", host, port, path, nullptr, nullptr, 0, nullptr, false, 0, 0, nullptr };
+  return r;
+}
+
+HttpRequest HttpRequest::post(const char* host, uint16_t port, const char* path,
+                              const char* contentType, const uint8_t* body, size_t length) {
+  HttpRequest r = { "POST", host, port, path, contentType, body, length, nullptr, false, 0, 0, nullptr };
+  return r;
+}
+
+HttpRequest HttpRequest::postStream(const char* host, uint16_t port, const char* path,
+                                    const char* contentType, BodySource& source, bool gzip) {
+  HttpRequest r = { "POST", host, port, path, contentType, nullptr, 0, &source, gzip, 0, 0, nullptr };
+  return r;
+}
+
+// The outcome is looked up right away and held back until its latency has passed
+WifiModule::Handle WifiModule::submit(const HttpRequest& request, HttpCallback callback, void* context) {
+  uint8_t index = 0;
+  while (index < MAX_IN_FLIGHT && _slots[index].state.load() != Unknown) index++;
+  if (index == MAX_IN_FLIGHT || request.length > MAX_INLINE_BODY) {
+    _requestStats.rejected++;
+    return INVALID_HANDLE;
+  }
+
+  Slot& slot = _slots[index];
+  _nextHandle = _nextHandle % (0xFFFF / MAX_IN_FLIGHT) + 1;
+  slot.handle = _nextHandle * MAX_IN_FLIGHT + index;
+  slot.seq = _nextSeq++;
+  slot.request = request;
+  slot.callback = callback;
+  slot.context = context;
+  slot.submittedMs = millis();
+  slot.response = HttpResponse();
+  slot.response.handle = slot.handle;
+  slot.response.bytesIn = request.length;
+
+  // The body is produced as on the device, so the encoders count in the profile
+  if (request.source) {
+    CountingSink wire;
+    if (request.gzip) {
+      GzipWriter compressor(wire);
+      request.source->writeTo(compressor);
+      compressor.finish();
+      slot.response.bytesIn = compressor.bytesIn();
+    } else {
+      request.source->writeTo(wire);
+      slot.response.bytesIn = wire.total;
+    }
+    slot.response.bytesOut = wire.total;
+  } else {
+    slot.response.bytesOut = request.length;
+  }
+
+  TraceEvent r;
+  if (replayResponse(request.method, request.path, r)) {
+    slot.response.status = r.status;
+    slot.response.body.concat((const char*)r.body, r.bodyLength);
+    slot.response.contentLength = r.contentLength;
+    slot.response.truncated = r.flags & TRACE_BODY_TRUNCATED;
+    slot.response.latencyMs = r.latencyMs;
+  } else {
+    slot.response.status = HTTPC_ERROR_CONNECTION_REFUSED;
+    slot.response.contentLength = -1;
+  }
+  slot.cancel.store(false);
+  slot.state.store(Queued);
+  _requestStats.submitted++;
+  return slot.handle;
+}
+
+WifiModule::Slot* WifiModule::_find(Handle handle) const {
+  if (handle == INVALID_HANDLE) return nullptr;
+  Slot* slot = const_cast<Slot*>(&_slots[handle % MAX_IN_FLIGHT]);
+  if (slot->handle != handle || slot->state.load() == Unknown) return nullptr;
+  if (slot->state.load() == Queued && millis() - slot->submittedMs >= slot->response.latencyMs) {
+    slot->state.store(Done);
+  }
+  return slot;
+}
+
+WifiModule::RequestState WifiModule::state(Handle handle) const {
+  Slot* slot = _find(handle);
+  if (!slot || slot->cancel.load()) return Unknown;
+  return (RequestState)slot->state.load();
+}
+
+bool WifiModule::take(Handle handle, HttpResponse& response) {
+  Slot* slot = _find(handle);
+  if (!slot || slot->state.load() != Done) return false;
+  bool cancelled = slot->cancel.load();
+  if (!cancelled) {
+    response = std::move(slot->response);
+    runHandler(slot->request, response);
+  }
+  slot->state.store(Unknown);
+  return !cancelled;
+}
+
+bool WifiModule::cancel(Handle handle) {
+  Slot* slot = _find(handle);
+  if (!slot || slot->cancel.load()) return false;
+  if (slot->state.load() == Queued) {
+    slot->state.store(Unknown);
+  } else {
+    slot->cancel.store(true);
+  }
+  _requestStats.cancelled++;
+  return true;
+}
+
+uint8_t WifiModule::dispatch() {
+  for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) _find(_slots[i].handle);
+
+  uint8_t delivered = 0;
+  for (;;) {
+    Slot* next = nullptr;
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+      Slot& slot = _slots[i];
+      if (slot.state.load() != Done) continue;
+      if (!slot.callback && !slot.cancel.load()) continue;
+      if (!next || (int32_t)(slot.seq - next->seq) < 0) next = &slot;
+    }
+    if (!next) return delivered;
+
+    bool cancelled = next->cancel.load();
+    HttpCallback callback = next->callback;
+    void* context = next->context;
+    HttpResponse response(std::move(next->response));
+    if (!cancelled) runHandler(next->request, response);
+    next->state.store(Unknown);
+    if (cancelled) continue;
+    callback(context, response);
+    delivered++;
+  }
+}
+
+uint8_t WifiModule::inFlight() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+    if (_slots[i].state.load() != Unknown) count++;
+  }
+  return count;
+}
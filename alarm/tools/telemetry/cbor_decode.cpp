@@ -0,0 +1,156 @@
+// Reference decoder for the CBOR telemetry produced by CborEncoder.
+//
+// Reads one or more concatenated CBOR items from a file (or stdin) and
+// prints each as a line of JSON. With --records, the fixed-point sensor
+// fields ("t", "h") are scaled back to floats and "ts" is expanded to an
+// ISO-8601 UTC string, which is what a backend would store.
+//
+//   g++ -std=c++11 -O2 -o cbor_decode tools/telemetry/cbor_decode.cpp
+//   ./cbor_decode [--records] [file]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Reader {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok;
+
+  bool need(size_t n) {
+    if (!ok || (size_t)(end - p) < n) ok = false;
+    return ok;
+  }
+};
+
+bool readHead(Reader& r, uint8_t& major, uint64_t& value) {
+  if (!r.need(1)) return false;
+  uint8_t ib = *r.p++;
+  major = ib >> 5;
+  uint8_t info = ib & 0x1F;
+  if (info < 24) { value = info; return true; }
+  size_t n = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0;
+  if (n == 0 || !r.need(n)) { r.ok = false; return false; }  // indefinite lengths unsupported
+  value = 0;
+  for (size_t i = 0; i < n; ++i) value = (value << 8) | *r.p++;
+  return true;
+}
+
+std::string quote(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') { out += '\\'; out += c; }
+    else if ((unsigned char)c < 0x20) { char b[8]; snprintf(b, sizeof(b), "\\u%04x", c); out += b; }
+    else out += c;
+  }
+  return out + "\"";
+}
+
+std::string isoTime(uint64_t epoch) {
+  time_t t = (time_t)epoch;
+  struct tm tmv;
+  gmtime_r(&t, &tmv);
+  char b[32];
+  strftime(b, sizeof(b), "%Y-%m-%dT%H:%M:%SZ", &tmv);
+  return quote(b);
+}
+
+std::string decodeItem(Reader& r, bool records, const std::string& key, int depth);
+
+std::string scaled(const std::string& key, bool negative, uint64_t raw, bool records) {
+  char b[32];
+  if (records && (key == "t" || key == "h")) {
+    double v = negative ? -1.0 - (double)raw : (double)raw;
+    snprintf(b, sizeof(b), "%.2f", v / 100.0);
+    return b;
+  }
+  if (records && key == "ts" && !negative) return isoTime(raw);
+  if (negative) snprintf(b, sizeof(b), "-%llu", (unsigned long long)raw + 1);
+  else          snprintf(b, sizeof(b), "%llu", (unsigned long long)raw);
+  return b;
+}
+
+std::string decodeItem(Reader& r, bool records, const std::string& key, int depth) {
+  uint8_t major;
+  uint64_t value;
+  if (depth > 16 || !readHead(r, major, value)) { r.ok = false; return ""; }
+  switch (major) {
+    case 0: return scaled(key, false, value, records);
+    case 1: return scaled(key, true, value, records);
+    case 2:
+    case 3: {
+      if (!r.need(value)) return "";
+      std::string s((const char*)r.p, (size_t)value);
+      r.p += value;
+      if (major == 3) return quote(s);
+      std::string hex = "\"h'";
+      for (unsigned char c : s) { char b[3]; snprintf(b, sizeof(b), "%02x", c); hex += b; }
+      return hex + "'\"";
+    }
+    case 4: {
+      std::string out = "[";
+      for (uint64_t i = 0; i < value && r.ok; ++i) {
+        if (i) out += ",";
+        out += decodeItem(r, records, "", depth + 1);
+      }
+      return out + "]";
+    }
+    case 5: {
+      std::string out = "{";
+      for (uint64_t i = 0; i < value && r.ok; ++i) {
+        if (i) out += ",";
+        uint8_t km;
+        uint64_t klen;
+        if (!readHead(r, km, klen) || km != 3 || !r.need(klen)) { r.ok = false; return ""; }
+        std::string k((const char*)r.p, (size_t)klen);
+        r.p += klen;
+        out += quote(k) + ":" + decodeItem(r, records, k, depth + 1);
+      }
+      return out + "}";
+    }
+    case 7:
+      if (value == 20) return "false";
+      if (value == 21) return "true";
+      if (value == 22) return "null";
+      r.ok = false;  // floats are never emitted by the firmware
+      return "";
+    default:
+      r.ok = false;  // tags unsupported
+      return "";
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool records = false;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--records") == 0) records = true;
+    else path = argv[i];
+  }
+
+  FILE* in = path ? fopen(path, "rb") : stdin;
+  if (!in) { perror(path); return 2; }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) data.insert(data.end(), chunk, chunk + n);
+  if (path) fclose(in);
+
+  Reader r = { data.data(), data.data() + data.size(), true };
+  while (r.p < r.end) {
+    std::string json = decodeItem(r, records, "", 0);
+    if (!r.ok) {
+      fprintf(stderr, "malformed CBOR at offset %ld\n", (long)(r.p - data.data()));
+      return 1;
+    }
+    printf("%s\n", json.c_str());
+  }
+  return 0;
+}
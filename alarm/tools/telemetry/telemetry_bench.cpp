@@ -0,0 +1,80 @@
+// Host benchmark: payload size and encode time of JsonEncoder vs CborEncoder.
+//
+//   g++ -std=c++11 -O2 -Isrc -o telemetry_bench tools/telemetry/telemetry_bench.cpp src/core/TelemetryEncoder.cpp
+//   ./telemetry_bench [iterations] [--dump sensor.cbor]
+//
+// --dump writes a few CBOR sensor records back to back, for feeding into
+// cbor_decode.
+
+#include <core/TelemetryEncoder.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+volatile size_t sink;  // keeps the optimizer from dropping the encode calls
+
+template <typename Record>
+double nsPerEncode(const TelemetryEncoder& enc, const Record* records, size_t count,
+                   long iterations, size_t& bytes) {
+  uint8_t buf[TELEMETRY_MAX_RECORD];
+  bytes = 0;
+  for (size_t i = 0; i < count; ++i) bytes += enc.encode(records[i], buf, sizeof(buf));
+
+  auto start = std::chrono::steady_clock::now();
+  for (long it = 0; it < iterations; ++it) {
+    sink += enc.encode(records[it % count], buf, sizeof(buf));
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+template <typename Record>
+void report(const char* name, const Record* records, size_t count, long iterations) {
+  JsonEncoder json;
+  CborEncoder cbor;
+  size_t jsonBytes, cborBytes;
+  double jsonNs = nsPerEncode(json, records, count, iterations, jsonBytes);
+  double cborNs = nsPerEncode(cbor, records, count, iterations, cborBytes);
+  printf("%-8s json  %6.1f B/rec  %7.1f ns/rec\n", name, (double)jsonBytes / count, jsonNs);
+  printf("%-8s cbor  %6.1f B/rec  %7.1f ns/rec   (%.2fx smaller, %.2fx faster)\n",
+         name, (double)cborBytes / count, cborNs,
+         (double)jsonBytes / cborBytes, jsonNs / cborNs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long iterations = 1000000;
+  const char* dumpPath = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) dumpPath = argv[++i];
+    else iterations = atol(argv[i]);
+  }
+
+  const size_t N = 64;
+  SensorRecord sensors[N];
+  MetricsRecord metrics[N];
+  srand(1);
+  for (size_t i = 0; i < N; ++i) {
+    uint32_t ts = 1746000000u + (uint32_t)i * 300;
+    sensors[i] = { ts, toCenti(18.0f + (rand() % 1000) / 100.0f),
+                   toCentiUnsigned(30.0f + (rand() % 4000) / 100.0f) };
+    metrics[i] = { ts, (uint8_t)(1 + rand() % 4), (uint32_t)(800 + rand() % 6000) };
+  }
+
+  report("sensor", sensors, N, iterations);
+  report("metrics", metrics, N, iterations);
+
+  if (dumpPath) {
+    FILE* out = fopen(dumpPath, "wb");
+    if (!out) { perror(dumpPath); return 1; }
+    CborEncoder cbor;
+    uint8_t buf[TELEMETRY_MAX_RECORD];
+    for (size_t i = 0; i < 4; ++i) fwrite(buf, 1, cbor.encode(sensors[i], buf, sizeof(buf)), out);
+    fclose(out);
+  }
+  return 0;
+}
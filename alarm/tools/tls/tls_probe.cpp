@@ -0,0 +1,121 @@
+// TLS handshake probe for the backend (or a local test server).
+//
+// Connects repeatedly to host:port with TLS 1.2 (what the ESP32's mbedTLS
+// speaks), reusing the session after the first connection, and reports
+// handshake time and bytes on the wire for full vs. resumed handshakes. It
+// also prints the server's public key pin in the form BACKEND_TLS_PIN
+// expects in credentials.h.
+//
+//   g++ -std=c++11 -O2 -o tls_probe tools/tls/tls_probe.cpp -lssl -lcrypto
+//   ./tls_probe host port [connections] [--no-tickets]
+//
+// --no-tickets disables session tickets, so resumption has to use a
+// server-side session ID cache.
+
+#include <netdb.h>
+#include <openssl/err.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+
+namespace {
+
+int tcpConnect(const char* host, const char* port) {
+  addrinfo hints, *res;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+  int fd = socket(res->ai_family, res->ai_socktype, 0);
+  if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+void printPin(SSL* ssl) {
+  X509* cert = SSL_get1_peer_certificate(ssl);
+  if (!cert) return;
+  unsigned char* der = nullptr;
+  int len = i2d_X509_PUBKEY(X509_get_X509_PUBKEY(cert), &der);
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256(der, len, digest);
+  printf("#define BACKEND_TLS_PIN {");
+  for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) printf("%s0x%02x", i ? ", " : "", digest[i]);
+  printf("}\n");
+  OPENSSL_free(der);
+  X509_free(cert);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s host port [connections] [--no-tickets]\n", argv[0]);
+    return 2;
+  }
+  const char* host = argv[1];
+  const char* port = argv[2];
+  int connections = 5;
+  bool tickets = true;
+  for (int i = 3; i < argc; ++i) {
+    if (!strcmp(argv[i], "--no-tickets")) tickets = false;
+    else connections = atoi(argv[i]);
+  }
+
+  SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);  // trust is established by the pin
+  if (!tickets) SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+
+  SSL_SESSION* session = nullptr;
+  double fullUs = 0, resumedUs = 0;
+  long fullBytes = 0, resumedBytes = 0;
+  int fullCount = 0, resumedCount = 0;
+
+  for (int i = 0; i < connections; ++i) {
+    int fd = tcpConnect(host, port);
+    if (fd < 0) { perror("connect"); return 1; }
+
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, host);
+    if (session) SSL_set_session(ssl, session);
+
+    auto start = std::chrono::steady_clock::now();
+    if (SSL_connect(ssl) != 1) {
+      ERR_print_errors_fp(stderr);
+      return 1;
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    BIO* bio = SSL_get_rbio(ssl);
+    long tx = (long)BIO_number_written(bio);
+    long rx = (long)BIO_number_read(bio);
+    bool resumed = SSL_session_reused(ssl);
+
+    printf("#%d %-7s %8.0f us  tx %5ld B  rx %5ld B\n", i + 1, resumed ? "resumed" : "full", us, tx, rx);
+    if (i == 0) printPin(ssl);
+    if (resumed) { resumedUs += us; resumedBytes += tx + rx; resumedCount++; }
+    else         { fullUs += us; fullBytes += tx + rx; fullCount++; }
+
+    if (session) SSL_SESSION_free(session);
+    session = SSL_get1_session(ssl);
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(fd);
+  }
+
+  if (fullCount)    printf("full:    %d x, avg %.0f us, %ld B\n", fullCount, fullUs / fullCount, fullBytes / fullCount);
+  if (resumedCount) printf("resumed: %d x, avg %.0f us, %ld B\n", resumedCount, resumedUs / resumedCount, resumedBytes / resumedCount);
+  if (session) SSL_SESSION_free(session);
+  SSL_CTX_free(ctx);
+  return 0;
+}
@@ -0,0 +1,190 @@
+// Local HTTP sink for testing WifiModule::httpPostStream() uploads.
+//
+// Accepts POSTs with Content-Length or chunked bodies, inflates
+// Content-Encoding: gzip, and answers with the CRC-32 and sizes of what it
+// received so a client can verify the round trip:
+//   {"raw":<bytes>,"wire":<bytes>,"crc32":"<hex>","encoding":"gzip|identity"}
+// Every request is also logged as one line on stdout.
+//
+//   g++ -std=c++11 -O2 -o gzip_sink tools/upload/gzip_sink.cpp -lz
+//   ./gzip_sink [port] [--reject-gzip] [--dump dir]
+//
+// --reject-gzip answers 415 to compressed bodies, to exercise the
+// fallback in TelemetryEndpoint. --dump writes each decoded body to dir.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <string>
+
+namespace {
+
+struct Conn {
+  int fd;
+  std::string buf;  // received but not yet consumed
+
+  bool fill() {
+    char tmp[4096];
+    ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+    if (n <= 0) return false;
+    buf.append(tmp, (size_t)n);
+    return true;
+  }
+
+  bool line(std::string& out) {
+    size_t eol;
+    while ((eol = buf.find("\r\n")) == std::string::npos) {
+      if (!fill()) return false;
+    }
+    out = buf.substr(0, eol);
+    buf.erase(0, eol + 2);
+    return true;
+  }
+
+  bool take(size_t n, std::string& out) {
+    while (buf.size() < n) {
+      if (!fill()) return false;
+    }
+    out.append(buf, 0, n);
+    buf.erase(0, n);
+    return true;
+  }
+};
+
+bool gunzip(const std::string& in, std::string& out) {
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) return false;
+  z.next_in = (Bytef*)in.data();
+  z.avail_in = (uInt)in.size();
+  char tmp[16384];
+  int rc;
+  do {
+    z.next_out = (Bytef*)tmp;
+    z.avail_out = sizeof(tmp);
+    rc = inflate(&z, Z_NO_FLUSH);
+    out.append(tmp, sizeof(tmp) - z.avail_out);
+  } while (rc == Z_OK);
+  inflateEnd(&z);
+  return rc == Z_STREAM_END;
+}
+
+void respond(int fd, int status, const char* reason, const std::string& body) {
+  char head[256];
+  int n = snprintf(head, sizeof(head),
+                   "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                   "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                   status, reason, body.size());
+  send(fd, head, n, 0);
+  send(fd, body.data(), body.size(), 0);
+}
+
+void handle(int fd, bool rejectGzip, const char* dumpDir, unsigned long seq) {
+  Conn c = { fd, std::string() };
+  std::string requestLine, header;
+  if (!c.line(requestLine)) return;
+
+  long contentLength = -1;
+  bool chunked = false, gzip = false;
+  std::string contentType = "-";
+  while (c.line(header) && !header.empty()) {
+    size_t colon = header.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = header.substr(0, colon);
+    std::string value = header.substr(header.find_first_not_of(' ', colon + 1));
+    if (!strcasecmp(name.c_str(), "Content-Length")) contentLength = atol(value.c_str());
+    if (!strcasecmp(name.c_str(), "Transfer-Encoding")) chunked = value.find("chunked") != std::string::npos;
+    if (!strcasecmp(name.c_str(), "Content-Encoding")) gzip = value.find("gzip") != std::string::npos;
+    if (!strcasecmp(name.c_str(), "Content-Type")) contentType = value;
+  }
+
+  std::string wire;
+  if (chunked) {
+    std::string sizeLine, crlf;
+    for (;;) {
+      if (!c.line(sizeLine)) return;
+      size_t n = strtoul(sizeLine.c_str(), nullptr, 16);
+      if (n == 0) { c.line(crlf); break; }
+      if (!c.take(n, wire) || !c.line(crlf)) return;
+    }
+  } else if (contentLength > 0) {
+    if (!c.take((size_t)contentLength, wire)) return;
+  }
+
+  if (gzip && rejectGzip) {
+    printf("%s  415 (gzip rejected)\n", requestLine.c_str());
+    respond(fd, 415, "Unsupported Media Type", "{\"error\":\"gzip not accepted\"}");
+    return;
+  }
+
+  std::string raw;
+  if (gzip) {
+    if (!gunzip(wire, raw)) {
+      printf("%s  400 (corrupt gzip, %zu wire bytes)\n", requestLine.c_str(), wire.size());
+      respond(fd, 400, "Bad Request", "{\"error\":\"corrupt gzip\"}");
+      return;
+    }
+  } else {
+    raw = wire;
+  }
+
+  unsigned long crc = crc32(0L, (const Bytef*)raw.data(), (uInt)raw.size());
+  printf("%s  %s %s  wire=%zu raw=%zu ratio=%.2f crc32=%08lx%s\n",
+         requestLine.c_str(), contentType.c_str(), gzip ? "gzip" : "identity",
+         wire.size(), raw.size(), wire.empty() ? 0.0 : (double)raw.size() / wire.size(), crc,
+         chunked ? " chunked" : "");
+  fflush(stdout);
+
+  if (dumpDir) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/body-%04lu.bin", dumpDir, seq);
+    FILE* f = fopen(path, "wb");
+    if (f) { fwrite(raw.data(), 1, raw.size(), f); fclose(f); }
+  }
+
+  char body[160];
+  snprintf(body, sizeof(body), "{\"raw\":%zu,\"wire\":%zu,\"crc32\":\"%08lx\",\"encoding\":\"%s\"}",
+           raw.size(), wire.size(), crc, gzip ? "gzip" : "identity");
+  respond(fd, 200, "OK", body);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int port = 5000;
+  bool rejectGzip = false;
+  const char* dumpDir = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--reject-gzip")) rejectGzip = true;
+    else if (!strcmp(argv[i], "--dump") && i + 1 < argc) dumpDir = argv[++i];
+    else port = atoi(argv[i]);
+  }
+
+  int srv = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(srv, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(srv, 16) < 0) {
+    perror("bind/listen");
+    return 1;
+  }
+  printf("gzip_sink listening on :%d%s\n", port, rejectGzip ? " (rejecting gzip)" : "");
+  fflush(stdout);
+
+  for (unsigned long seq = 0;; ++seq) {
+    int fd = accept(srv, nullptr, nullptr);
+    if (fd < 0) continue;
+    handle(fd, rejectGzip, dumpDir, seq);
+    close(fd);
+  }
+}